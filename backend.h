@@ -0,0 +1,77 @@
+#ifndef BACKEND_H
+#define BACKEND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "drag.h"
+#include "frame.h"
+#include "notify.h"
+#include "topology.h"
+
+// Platform backend: everything the switching, drag and dispatch logic needs
+// from the operating system. backend_cg.c talks to CoreGraphics;
+// backend_sim.c is an in-memory simulation used by the benchmarks.
+
+// Which window a move applies to
+typedef enum {
+    WINDOW_UNDER_CURSOR = 0,
+    WINDOW_FOCUSED,
+} WindowPick;
+
+// A window found for a move; the handle belongs to the backend until
+// windowRelease().
+typedef struct {
+    void    *handle;
+    TopoRect frame;           // global coordinates, in points
+    uint32_t id;              // window server id (0 = unknown)
+    int32_t  owner;           // owning process
+} BackendWindow;
+
+typedef struct Backend {
+    const char *name;
+
+    // Enumerate active displays into a malloc'ed array the caller frees.
+    bool (*displays)(struct Backend *backend, DisplayInfo **displays, uint32_t *count);
+
+    bool (*cursorGet)(struct Backend *backend, TopoPoint *point);
+    void (*cursorSet)(struct Backend *backend, TopoPoint point);
+
+    // Post one synthetic left-button mouse event (drag thread).
+    void (*postMouse)(struct Backend *backend, DragEventType type, TopoPoint point);
+
+    // Window relocation (window mover thread). windowFind() looks up the
+    // focused window or the one at `point`; windowSetFrame() applies a new
+    // frame in one step (the size only changes when it differs).
+    bool (*windowFind)(struct Backend *backend, WindowPick pick, TopoPoint point, BackendWindow *window);
+    // All ordinary on-screen windows, front to back, in one query, as a
+    // malloc'ed array the caller frees after releasing each window.
+    bool (*windowList)(struct Backend *backend, BackendWindow **windows, uint32_t *count);
+    bool (*windowSetFrame)(struct Backend *backend, BackendWindow *window, TopoRect frame);
+    void (*windowRelease)(struct Backend *backend, BackendWindow *window);
+
+    // Menu bar and Dock space on a display, current at the time of the call.
+    FrameInsets (*displayInsets)(struct Backend *backend, const DisplayInfo *display);
+
+    // Show a notification; must not block (tap thread).
+    void (*notify)(struct Backend *backend, const NotifyEvent *event);
+
+    // Stop the main loop (exit hotkey).
+    void (*quit)(struct Backend *backend);
+
+    // Monotonic time in ns (statsNowNs() time base for real backends).
+    uint64_t (*now)(struct Backend *backend);
+
+    // One-shot timer: run fn(arg) at time `at` on the thread that dispatches
+    // keys. Replaces any timer armed before; fn == NULL just cancels.
+    void (*schedule)(struct Backend *backend, uint64_t at, void (*fn)(void *arg), void *arg);
+
+    void *context;
+} Backend;
+
+#ifdef __APPLE__
+// CoreGraphics implementation
+Backend *backendCoreGraphics(void);
+#endif
+
+#endif // BACKEND_H
@@ -0,0 +1,352 @@
+#include <ApplicationServices/ApplicationServices.h>
+#include <Carbon/Carbon.h>
+#include <mach/mach_time.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "backend.h"
+#include "log.h"
+#include "stats.h"
+
+// Query the WindowServer for the active displays (any number of them)
+static bool cgDisplays(Backend *backend, DisplayInfo **out, uint32_t *count) {
+    (void)backend;
+    uint32_t displayCount = 0;
+    CGError err = CGGetActiveDisplayList(0, NULL, &displayCount);
+    if (err != kCGErrorSuccess || displayCount == 0) {
+        return false;
+    }
+    CGDirectDisplayID *displays = malloc(displayCount * sizeof(*displays));
+    DisplayInfo *infos = malloc(displayCount * sizeof(*infos));
+    if (!displays || !infos ||
+        CGGetActiveDisplayList(displayCount, displays, &displayCount) != kCGErrorSuccess) {
+        free(displays);
+        free(infos);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < displayCount; ++i) {
+        CGRect bounds = CGDisplayBounds(displays[i]);
+        infos[i].id = displays[i];
+        infos[i].bounds = (TopoRect){ bounds.origin.x, bounds.origin.y, bounds.size.width, bounds.size.height };
+        infos[i].scale = 1.0;
+        // Physical size from the display's EDID; zero when it does not report one
+        CGSize size = CGDisplayScreenSize(displays[i]);
+        infos[i].widthMm = size.width;
+        infos[i].heightMm = size.height;
+        CGDisplayModeRef mode = CGDisplayCopyDisplayMode(displays[i]);
+        if (mode) {
+            size_t points = CGDisplayModeGetWidth(mode);
+            if (points > 0) infos[i].scale = (double)CGDisplayModeGetPixelWidth(mode) / (double)points;
+            CGDisplayModeRelease(mode);
+        }
+    }
+    free(displays);
+    *out = infos;
+    *count = displayCount;
+    return true;
+}
+
+// Only for actions that do not come with a key event (control socket,
+// coalescing timer): key presses pass the position the event carries.
+static bool cgCursorGet(Backend *backend, TopoPoint *point) {
+    (void)backend;
+    CGEventRef mouseEvent = CGEventCreate(NULL);
+    if (mouseEvent == NULL) {
+        return false;
+    }
+    CGPoint location = CGEventGetLocation(mouseEvent);
+    CFRelease(mouseEvent);
+    *point = (TopoPoint){ location.x, location.y };
+    return true;
+}
+
+static void cgCursorSet(Backend *backend, TopoPoint point) {
+    (void)backend;
+    CGWarpMouseCursorPosition(CGPointMake(point.x, point.y));
+    CGAssociateMouseAndMouseCursorPosition(true);
+}
+
+// One event per button transition, created on first use and reposted with
+// a new location and timestamp: a drag no longer allocates an event for
+// every frame. Only the drag thread posts, so no locking; they live as long
+// as the process.
+static CGEventRef gMouseEvents[DRAG_MOUSE_UP + 1];
+
+static void cgPostMouse(Backend *backend, DragEventType type, TopoPoint point) {
+    (void)backend;
+    static const CGEventType eventTypes[] = {
+        [DRAG_MOUSE_DOWN] = kCGEventLeftMouseDown,
+        [DRAG_MOUSE_DRAGGED] = kCGEventLeftMouseDragged,
+        [DRAG_MOUSE_UP] = kCGEventLeftMouseUp,
+    };
+    CGEventRef event = gMouseEvents[type];
+    if (event == NULL) {
+        event = gMouseEvents[type] = CGEventCreateMouseEvent(
+            NULL, eventTypes[type],
+            CGPointMake(point.x, point.y), kCGMouseButtonLeft
+        );
+        if (event == NULL) {
+            LOG_ERROR("Failed to create mouse event");
+            return;
+        }
+    } else {
+        CGEventSetLocation(event, CGPointMake(point.x, point.y));
+        CGEventSetTimestamp(event, mach_absolute_time());
+    }
+    CGEventPost(kCGSessionEventTap, event);
+}
+
+// Window lookup and placement through the accessibility API. Every call is
+// a round trip to the window's application; the messaging timeout bounds
+// how long an unresponsive one can hold up the mover thread.
+#define AX_TIMEOUT_SECONDS 0.25f
+
+static AXUIElementRef gSystemWide = NULL;
+static pthread_once_t gSystemWideOnce = PTHREAD_ONCE_INIT;
+
+static void createSystemWide(void) {
+    gSystemWide = AXUIElementCreateSystemWide();
+    if (gSystemWide) AXUIElementSetMessagingTimeout(gSystemWide, AX_TIMEOUT_SECONDS);
+}
+
+static CFTypeRef copyAttribute(AXUIElementRef element, CFStringRef attribute) {
+    CFTypeRef value = NULL;
+    if (AXUIElementCopyAttributeValue(element, attribute, &value) != kAXErrorSuccess) return NULL;
+    return value;
+}
+
+static bool windowFrame(AXUIElementRef window, TopoRect *frame) {
+    CGPoint position;
+    CGSize size;
+    AXValueRef positionValue = copyAttribute(window, kAXPositionAttribute);
+    AXValueRef sizeValue = copyAttribute(window, kAXSizeAttribute);
+    bool ok = positionValue && sizeValue &&
+              AXValueGetValue(positionValue, kAXValueCGPointType, &position) &&
+              AXValueGetValue(sizeValue, kAXValueCGSizeType, &size);
+    if (positionValue) CFRelease(positionValue);
+    if (sizeValue) CFRelease(sizeValue);
+    if (ok) *frame = (TopoRect){ position.x, position.y, size.width, size.height };
+    return ok;
+}
+
+static bool cgWindowFind(Backend *backend, WindowPick pick, TopoPoint point, BackendWindow *out) {
+    (void)backend;
+    pthread_once(&gSystemWideOnce, createSystemWide);
+    if (!gSystemWide) return false;
+
+    AXUIElementRef window = NULL;
+    if (pick == WINDOW_FOCUSED) {
+        AXUIElementRef app = (AXUIElementRef)copyAttribute(gSystemWide, kAXFocusedApplicationAttribute);
+        if (app) {
+            window = (AXUIElementRef)copyAttribute(app, kAXFocusedWindowAttribute);
+            CFRelease(app);
+        }
+    } else {
+        AXUIElementRef element = NULL;
+        if (AXUIElementCopyElementAtPosition(gSystemWide, (float)point.x, (float)point.y, &element) == kAXErrorSuccess) {
+            // The element is usually a control inside the window
+            CFTypeRef role = copyAttribute(element, kAXRoleAttribute);
+            if (role && CFEqual(role, kAXWindowRole)) {
+                window = element;
+                element = NULL;
+            } else {
+                window = (AXUIElementRef)copyAttribute(element, kAXWindowAttribute);
+            }
+            if (role) CFRelease(role);
+            if (element) CFRelease(element);
+        }
+    }
+    if (!window) return false;
+    if (!windowFrame(window, &out->frame)) {
+        CFRelease(window);
+        return false;
+    }
+    out->handle = (void *)window;
+    return true;
+}
+
+// The ordinary (layer 0) windows on screen, front to back. Handles stay NULL:
+// the accessibility element is looked up by whoever moves the window.
+static bool cgWindowList(Backend *backend, BackendWindow **out, uint32_t *count) {
+    (void)backend;
+    CFArrayRef list = CGWindowListCopyWindowInfo(kCGWindowListOptionOnScreenOnly | kCGWindowListExcludeDesktopElements,
+                                                 kCGNullWindowID);
+    if (!list) return false;
+    CFIndex total = CFArrayGetCount(list);
+    BackendWindow *windows = malloc((total ? (size_t)total : 1) * sizeof(*windows));
+    if (!windows) {
+        CFRelease(list);
+        return false;
+    }
+    uint32_t n = 0;
+    for (CFIndex i = 0; i < total; i++) {
+        CFDictionaryRef info = CFArrayGetValueAtIndex(list, i);
+        int32_t layer = -1, owner = 0, number = 0;
+        CFNumberRef value = CFDictionaryGetValue(info, kCGWindowLayer);
+        if (!value || !CFNumberGetValue(value, kCFNumberSInt32Type, &layer) || layer != 0) continue;
+        value = CFDictionaryGetValue(info, kCGWindowOwnerPID);
+        if (!value || !CFNumberGetValue(value, kCFNumberSInt32Type, &owner)) continue;
+        value = CFDictionaryGetValue(info, kCGWindowNumber);
+        if (value) CFNumberGetValue(value, kCFNumberSInt32Type, &number);
+        CFDictionaryRef boundsInfo = CFDictionaryGetValue(info, kCGWindowBounds);
+        CGRect bounds;
+        if (!boundsInfo || !CGRectMakeWithDictionaryRepresentation(boundsInfo, &bounds)) continue;
+        windows[n++] = (BackendWindow){
+            .frame = { bounds.origin.x, bounds.origin.y, bounds.size.width, bounds.size.height },
+            .id = (uint32_t)number,
+            .owner = owner,
+        };
+    }
+    CFRelease(list);
+    *out = windows;
+    *count = n;
+    return true;
+}
+
+// Accessibility element of a listed window: the owner's window with the same frame
+static AXUIElementRef resolveWindow(const BackendWindow *window) {
+    pthread_once(&gSystemWideOnce, createSystemWide);
+    AXUIElementRef app = AXUIElementCreateApplication(window->owner);
+    if (!app) return NULL;
+    CFArrayRef list = (CFArrayRef)copyAttribute(app, kAXWindowsAttribute);
+    CFRelease(app);
+    if (!list) return NULL;
+    AXUIElementRef found = NULL;
+    for (CFIndex i = 0; i < CFArrayGetCount(list) && !found; i++) {
+        AXUIElementRef candidate = (AXUIElementRef)CFArrayGetValueAtIndex(list, i);
+        TopoRect frame;
+        if (windowFrame(candidate, &frame) && fabs(frame.x - window->frame.x) < 1 && fabs(frame.y - window->frame.y) < 1 &&
+            fabs(frame.width - window->frame.width) < 1 && fabs(frame.height - window->frame.height) < 1) {
+            found = (AXUIElementRef)CFRetain(candidate);
+        }
+    }
+    CFRelease(list);
+    return found;
+}
+
+static bool setAttribute(AXUIElementRef window, CFStringRef attribute, AXValueType type, const void *value) {
+    AXValueRef axValue = AXValueCreate(type, value);
+    if (!axValue) return false;
+    bool ok = AXUIElementSetAttributeValue(window, attribute, axValue) == kAXErrorSuccess;
+    CFRelease(axValue);
+    return ok;
+}
+
+static bool cgWindowSetFrame(Backend *backend, BackendWindow *window, TopoRect frame) {
+    (void)backend;
+    AXUIElementRef element = (AXUIElementRef)window->handle;
+    if (!element) {
+        element = resolveWindow(window);
+        if (!element) return false;
+        window->handle = (void *)element;
+    }
+    CGPoint position = CGPointMake(frame.x, frame.y);
+    CGSize size = CGSizeMake(frame.width, frame.height);
+    if (frame.width == window->frame.width && frame.height == window->frame.height) {
+        if (!setAttribute(element, kAXPositionAttribute, kAXValueCGPointType, &position)) return false;
+    } else {
+        // The app may clamp a size that does not fit the display the window
+        // is still on: size, move, then size again on the new display
+        setAttribute(element, kAXSizeAttribute, kAXValueCGSizeType, &size);
+        if (!setAttribute(element, kAXPositionAttribute, kAXValueCGPointType, &position)) return false;
+        setAttribute(element, kAXSizeAttribute, kAXValueCGSizeType, &size);
+    }
+    window->frame = frame;
+    return true;
+}
+
+static void cgWindowRelease(Backend *backend, BackendWindow *window) {
+    (void)backend;
+    if (window->handle) CFRelease((AXUIElementRef)window->handle);
+    window->handle = NULL;
+}
+
+// Menu bar and Dock: what the window server leaves for window placement
+static FrameInsets cgDisplayInsets(Backend *backend, const DisplayInfo *display) {
+    (void)backend;
+    FrameInsets insets = { 0, 0, 0, 0 };
+    HIRect available;
+    if (HIWindowGetAvailablePositioningBounds(display->id, kHICoordSpace72DPIGlobal, &available) != noErr) {
+        return insets;
+    }
+    TopoRect b = display->bounds;
+    insets.left = available.origin.x - b.x;
+    insets.top = available.origin.y - b.y;
+    insets.right = (b.x + b.width) - (available.origin.x + available.size.width);
+    insets.bottom = (b.y + b.height) - (available.origin.y + available.size.height);
+    return insets;
+}
+
+static void cgNotify(Backend *backend, const NotifyEvent *event) {
+    (void)backend;
+    notifyPost(event);
+}
+
+static void cgQuit(Backend *backend) {
+    (void)backend;
+    CFRunLoopStop(CFRunLoopGetMain());
+}
+
+static uint64_t cgNow(Backend *backend) {
+    (void)backend;
+    return statsNowNs();
+}
+
+// A single run-loop timer on the main (event tap) run loop, re-armed as
+// needed. Armed from the tap or from the watchdog worker, hence the lock.
+static pthread_mutex_t   gTimerLock = PTHREAD_MUTEX_INITIALIZER;
+static CFRunLoopTimerRef gTimer = NULL;       // guarded by gTimerLock
+static void (*gTimerFn)(void *arg);           // guarded by gTimerLock
+static void *gTimerArg;                       // guarded by gTimerLock
+
+static void timerFired(CFRunLoopTimerRef timer, void *info) {
+    (void)timer;
+    (void)info;
+    pthread_mutex_lock(&gTimerLock);
+    void (*fn)(void *) = gTimerFn;
+    void *arg = gTimerArg;
+    gTimerFn = NULL;
+    pthread_mutex_unlock(&gTimerLock);
+    if (fn) fn(arg);
+}
+
+static void cgSchedule(Backend *backend, uint64_t at, void (*fn)(void *arg), void *arg) {
+    (void)backend;
+    pthread_mutex_lock(&gTimerLock);
+    gTimerFn = fn;
+    gTimerArg = arg;
+    if (fn && !gTimer) {
+        // Effectively one-shot: re-armed with CFRunLoopTimerSetNextFireDate
+        gTimer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent() + 1e9, 1e9, 0, 0, timerFired, NULL);
+        if (gTimer) CFRunLoopAddTimer(CFRunLoopGetMain(), gTimer, kCFRunLoopCommonModes);
+    }
+    if (fn && gTimer) {
+        uint64_t now = statsNowNs();
+        double delay = at > now ? (double)(at - now) / 1e9 : 0.0;
+        CFRunLoopTimerSetNextFireDate(gTimer, CFAbsoluteTimeGetCurrent() + delay);
+    }
+    pthread_mutex_unlock(&gTimerLock);
+}
+
+Backend *backendCoreGraphics(void) {
+    static Backend backend = {
+        .name = "coregraphics",
+        .displays = cgDisplays,
+        .cursorGet = cgCursorGet,
+        .cursorSet = cgCursorSet,
+        .postMouse = cgPostMouse,
+        .windowFind = cgWindowFind,
+        .windowList = cgWindowList,
+        .windowSetFrame = cgWindowSetFrame,
+        .windowRelease = cgWindowRelease,
+        .displayInsets = cgDisplayInsets,
+        .notify = cgNotify,
+        .quit = cgQuit,
+        .now = cgNow,
+        .schedule = cgSchedule,
+    };
+    return &backend;
+}
@@ -0,0 +1,237 @@
+#include "backend_sim.h"
+
+#include "stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static bool simDisplays(Backend *backend, DisplayInfo **out, uint32_t *count) {
+    SimBackend *sim = (SimBackend *)backend;
+    atomic_fetch_add_explicit(&sim->calls.displayQueries, 1, memory_order_relaxed);
+    if (sim->count == 0) return false;
+    *out = malloc(sim->count * sizeof(**out));
+    if (!*out) return false;
+    memcpy(*out, sim->displays, sim->count * sizeof(**out));
+    *count = sim->count;
+    return true;
+}
+
+static bool simCursorGet(Backend *backend, TopoPoint *point) {
+    SimBackend *sim = (SimBackend *)backend;
+    atomic_fetch_add_explicit(&sim->calls.cursorGets, 1, memory_order_relaxed);
+    pthread_mutex_lock(&sim->lock);
+    *point = sim->cursor;
+    pthread_mutex_unlock(&sim->lock);
+    return true;
+}
+
+static void simCursorSet(Backend *backend, TopoPoint point) {
+    SimBackend *sim = (SimBackend *)backend;
+    atomic_fetch_add_explicit(&sim->calls.cursorSets, 1, memory_order_relaxed);
+    if (sim->cursorDelayUs) usleep(sim->cursorDelayUs);
+    pthread_mutex_lock(&sim->lock);
+    sim->cursor = point;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+static void simPostMouse(Backend *backend, DragEventType type, TopoPoint point) {
+    SimBackend *sim = (SimBackend *)backend;
+    (void)type;
+    atomic_fetch_add_explicit(&sim->calls.mousePosts, 1, memory_order_relaxed);
+    if (sim->postDelayUs) usleep(sim->postDelayUs);
+    pthread_mutex_lock(&sim->lock);
+    sim->cursor = point;
+    pthread_mutex_unlock(&sim->lock);
+}
+
+// Window handles are 1-based indexes into sim->windows
+static bool simWindowFind(Backend *backend, WindowPick pick, TopoPoint point, BackendWindow *window) {
+    SimBackend *sim = (SimBackend *)backend;
+    atomic_fetch_add_explicit(&sim->calls.windowFinds, 1, memory_order_relaxed);
+    if (sim->windowDelayUs) usleep(sim->windowDelayUs);
+    pthread_mutex_lock(&sim->lock);
+    int found = -1;
+    if (pick == WINDOW_FOCUSED) {
+        if (sim->focusedWindow < sim->windowCount) found = (int)sim->focusedWindow;
+    } else {
+        for (uint32_t i = 0; i < sim->windowCount && found < 0; i++) {
+            if (topoRectContains(sim->windows[i], point)) found = (int)i;
+        }
+    }
+    if (found >= 0) {
+        *window = (BackendWindow){ .handle = (void *)(uintptr_t)(found + 1), .frame = sim->windows[found],
+                                   .id = (uint32_t)found + 1 };
+    }
+    pthread_mutex_unlock(&sim->lock);
+    return found >= 0;
+}
+
+static bool simWindowList(Backend *backend, BackendWindow **windows, uint32_t *count) {
+    SimBackend *sim = (SimBackend *)backend;
+    atomic_fetch_add_explicit(&sim->calls.windowLists, 1, memory_order_relaxed);
+    if (sim->windowDelayUs) usleep(sim->windowDelayUs);
+    pthread_mutex_lock(&sim->lock);
+    uint32_t n = sim->windowCount;
+    BackendWindow *list = malloc((n ? n : 1) * sizeof(*list));
+    if (list) {
+        for (uint32_t i = 0; i < n; i++) {
+            list[i] = (BackendWindow){ .handle = (void *)(uintptr_t)(i + 1), .frame = sim->windows[i], .id = i + 1 };
+        }
+    }
+    pthread_mutex_unlock(&sim->lock);
+    if (!list) return false;
+    *windows = list;
+    *count = n;
+    return true;
+}
+
+static bool simWindowSetFrame(Backend *backend, BackendWindow *window, TopoRect frame) {
+    SimBackend *sim = (SimBackend *)backend;
+    atomic_fetch_add_explicit(&sim->calls.windowMoves, 1, memory_order_relaxed);
+    if (sim->windowDelayUs) usleep(sim->windowDelayUs);
+    uintptr_t index = (uintptr_t)window->handle - 1;
+    pthread_mutex_lock(&sim->lock);
+    bool ok = index < sim->windowCount;
+    if (ok) sim->windows[index] = window->frame = frame;
+    pthread_mutex_unlock(&sim->lock);
+    return ok;
+}
+
+static void simWindowRelease(Backend *backend, BackendWindow *window) {
+    (void)backend;
+    window->handle = NULL;
+}
+
+static FrameInsets simDisplayInsets(Backend *backend, const DisplayInfo *display) {
+    SimBackend *sim = (SimBackend *)backend;
+    return sim->count && display->id == sim->displays[0].id ? sim->primaryInsets : sim->insets;
+}
+
+static void simNotify(Backend *backend, const NotifyEvent *event) {
+    SimBackend *sim = (SimBackend *)backend;
+    (void)event;
+    atomic_fetch_add_explicit(&sim->calls.notifications, 1, memory_order_relaxed);
+}
+
+static void simQuit(Backend *backend) {
+    SimBackend *sim = (SimBackend *)backend;
+    atomic_fetch_add_explicit(&sim->calls.quits, 1, memory_order_relaxed);
+}
+
+static uint64_t simNow(Backend *backend) {
+    SimBackend *sim = (SimBackend *)backend;
+    return sim->virtualClock ? sim->clockNs : statsNowNs();
+}
+
+static void simSchedule(Backend *backend, uint64_t at, void (*fn)(void *arg), void *arg) {
+    SimBackend *sim = (SimBackend *)backend;
+    sim->timerAt = at;
+    sim->timerFn = fn;
+    sim->timerArg = arg;
+}
+
+void simBackendAdvance(SimBackend *sim, uint64_t ns) {
+    uint64_t target = sim->clockNs + ns;
+    while (sim->timerFn && sim->timerAt <= target) {
+        void (*fn)(void *) = sim->timerFn;
+        if (sim->timerAt > sim->clockNs) sim->clockNs = sim->timerAt;
+        sim->timerFn = NULL;
+        atomic_fetch_add_explicit(&sim->calls.timers, 1, memory_order_relaxed);
+        fn(sim->timerArg);
+    }
+    sim->clockNs = target;
+}
+
+void simBackendInit(SimBackend *sim) {
+    memset(sim, 0, sizeof(*sim));
+    pthread_mutex_init(&sim->lock, NULL);
+    sim->backend = (Backend){
+        .name = "simulated",
+        .displays = simDisplays,
+        .cursorGet = simCursorGet,
+        .cursorSet = simCursorSet,
+        .postMouse = simPostMouse,
+        .windowFind = simWindowFind,
+        .windowList = simWindowList,
+        .windowSetFrame = simWindowSetFrame,
+        .windowRelease = simWindowRelease,
+        .displayInsets = simDisplayInsets,
+        .notify = simNotify,
+        .quit = simQuit,
+        .now = simNow,
+        .schedule = simSchedule,
+        .context = sim,
+    };
+}
+
+void simBackendFree(SimBackend *sim) {
+    free(sim->displays);
+    sim->displays = NULL;
+    sim->count = 0;
+    free(sim->windows);
+    sim->windows = NULL;
+    sim->windowCount = 0;
+    pthread_mutex_destroy(&sim->lock);
+}
+
+bool simBackendSetDisplays(SimBackend *sim, const DisplayInfo *displays, uint32_t count) {
+    DisplayInfo *copy = malloc((count ? count : 1) * sizeof(*copy));
+    if (!copy) return false;
+    memcpy(copy, displays, count * sizeof(*copy));
+    free(sim->displays);
+    sim->displays = copy;
+    sim->count = count;
+    if (count) {
+        pthread_mutex_lock(&sim->lock);
+        sim->cursor = (TopoPoint){ copy[0].bounds.x + copy[0].bounds.width / 2,
+                                   copy[0].bounds.y + copy[0].bounds.height / 2 };
+        pthread_mutex_unlock(&sim->lock);
+    }
+    return true;
+}
+
+bool simBackendSetWindows(SimBackend *sim, const TopoRect *frames, uint32_t count) {
+    TopoRect *copy = malloc((count ? count : 1) * sizeof(*copy));
+    if (!copy) return false;
+    memcpy(copy, frames, count * sizeof(*copy));
+    pthread_mutex_lock(&sim->lock);
+    free(sim->windows);
+    sim->windows = copy;
+    sim->windowCount = count;
+    sim->focusedWindow = 0;
+    pthread_mutex_unlock(&sim->lock);
+    return true;
+}
+
+void simBackendResetCounters(SimBackend *sim) {
+    atomic_store(&sim->calls.displayQueries, 0);
+    atomic_store(&sim->calls.cursorGets, 0);
+    atomic_store(&sim->calls.cursorSets, 0);
+    atomic_store(&sim->calls.mousePosts, 0);
+    atomic_store(&sim->calls.notifications, 0);
+    atomic_store(&sim->calls.quits, 0);
+    atomic_store(&sim->calls.timers, 0);
+    atomic_store(&sim->calls.windowFinds, 0);
+    atomic_store(&sim->calls.windowLists, 0);
+    atomic_store(&sim->calls.windowMoves, 0);
+}
+
+uint32_t simLayoutRow(DisplayInfo *out, uint32_t count, double width, double height) {
+    return simLayoutWall(out, count, 1, width, height);
+}
+
+uint32_t simLayoutWall(DisplayInfo *out, uint32_t columns, uint32_t rows, double width, double height) {
+    uint32_t count = 0;
+    for (uint32_t row = 0; row < rows; row++) {
+        for (uint32_t col = 0; col < columns; col++) {
+            out[count] = (DisplayInfo){
+                .id = count + 1,
+                .bounds = { col * width, row * height, width, height },
+                .scale = 1.0,
+            };
+            count++;
+        }
+    }
+    return count;
+}
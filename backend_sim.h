@@ -0,0 +1,67 @@
+#ifndef BACKEND_SIM_H
+#define BACKEND_SIM_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "backend.h"
+
+// In-memory backend: a configurable display layout, a cursor and counters
+// for every call, so the hot paths can be driven and measured headless.
+
+typedef struct {
+    _Atomic uint64_t displayQueries;
+    _Atomic uint64_t cursorGets;
+    _Atomic uint64_t cursorSets;
+    _Atomic uint64_t mousePosts;
+    _Atomic uint64_t notifications;
+    _Atomic uint64_t quits;
+    _Atomic uint64_t timers;        // timers fired
+    _Atomic uint64_t windowFinds;
+    _Atomic uint64_t windowLists;
+    _Atomic uint64_t windowMoves;
+} SimCounters;
+
+typedef struct {
+    Backend      backend;         // must be first
+    DisplayInfo *displays;
+    uint32_t     count;
+    TopoPoint    cursor;          // guarded by lock (the drag thread moves it too)
+    pthread_mutex_t lock;
+    SimCounters  calls;
+    uint32_t     postDelayUs;     // simulated cost of posting one mouse event
+    uint32_t     cursorDelayUs;   // simulated cost of one cursor warp
+
+    // Window frames, front to back (guarded by lock); windows[focusedWindow]
+    // has keyboard focus.
+    TopoRect    *windows;
+    uint32_t     windowCount;
+    uint32_t     focusedWindow;
+    uint32_t     windowDelayUs;   // simulated cost of one window lookup, list or move
+    FrameInsets  primaryInsets;   // menu bar and Dock on the first display
+    FrameInsets  insets;          // menu bar on the others
+
+    // Virtual clock: when enabled, now() only moves with simBackendAdvance()
+    // and timers fire from there; otherwise timers never fire.
+    bool         virtualClock;
+    uint64_t     clockNs;
+    uint64_t     timerAt;
+    void       (*timerFn)(void *arg);
+    void        *timerArg;
+} SimBackend;
+
+void simBackendInit(SimBackend *sim);
+void simBackendFree(SimBackend *sim);
+bool simBackendSetDisplays(SimBackend *sim, const DisplayInfo *displays, uint32_t count);
+void simBackendResetCounters(SimBackend *sim);
+bool simBackendSetWindows(SimBackend *sim, const TopoRect *frames, uint32_t count);
+
+// Move the virtual clock forward by `ns`, firing due timers on the way.
+void simBackendAdvance(SimBackend *sim, uint64_t ns);
+
+// Synthetic layouts: `count` displays of width x height in a row, or a
+// columns x rows wall. Ids start at 1.
+uint32_t simLayoutRow(DisplayInfo *out, uint32_t count, double width, double height);
+uint32_t simLayoutWall(DisplayInfo *out, uint32_t columns, uint32_t rows, double width, double height);
+
+#endif // BACKEND_SIM_H
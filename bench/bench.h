@@ -0,0 +1,43 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+// Shared helpers for the headless benchmarks (make bench).
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static inline uint64_t benchNowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Deterministic xorshift so runs are comparable.
+static inline uint32_t benchRandom(uint32_t *state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+static int benchCompareU64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Print mean/p50/p99/max of per-operation samples (sorts samples in place).
+static inline void benchReport(const char *name, uint64_t *samples, size_t count, uint64_t totalNs) {
+    qsort(samples, count, sizeof(*samples), benchCompareU64);
+    double mean = count ? (double)totalNs / (double)count : 0.0;
+    double opsPerSec = totalNs ? (double)count * 1e9 / (double)totalNs : 0.0;
+    printf("  %-38s %10.0f ops/s  mean %8.1f ns  p50 %6llu  p99 %6llu  max %8llu\n",
+           name, opsPerSec, mean,
+           (unsigned long long)samples[count / 2],
+           (unsigned long long)samples[count * 99 / 100],
+           (unsigned long long)samples[count - 1]);
+}
+
+#endif // BENCH_H
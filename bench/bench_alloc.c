@@ -0,0 +1,205 @@
+// Heap allocations on the keystroke path. malloc and friends are interposed
+// with counters for the calling thread; after a warm-up (for first-use
+// setup such as the thread's log ring) a mixed stream of typing, switches,
+// coalesced auto-repeat bursts, jumps and window moves is dispatched with
+// switcherHandleKeyAt(), notifications going through the real queue. Exits
+// non-zero if the steady state allocates at all. The worker threads (mover,
+// notifications, logger) may allocate; they are not counted.
+//
+// Interposition needs glibc's __libc_* entry points; elsewhere the check is
+// skipped.
+
+#include <sched.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "log.h"
+#include "mover.h"
+#include "notify.h"
+#include "switcher.h"
+
+#define WARMUP     2000
+#define KEYSTROKES 200000
+
+static _Thread_local bool     tCounting;
+static _Thread_local uint64_t tAllocations;
+
+#ifdef __GLIBC__
+#define ALLOC_COUNTING 1
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t count, size_t size);
+extern void *__libc_realloc(void *p, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void  __libc_free(void *p);
+
+static inline void counted(void) {
+    if (tCounting) tAllocations++;
+}
+
+void *malloc(size_t size) { counted(); return __libc_malloc(size); }
+void *calloc(size_t count, size_t size) { counted(); return __libc_calloc(count, size); }
+void *realloc(void *p, size_t size) { counted(); return __libc_realloc(p, size); }
+void *aligned_alloc(size_t alignment, size_t size) { counted(); return __libc_memalign(alignment, size); }
+void *memalign(size_t alignment, size_t size) { counted(); return __libc_memalign(alignment, size); }
+int posix_memalign(void **out, size_t alignment, size_t size) {
+    counted();
+    void *p = __libc_memalign(alignment, size);
+    if (!p) return 12;   // ENOMEM
+    *out = p;
+    return 0;
+}
+void free(void *p) {
+    if (p) counted();
+    __libc_free(p);
+}
+#else
+#define ALLOC_COUNTING 0
+#endif
+
+typedef struct { uint16_t keyCode; uint64_t flags; bool autorepeat; } Key;
+
+static SimBackend gSim;
+
+static HotkeyTable *buildTable(void) {
+    static const struct { const char *hotkey; HotkeyAction action; } bindings[] = {
+        { "Control+Space",                { ACTION_SWITCH, TOPO_NEXT } },
+        { "Command+Left",                 { ACTION_SWITCH, TOPO_LEFT } },
+        { "Command+Right",                { ACTION_SWITCH, TOPO_RIGHT } },
+        { "Control+Option+1",             { ACTION_JUMP, 1 } },
+        { "Control+Option+2",             { ACTION_JUMP, 2 } },
+        { "Control+Option+3",             { ACTION_JUMP, 3 } },
+        { "Control+Option+Command+Space", { ACTION_DRAG, TOPO_NEXT } },
+    };
+    HotkeyBindingList list = { 0 };
+    for (size_t i = 0; i < sizeof(bindings) / sizeof(bindings[0]); i++) {
+        HotkeyBinding b = { .action = bindings[i].action };
+        parse_hotkey(bindings[i].hotkey, &b.required, &b.keyCode);
+        b.forbidden = MOD_ALL & ~b.required;
+        hotkeyListAppend(&list, &b);
+    }
+    HotkeyTable *table = hotkeyTableCreate(list.items, list.count);
+    hotkeyListFree(&list);
+    return table;
+}
+
+// Mostly typing; hotkeys of every kind, with auto-repeat runs of the switch key
+static void makeStream(Key *keys, size_t count, uint32_t seed) {
+    uint16_t digits[3];
+    uint64_t modifiers;
+    for (int i = 0; i < 3; i++) {
+        char digit[2] = { (char)('1' + i), '\0' };
+        parse_hotkey(digit, &modifiers, &digits[i]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        uint32_t r = benchRandom(&seed) % 100;
+        if (r < 70) {
+            keys[i] = (Key){ (uint16_t)(benchRandom(&seed) % 0x30), benchRandom(&seed) % 8 == 0 ? MOD_SHIFT : 0, false };
+        } else if (r < 85) {
+            keys[i] = (Key){ KEYCODE_SPACE, MOD_CONTROL, i > 0 && keys[i - 1].keyCode == KEYCODE_SPACE };
+        } else if (r < 92) {
+            keys[i] = (Key){ benchRandom(&seed) & 1 ? KEYCODE_LEFT_ARROW : KEYCODE_RIGHT_ARROW, MOD_COMMAND, false };
+        } else if (r < 98) {
+            keys[i] = (Key){ digits[benchRandom(&seed) % 3], MOD_CONTROL | MOD_OPTION, false };
+        } else {
+            keys[i] = (Key){ KEYCODE_SPACE, MOD_CONTROL | MOD_OPTION | MOD_COMMAND, false };
+        }
+    }
+}
+
+static void postNotification(Backend *backend, const NotifyEvent *event) {
+    (void)backend;
+    notifyPost(event);
+}
+
+static void discard(NotifySink *sink, const char *title, const char *message) {
+    (void)sink;
+    (void)title;
+    (void)message;
+}
+
+// Dispatch keys[0..count) the way the event tap does, 5 ms apart
+static void dispatch(const Key *keys, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        pthread_mutex_lock(&gSim.lock);
+        TopoPoint cursor = gSim.cursor;
+        pthread_mutex_unlock(&gSim.lock);
+        simBackendAdvance(&gSim, 5000000);
+        switcherHandleKeyAt(keys[i].keyCode, keys[i].flags, gSim.clockNs, keys[i].autorepeat, cursor);
+    }
+}
+
+int main(void) {
+    printf("bench_alloc: heap allocations per keystroke\n");
+    if (!ALLOC_COUNTING) {
+        printf("  allocation counting needs glibc; skipped\n");
+        return 0;
+    }
+
+    simBackendInit(&gSim);
+    DisplayInfo displays[3];
+    uint32_t count = simLayoutRow(displays, 3, 1920, 1080);
+    simBackendSetDisplays(&gSim, displays, count);
+    TopoRect window = { 200, 200, 800, 600 };
+    simBackendSetWindows(&gSim, &window, 1);
+    gSim.focusedWindow = 0;
+    gSim.virtualClock = true;
+    gSim.backend.notify = postNotification;
+
+    logSetLevel(LOG_LEVEL_DEBUG);
+    logStart("/dev/null");
+    NotifySink sink = { .name = "discard", .deliver = discard };
+    NotifyOptions notifyOptions = { .minIntervalMs = 0 };
+    notifyStart(&sink, &notifyOptions);
+
+    switcherInit(&gSim.backend);
+    switcherRebuildTopology();
+    switcherPublishHotkeys(buildTable());
+    RepeatOptions repeat = REPEAT_DEFAULT_OPTIONS;
+    switcherSetRepeatOptions(&repeat);
+    MoveOptions move = { .pick = WINDOW_FOCUSED };
+    moverStart(&gSim.backend, &move);
+
+    static Key keys[KEYSTROKES];
+    makeStream(keys, KEYSTROKES, 11);
+
+    // The counters must see this thread's allocations at all
+    tCounting = true;
+    void *volatile probe = malloc(16);
+    free(probe);
+    if (tAllocations != 2) {
+        printf("  FAIL: malloc interposition not active (%llu calls seen)\n", (unsigned long long)tAllocations);
+        return 1;
+    }
+    tAllocations = 0;
+    dispatch(keys, WARMUP);
+    uint64_t warmup = tAllocations;
+    tAllocations = 0;
+    uint64_t t0 = benchNowNs();
+    dispatch(keys, KEYSTROKES);
+    uint64_t elapsed = benchNowNs() - t0;
+    uint64_t steady = tAllocations;
+    tCounting = false;
+
+    while (moverBusy()) sched_yield();
+    moverStop();
+    notifyStop();
+    logStop();
+    MoveStats moves = moverGetStats();
+    NotifyStats notes = notifyGetStats();
+    printf("  %-38s %llu allocations in %d keystrokes\n", "warm-up",
+           (unsigned long long)warmup, WARMUP);
+    printf("  %-38s %llu allocations in %d keystrokes, %.1f ns/keystroke\n", "steady state",
+           (unsigned long long)steady, KEYSTROKES, (double)elapsed / KEYSTROKES);
+    printf("  %-38s %llu cursor moves, %llu window moves requested, %llu notifications\n", "",
+           (unsigned long long)atomic_load(&gSim.calls.cursorSets), (unsigned long long)moves.requested,
+           (unsigned long long)notes.posted);
+    simBackendFree(&gSim);
+
+    if (steady) {
+        printf("  FAIL: the keystroke path allocated %llu times\n", (unsigned long long)steady);
+        return 1;
+    }
+    return 0;
+}
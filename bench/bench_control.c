@@ -0,0 +1,260 @@
+// Control socket: cost of the request handler per command, and end-to-end
+// throughput over the Unix socket for one command per connection (what a
+// script spawning a client per switch pays), pipelined single-command
+// requests and pipelined batches. Runs against the simulated backend and
+// exits non-zero if a reply is wrong, the cursor does not end up where
+// the commands sent it, or starting on a path takes over a running
+// instance's socket.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "control.h"
+#include "switcher.h"
+
+#define DISPLAYS      4
+#define HANDLER_OPS   200000
+#define CONNECTIONS   2000
+#define PIPELINED     100000
+#define BATCHES       2000
+#define BATCH_SIZE    100
+
+static SimBackend gSim;
+static char       gSocketPath[108];
+
+static int displayOfCursor(void) {
+    for (uint32_t i = 0; i < gSim.count; i++) {
+        if (topoRectContains(gSim.displays[i].bounds, gSim.cursor)) return (int)i;
+    }
+    return -1;
+}
+
+static int expectReply(const char *request, const char *prefix) {
+    char line[1024], reply[CONTROL_MAX_REPLY];
+    snprintf(line, sizeof(line), "%s", request);
+    controlExecute(line, reply, sizeof(reply));
+    if (strncmp(reply, prefix, strlen(prefix)) != 0) {
+        fprintf(stderr, "  ERROR: '%s' -> '%.*s', expected '%s...'\n", request, (int)strcspn(reply, "\n"), reply, prefix);
+        return 1;
+    }
+    return 0;
+}
+
+static int expectDisplay(const char *after, int display) {
+    if (displayOfCursor() == display) return 0;
+    fprintf(stderr, "  ERROR: after %s the cursor is on display %d, expected %d\n", after, displayOfCursor(), display);
+    return 1;
+}
+
+static int checkProtocol(void) {
+    int errors = 0;
+    errors += expectReply("ping", "ok 1/1\n");
+    errors += expectReply("", "ok 0/0\n");
+    errors += expectReply("next", "ok 1/1\n") + expectDisplay("next", 1);
+    errors += expectReply("next 2", "ok 1/1\n") + expectDisplay("next 2", 3);
+    errors += expectReply("prev; prev ;prev", "ok 3/3\n") + expectDisplay("3x prev", 0);
+    errors += expectReply("jump 3", "ok 1/1\n") + expectDisplay("jump 3", 2);
+    errors += expectReply("jump 9", "err 0/1 #1 no display 9\n");
+    errors += expectReply("left;bogus;right 2", "err 2/3 #2 unknown command 'bogus'\n") + expectDisplay("left, right 2", 3);
+    errors += expectReply("next x", "err 0/1 #1 bad count");
+    errors += expectReply("ping extra", "err 0/1 #1 too many arguments");
+    errors += expectReply("jump 1; cursor", "ok 2/2\tcursor 960.0,540.0\n");
+    errors += expectReply("topology", "ok 1/1\tdisplays 4 1:1@0,0,1920x1080*1");
+    errors += expectReply("stats", "ok 1/1\t{");
+    return errors;
+}
+
+static uint64_t runHandler(const char *request, int ops) {
+    char line[BATCH_SIZE * 8], reply[CONTROL_MAX_REPLY];
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i < ops; i++) {
+        strcpy(line, request);
+        controlExecute(line, reply, sizeof(reply));
+    }
+    return benchNowNs() - t0;
+}
+
+static int connectClient(void) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strcpy(addr.sun_path, gSocketPath);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool writeAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n <= 0) return false;
+        data += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+// Read `count` reply lines, counting the ones that are not "ok"
+static bool readReplies(int fd, unsigned count, unsigned *bad) {
+    static char buffer[65536];
+    bool lineStart = true;
+    while (count > 0) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n <= 0) return false;
+        for (ssize_t i = 0; i < n; i++) {
+            if (lineStart && buffer[i] != 'o') (*bad)++;
+            lineStart = buffer[i] == '\n';
+            if (lineStart) count--;
+        }
+    }
+    return true;
+}
+
+typedef struct {
+    int         fd;
+    const char *line;
+    unsigned    count;
+} Writer;
+
+static void *writerThread(void *arg) {
+    Writer *w = arg;
+    size_t length = strlen(w->line);
+    for (unsigned i = 0; i < w->count; i++) {
+        if (!writeAll(w->fd, w->line, length)) break;
+    }
+    return NULL;
+}
+
+// Send `count` copies of line over one connection, replies read concurrently
+static uint64_t runPipelined(const char *line, unsigned count, unsigned *bad) {
+    int fd = connectClient();
+    if (fd < 0) return 0;
+    Writer writer = { fd, line, count };
+    pthread_t thread;
+    uint64_t t0 = benchNowNs();
+    pthread_create(&thread, NULL, writerThread, &writer);
+    if (!readReplies(fd, count, bad)) *bad = count;
+    uint64_t elapsed = benchNowNs() - t0;
+    pthread_join(thread, NULL);
+    close(fd);
+    return elapsed;
+}
+
+static uint64_t runConnections(unsigned count, unsigned *bad) {
+    uint64_t t0 = benchNowNs();
+    for (unsigned i = 0; i < count; i++) {
+        int fd = connectClient();
+        if (fd < 0 || !writeAll(fd, "next\n", 5) || !readReplies(fd, 1, bad)) (*bad)++;
+        if (fd >= 0) close(fd);
+    }
+    return benchNowNs() - t0;
+}
+
+static void report(const char *name, uint64_t commands, uint64_t elapsed) {
+    printf("  %-42s %10.0f commands/s  %8.1f ns/command\n", name,
+           elapsed ? (double)commands * 1e9 / (double)elapsed : 0.0,
+           commands ? (double)elapsed / (double)commands : 0.0);
+}
+
+// Another instance listening on the path keeps it; a dead one's socket is
+// replaced; the socket is created 0600
+static int checkSocketFile(void) {
+    int errors = 0;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strcpy(addr.sun_path, gSocketPath);
+    int other = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (other < 0 || bind(other, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(other, 1) != 0) {
+        fprintf(stderr, "  ERROR: cannot set up the other instance's socket\n");
+        return 1;
+    }
+    if (controlStart(gSocketPath)) {
+        fprintf(stderr, "  ERROR: took over the socket of a running instance\n");
+        controlStop();
+        errors++;
+    }
+    int client = connectClient();
+    if (client < 0) {
+        fprintf(stderr, "  ERROR: the running instance's socket was removed\n");
+        errors++;
+    } else {
+        close(client);
+    }
+    close(other);   // gone, its socket file left behind
+    if (!controlStart(gSocketPath)) {
+        fprintf(stderr, "  ERROR: stale socket not replaced\n");
+        unlink(gSocketPath);
+        return errors + 1;
+    }
+    struct stat st;
+    if (stat(gSocketPath, &st) != 0 || (st.st_mode & 0777) != 0600) {
+        fprintf(stderr, "  ERROR: socket mode %o, expected 600\n", (unsigned)(st.st_mode & 0777));
+        errors++;
+    }
+    controlStop();
+    printf("  %-44s %s\n", "socket file: live kept, stale replaced, 0600", errors ? "FAILED" : "ok");
+    return errors;
+}
+
+int main(void) {
+    DisplayInfo displays[DISPLAYS];
+    simBackendInit(&gSim);
+    simBackendSetDisplays(&gSim, displays, simLayoutRow(displays, DISPLAYS, 1920, 1080));
+    switcherInit(&gSim.backend);
+    switcherRebuildTopology();
+
+    printf("bench_control: control socket on %d simulated displays\n", DISPLAYS);
+    int errors = checkProtocol();
+
+    char batch[BATCH_SIZE * 8] = "";
+    for (int i = 0; i < BATCH_SIZE; i++) strcat(batch, i ? ";next" : "next");
+
+    simBackendSetDisplays(&gSim, gSim.displays, gSim.count);
+    report("handler: ping", HANDLER_OPS, runHandler("ping", HANDLER_OPS));
+    report("handler: next", HANDLER_OPS, runHandler("next", HANDLER_OPS));
+    report("handler: 100 x next per request", (uint64_t)HANDLER_OPS / 10 * BATCH_SIZE, runHandler(batch, HANDLER_OPS / 10));
+    unsigned moves = HANDLER_OPS + HANDLER_OPS / 10 * BATCH_SIZE;
+
+    snprintf(gSocketPath, sizeof(gSocketPath), "/tmp/bench_control.%d.sock", (int)getpid());
+    errors += checkSocketFile();
+    if (!controlStart(gSocketPath)) {
+        fprintf(stderr, "  ERROR: cannot start control socket at %s\n", gSocketPath);
+        return 1;
+    }
+    simBackendResetCounters(&gSim);
+    unsigned bad = 0;
+    report("socket: connection per command", CONNECTIONS, runConnections(CONNECTIONS, &bad));
+    report("socket: pipelined, 1 command per request", PIPELINED, runPipelined("next\n", PIPELINED, &bad));
+    strcat(batch, "\n");
+    report("socket: pipelined, 100 commands per request", (uint64_t)BATCHES * BATCH_SIZE, runPipelined(batch, BATCHES, &bad));
+    controlStop();
+
+    uint64_t socketMoves = CONNECTIONS + PIPELINED + (uint64_t)BATCHES * BATCH_SIZE;
+    uint64_t warps = atomic_load(&gSim.calls.cursorSets);
+    printf("  socket commands %llu, cursor warps %llu, bad replies %u\n",
+           (unsigned long long)socketMoves, (unsigned long long)warps, bad);
+    if (bad) {
+        fprintf(stderr, "  ERROR: %u bad replies over the socket\n", bad);
+        errors++;
+    }
+    if (warps != socketMoves) {
+        fprintf(stderr, "  ERROR: %llu cursor warps for %llu switch commands\n",
+                (unsigned long long)warps, (unsigned long long)socketMoves);
+        errors++;
+    }
+    errors += expectDisplay("all switches", (int)((moves + socketMoves) % DISPLAYS));
+    if (access(gSocketPath, F_OK) == 0) {
+        fprintf(stderr, "  ERROR: socket file left behind\n");
+        errors++;
+    }
+
+    simBackendFree(&gSim);
+    return errors ? 1 : 0;
+}
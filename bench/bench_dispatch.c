@@ -0,0 +1,115 @@
+// Per-keystroke dispatch cost: the original chain of if-blocks against the
+// keycode-indexed table, for cold keys (ordinary typing) and hot keys
+// (bound hotkeys), plus a table with many more bindings.
+
+#include "bench.h"
+#include "hotkeys.h"
+
+#define KEYSTROKES 5000000
+
+static const char *gDefaults[][2] = {
+    { "switch", "Control+Space" },         { "up", "Control+Command+Up" },
+    { "down", "Control+Command+Down" },    { "exit", "Control+Option+Command+Q" },
+    { "left", "Command+Left" },            { "right", "Command+Right" },
+    { "drag", "Control+Option+Command+Space" },
+};
+
+// Reproduction of the pre-table eventTapCallback decision logic.
+static int legacyDispatch(uint16_t keyCode, uint64_t flags) {
+    const uint64_t switchMods = MOD_CONTROL, switchForbidden = MOD_SHIFT | MOD_OPTION | MOD_COMMAND;
+    const uint64_t exitMods = MOD_CONTROL | MOD_OPTION | MOD_COMMAND;
+    const uint64_t dragMods = MOD_CONTROL | MOD_OPTION | MOD_COMMAND;
+    if ((flags & switchMods) == switchMods && !(flags & switchForbidden) && keyCode == KEYCODE_SPACE) return 1;
+    if (keyCode == KEYCODE_UP_ARROW && (flags & MOD_ALL) == (MOD_CONTROL | MOD_COMMAND)) return 2;
+    if (keyCode == KEYCODE_DOWN_ARROW && (flags & MOD_ALL) == (MOD_CONTROL | MOD_COMMAND)) return 3;
+    if ((flags & exitMods) == exitMods && keyCode == 0x0C) return 4;
+    if ((flags & MOD_COMMAND) && !(flags & (MOD_SHIFT | MOD_OPTION | MOD_CONTROL))) {
+        if (keyCode == KEYCODE_LEFT_ARROW) return 5;
+        if (keyCode == KEYCODE_RIGHT_ARROW) return 6;
+    }
+    if (keyCode == KEYCODE_SPACE && (flags & MOD_ALL) == dragMods) return 7;
+    if ((flags & dragMods) == dragMods) {
+        if (keyCode >= KEYCODE_LEFT_ARROW && keyCode <= KEYCODE_UP_ARROW) return 8;
+    }
+    return 0;
+}
+
+static HotkeyTable *buildTable(uint32_t extra) {
+    HotkeyBindingList list = { 0 };
+    for (size_t i = 0; i < sizeof(gDefaults) / sizeof(gDefaults[0]); i++) {
+        HotkeyBinding b = { .action = { ACTION_SWITCH, (int)i } };
+        parse_hotkey(gDefaults[i][1], &b.required, &b.keyCode);
+        b.forbidden = MOD_ALL & ~b.required;
+        hotkeyListAppend(&list, &b);
+    }
+    // Extra actions spread over digit and function-row keycodes
+    for (uint32_t i = 0; i < extra; i++) {
+        HotkeyBinding b = {
+            .keyCode = (uint16_t)(0x12 + i % 12),
+            .required = MOD_CONTROL | MOD_OPTION | ((i / 12) & 1 ? MOD_SHIFT : 0) | ((i / 24) & 1 ? MOD_COMMAND : 0),
+            .action = { ACTION_SWITCH, (int)(100 + i) },
+        };
+        b.forbidden = MOD_ALL & ~b.required;
+        hotkeyListAppend(&list, &b);
+    }
+    HotkeyTable *table = hotkeyTableCreate(list.items, list.count);
+    hotkeyListFree(&list);
+    return table;
+}
+
+typedef struct { uint16_t keyCode; uint64_t flags; } Key;
+
+static void makeStream(Key *keys, size_t count, bool hot, uint32_t seed) {
+    static const Key hotKeys[] = {
+        { KEYCODE_SPACE, MOD_CONTROL }, { KEYCODE_LEFT_ARROW, MOD_COMMAND },
+        { KEYCODE_RIGHT_ARROW, MOD_COMMAND }, { KEYCODE_SPACE, MOD_CONTROL | MOD_OPTION | MOD_COMMAND },
+    };
+    static const uint16_t letters[] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x0E, 0x0F, 0x10, 0x11, 0x1F, 0x20, 0x22, 0x23, 0x25, 0x2D };
+    for (size_t i = 0; i < count; i++) {
+        if (hot) {
+            keys[i] = hotKeys[benchRandom(&seed) % 4];
+        } else {
+            keys[i].keyCode = letters[benchRandom(&seed) % 15];
+            keys[i].flags = benchRandom(&seed) % 8 == 0 ? MOD_SHIFT : 0;
+        }
+    }
+}
+
+static void measure(const char *name, const Key *keys, int (*fn)(const HotkeyTable *, uint16_t, uint64_t), const HotkeyTable *table) {
+    volatile long sink = 0;
+    uint64_t t0 = benchNowNs();
+    for (size_t i = 0; i < KEYSTROKES; i++) sink += fn(table, keys[i].keyCode, keys[i].flags);
+    uint64_t elapsed = benchNowNs() - t0;
+    (void)sink;
+    printf("  %-40s %6.2f ns/keystroke\n", name, (double)elapsed / KEYSTROKES);
+}
+
+static int viaLegacy(const HotkeyTable *table, uint16_t keyCode, uint64_t flags) {
+    (void)table;
+    return legacyDispatch(keyCode, flags);
+}
+
+static int viaTable(const HotkeyTable *table, uint16_t keyCode, uint64_t flags) {
+    const HotkeyBinding *b = hotkeyLookup(table, keyCode, flags);
+    return b ? b->action.arg + 1 : 0;
+}
+
+int main(void) {
+    static Key cold[KEYSTROKES], hot[KEYSTROKES];
+    makeStream(cold, KEYSTROKES, false, 1);
+    makeStream(hot, KEYSTROKES, true, 2);
+    HotkeyTable *table = buildTable(0);
+    HotkeyTable *large = buildTable(96);
+
+    printf("bench_dispatch: hotkey dispatch per keystroke (%d keystrokes)\n", KEYSTROKES);
+    measure("cold keys, if-chain", cold, viaLegacy, NULL);
+    measure("cold keys, table (default bindings)", cold, viaTable, table);
+    measure("cold keys, table (103 bindings)", cold, viaTable, large);
+    measure("hot keys, if-chain", hot, viaLegacy, NULL);
+    measure("hot keys, table (default bindings)", hot, viaTable, table);
+    measure("hot keys, table (103 bindings)", hot, viaTable, large);
+
+    hotkeyTableDestroy(table);
+    hotkeyTableDestroy(large);
+    return 0;
+}
@@ -0,0 +1,229 @@
+// Drag engine timing with a fake poster: caller cost of dragRequest(), frame
+// pacing while moving, adaptation to a slow poster and cancellation latency.
+// The pre-engine drag blocked its caller for 150 + 10 x 20 + 150 = 500 ms.
+//
+// Also checks what was posted: press, moves, release with the last move
+// exactly on the target; a cancelled or superseded drag released once where
+// it was; every started drag either completed or cancelled; and a slow poster
+// stretching the frame interval. Exits non-zero if a check fails.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "drag.h"
+
+#define MAX_EVENTS 8192
+
+typedef struct {
+    DragEventType type;
+    TopoPoint     point;
+    uint64_t      at;
+} Posted;
+
+static Posted          gPosted[MAX_EVENTS];
+static _Atomic size_t  gPostedCount;
+static uint64_t        gPostDelayUs;
+static int             gFailures;
+
+static void fail(const char *what, size_t event) {
+    if (gFailures++ < 10) printf("  FAIL %s (event %zu)\n", what, event);
+}
+
+static bool samePoint(TopoPoint a, TopoPoint b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+static void fakePost(DragPoster *poster, DragEventType type, TopoPoint point) {
+    (void)poster;
+    if (gPostDelayUs) usleep((useconds_t)gPostDelayUs);
+    size_t n = atomic_load(&gPostedCount);
+    if (n < MAX_EVENTS) {
+        gPosted[n] = (Posted){ type, point, benchNowNs() };
+        atomic_store(&gPostedCount, n + 1);
+    }
+}
+
+static DragPoster gPoster = { .post = fakePost };
+
+static void waitForMouseUp(size_t from) {
+    for (;;) {
+        size_t n = atomic_load(&gPostedCount);
+        for (size_t i = from; i < n; i++) {
+            if (gPosted[i].type == DRAG_MOUSE_UP) return;
+        }
+        usleep(200);
+    }
+}
+
+static void waitIdle(void) {
+    while (dragInProgress()) usleep(200);
+}
+
+// A whole drag from `from` on: press at the source, moves, release, with the
+// last move exactly on the target
+static void checkCompleted(size_t from, TopoPoint source, TopoPoint target) {
+    size_t n = atomic_load(&gPostedCount);
+    if (n - from < 3) {
+        fail("drag posted fewer than 3 events", from);
+        return;
+    }
+    if (gPosted[from].type != DRAG_MOUSE_DOWN || !samePoint(gPosted[from].point, source)) fail("drag does not start with a press at the source", from);
+    for (size_t i = from + 1; i + 1 < n; i++) {
+        if (gPosted[i].type != DRAG_MOUSE_DRAGGED) fail("not a move between press and release", i);
+    }
+    if (!samePoint(gPosted[n - 2].point, target)) fail("last move is not exactly on the target", n - 2);
+    if (gPosted[n - 1].type != DRAG_MOUSE_UP || !samePoint(gPosted[n - 1].point, target)) fail("drag does not end with a release on the target", n - 1);
+}
+
+// From `from` to `to`: one press, moves, and exactly one release, where the
+// button last was
+static void checkReleasedOnce(size_t from, size_t to) {
+    size_t ups = 0;
+    for (size_t i = from; i < to; i++) {
+        if (gPosted[i].type == DRAG_MOUSE_UP) ups++;
+    }
+    if (ups != 1) fail("interrupted drag not released exactly once", from);
+    if (to - from < 2 || gPosted[to - 1].type != DRAG_MOUSE_UP) {
+        fail("interrupted drag does not end with the release", to - 1);
+    } else if (!samePoint(gPosted[to - 1].point, gPosted[to - 2].point)) {
+        fail("interrupted drag released away from the current point", to - 1);
+    }
+}
+
+// Mean gap between consecutive moves from `from` on, in ns
+static double reportFrames(const char *name, size_t from) {
+    static uint64_t gaps[MAX_EVENTS];
+    size_t n = atomic_load(&gPostedCount), count = 0;
+    uint64_t total = 0;
+    for (size_t i = from + 1; i < n; i++) {
+        if (gPosted[i].type == DRAG_MOUSE_DRAGGED && gPosted[i - 1].type == DRAG_MOUSE_DRAGGED) {
+            gaps[count] = gPosted[i].at - gPosted[i - 1].at;
+            total += gaps[count++];
+        }
+    }
+    if (count) benchReport(name, gaps, count, total);
+    printf("  %-38s %zu events, %.1f ms press-to-release\n", "", n - from,
+           (gPosted[n - 1].at - gPosted[from].at) / 1e6);
+    return count ? (double)total / count : 0;
+}
+
+int main(void) {
+    DragOptions options = DRAG_DEFAULT_OPTIONS;
+    options.moveMs = 100;
+    options.settleMs = 40;
+    options.minSettleMs = 10;
+    dragEngineStart(&gPoster, &options);
+    TopoPoint from = { 100, 100 }, to = { 2500, 600 };
+
+    printf("bench_drag: frame-paced drag engine (fake poster)\n");
+
+    // Caller cost: what the event tap pays per drag hotkey.
+    static uint64_t samples[1000];
+    uint64_t total = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t t0 = benchNowNs();
+        dragRequest(from, to);
+        samples[i] = benchNowNs() - t0;
+        total += samples[i];
+        dragCancel();
+    }
+    benchReport("dragRequest()+dragCancel() caller cost", samples, 1000, total);
+    waitIdle();
+
+    size_t mark = atomic_load(&gPostedCount);
+    dragRequest(from, to);
+    waitForMouseUp(mark);
+    waitIdle();
+    reportFrames("frame gaps @60 Hz, instant poster", mark);
+    checkCompleted(mark, from, to);
+
+    gPostDelayUs = 12000; // slower than half a 60 Hz frame
+    mark = atomic_load(&gPostedCount);
+    dragRequest(from, to);
+    waitForMouseUp(mark);
+    waitIdle();
+    double slowGap = reportFrames("frame gaps @60 Hz, 12 ms poster", mark);
+    checkCompleted(mark, from, to);
+    gPostDelayUs = 0;
+    // Posting takes 12 ms, more than half a 16.7 ms frame: the interval must
+    // grow (to twice the latency) instead of staying at the frame rate
+    if (slowGap < 1.1e9 / options.frameRate) {
+        if (gFailures++ < 10) printf("  FAIL slow poster: mean frame gap %.2f ms, not above 1/frameRate\n", slowGap / 1e6);
+    }
+
+    // Cancellation: time from dragCancel() until the button is released.
+    uint64_t cancelTotal = 0;
+    static uint64_t cancelSamples[50];
+    for (int i = 0; i < 50; i++) {
+        mark = atomic_load(&gPostedCount);
+        dragRequest(from, to);
+        usleep(20000 + (useconds_t)(i * 1000));
+        uint64_t t0 = benchNowNs();
+        dragCancel();
+        waitForMouseUp(mark);
+        waitIdle();
+        size_t n = atomic_load(&gPostedCount);
+        cancelSamples[i] = gPosted[n - 1].at - t0;
+        cancelTotal += cancelSamples[i];
+        checkReleasedOnce(mark, n);
+    }
+    benchReport("cancel -> mouse up", cancelSamples, 50, cancelTotal);
+
+    // Superseding: the first drag is released where it is, then the second
+    // runs in full
+    TopoPoint from2 = { 300, 900 }, to2 = { 1700, 200 };
+    for (int i = 0; i < 20; i++) {
+        mark = atomic_load(&gPostedCount);
+        dragRequest(from, to);
+        usleep(20000 + (useconds_t)(i * 3000));
+        dragRequest(from2, to2);
+        waitIdle();
+        size_t n = atomic_load(&gPostedCount), second = n;
+        for (size_t j = mark + 1; j < n; j++) {
+            if (gPosted[j].type == DRAG_MOUSE_DOWN) {
+                second = j;
+                break;
+            }
+        }
+        if (second == n) {
+            fail("superseding drag never pressed", mark);
+            continue;
+        }
+        checkReleasedOnce(mark, second);
+        checkCompleted(second, from2, to2);
+    }
+
+    // Every press released before the next one, and the stats agree with the log
+    size_t n = atomic_load(&gPostedCount), downs = 0, ups = 0;
+    bool pressed = false;
+    if (n >= MAX_EVENTS) fail("event log full", n);
+    for (size_t i = 0; i < n; i++) {
+        if (gPosted[i].type == DRAG_MOUSE_DOWN) {
+            if (pressed) fail("press while the button is down", i);
+            pressed = true;
+            downs++;
+        } else if (gPosted[i].type == DRAG_MOUSE_UP) {
+            if (!pressed) fail("release while the button is up", i);
+            pressed = false;
+            ups++;
+        }
+    }
+    if (pressed) fail("button left down", n);
+
+    DragStats stats = dragGetStats();
+    printf("  started %llu completed %llu cancelled %llu events %llu post latency %.1f us\n",
+           (unsigned long long)stats.started, (unsigned long long)stats.completed,
+           (unsigned long long)stats.cancelled, (unsigned long long)stats.eventsPosted, stats.postLatencyUs);
+    if (stats.started != stats.completed + stats.cancelled) fail("started != completed + cancelled", n);
+    if (stats.started != downs || stats.completed + stats.cancelled != ups) fail("stats disagree with the posted events", n);
+    if (stats.eventsPosted != n) fail("eventsPosted disagrees with the posted events", n);
+    dragEngineStop();
+
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+// Display evacuation: the planner against its invariants with hundreds of
+// simulated windows (every window on the source display planned exactly
+// once, inside the target's usable area, no two on the same spot, nothing
+// else touched), then a whole evacuation through the hotkey path on the
+// simulated backend - one list query and concurrent moves - against
+// moving the same windows one hotkey press at a time. Exits non-zero if a
+// check fails.
+
+#include <math.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "evacuate.h"
+#include "frame.h"
+#include "mover.h"
+#include "switcher.h"
+
+#define PLAN_RUNS   50
+#define E2E_WINDOWS 200
+#define AX_CALL_US  1000      // assumed cost of one accessibility round trip
+
+static int gFailures;
+
+static void fail(const char *what, uint32_t n, uint32_t value) {
+    if (gFailures++ < 10) printf("  FAIL %s (%u windows): %u\n", what, n, value);
+}
+
+static bool inside(TopoRect r, TopoRect area) {
+    return r.x >= area.x && r.y >= area.y && r.x + r.width <= area.x + area.width &&
+           r.y + r.height <= area.y + area.height;
+}
+
+static double randomIn(uint32_t *seed, double lo, double hi) {
+    return round(lo + (hi - lo) * (benchRandom(seed) % 100000) / 100000.0);
+}
+
+// 60% of the windows on display 0, 25% on display 1, the rest on display 2;
+// a third of those on display 0 share one of a few frames (maximized,
+// centered, a corner), as freshly opened windows do.
+static void makeWindows(const TopoRect *usable, TopoRect *frames, uint32_t n, uint32_t seed) {
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t r = benchRandom(&seed) % 100;
+        int d = r < 60 ? 0 : r < 85 ? 1 : 2;
+        TopoRect area = usable[d];
+        if (d == 0 && benchRandom(&seed) % 3 == 0) {
+            static const TopoRect common[] = {
+                { 0, 0, 1920, 985 }, { 560, 200, 800, 600 }, { 0, 0, 1200, 800 }, { 100, 100, 640, 480 },
+            };
+            frames[i] = common[benchRandom(&seed) % 4];
+            frames[i].x += area.x;
+            frames[i].y += area.y;
+            continue;
+        }
+        double width = randomIn(&seed, 300, fmin(1200, area.width));
+        double height = randomIn(&seed, 200, fmin(800, area.height));
+        frames[i] = (TopoRect){ randomIn(&seed, area.x, area.x + area.width - width),
+                                randomIn(&seed, area.y, area.y + area.height - height), width, height };
+    }
+}
+
+static int64_t spotOf(TopoRect r, TopoRect area) {
+    int64_t cx = lround((r.x - area.x) / EVACUATE_CASCADE);
+    int64_t cy = lround((r.y - area.y) / EVACUATE_CASCADE);
+    return cx << 32 | (cy & 0xffffffff);
+}
+
+static int compareSpots(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void checkPlan(const Topology *topology, const TopoRect *usable, uint32_t n) {
+    TopoRect *frames = malloc(n * sizeof(*frames));
+    EvacuateMove *moves = malloc(EVACUATE_MAX_WINDOWS * sizeof(*moves));
+    int64_t *spots = malloc((n + EVACUATE_MAX_WINDOWS) * sizeof(*spots));
+    uint8_t *seen = calloc(n, 1);
+    makeWindows(usable, frames, n, 2024 + n);
+
+    EvacuatePlanOptions options = { .fromArea = usable[0], .toArea = usable[1] };
+    uint32_t planned = 0;
+    uint64_t t0 = benchNowNs();
+    for (int run = 0; run < PLAN_RUNS; run++) {
+        planned = evacuatePlan(topology, frames, n, 0, 1, &options, moves);
+    }
+    uint64_t elapsed = benchNowNs() - t0;
+
+    uint32_t onSource = 0, onTarget = 0, cascaded = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        int d = frameDisplayOf(topology, frames[i]);
+        if (d == 0) onSource++;
+        if (d == 1) spots[onTarget++] = spotOf(frames[i], usable[1]);
+    }
+    if (planned != onSource) fail("planned != windows on the source display", n, planned);
+    for (uint32_t i = 0; i < planned; i++) {
+        const EvacuateMove *move = &moves[i];
+        if (move->window >= n || frameDisplayOf(topology, frames[move->window]) != 0) {
+            fail("planned a window not on the source display", n, move->window);
+            continue;
+        }
+        if (seen[move->window]++) fail("window planned twice", n, move->window);
+        if (!inside(move->to, usable[1])) fail("planned frame outside the target area", n, move->window);
+        if (move->to.width != frames[move->window].width || move->to.height != frames[move->window].height) {
+            fail("window resized without window_scale", n, move->window);
+        }
+        cascaded += move->cascaded;
+        spots[onTarget + i] = spotOf(move->to, usable[1]);
+    }
+    // No moved window on the same spot as another window on the target, old
+    // or new (windows already there may share spots among themselves)
+    uint32_t total = onTarget + planned, shared = 0;
+    qsort(spots, onTarget, sizeof(*spots), compareSpots);
+    for (uint32_t i = 1; i < onTarget; i++) shared -= spots[i] == spots[i - 1];
+    qsort(spots, total, sizeof(*spots), compareSpots);
+    for (uint32_t i = 1; i < total; i++) shared += spots[i] == spots[i - 1];
+    if (shared) fail("windows sharing a spot", n, shared);
+
+    char name[64];
+    snprintf(name, sizeof(name), "plan %u windows", n);
+    printf("  %-38s %8.1f ns/window (%u moved, %u cascaded, %u already there, %s)\n", name,
+           (double)elapsed / PLAN_RUNS / (planned ? planned : 1), planned, cascaded, onTarget,
+           shared ? "spots shared" : "no shared spots");
+    free(frames);
+    free(moves);
+    free(spots);
+    free(seen);
+}
+
+static void waitIdle(void) {
+    while (moverBusy()) sched_yield();
+}
+
+int main(void) {
+    printf("bench_evacuate: display evacuation\n");
+
+    SimBackend sim;
+    simBackendInit(&sim);
+    DisplayInfo displays[3];
+    uint32_t count = simLayoutRow(displays, 3, 1920, 1080);
+    displays[1].bounds = (TopoRect){ 1920, 0, 2560, 1440 };
+    displays[2].bounds.x = 1920 + 2560;
+    simBackendSetDisplays(&sim, displays, count);
+    sim.primaryInsets = (FrameInsets){ .top = 25, .bottom = 70 };
+    sim.insets = (FrameInsets){ .top = 25 };
+    TopoRect usable[3];
+    for (uint32_t i = 0; i < count; i++) {
+        usable[i] = frameUsableArea(displays[i].bounds, i == 0 ? sim.primaryInsets : sim.insets);
+    }
+
+    Topology *topology = topologyCreate(displays, count);
+    static const uint32_t sizes[] = { 100, 300, 1000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) checkPlan(topology, usable, sizes[i]);
+    topologyDestroy(topology);
+
+    // End to end: the evacuate hotkey with every accessibility call costing AX_CALL_US
+    static TopoRect frames[E2E_WINDOWS], before[E2E_WINDOWS];
+    makeWindows(usable, frames, E2E_WINDOWS, 99);
+    memcpy(before, frames, sizeof(frames));
+    simBackendSetWindows(&sim, frames, E2E_WINDOWS);
+    sim.windowDelayUs = AX_CALL_US;
+    sim.cursor = (TopoPoint){ 900, 500 };
+    switcherInit(&sim.backend);
+    switcherRebuildTopology();
+    MoveOptions options = MOVE_DEFAULT_OPTIONS;
+    moverStart(&sim.backend, &options);
+
+    unsigned token;
+    const Topology *live = topologyAcquire(&token);
+    uint32_t onSource = 0;
+    for (uint32_t i = 0; i < E2E_WINDOWS; i++) onSource += frameDisplayOf(live, before[i]) == 0;
+    topologyRelease(token);
+
+    simBackendResetCounters(&sim);
+    uint64_t t0 = benchNowNs();
+    bool queued = evacuateDisplay(TOPO_NEXT);
+    uint64_t t1 = benchNowNs();
+    waitIdle();
+    uint64_t t2 = benchNowNs();
+    if (!queued) fail("evacuate not queued", E2E_WINDOWS, 0);
+
+    live = topologyAcquire(&token);
+    uint32_t left = 0, touched = 0;
+    for (uint32_t i = 0; i < E2E_WINDOWS; i++) {
+        int was = frameDisplayOf(live, before[i]);
+        int now = frameDisplayOf(live, sim.windows[i]);
+        if (was == 0 && (now != 1 || !inside(sim.windows[i], usable[1]))) left++;
+        if (was != 0 && memcmp(&before[i], &sim.windows[i], sizeof(TopoRect)) != 0) touched++;
+    }
+    topologyRelease(token);
+    if (left) fail("windows not moved to the target", E2E_WINDOWS, left);
+    if (touched) fail("windows on other displays moved", E2E_WINDOWS, touched);
+    MoveStats stats = moverGetStats();
+    if (stats.evacuations != 1) fail("evacuations completed", E2E_WINDOWS, (uint32_t)stats.evacuations);
+    uint64_t lists = atomic_load(&sim.calls.windowLists), moves = atomic_load(&sim.calls.windowMoves);
+    if (lists != 1 || moves != onSource) fail("window calls", E2E_WINDOWS, (uint32_t)(lists + moves));
+    printf("  %-38s %8.1f us caller, %8.1f ms to all placed (%u windows, %llu list query, %d workers)\n",
+           "evacuate hotkey", (double)(t1 - t0) / 1e3, (double)(t2 - t0) / 1e6, onSource,
+           (unsigned long long)lists, EVACUATE_WORKERS);
+    double evacuateMs = (double)(t2 - t0) / 1e6;
+
+    // The same windows sent over one at a time: focus, press the drag hotkey
+    moverStop();
+    simBackendSetWindows(&sim, before, E2E_WINDOWS);
+    MoveOptions focused = { .pick = WINDOW_FOCUSED };
+    simBackendResetCounters(&sim);
+    t0 = benchNowNs();
+    uint32_t oneByOne = 0;
+    for (uint32_t i = 0; i < E2E_WINDOWS; i++) {
+        live = topologyAcquire(&token);
+        bool mine = frameDisplayOf(live, before[i]) == 0;
+        topologyRelease(token);
+        if (!mine) continue;
+        sim.focusedWindow = i;
+        oneByOne += moverMoveWindow(&sim.backend, &focused, TOPO_NEXT, sim.cursor, NULL);
+    }
+    double serialMs = (double)(benchNowNs() - t0) / 1e6;
+    printf("  %-38s %8.1f ms (%u windows, %llu window calls) - evacuate is %.1fx faster\n",
+           "one move per window", serialMs, oneByOne,
+           (unsigned long long)(atomic_load(&sim.calls.windowFinds) + atomic_load(&sim.calls.windowMoves)),
+           serialMs / evacuateMs);
+    simBackendFree(&sim);
+
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,216 @@
+// Cost of one log call on the calling (event tap) thread: compiled out,
+// filtered at runtime, queued for the async writer, and the synchronous
+// unbuffered fprintf the tree used before, both into /dev/null and into a
+// pipe that is drained slowly (a stalled terminal or log collector).
+// Checks that deferred formatting matches snprintf and that every message
+// is either written or counted as dropped.
+
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "log.h"
+
+#define CALLS        20000
+#define BURST        128          // calls between pauses that let the writer drain
+#define PAUSE_NS     6000000
+#define THREADS      4
+#define PER_THREAD   20000
+
+static uint64_t gSamples[CALLS];
+static int      gFailures;
+
+static void letWriterDrain(void) {
+    nanosleep(&(struct timespec){ 0, PAUSE_NS }, NULL);
+}
+
+// What a switch logs on failure: a string, an int and a double
+#define SAMPLE_FORMAT "Cannot move cursor to display %s (%d): %.1f ms"
+#define SAMPLE_ARGS   "DELL U2720Q", i, 1.25
+
+typedef enum { MODE_MACRO_DEBUG, MODE_MACRO_INFO, MODE_FPRINTF } Mode;
+
+static void measure(const char *name, Mode mode, FILE *out, bool paced) {
+    uint64_t total = 0;
+    for (int i = 0; i < CALLS; i++) {
+        uint64_t t0 = benchNowNs();
+        switch (mode) {
+            case MODE_MACRO_DEBUG: LOG_DEBUG(SAMPLE_FORMAT, SAMPLE_ARGS); break;
+            case MODE_MACRO_INFO:  LOG_INFO(SAMPLE_FORMAT, SAMPLE_ARGS); break;
+            case MODE_FPRINTF:     fprintf(out, SAMPLE_FORMAT "\n", SAMPLE_ARGS); break;
+        }
+        gSamples[i] = benchNowNs() - t0;
+        total += gSamples[i];
+        if (paced && i % BURST == BURST - 1) letWriterDrain();
+    }
+    benchReport(name, gSamples, CALLS, total);
+}
+
+// A reader that drains a pipe at about 1 MB/s
+typedef struct {
+    int      fd;
+    uint64_t bytes;
+} SlowReader;
+
+static void *slowReaderMain(void *arg) {
+    SlowReader *reader = arg;
+    char buf[1024];
+    ssize_t n;
+    while ((n = read(reader->fd, buf, sizeof(buf))) > 0) {
+        reader->bytes += (uint64_t)n;
+        nanosleep(&(struct timespec){ 0, 1000000 }, NULL);
+    }
+    return NULL;
+}
+
+static void slowPipeCase(const char *name, Mode mode) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        perror("pipe");
+        exit(1);
+    }
+    SlowReader reader = { fds[0], 0 };
+    pthread_t thread;
+    pthread_create(&thread, NULL, slowReaderMain, &reader);
+
+    uint64_t droppedBefore = logDropped();
+    FILE *out = NULL;
+    if (mode == MODE_FPRINTF) {
+        out = fdopen(fds[1], "w");
+        setvbuf(out, NULL, _IONBF, 0);   // like stderr
+    } else {
+        char path[32];
+        snprintf(path, sizeof(path), "/dev/fd/%d", fds[1]);
+        logStart(path);
+    }
+    measure(name, mode, out, false);
+    if (mode == MODE_FPRINTF) {
+        fclose(out);
+    } else {
+        logStop();
+        close(fds[1]);
+        printf("  %-38s %llu of %d dropped instead of blocking\n", "",
+               (unsigned long long)(logDropped() - droppedBefore), CALLS);
+    }
+    pthread_join(thread, NULL);
+    close(fds[0]);
+}
+
+// --- Checks --------------------------------------------------------------------
+
+#define CHECK_FORMAT(...) do {                                                                  \
+        char expected_[256], actual_[256];                                                      \
+        snprintf(expected_, sizeof(expected_), __VA_ARGS__);                                   \
+        const LogArg args_[] = { LOG_CAT(LOG_MAP, LOG_COUNT(__VA_ARGS__))(__VA_ARGS__) };      \
+        logFormat(actual_, sizeof(actual_), LOG_FIRST(__VA_ARGS__), args_ + 1, LOG_COUNT(__VA_ARGS__) - 1); \
+        if (strcmp(expected_, actual_) != 0) {                                                  \
+            printf("  FORMAT MISMATCH: \"%s\" vs \"%s\"\n", expected_, actual_);               \
+            gFailures++;                                                                        \
+        }                                                                                       \
+    } while (0)
+
+static void checkFormatting(void) {
+    size_t bytes = 4096;
+    unsigned long long big = 18446744073709551615ull;
+    const char *name = "Built-in Retina Display";
+    CHECK_FORMAT("%d displays", 3);
+    CHECK_FORMAT("%s: %s", "config", "bad key");
+    CHECK_FORMAT("%5.2f ms|%-8.3e|%g", 1.23456, 0.000123, 1e10);
+    CHECK_FORMAT("%-6s|%4u|%x|%#o|%08X", "ab", 42u, 255u, 8u, 0xbeefu);
+    CHECK_FORMAT("%llu messages, %zu bytes, %ld", big, bytes, -7L);
+    CHECK_FORMAT("[%.5s] [%12s] %c%c", name, "right", 'o', 'k');
+    CHECK_FORMAT("100%% of %+d, % d", 5, 6);
+    CHECK_FORMAT("no arguments");
+    char longString[300];
+    memset(longString, 'x', sizeof(longString) - 1);
+    longString[sizeof(longString) - 1] = '\0';
+    char small[16];
+    const LogArg args[] = { LOG_ARG(longString) };
+    size_t length = logFormat(small, sizeof(small), "%s!", args, 1);
+    if (length != 300 || strlen(small) != sizeof(small) - 1) {
+        printf("  TRUNCATION MISMATCH: length %zu, wrote %zu\n", length, strlen(small));
+        gFailures++;
+    }
+}
+
+static void *floodMain(void *arg) {
+    int id = (int)(uintptr_t)arg;
+    for (int i = 0; i < PER_THREAD; i++) {
+        LOG_INFO("thread %d message %d", id, i);
+        if (i % 64 == 63) sched_yield();
+    }
+    return NULL;
+}
+
+// Every message lands in the file or in the drop count, never both
+static void checkAccounting(void) {
+    char path[] = "/tmp/bench_log_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror("mkstemp");
+        exit(1);
+    }
+    close(fd);
+
+    uint64_t droppedBefore = logDropped();
+    logStart(path);
+    pthread_t threads[THREADS];
+    uint64_t t0 = benchNowNs();
+    for (int t = 0; t < THREADS; t++) pthread_create(&threads[t], NULL, floodMain, (void *)(uintptr_t)t);
+    for (int t = 0; t < THREADS; t++) pthread_join(threads[t], NULL);
+    uint64_t elapsed = benchNowNs() - t0;
+    logStop();
+    uint64_t dropped = logDropped() - droppedBefore;
+
+    FILE *f = fopen(path, "r");
+    char line[512];
+    uint64_t lines = 0, dropReports = 0;
+    while (f && fgets(line, sizeof(line), f)) {
+        if (strstr(line, " messages dropped")) dropReports++;
+        else lines++;
+    }
+    if (f) fclose(f);
+    unlink(path);
+
+    uint64_t sent = (uint64_t)THREADS * PER_THREAD;
+    printf("  %-38s %llu written + %llu dropped of %llu (%.1f ns/call wall, %d threads)\n",
+           "flood, no pacing", (unsigned long long)lines, (unsigned long long)dropped,
+           (unsigned long long)sent, (double)elapsed / (double)sent, THREADS);
+    if (lines + dropped != sent || (dropped && !dropReports)) {
+        printf("  ACCOUNTING MISMATCH\n");
+        gFailures++;
+    }
+}
+
+int main(void) {
+    printf("bench_log: cost per log call on the calling thread (ns)\n");
+
+    FILE *devNull = fopen("/dev/null", "w");
+    setvbuf(devNull, NULL, _IONBF, 0);
+
+    logSetLevel(LOG_LEVEL_INFO);
+    measure("LOG_DEBUG, compiled out", MODE_MACRO_DEBUG, NULL, false);
+    logSetLevel(LOG_LEVEL_WARN);
+    measure("LOG_INFO, filtered at runtime", MODE_MACRO_INFO, NULL, false);
+    logSetLevel(LOG_LEVEL_INFO);
+
+    measure("fprintf, unbuffered, /dev/null", MODE_FPRINTF, devNull, false);
+    logStart("/dev/null");
+    measure("LOG_INFO, async, /dev/null", MODE_MACRO_INFO, NULL, true);
+    logStop();
+    fclose(devNull);
+
+    slowPipeCase("fprintf, unbuffered, slow pipe", MODE_FPRINTF);
+    slowPipeCase("LOG_INFO, async, slow pipe", MODE_MACRO_INFO);
+
+    checkFormatting();
+    checkAccounting();
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,188 @@
+// Window relocation: the frame geometry (usable areas, clamping, scaling,
+// relative position) against its invariants, then end-to-end latency of the
+// drag hotkey on the simulated backend - window mover (one lookup and one
+// frame change, each costing a simulated accessibility round trip) versus
+// the synthesized title-bar drag. Exits non-zero if a mapped frame breaks
+// an invariant or a moved window does not land on the target display.
+
+#include <math.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "frame.h"
+#include "mover.h"
+#include "switcher.h"
+
+#define MAPPINGS   200000
+#define MOVES      200
+#define DRAGS      6
+#define AX_CALL_US 1000       // assumed cost of one accessibility round trip
+
+static int gFailures;
+
+static void fail(const char *what, TopoRect r) {
+    if (gFailures++ < 10) printf("  FAIL %s: {%g, %g, %g x %g}\n", what, r.x, r.y, r.width, r.height);
+}
+
+static bool sameRect(TopoRect a, TopoRect b) {
+    return a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height;
+}
+
+static bool inside(TopoRect r, TopoRect area) {
+    return r.x >= area.x && r.y >= area.y && r.width >= 0 && r.height >= 0 &&
+           r.x + r.width <= area.x + area.width && r.y + r.height <= area.y + area.height;
+}
+
+static double randomIn(uint32_t *seed, double lo, double hi) {
+    return lo + (hi - lo) * (benchRandom(seed) % 100000) / 100000.0;
+}
+
+static void checkGeometry(void) {
+    TopoRect display = { 0, 0, 1920, 1080 };
+    FrameInsets menuAndDock = { .top = 25, .bottom = 70 };
+    TopoRect usable = frameUsableArea(display, menuAndDock);
+    if (!sameRect(usable, (TopoRect){ 0, 25, 1920, 985 })) fail("usable area", usable);
+    FrameInsets huge = { .top = 900, .bottom = 900, .left = -5 };
+    TopoRect squeezed = frameUsableArea(display, huge);
+    if (squeezed.height != 0 || squeezed.width != 1920) fail("oversized insets", squeezed);
+
+    TopoRect from = { 0, 25, 1920, 985 };
+    TopoRect to = { 1920, 25, 2560, 1415 };
+    // Centered stays centered, edges stay on their edges
+    TopoRect centered = frameMap((TopoRect){ 560, 217.5, 800, 600 }, from, to, false);
+    if (!sameRect(centered, (TopoRect){ 2800, 433, 800, 600 })) fail("centered window", centered);
+    TopoRect corner = frameMap((TopoRect){ 1120, 410, 800, 600 }, from, to, false);
+    if (!sameRect(corner, (TopoRect){ 3680, 840, 800, 600 })) fail("bottom-right window", corner);
+    // Too big for the target: shrunk to fit
+    TopoRect big = frameMap((TopoRect){ 0, 25, 2560, 1415 }, to, from, false);
+    if (!sameRect(big, from)) fail("oversized window", big);
+    // Scaled in proportion to the usable areas
+    TopoRect scaled = frameMap((TopoRect){ 0, 25, 960, 985 }, from, to, true);
+    if (!sameRect(scaled, (TopoRect){ 1920, 25, 1280, 1415 })) fail("scaled window", scaled);
+
+    // Random frames and areas: always inside the target, whole points, and
+    // a round trip between two areas the window fits returns it unchanged
+    uint32_t seed = 7;
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i < MAPPINGS; i++) {
+        TopoRect a = { randomIn(&seed, -3000, 3000), randomIn(&seed, -2000, 2000),
+                       randomIn(&seed, 800, 4000), randomIn(&seed, 600, 2500) };
+        TopoRect b = { randomIn(&seed, -3000, 3000), randomIn(&seed, -2000, 2000),
+                       randomIn(&seed, 800, 4000), randomIn(&seed, 600, 2500) };
+        a.x = round(a.x); a.y = round(a.y); a.width = round(a.width); a.height = round(a.height);
+        b.x = round(b.x); b.y = round(b.y); b.width = round(b.width); b.height = round(b.height);
+        TopoRect w = { a.x + randomIn(&seed, -200, a.width), a.y + randomIn(&seed, -200, a.height),
+                       randomIn(&seed, 100, 5000), randomIn(&seed, 100, 3000) };
+        bool scale = i & 1;
+        TopoRect m = frameMap(w, a, b, scale);
+        if (!inside(m, b)) fail("mapped frame outside target", m);
+        if (m.x != round(m.x) || m.y != round(m.y) || m.width != round(m.width) || m.height != round(m.height)) {
+            fail("fractional frame", m);
+        }
+        // Exact round trips need a window that already lies on whole points
+        // inside a and fits b; the slack fractions only survive rounding when
+        // b has at least as much free space as a
+        TopoRect fit = frameClamp((TopoRect){ round(w.x), round(w.y), fmin(round(w.width), b.width), fmin(round(w.height), b.height) }, a);
+        if (!scale && b.width - fit.width >= a.width - fit.width && b.height - fit.height >= a.height - fit.height) {
+            TopoRect back = frameMap(frameMap(fit, a, b, false), b, a, false);
+            if (fabs(back.x - fit.x) > 1 || fabs(back.y - fit.y) > 1 || back.width != fit.width || back.height != fit.height) {
+                fail("round trip", back);
+            }
+        }
+    }
+    uint64_t elapsed = benchNowNs() - t0;
+    printf("  %-38s %8.1f ns/mapping (%d random frames, %s)\n", "frameMap + checks", (double)elapsed / MAPPINGS,
+           MAPPINGS, gFailures ? "FAILED" : "all invariants hold");
+}
+
+static void waitIdle(bool (*busy)(void)) {
+    while (busy()) sched_yield();
+}
+
+int main(void) {
+    printf("bench_move: window relocation\n");
+    checkGeometry();
+
+    SimBackend sim;
+    simBackendInit(&sim);
+    DisplayInfo displays[3];
+    uint32_t count = simLayoutRow(displays, 3, 1920, 1080);
+    displays[1].bounds = (TopoRect){ 1920, 0, 2560, 1440 };
+    displays[2].bounds.x = 1920 + 2560;
+    simBackendSetDisplays(&sim, displays, count);
+    sim.primaryInsets = (FrameInsets){ .top = 25, .bottom = 70 };
+    sim.insets = (FrameInsets){ .top = 25 };
+    TopoRect window = { 560, 300, 800, 600 };
+    simBackendSetWindows(&sim, &window, 1);
+    sim.windowDelayUs = AX_CALL_US;
+    switcherInit(&sim.backend);
+    switcherRebuildTopology();
+
+    MoveOptions options = MOVE_DEFAULT_OPTIONS;
+    moverStart(&sim.backend, &options);
+    switcherSetWindowMode(WINDOW_MODE_MOVE);
+
+    static uint64_t caller[MOVES], endToEnd[MOVES];
+    uint64_t callerTotal = 0, total = 0;
+    TopoRect usable[3];
+    for (uint32_t i = 0; i < count; i++) {
+        usable[i] = frameUsableArea(displays[i].bounds, i == 0 ? sim.primaryInsets : sim.insets);
+    }
+    for (int i = 0; i < MOVES; i++) {
+        uint64_t t0 = benchNowNs();
+        dragWindowBetweenDisplays(TOPO_NEXT);
+        uint64_t t1 = benchNowNs();
+        waitIdle(moverBusy);
+        caller[i] = t1 - t0;
+        endToEnd[i] = benchNowNs() - t0;
+        callerTotal += caller[i];
+        total += endToEnd[i];
+
+        // The window must be on the next display's usable area, cursor on it
+        TopoRect now = sim.windows[0];
+        if (!inside(now, usable[(i + 1) % 3])) fail("moved window", now);
+        if (!topoRectContains(now, sim.cursor)) fail("cursor left behind", now);
+    }
+    benchReport("move: hotkey caller cost", caller, MOVES, callerTotal);
+    benchReport("move: hotkey to window placed", endToEnd, MOVES, total);
+    MoveStats stats = moverGetStats();
+    printf("  %-38s %llu moved, %llu failed, %llu window lookups, %llu frame changes (%d us each)\n", "",
+           (unsigned long long)stats.completed, (unsigned long long)stats.failed,
+           (unsigned long long)atomic_load(&sim.calls.windowFinds),
+           (unsigned long long)atomic_load(&sim.calls.windowMoves), AX_CALL_US);
+    if (stats.completed != MOVES) {
+        printf("  FAIL: %llu of %d moves completed\n", (unsigned long long)stats.completed, MOVES);
+        gFailures++;
+    }
+    moverStop();
+
+    // The same hotkey with the synthesized drag (default pacing)
+    switcherSetWindowMode(WINDOW_MODE_DRAG);
+    DragOptions dragOptions = DRAG_DEFAULT_OPTIONS;
+    dragEngineStart(switcherDragPoster(), &dragOptions);
+    callerTotal = total = 0;
+    for (int i = 0; i < DRAGS; i++) {
+        uint64_t t0 = benchNowNs();
+        dragWindowBetweenDisplays(TOPO_NEXT);
+        uint64_t t1 = benchNowNs();
+        waitIdle(dragInProgress);
+        caller[i] = t1 - t0;
+        endToEnd[i] = benchNowNs() - t0;
+        callerTotal += caller[i];
+        total += endToEnd[i];
+    }
+    benchReport("drag: hotkey caller cost", caller, DRAGS, callerTotal);
+    benchReport("drag: hotkey to button released", endToEnd, DRAGS, total);
+    printf("  %-38s %llu mouse events for %d drags\n", "",
+           (unsigned long long)atomic_load(&sim.calls.mousePosts), DRAGS);
+    dragEngineStop();
+    simBackendFree(&sim);
+
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,162 @@
+// Neighbor graph and spatial index over synthetic layouts: rows, stacked
+// grids, irregular attached layouts and a large video wall. Reports build
+// cost and point-lookup cost, and cross-checks the grid index against a
+// linear scan and every neighbor edge against its direction.
+
+#include <string.h>
+
+#include "bench.h"
+#include "topology.h"
+
+#define MAX_DISPLAYS   256
+#define RANDOM_LAYOUTS 300
+#define PROBES         2000
+
+static const TopoRect gSizes[] = {
+    { 0, 0, 1440, 900 }, { 0, 0, 1920, 1080 }, { 0, 0, 2560, 1440 },
+    { 0, 0, 1080, 1920 }, { 0, 0, 1728, 1117 }, { 0, 0, 3840, 2160 },
+};
+
+static bool rectsOverlap(const TopoRect *a, const TopoRect *b) {
+    return a->x < b->x + b->width && b->x < a->x + a->width &&
+           a->y < b->y + b->height && b->y < a->y + a->height;
+}
+
+// Attach each new display to a random side of a random existing one.
+static uint32_t makeIrregular(DisplayInfo *out, uint32_t want, uint32_t *seed) {
+    uint32_t count = 0;
+    out[count++] = (DisplayInfo){ .id = 1, .bounds = gSizes[1], .scale = 2.0 };
+    for (uint32_t attempts = 0; count < want && attempts < want * 50; attempts++) {
+        TopoRect r = gSizes[benchRandom(seed) % (sizeof(gSizes) / sizeof(gSizes[0]))];
+        const TopoRect *base = &out[benchRandom(seed) % count].bounds;
+        double slide = (double)(benchRandom(seed) % 1000) / 1000.0 - 0.5;
+        switch (benchRandom(seed) % 4) {
+            case 0: r.x = base->x - r.width;  r.y = base->y + slide * base->height; break;
+            case 1: r.x = base->x + base->width; r.y = base->y + slide * base->height; break;
+            case 2: r.y = base->y - r.height; r.x = base->x + slide * base->width; break;
+            default: r.y = base->y + base->height; r.x = base->x + slide * base->width; break;
+        }
+        bool clash = false;
+        for (uint32_t i = 0; i < count && !clash; i++) clash = rectsOverlap(&r, &out[i].bounds);
+        if (clash) continue;
+        out[count] = (DisplayInfo){ .id = count + 1, .bounds = r, .scale = 1.0 };
+        count++;
+    }
+    return count;
+}
+
+static uint32_t makeWall(DisplayInfo *out, uint32_t columns, uint32_t rows) {
+    uint32_t count = 0;
+    for (uint32_t row = 0; row < rows; row++) {
+        for (uint32_t col = 0; col < columns; col++) {
+            out[count] = (DisplayInfo){ .id = count + 1, .bounds = { col * 1920.0, row * 1080.0, 1920, 1080 }, .scale = 1.0 };
+            count++;
+        }
+    }
+    return count;
+}
+
+static int linearDisplayAt(const Topology *t, TopoPoint p) {
+    for (uint32_t i = 0; i < t->count; i++) {
+        if (topoRectContains(t->displays[i].bounds, p)) return (int)i;
+    }
+    return -1;
+}
+
+static bool edgeIsValid(const Topology *t, uint32_t from, TopoDirection d, int32_t to) {
+    const TopoRect *a = &t->displays[from].bounds, *b = &t->displays[to].bounds;
+    switch (d) {
+        case TOPO_LEFT:  return b->x + b->width <= a->x + 1.0;
+        case TOPO_RIGHT: return b->x >= a->x + a->width - 1.0;
+        case TOPO_UP:    return b->y + b->height <= a->y + 1.0;
+        default:         return b->y >= a->y + a->height - 1.0;
+    }
+}
+
+// Returns the number of inconsistencies found.
+static uint32_t checkLayout(const Topology *t, uint32_t *seed, uint64_t *lookupNs, uint64_t *lookups) {
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < t->count; i++) {
+        for (int d = 0; d < TOPO_EDGE_DIRECTIONS; d++) {
+            int32_t n = t->neighbors[i][d];
+            if (n >= 0 && (n == (int32_t)i || !edgeIsValid(t, i, (TopoDirection)d, n))) errors++;
+        }
+    }
+    TopoPoint probes[PROBES];
+    for (int k = 0; k < PROBES; k++) {
+        probes[k].x = t->extent.x + (benchRandom(seed) % 100000) / 100000.0 * t->extent.width;
+        probes[k].y = t->extent.y + (benchRandom(seed) % 100000) / 100000.0 * t->extent.height;
+    }
+    volatile int sink = 0;
+    uint64_t t0 = benchNowNs();
+    for (int k = 0; k < PROBES; k++) sink += topologyDisplayAt(t, probes[k]);
+    *lookupNs += benchNowNs() - t0;
+    *lookups += PROBES;
+    for (int k = 0; k < PROBES; k++) {
+        if (topologyDisplayAt(t, probes[k]) != linearDisplayAt(t, probes[k])) errors++;
+    }
+    (void)sink;
+    return errors;
+}
+
+static uint32_t runSet(const char *name, DisplayInfo *displays, uint32_t layouts,
+                       uint32_t (*make)(DisplayInfo *, uint32_t *), uint32_t *seed) {
+    uint64_t buildNs = 0, lookupNs = 0, lookups = 0, totalDisplays = 0;
+    uint32_t errors = 0;
+    for (uint32_t l = 0; l < layouts; l++) {
+        uint32_t count = make(displays, seed);
+        uint64_t t0 = benchNowNs();
+        Topology *t = topologyCreate(displays, count);
+        buildNs += benchNowNs() - t0;
+        if (!t) return errors + 1;
+        errors += checkLayout(t, seed, &lookupNs, &lookups);
+        totalDisplays += count;
+        topologyDestroy(t);
+    }
+    printf("  %-28s %4u layouts  avg %5.1f displays  build %9.1f us  lookup %6.1f ns  errors %u\n",
+           name, layouts, (double)totalDisplays / layouts, buildNs / 1000.0 / layouts,
+           (double)lookupNs / (double)lookups, errors);
+    return errors;
+}
+
+static uint32_t makeSmallIrregular(DisplayInfo *out, uint32_t *seed) {
+    return makeIrregular(out, 2 + benchRandom(seed) % 15, seed);
+}
+
+static uint32_t makeLargeIrregular(DisplayInfo *out, uint32_t *seed) {
+    return makeIrregular(out, 17 + benchRandom(seed) % 48, seed);
+}
+
+static uint32_t makeRandomWall(DisplayInfo *out, uint32_t *seed) {
+    return makeWall(out, 2 + benchRandom(seed) % 15, 1 + benchRandom(seed) % 8);
+}
+
+static uint32_t makeBigWall(DisplayInfo *out, uint32_t *seed) {
+    (void)seed;
+    return makeWall(out, 16, 16);
+}
+
+int main(void) {
+    static DisplayInfo displays[MAX_DISPLAYS];
+    uint32_t seed = 0x5eed;
+    uint32_t errors = 0;
+
+    printf("bench_neighbors: neighbor graph + grid index over synthetic layouts\n");
+    errors += runSet("irregular, 2-16 displays", displays, RANDOM_LAYOUTS, makeSmallIrregular, &seed);
+    errors += runSet("irregular, 17-64 displays", displays, RANDOM_LAYOUTS, makeLargeIrregular, &seed);
+    errors += runSet("grid walls, up to 16x8", displays, RANDOM_LAYOUTS, makeRandomWall, &seed);
+    errors += runSet("video wall 16x16", displays, 10, makeBigWall, &seed);
+
+    // Direction resolution on a wall must be exact.
+    uint32_t count = makeWall(displays, 4, 3);
+    Topology *wall = topologyCreate(displays, count);
+    if (topologyNeighbor(wall, 5, TOPO_RIGHT) != 6 || topologyNeighbor(wall, 5, TOPO_UP) != 1 ||
+        topologyNeighbor(wall, 5, TOPO_DOWN) != 9 || topologyNeighbor(wall, 7, TOPO_RIGHT) != 4) {
+        printf("  wall neighbor resolution: WRONG\n");
+        errors++;
+    }
+    topologyDestroy(wall);
+
+    if (errors) printf("bench_neighbors: %u inconsistencies\n", errors);
+    return errors ? 1 : 0;
+}
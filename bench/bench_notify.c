@@ -0,0 +1,291 @@
+// Notification queue through the file sink, headless: a burst posted while
+// the worker waits out the rate limit is coalesced to the newest message
+// of each kind, minIntervalMs bounds the delivery rate of a steady stream,
+// delivered plus coalesced accounts for every posted message, and
+// notifyStop() delivers what is still queued, also with other threads
+// posting while it runs. Also the cost of a post on the calling thread.
+// Exits non-zero if a check fails.
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "log.h"
+#include "notify.h"
+
+#define INTERVAL_MS  200
+#define BURST_CURSOR 40
+#define BURST_DRAG   20
+#define STREAM_MS    1000
+#define STREAM_GAP_MS 10
+#define POSTS        1000000
+
+static int gFailures;
+
+static void fail(const char *what, long long got, long long want) {
+    if (gFailures++ < 10) printf("  FAIL %s: %lld, expected %lld\n", what, got, want);
+}
+
+static char gPath[] = "/tmp/bench_notify.XXXXXX";
+
+typedef struct {
+    long long ms;          // delivery time (file sink timestamp)
+    char      message[160];
+} Line;
+
+// The sink's lines so far: "<sec>.<ms> <title>: <message>"
+static int readLines(Line *lines, int max) {
+    FILE *f = fopen(gPath, "r");
+    if (!f) return 0;
+    char buf[256];
+    int n = 0;
+    while (n < max && fgets(buf, sizeof(buf), f)) {
+        long long sec;
+        long msec;
+        int offset = 0;
+        if (sscanf(buf, "%lld.%ld %*[^:]: %n", &sec, &msec, &offset) < 2 || !offset) continue;
+        lines[n].ms = sec * 1000 + msec;
+        snprintf(lines[n].message, sizeof(lines[n].message), "%s", buf + offset);
+        lines[n].message[strcspn(lines[n].message, "\n")] = '\0';
+        n++;
+    }
+    fclose(f);
+    return n;
+}
+
+static bool start(uint32_t intervalMs) {
+    if (truncate(gPath, 0) != 0) return false;
+    NotifySink sink;
+    NotifyOptions options = { .minIntervalMs = intervalMs };
+    return notifySinkFile(&sink, gPath) && notifyStart(&sink, &options);
+}
+
+static void waitDelivered(uint64_t count) {
+    uint64_t deadline = benchNowNs() + 5000000000ull;
+    while (notifyGetStats().delivered < count && benchNowNs() < deadline) usleep(1000);
+}
+
+static NotifyEvent cursorAt(double x) {
+    return (NotifyEvent){ .kind = NOTIFY_CURSOR_MOVED, .x = x, .y = 1 };
+}
+
+static NotifyEvent dragTo(double x) {
+    return (NotifyEvent){ .kind = NOTIFY_WINDOW_DRAGGED, .fromX = 0, .fromY = 0, .x = x, .y = 2 };
+}
+
+// One message, then a burst of two kinds while the worker waits out the interval
+static void checkBurst(void) {
+    NotifyStats before = notifyGetStats();
+    if (!start(INTERVAL_MS)) {
+        fail("cannot start the file sink", 0, 1);
+        return;
+    }
+    NotifyEvent first = cursorAt(1);
+    notifyPost(&first);
+    waitDelivered(before.delivered + 1);
+    for (int i = 0; i < BURST_CURSOR; i++) {
+        NotifyEvent event = cursorAt(100 + i);
+        notifyPost(&event);
+        if (i < BURST_DRAG) {
+            event = dragTo(500 + i);
+            notifyPost(&event);
+        }
+    }
+    waitDelivered(before.delivered + 3);
+    notifyStop();
+
+    NotifyStats after = notifyGetStats();
+    uint64_t posted = after.posted - before.posted, delivered = after.delivered - before.delivered;
+    uint64_t coalesced = after.coalesced - before.coalesced, dropped = after.dropped - before.dropped;
+    if (posted != 1 + BURST_CURSOR + BURST_DRAG) fail("burst posted", (long long)posted, 1 + BURST_CURSOR + BURST_DRAG);
+    if (dropped) fail("burst dropped", (long long)dropped, 0);
+    if (delivered != 3) fail("burst delivered (first, newest cursor, newest drag)", (long long)delivered, 3);
+    if (coalesced != BURST_CURSOR + BURST_DRAG - 2) fail("burst coalesced", (long long)coalesced, BURST_CURSOR + BURST_DRAG - 2);
+    if (delivered + coalesced != posted) fail("delivered + coalesced", (long long)(delivered + coalesced), (long long)posted);
+
+    Line lines[8];
+    int n = readLines(lines, 8);
+    char newestCursor[160], newestDrag[160];
+    snprintf(newestCursor, sizeof(newestCursor), "Cursor at X: %d, Y: 1", 100 + BURST_CURSOR - 1);
+    snprintf(newestDrag, sizeof(newestDrag), "Attempted to drag window from (0,0) to (%d,2)", 500 + BURST_DRAG - 1);
+    if (n != 3) {
+        fail("lines written", n, 3);
+    } else {
+        if (strcmp(lines[0].message, "Cursor at X: 1, Y: 1") != 0) fail("first message not delivered as posted", 0, 1);
+        if (strcmp(lines[1].message, newestCursor) != 0) fail("burst: cursor message is not the newest", 0, 1);
+        if (strcmp(lines[2].message, newestDrag) != 0) fail("burst: drag message is not the newest", 0, 1);
+        if (lines[1].ms - lines[0].ms < INTERVAL_MS - 1) fail("burst delivered before the interval (ms)", lines[1].ms - lines[0].ms, INTERVAL_MS);
+    }
+    printf("  %-38s %llu posted, %llu delivered, %llu coalesced, gap %lld ms (min %d)\n", "burst under the rate limit",
+           (unsigned long long)posted, (unsigned long long)delivered, (unsigned long long)coalesced,
+           n == 3 ? lines[1].ms - lines[0].ms : -1, INTERVAL_MS);
+}
+
+// A message every STREAM_GAP_MS for STREAM_MS: at most one delivery per interval
+static void checkRate(void) {
+    enum { INTERVAL = 100 };
+    NotifyStats before = notifyGetStats();
+    if (!start(INTERVAL)) {
+        fail("cannot start the file sink", 0, 1);
+        return;
+    }
+    int posts = 0;
+    uint64_t t0 = benchNowNs();
+    for (int t = 0; t < STREAM_MS; t += STREAM_GAP_MS) {
+        NotifyEvent event = cursorAt(posts++);
+        notifyPost(&event);
+        usleep(STREAM_GAP_MS * 1000);
+    }
+    notifyStop();
+    long long elapsedMs = (long long)((benchNowNs() - t0) / 1000000);
+    NotifyStats after = notifyGetStats();
+    uint64_t delivered = after.delivered - before.delivered, coalesced = after.coalesced - before.coalesced;
+    long long most = elapsedMs / INTERVAL + 2;   // the first message, plus the flush at stop
+    if ((long long)delivered > most) fail("deliveries in a rate-limited stream", (long long)delivered, most);
+    if (delivered + coalesced != (uint64_t)posts) fail("delivered + coalesced in the stream", (long long)(delivered + coalesced), posts);
+
+    static Line lines[STREAM_MS / STREAM_GAP_MS + 1];
+    int n = readLines(lines, STREAM_MS / STREAM_GAP_MS + 1);
+    long long minGap = -1;
+    // All but the flush at stop respect the interval
+    for (int i = 1; i + 1 < n; i++) {
+        long long gap = lines[i].ms - lines[i - 1].ms;
+        if (minGap < 0 || gap < minGap) minGap = gap;
+    }
+    if (minGap >= 0 && minGap < INTERVAL - 1) fail("deliveries closer than the interval (ms)", minGap, INTERVAL);
+    char last[160];
+    snprintf(last, sizeof(last), "Cursor at X: %d, Y: 1", posts - 1);
+    if (n == 0 || strcmp(lines[n - 1].message, last) != 0) fail("stream: last message not delivered", 0, 1);
+    printf("  %-38s %d posted, %llu delivered, %llu coalesced, min gap %lld ms (min %d)\n", "steady stream, 100 ms limit",
+           posts, (unsigned long long)delivered, (unsigned long long)coalesced, minGap, INTERVAL);
+}
+
+// Posted right before stopping, inside the rate-limit interval: still delivered
+static void checkStopDrains(void) {
+    NotifyStats before = notifyGetStats();
+    if (!start(INTERVAL_MS)) {
+        fail("cannot start the file sink", 0, 1);
+        return;
+    }
+    NotifyEvent event = cursorAt(7);
+    notifyPost(&event);
+    waitDelivered(before.delivered + 1);
+    event = dragTo(8);
+    notifyPost(&event);
+    event = cursorAt(9);
+    notifyPost(&event);
+    notifyStop();
+    NotifyStats after = notifyGetStats();
+    if (after.delivered - before.delivered != 3) fail("delivered by notifyStop", (long long)(after.delivered - before.delivered), 3);
+    Line lines[8];
+    int n = readLines(lines, 8);
+    bool cursor = false, drag = false;
+    for (int i = 1; i < n; i++) {
+        cursor |= strcmp(lines[i].message, "Cursor at X: 9, Y: 1") == 0;
+        drag |= strcmp(lines[i].message, "Attempted to drag window from (0,0) to (8,2)") == 0;
+    }
+    if (n != 3 || !cursor || !drag) fail("messages flushed by notifyStop", n, 3);
+    if (notifyPost(&event)) fail("post accepted after notifyStop", 1, 0);
+    printf("  %-38s %s\n", "notifyStop drains the queue", cursor && drag ? "ok" : "FAILED");
+}
+
+static void discard(NotifySink *sink, const char *title, const char *message) {
+    (void)sink;
+    (void)title;
+    (void)message;
+}
+
+#define POSTERS 4
+#define CYCLES  300
+
+static _Atomic bool     gPostersDone;
+static _Atomic uint64_t gAccepted;
+
+static void *posterThread(void *arg) {
+    (void)arg;
+    uint64_t accepted = 0;
+    for (uint32_t i = 0; !atomic_load(&gPostersDone); i++) {
+        NotifyEvent event = cursorAt(i);
+        accepted += notifyPost(&event);
+        if ((i & 63) == 63) sched_yield();
+    }
+    atomic_fetch_add(&gAccepted, accepted);
+    return NULL;
+}
+
+// Threads post while the subsystem starts and stops under them: every
+// accepted post must be delivered or coalesced by the stop that follows it
+static void checkStopWhilePosting(void) {
+    NotifySink sink = { .name = "discard", .deliver = discard };
+    NotifyOptions options = { 0 };
+    NotifyStats before = notifyGetStats();
+    pthread_t threads[POSTERS];
+    atomic_store(&gPostersDone, false);
+    atomic_store(&gAccepted, 0);
+    for (int i = 0; i < POSTERS; i++) pthread_create(&threads[i], NULL, posterThread, NULL);
+    for (int cycle = 0; cycle < CYCLES; cycle++) {
+        if (!notifyStart(&sink, &options)) {
+            fail("notifyStart after notifyStop", 0, 1);
+            break;
+        }
+        usleep(200);
+        notifyStop();
+    }
+    atomic_store(&gPostersDone, true);
+    for (int i = 0; i < POSTERS; i++) pthread_join(threads[i], NULL);
+    NotifyStats after = notifyGetStats();
+    uint64_t accepted = atomic_load(&gAccepted);
+    uint64_t handled = (after.delivered - before.delivered) + (after.coalesced - before.coalesced);
+    if (after.posted - before.posted != accepted) fail("posted while stopping", (long long)(after.posted - before.posted), (long long)accepted);
+    if (handled != accepted) fail("accepted posts delivered or coalesced", (long long)handled, (long long)accepted);
+    printf("  %-38s %d start/stop cycles, %llu posts accepted, all %s\n", "stop with 4 threads posting", CYCLES,
+           (unsigned long long)accepted, handled == accepted ? "handled" : "NOT handled");
+}
+
+static void timePosts(void) {
+    NotifySink sink = { .name = "discard", .deliver = discard };
+    NotifyOptions options = { 0 };
+    notifyStart(&sink, &options);
+    NotifyStats before = notifyGetStats();
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i < POSTS; i++) {
+        NotifyEvent event = cursorAt(i);
+        notifyPost(&event);
+    }
+    uint64_t elapsed = benchNowNs() - t0;
+    notifyStop();
+    NotifyStats after = notifyGetStats();
+    uint64_t accounted = (after.delivered - before.delivered) + (after.coalesced - before.coalesced) +
+                         (after.dropped - before.dropped);
+    if (accounted != POSTS) fail("posts unaccounted for", (long long)accounted, POSTS);
+    printf("  %-38s %6.1f ns/post (%llu dropped on a full queue)\n", "notifyPost, caller", (double)elapsed / POSTS,
+           (unsigned long long)(after.dropped - before.dropped));
+}
+
+int main(void) {
+    printf("bench_notify: notification queue (file sink)\n");
+    logSetLevel(LOG_LEVEL_ERROR);
+    int fd = mkstemp(gPath);
+    if (fd < 0) {
+        printf("  FAIL cannot create %s\n", gPath);
+        return 1;
+    }
+    close(fd);
+
+    checkBurst();
+    checkRate();
+    checkStopDrains();
+    checkStopWhilePosting();
+    timePosts();
+    unlink(gPath);
+
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,184 @@
+// Config hot reload: latency from saving config.ini to the new bindings
+// being live (file watcher + debounce + parse + swap), the parse/swap cost
+// alone, and dispatch latency on a "tap" thread while reloads happen
+// underneath it. Exits non-zero if a reload is missed, a bad config
+// replaces the bindings, or the wrong bindings end up live.
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "config.h"
+#include "configwatch.h"
+#include "stats.h"
+#include "switcher.h"
+
+#define EDITS         40
+#define DIRECT_RELOADS 2000
+#define TAP_SAMPLES   (1 << 21)
+#define DEBOUNCE_MS   10
+
+static char              gPath[PATH_MAX];
+static char              gTmpPath[PATH_MAX];
+static _Atomic bool      gStop;
+static uint64_t          gTapSamples[TAP_SAMPLES];
+static size_t            gTapCount;
+
+static void writeConfig(const char *switchHotkey, bool atomicSave) {
+    const char *target = atomicSave ? gTmpPath : gPath;
+    FILE *f = fopen(target, "w");
+    fprintf(f, "; generated by bench_reload\nswitch_hotkey=%s\nexit_hotkey=Control+Option+Command+Q\n", switchHotkey);
+    fclose(f);
+    if (atomicSave) rename(gTmpPath, gPath);
+}
+
+static void configChanged(const char *path, void *context) {
+    (void)context;
+    char error[256];
+    configReloadHotkeys(path, error, sizeof(error));
+}
+
+// Stand-in for the event tap: dispatch keystrokes as fast as possible
+static void *tapThread(void *arg) {
+    (void)arg;
+    uint32_t seed = 3;
+    while (!atomic_load_explicit(&gStop, memory_order_relaxed) && gTapCount < TAP_SAMPLES) {
+        uint16_t keyCode = benchRandom(&seed) % 4 == 0 ? KEYCODE_SPACE : (uint16_t)(benchRandom(&seed) % 0x30);
+        uint64_t t0 = benchNowNs();
+        switcherHandleKey(keyCode, MOD_CONTROL, 0, false);
+        gTapSamples[gTapCount++] = benchNowNs() - t0;
+    }
+    return NULL;
+}
+
+static bool waitForCounter(StatsCounter counter, uint64_t target, uint64_t timeoutNs) {
+    uint64_t deadline = benchNowNs() + timeoutNs;
+    while (statsCounter(counter) < target) {
+        if (benchNowNs() > deadline) return false;
+        usleep(100);
+    }
+    return true;
+}
+
+static void runTap(const char *label, void (*work)(int *errors), int *errors) {
+    pthread_t tap;
+    gTapCount = 0;
+    atomic_store(&gStop, false);
+    pthread_create(&tap, NULL, tapThread, NULL);
+    work(errors);
+    atomic_store(&gStop, true);
+    pthread_join(tap, NULL);
+    uint64_t total = 0;
+    for (size_t i = 0; i < gTapCount; i++) total += gTapSamples[i];
+    benchReport(label, gTapSamples, gTapCount, total);
+}
+
+static void idle(int *errors) {
+    (void)errors;
+    usleep(200000);
+}
+
+static void directReloads(int *errors) {
+    for (int i = 0; i < DIRECT_RELOADS; i++) {
+        writeConfig(i & 1 ? "Option+Space" : "Control+Space", false);
+        char error[256];
+        if (!configReloadHotkeys(gPath, error, sizeof(error))) {
+            fprintf(stderr, "  ERROR: reload failed: %s\n", error);
+            (*errors)++;
+            return;
+        }
+    }
+}
+
+int main(void) {
+    char dir[] = "/tmp/bench_reload.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    snprintf(gPath, sizeof(gPath), "%s/config.ini", dir);
+    snprintf(gTmpPath, sizeof(gTmpPath), "%s/.config.ini.tmp", dir);
+
+    SimBackend sim;
+    DisplayInfo displays[2];
+    simBackendInit(&sim);
+    simBackendSetDisplays(&sim, displays, simLayoutRow(displays, 2, 1920, 1080));
+    switcherInit(&sim.backend);
+    switcherRebuildTopology();
+
+    writeConfig("Control+Space", false);
+    char error[256];
+    if (!configReloadHotkeys(gPath, error, sizeof(error))) {
+        fprintf(stderr, "initial load failed: %s\n", error);
+        return 1;
+    }
+
+    int errors = 0;
+    printf("bench_reload: config hot reload\n");
+
+    // Parse + swap cost with a busy tap thread, and the tap's view of it
+    runTap("tap dispatch, no reloads", idle, &errors);
+    runTap("tap dispatch, back-to-back reloads", directReloads, &errors);
+    const Histogram *reload = statsPhaseHistogram(PHASE_CONFIG_RELOAD);
+    printf("  %-38s p50 %8llu ns  p99 %8llu ns\n", "parse + compile + swap",
+           (unsigned long long)histogramPercentile(reload, 50.0),
+           (unsigned long long)histogramPercentile(reload, 99.0));
+
+    // End to end through the file watcher: save -> bindings live
+    if (!configWatchStart(gPath, DEBOUNCE_MS, configChanged, NULL)) {
+        fprintf(stderr, "  ERROR: cannot watch %s\n", gPath);
+        return 1;
+    }
+    static uint64_t latencies[EDITS];
+    uint64_t total = 0;
+    for (int i = 0; i < EDITS; i++) {
+        bool optionSpace = i % 2 == 0;
+        uint64_t before = statsCounter(COUNTER_CONFIG_RELOADS);
+        uint64_t t0 = benchNowNs();
+        writeConfig(optionSpace ? "Option+Space" : "Control+Space", i % 4 >= 2);
+        if (!waitForCounter(COUNTER_CONFIG_RELOADS, before + 1, 2000000000ull)) {
+            fprintf(stderr, "  ERROR: edit %d was not picked up\n", i);
+            errors++;
+            break;
+        }
+        latencies[i] = benchNowNs() - t0;
+        total += latencies[i];
+        bool live = switcherHandleKey(KEYCODE_SPACE, optionSpace ? MOD_OPTION : MOD_CONTROL, 0, false);
+        bool stale = switcherHandleKey(KEYCODE_SPACE, optionSpace ? MOD_CONTROL : MOD_OPTION, 0, false);
+        if (!live || stale) {
+            fprintf(stderr, "  ERROR: wrong bindings live after edit %d\n", i);
+            errors++;
+        }
+        usleep(2 * DEBOUNCE_MS * 1000);
+    }
+    printf("  save -> live (debounce %d ms, in-place and rename saves)\n", DEBOUNCE_MS);
+    benchReport("watcher reload latency", latencies, EDITS, total);
+
+    // A broken config must leave the previous bindings in place
+    uint64_t failures = statsCounter(COUNTER_CONFIG_ERRORS);
+    writeConfig("Control+NoSuchKey", true);
+    if (!waitForCounter(COUNTER_CONFIG_ERRORS, failures + 1, 2000000000ull)) {
+        fprintf(stderr, "  ERROR: bad config was not rejected\n");
+        errors++;
+    }
+    bool lastOptionSpace = (EDITS - 1) % 2 == 0;
+    if (!switcherHandleKey(KEYCODE_SPACE, lastOptionSpace ? MOD_OPTION : MOD_CONTROL, 0, false)) {
+        fprintf(stderr, "  ERROR: bad config dropped the previous bindings\n");
+        errors++;
+    }
+    printf("  reloads %llu, rejected %llu\n",
+           (unsigned long long)statsCounter(COUNTER_CONFIG_RELOADS),
+           (unsigned long long)statsCounter(COUNTER_CONFIG_ERRORS));
+
+    configWatchStop();
+    switcherPublishHotkeys(NULL);
+    simBackendFree(&sim);
+    unlink(gPath);
+    rmdir(dir);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,143 @@
+// Auto-repeat and rapid-press handling on the simulated backend with a
+// virtual clock: a held switch hotkey (1 press + 1000 auto-repeats at the
+// macOS default 30 Hz) and 1000 hammered presses 5 ms apart, under each
+// repeat policy. Reports the backend calls made and exits non-zero if they
+// differ from what the policy allows or the cursor ends on the wrong display,
+// or if autorepeat=accelerate does not add a hop every accelEvery repeats.
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "stats.h"
+#include "switcher.h"
+
+#define BURST        1000
+#define REPEAT_NS    33000000ull   // ~30 Hz key repeat
+#define HAMMER_NS    5000000ull
+#define DISPLAYS     7
+
+typedef struct {
+    const char   *name;
+    RepeatOptions options;
+    bool          autorepeat;      // held key (else hammered presses)
+    uint64_t      interval;
+    uint64_t      maxWarps;        // upper bound on cursor moves
+    uint64_t      exactWarps;      // 0 = only the bound applies
+    int           finalDisplay;    // -1 = not checked
+} Scenario;
+
+static SimBackend gSim;
+
+static int displayOfCursor(void) {
+    for (uint32_t i = 0; i < gSim.count; i++) {
+        if (topoRectContains(gSim.displays[i].bounds, gSim.cursor)) return (int)i;
+    }
+    return -1;
+}
+
+static int runScenario(const Scenario *scenario) {
+    switcherSetRepeatOptions(&scenario->options);
+    simBackendSetDisplays(&gSim, gSim.displays, gSim.count);   // cursor back to display 0
+    simBackendResetCounters(&gSim);
+
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i <= BURST; i++) {
+        bool repeat = scenario->autorepeat && i > 0;
+        switcherHandleKey(KEYCODE_SPACE, MOD_CONTROL, 0, repeat);
+        simBackendAdvance(&gSim, scenario->interval);
+    }
+    simBackendAdvance(&gSim, 1000000000ull);   // let the last window close
+    uint64_t elapsed = benchNowNs() - t0;
+
+    uint64_t warps = atomic_load(&gSim.calls.cursorSets);
+    int display = displayOfCursor();
+    printf("  %-34s %5llu warps %5llu cursor reads %5llu notifications %4llu timers  %6.0f ns/event\n",
+           scenario->name, (unsigned long long)warps,
+           (unsigned long long)atomic_load(&gSim.calls.cursorGets),
+           (unsigned long long)atomic_load(&gSim.calls.notifications),
+           (unsigned long long)atomic_load(&gSim.calls.timers),
+           (double)elapsed / (BURST + 1));
+
+    int errors = 0;
+    if (warps > scenario->maxWarps || (scenario->exactWarps && warps != scenario->exactWarps)) {
+        fprintf(stderr, "  ERROR: %s: %llu warps, expected %s %llu\n", scenario->name, (unsigned long long)warps,
+                scenario->exactWarps ? "exactly" : "at most",
+                (unsigned long long)(scenario->exactWarps ? scenario->exactWarps : scenario->maxWarps));
+        errors++;
+    }
+    if (scenario->finalDisplay >= 0 && display != scenario->finalDisplay) {
+        fprintf(stderr, "  ERROR: %s: cursor on display %d, expected %d\n", scenario->name, display, scenario->finalDisplay);
+        errors++;
+    }
+    return errors;
+}
+
+// autorepeat=accelerate, with repeats slower than the window so each one
+// warps on its own: every accelEvery repeats a warp covers one hop more,
+// up to maxHops
+static int checkAccelerate(void) {
+    const RepeatOptions options = { .windowMs = 40, .policy = REPEAT_ACCELERATE, .accelEvery = 5, .maxHops = 4 };
+    switcherSetRepeatOptions(&options);
+    simBackendSetDisplays(&gSim, gSim.displays, gSim.count);
+    simBackendResetCounters(&gSim);
+
+    int errors = 0, display = displayOfCursor();
+    for (uint32_t i = 0; i <= 30; i++) {
+        uint32_t hops = 1;
+        if (i > 0) hops = 1 + i / options.accelEvery;
+        if (hops > options.maxHops) hops = options.maxHops;
+        switcherHandleKey(KEYCODE_SPACE, MOD_CONTROL, 0, i > 0);
+        simBackendAdvance(&gSim, 100000000ull);
+        int expected = (display + (int)hops) % DISPLAYS;
+        display = displayOfCursor();
+        uint64_t warps = atomic_load(&gSim.calls.cursorSets);
+        if (display != expected || warps != i + 1) {
+            fprintf(stderr, "  ERROR: accelerate: repeat %u moved to display %d with %llu warps, expected %d (%u hops) with %u\n",
+                    i, display, (unsigned long long)warps, expected, hops, i + 1);
+            if (++errors >= 5) break;
+        }
+    }
+    printf("  %-34s %s\n", "accelerate, hops per repeat", errors ? "FAILED" : "1 (x5), 2 (x5), 3 (x5), then 4 (cap)");
+    return errors;
+}
+
+int main(void) {
+    HotkeyBinding binding = { .keyCode = KEYCODE_SPACE, .required = MOD_CONTROL, .action = { ACTION_SWITCH, TOPO_NEXT } };
+    binding.forbidden = MOD_ALL & ~binding.required;
+    switcherPublishHotkeys(hotkeyTableCreate(&binding, 1));
+
+    DisplayInfo displays[DISPLAYS];
+    simBackendInit(&gSim);
+    gSim.virtualClock = true;
+    simBackendSetDisplays(&gSim, displays, simLayoutRow(displays, DISPLAYS, 1920, 1080));
+    switcherInit(&gSim.backend);
+    switcherRebuildTopology();
+
+    // Throttled to 10/s, a repeat gets through every 4th 33 ms tick
+    const uint64_t throttled = 1 + BURST / 4;
+    const Scenario scenarios[] = {
+        { "held, no coalescing (pre-change)", { .windowMs = 0, .policy = REPEAT_THROTTLE, .maxRate = 0 },
+          true, REPEAT_NS, BURST + 1, BURST + 1, (BURST + 1) % DISPLAYS },
+        { "held, autorepeat=ignore", { .windowMs = 40, .policy = REPEAT_IGNORE },
+          true, REPEAT_NS, 1, 1, 1 },
+        { "held, autorepeat=throttle (10/s)", { .windowMs = 40, .policy = REPEAT_THROTTLE, .maxRate = 10 },
+          true, REPEAT_NS, throttled, throttled, (int)(throttled % DISPLAYS) },
+        { "held, autorepeat=accelerate", { .windowMs = 40, .policy = REPEAT_ACCELERATE, .accelEvery = 5, .maxHops = 64 },
+          true, REPEAT_NS, BURST + 1, 0, -1 },
+        { "hammered, no coalescing (pre-change)", { .windowMs = 0 },
+          false, HAMMER_NS, BURST + 1, BURST + 1, (BURST + 1) % DISPLAYS },
+        { "hammered, 40 ms window", { .windowMs = 40, .maxHops = 0 },
+          false, HAMMER_NS, 1 + (BURST + 1) * HAMMER_NS / 40000000ull + 1, 0, (BURST + 1) % DISPLAYS },
+    };
+
+    printf("bench_repeat: %d-event switch bursts on %d simulated displays (virtual clock)\n", BURST + 1, DISPLAYS);
+    int errors = 0;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) errors += runScenario(&scenarios[i]);
+    errors += checkAccelerate();
+    printf("  coalesced presses %llu, dropped repeats %llu\n",
+           (unsigned long long)statsCounter(COUNTER_COALESCED),
+           (unsigned long long)statsCounter(COUNTER_REPEAT_DROPPED));
+
+    switcherPublishHotkeys(NULL);
+    simBackendFree(&gSim);
+    return errors ? 1 : 0;
+}
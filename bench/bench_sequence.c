@@ -0,0 +1,410 @@
+// Hotkey sequences ("Control+Space, 3"): parsing, the load-time conflict
+// checks (a sequence identical to, or starting with, another hotkey), the
+// compiled automaton driven through the keystroke path on the simulated
+// backend (completion, timeouts, broken-off sequences, auto-repeat of the
+// leader), then per-keystroke cost on synthetic typing with and without
+// sequences, and the raw automaton step as the number of sequences grows.
+// Exits non-zero if a check fails.
+
+#include <string.h>
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "config.h"
+#include "hotkeys.h"
+#include "log.h"
+#include "switcher.h"
+
+#define KEYSTROKES 2000000
+#define STEPS      20000000
+#define KEY_GAP_NS 150000000ull   // 150 ms between synthetic keystrokes
+
+static int gFailures;
+
+static void fail(const char *what, const char *detail) {
+    if (gFailures++ < 20) printf("  FAIL %s: %s\n", what, detail);
+}
+
+static uint16_t keyCodeOf(const char *name) {
+    uint64_t modifiers;
+    uint16_t keyCode = KEYCODE_INVALID;
+    parse_hotkey(name, &modifiers, &keyCode);
+    return keyCode;
+}
+
+static HotkeyBinding binding(const char *hotkey, bool exact, HotkeyAction action) {
+    HotkeyBinding b = { .action = action };
+    if (!parse_sequence(hotkey, exact, &b)) fail("parse", hotkey);
+    return b;
+}
+
+// --- Parsing ---------------------------------------------------------------------
+
+static void checkParse(void) {
+    HotkeyBinding b = { 0 };
+    if (!parse_sequence("Control+Space, 3", true, &b) || b.keyCode != KEYCODE_SPACE ||
+        b.required != MOD_CONTROL || b.forbidden != (MOD_ALL & ~MOD_CONTROL) || b.followCount != 1 ||
+        b.follow[0].keyCode != keyCodeOf("3") || b.follow[0].required || b.follow[0].forbidden != MOD_ALL ||
+        b.timeoutMs) {
+        fail("parse", "Control+Space, 3");
+    }
+    b = (HotkeyBinding){ 0 };
+    if (!parse_sequence("Hyper+L, L, 600ms", false, &b) || b.required != MOD_ALL || b.followCount != 1 ||
+        b.follow[0].keyCode != keyCodeOf("L") || b.follow[0].forbidden || b.timeoutMs != 600) {
+        fail("parse", "Hyper+L, L, 600ms");
+    }
+    b = (HotkeyBinding){ 0 };
+    if (!parse_sequence("Command+,", true, &b) || b.keyCode != keyCodeOf(",") || b.followCount) {
+        fail("parse", "Command+, (the comma key)");
+    }
+    b = (HotkeyBinding){ 0 };
+    if (!parse_sequence("Control+Space, ,", true, &b) || b.followCount != 1 ||
+        b.follow[0].keyCode != keyCodeOf(",")) {
+        fail("parse", "Control+Space, , (comma as the second key)");
+    }
+    b = (HotkeyBinding){ 0 };
+    if (!parse_sequence("A, B, C, D", true, &b) || b.followCount != 3) fail("parse", "A, B, C, D");
+
+    static const char *const invalid[] = {
+        "A, B, C, D, E", "Hyper", "Control+Space, Bogus", "Control+Space,, 3", "Control+Space, 3, 0ms", "",
+    };
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+        b = (HotkeyBinding){ 0 };
+        if (parse_sequence(invalid[i], true, &b)) fail("accepted an invalid sequence", invalid[i]);
+    }
+}
+
+// --- Load-time conflict checks ---------------------------------------------------
+
+typedef struct {
+    const char    *name;
+    const char    *hotkeys[4];
+    bool           exact[4];
+    uint32_t       conflicts;
+    HotkeyConflict expected[2];
+} ConflictCase;
+
+static const ConflictCase gConflictCases[] = {
+    { "key, then a sequence starting with it", { "Control+Space", "Control+Space, 3" }, { true, true },
+      1, { { 0, 1, true } } },
+    { "sequence, then its first key", { "Control+Space, 3", "Control+Space" }, { true, true },
+      1, { { 0, 1, true } } },
+    { "the same sequence twice", { "Control+Space, 3", "Control+Space, 3" }, { true, true },
+      1, { { 0, 1, false } } },
+    { "longer sequence with the same start", { "Hyper+L, L", "Hyper+L, L, L" }, { true, true },
+      1, { { 0, 1, true } } },
+    { "sequences overlapping through modifiers", { "Control+Space, 3", "Control+Shift+Space, 3" },
+      { false, true }, 1, { { 0, 1, false } } },
+    { "exact modifiers keep sequences apart", { "Control+Space, 3", "Control+Shift+Space, 3" },
+      { true, true }, 0, { { 0 } } },
+    { "sequences sharing a start", { "Control+Space, 1", "Control+Space, 2", "Control+Space, 2, 1" },
+      { true, true, true }, 1, { { 1, 2, true } } },
+    { "overlapping single keys", { "Control+Space", "Control+Option+Space" }, { false, false },
+      0, { { 0 } } },
+    { "duplicate, then a longer one", { "A, B", "A, B", "A, B, C" }, { true, true, true },
+      2, { { 0, 1, false }, { 0, 2, true } } },
+};
+
+static void checkConflicts(void) {
+    for (size_t c = 0; c < sizeof(gConflictCases) / sizeof(gConflictCases[0]); c++) {
+        const ConflictCase *test = &gConflictCases[c];
+        HotkeyBinding bindings[4];
+        uint32_t count = 0;
+        for (; count < 4 && test->hotkeys[count]; count++) {
+            bindings[count] = binding(test->hotkeys[count], test->exact[count], (HotkeyAction){ ACTION_JUMP, (int)count + 1 });
+        }
+        HotkeyConflict found[4];
+        uint32_t n = hotkeyFindConflicts(bindings, count, found, 4);
+        bool same = n == test->conflicts;
+        for (uint32_t i = 0; same && i < n; i++) {
+            same = found[i].earlier == test->expected[i].earlier && found[i].later == test->expected[i].later &&
+                   found[i].prefix == test->expected[i].prefix;
+        }
+        if (!same) fail("conflicts", test->name);
+
+        // The table keeps the earlier binding of each pair and drops the
+        // later: every action left (binding i jumps to display i + 1) is
+        // that of a binding no conflict dropped
+        HotkeyTable *table = hotkeyTableCreate(bindings, count);
+        if (!table) {
+            fail("table", test->name);
+            continue;
+        }
+        bool present[5] = { false };
+        for (uint32_t i = 0; i < table->count; i++) {
+            if (!table->bindings[i].next) present[table->bindings[i].action.arg] = true;
+        }
+        for (uint32_t i = 0; table->transitions && i <= table->transitionMask; i++) {
+            const HotkeyTransition *edge = &table->transitions[i];
+            if (edge->key && !edge->next) present[edge->action.arg] = true;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            bool dropped = false;
+            for (uint32_t j = 0; j < n; j++) dropped |= found[j].later == i;
+            if (present[i + 1] == dropped) fail(dropped ? "conflicting binding kept" : "binding lost", test->name);
+        }
+        hotkeyTableDestroy(table);
+    }
+
+    // Sequences sharing their first key share the state after it
+    HotkeyBinding digits[9];
+    for (int i = 0; i < 9; i++) {
+        char hotkey[32];
+        snprintf(hotkey, sizeof(hotkey), "Control+Space, %d", i + 1);
+        digits[i] = binding(hotkey, true, (HotkeyAction){ ACTION_JUMP, i + 1 });
+    }
+    HotkeyTable *table = hotkeyTableCreate(digits, 9);
+    if (!table || table->states != 1 || table->count != 1) fail("shared prefix", "Control+Space, 1..9");
+    hotkeyTableDestroy(table);
+
+    // Through config.ini: the default switch hotkey is Control+Space
+    Config config;
+    configDefaults(&config);
+    for (int i = 0; i < CONFIG_HOTKEY_COUNT; i++) {
+        if (strcmp(config.hotkeys[i].key, "display_3_hotkey") == 0) {
+            snprintf(config.hotkeys[i].hotkey, sizeof(config.hotkeys[i].hotkey), "Control+Space, 3");
+        }
+    }
+    char error[256] = "";
+    table = configCompileHotkeys(&config, true, error, sizeof(error));
+    if (table || !strstr(error, "display_3_hotkey") || !strstr(error, "switch_hotkey")) {
+        fail("strict config with a conflict", error[0] ? error : "compiled");
+    }
+    hotkeyTableDestroy(table);
+    table = configCompileHotkeys(&config, false, error, sizeof(error));
+    const HotkeyBinding *space = table ? hotkeyLookup(table, KEYCODE_SPACE, MOD_CONTROL) : NULL;
+    if (!space || space->next || space->action.type != ACTION_SWITCH || table->states) {
+        fail("lenient config with a conflict", "display_3_hotkey not dropped");
+    }
+    hotkeyTableDestroy(table);
+}
+
+// --- The automaton on the keystroke path -----------------------------------------
+
+static SimBackend gSim;
+
+static bool press(const char *hotkey, bool autorepeat) {
+    uint64_t modifiers = 0;
+    uint16_t keyCode = KEYCODE_INVALID;
+    parse_hotkey(hotkey, &modifiers, &keyCode);
+    simBackendAdvance(&gSim, 1000000);
+    return switcherHandleKey(keyCode, modifiers, gSim.clockNs, autorepeat);
+}
+
+static int displayOfCursor(void) {
+    return (int)(gSim.cursor.x / 1920) + 1;
+}
+
+static void home(void) {
+    gSim.cursor = (TopoPoint){ 960, 540 };
+}
+
+static void checkDispatch(void) {
+    HotkeyBinding bindings[] = {
+        binding("Command+Right", true, (HotkeyAction){ ACTION_SWITCH, TOPO_RIGHT }),
+        binding("Control+Space, 2", true, (HotkeyAction){ ACTION_JUMP, 2 }),
+        binding("Control+Space, 3", true, (HotkeyAction){ ACTION_JUMP, 3 }),
+        binding("Control+Space, 4, 200ms", true, (HotkeyAction){ ACTION_JUMP, 4 }),
+        binding("Hyper+L, L, L", true, (HotkeyAction){ ACTION_JUMP, 4 }),
+        binding("Hyper+L, H", true, (HotkeyAction){ ACTION_JUMP, 1 }),
+    };
+    switcherPublishHotkeys(hotkeyTableCreate(bindings, sizeof(bindings) / sizeof(bindings[0])));
+
+    home();
+    if (!press("Control+Space", false) || displayOfCursor() != 1) fail("dispatch", "leader not swallowed");
+    if (!press("3", false) || displayOfCursor() != 3) fail("dispatch", "Control+Space, 3 did not jump to display 3");
+
+    home();
+    press("Control+Space", false);
+    simBackendAdvance(&gSim, 1500000000ull);
+    if (press("3", false) || displayOfCursor() != 1) fail("dispatch", "jumped after the default timeout");
+
+    home();
+    press("Control+Space", false);
+    simBackendAdvance(&gSim, 300000000ull);
+    if (press("4", false) || displayOfCursor() != 1) fail("dispatch", "jumped after a 200ms sequence timed out");
+    press("Control+Space", false);
+    simBackendAdvance(&gSim, 100000000ull);
+    if (!press("4", false) || displayOfCursor() != 4) fail("dispatch", "200ms sequence within its limit");
+
+    home();
+    press("Control+Space", false);
+    if (press("A", false)) fail("dispatch", "key breaking off a sequence was swallowed");
+    if (press("3", false) || displayOfCursor() != 1) fail("dispatch", "sequence survived a wrong key");
+
+    home();
+    press("Control+Space", false);
+    if (!press("Command+Right", false) || displayOfCursor() != 2) fail("dispatch", "hotkey breaking off a sequence");
+
+    home();
+    press("Control+Space", false);
+    for (int i = 0; i < 5; i++) {
+        if (!press("Control+Space", true)) fail("dispatch", "auto-repeat of the leader passed through");
+    }
+    if (!press("3", false) || displayOfCursor() != 3) fail("dispatch", "sequence lost to auto-repeat");
+
+    home();
+    press("Control+Option+Shift+Command+L", false);
+    press("L", false);
+    if (!press("L", false) || displayOfCursor() != 4) fail("dispatch", "Hyper+L, L, L");
+    press("Control+Option+Shift+Command+L", false);
+    if (!press("H", false) || displayOfCursor() != 1) fail("dispatch", "Hyper+L, H");
+
+    home();
+    if (press("X", false) || press("3", false) || press("Shift+3", false)) fail("dispatch", "plain key swallowed");
+    press("Control+Space", false);
+    if (press("Shift+3", false) || displayOfCursor() != 1) fail("dispatch", "exact modifiers on the second key");
+
+    // The tap's fast reject: bound keys and keys inside a sequence get through
+    if (switcherKeyMayMatch(keyCodeOf("X")) || switcherKeyMayMatch(keyCodeOf("3"))) fail("fast reject", "unbound key not rejected");
+    if (!switcherKeyMayMatch(KEYCODE_SPACE) || !switcherKeyMayMatch(keyCodeOf("L"))) fail("fast reject", "bound key rejected");
+    press("Control+Space", false);
+    if (!switcherKeyMayMatch(keyCodeOf("3")) || !switcherKeyMayMatch(keyCodeOf("X"))) fail("fast reject", "key rejected inside a sequence");
+    press("3", false);
+    if (switcherKeyMayMatch(keyCodeOf("3"))) fail("fast reject", "key not rejected after the sequence completed");
+}
+
+// --- Throughput ------------------------------------------------------------------
+
+typedef struct { uint16_t keyCode; uint64_t flags; } Key;
+
+// Letters and digits, a few shifted; every `every` keys (0 = never) a
+// Control+Space, digit sequence. Returns the number of sequence keys.
+static uint64_t makeTyping(Key *keys, size_t count, uint32_t every, uint32_t seed) {
+    uint64_t sequenceKeys = 0;
+    static uint16_t digits[9];
+    for (int i = 0; i < 9; i++) {
+        char digit[2] = { (char)('1' + i), '\0' };
+        digits[i] = keyCodeOf(digit);
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (every && i + 1 < count && benchRandom(&seed) % every == 0) {
+            keys[i++] = (Key){ KEYCODE_SPACE, MOD_CONTROL };
+            keys[i] = (Key){ digits[benchRandom(&seed) % 3], 0 };
+            sequenceKeys += 2;
+            continue;
+        }
+        keys[i] = (Key){ (uint16_t)(benchRandom(&seed) % 0x30), benchRandom(&seed) % 8 == 0 ? MOD_SHIFT : 0 };
+    }
+    return sequenceKeys;
+}
+
+static double typeKeys(const Key *keys, size_t count, uint64_t *swallowed) {
+    uint64_t consumed = 0;
+    uint64_t t0 = benchNowNs();
+    for (size_t i = 0; i < count; i++) {
+        gSim.clockNs += KEY_GAP_NS;
+        consumed += switcherHandleKey(keys[i].keyCode, keys[i].flags, gSim.clockNs, false);
+    }
+    uint64_t elapsed = benchNowNs() - t0;
+    *swallowed = consumed;
+    return (double)elapsed / (double)count;
+}
+
+static void benchTyping(void) {
+    HotkeyBindingList list = { 0 };
+    static const struct { const char *hotkey; HotkeyAction action; } singles[] = {
+        { "Command+Left", { ACTION_SWITCH, TOPO_LEFT } },
+        { "Command+Right", { ACTION_SWITCH, TOPO_RIGHT } },
+        { "Control+Option+Command+Space", { ACTION_DRAG, TOPO_NEXT } },
+    };
+    for (size_t i = 0; i < sizeof(singles) / sizeof(singles[0]); i++) {
+        HotkeyBinding b = binding(singles[i].hotkey, true, singles[i].action);
+        hotkeyListAppend(&list, &b);
+    }
+    for (int i = 0; i < 3; i++) {
+        char hotkey[32];
+        snprintf(hotkey, sizeof(hotkey), "Control+Space, %d", i + 1);
+        HotkeyBinding b = binding(hotkey, true, (HotkeyAction){ ACTION_JUMP, i + 1 });
+        hotkeyListAppend(&list, &b);
+    }
+    switcherPublishHotkeys(hotkeyTableCreate(list.items, list.count));
+    hotkeyListFree(&list);
+
+    static Key keys[KEYSTROKES];
+    static const struct { const char *name; uint32_t every; } streams[] = {
+        { "typing, no sequences", 0 },
+        { "typing, a sequence per 50 keys", 50 },
+        { "typing, a sequence per 5 keys", 5 },
+    };
+    for (size_t s = 0; s < sizeof(streams) / sizeof(streams[0]); s++) {
+        uint64_t sequenceKeys = makeTyping(keys, KEYSTROKES, streams[s].every, 5);
+        uint64_t swallowed;
+        uint64_t jumps = atomic_load(&gSim.calls.cursorSets);
+        double ns = typeKeys(keys, KEYSTROKES, &swallowed);
+        jumps = atomic_load(&gSim.calls.cursorSets) - jumps;
+        printf("  %-38s %8.1f ns/keystroke (%llu swallowed, %llu jumps)\n", streams[s].name, ns,
+               (unsigned long long)swallowed, (unsigned long long)jumps);
+        if (swallowed != sequenceKeys) fail("throughput", "sequence keys and swallowed keys differ");
+    }
+}
+
+// Raw automaton step: random keys from random states of a table with n
+// sequences of 2-4 keys. Cost should not grow with n.
+static void benchStep(uint32_t n) {
+    HotkeyBinding *bindings = malloc(n * sizeof(*bindings));
+    uint32_t seed = 77 + n;
+    static const uint64_t mods[] = { MOD_CONTROL, MOD_OPTION, MOD_COMMAND, MOD_CONTROL | MOD_OPTION };
+    for (uint32_t i = 0; i < n; i++) {
+        HotkeyBinding b = { .keyCode = (uint16_t)(benchRandom(&seed) % 0x30), .action = { ACTION_JUMP, 1 } };
+        b.required = mods[benchRandom(&seed) % 4];
+        b.forbidden = MOD_ALL & ~b.required;
+        b.followCount = (uint8_t)(1 + benchRandom(&seed) % 3);
+        for (uint8_t k = 0; k < b.followCount; k++) {
+            b.follow[k] = (HotkeyChord){ (uint16_t)(benchRandom(&seed) % 0x30), 0, MOD_ALL };
+        }
+        bindings[i] = b;
+    }
+    uint64_t t0 = benchNowNs();
+    HotkeyTable *table = hotkeyTableCreate(bindings, n);
+    uint64_t buildNs = benchNowNs() - t0;
+    if (!table || !table->states) {
+        fail("step table", "not built");
+        hotkeyTableDestroy(table);
+        free(bindings);
+        return;
+    }
+    uint32_t state = 1, live = 0;
+    t0 = benchNowNs();
+    for (uint32_t i = 0; i < STEPS; i++) {
+        const HotkeyTransition *edge = hotkeyStep(table, state, (uint16_t)(benchRandom(&seed) % 0x30), 0);
+        live += edge != NULL;
+        state = edge && edge->next ? edge->next : 1 + benchRandom(&seed) % table->states;
+    }
+    uint64_t elapsed = benchNowNs() - t0;
+    char name[64];
+    snprintf(name, sizeof(name), "step, %u sequences", n);
+    printf("  %-38s %8.1f ns/step (%u states, %u slots, built in %.2f ms, %.1f%% keys continue)\n", name,
+           (double)elapsed / STEPS, table->states, table->transitionMask + 1, (double)buildNs / 1e6,
+           100.0 * live / STEPS);
+    hotkeyTableDestroy(table);
+    free(bindings);
+}
+
+int main(void) {
+    printf("bench_sequence: hotkey sequences\n");
+    logSetLevel(LOG_LEVEL_ERROR);   // the conflict checks are meant to warn
+    checkParse();
+    checkConflicts();
+
+    simBackendInit(&gSim);
+    DisplayInfo displays[4];
+    uint32_t count = simLayoutRow(displays, 4, 1920, 1080);
+    simBackendSetDisplays(&gSim, displays, count);
+    gSim.virtualClock = true;
+    switcherInit(&gSim.backend);
+    switcherRebuildTopology();
+    checkDispatch();
+    printf("  %-38s %s\n", "parsing, conflicts, dispatch", gFailures ? "FAILED" : "all checks pass");
+
+    benchTyping();
+    static const uint32_t sizes[] = { 10, 1000, 30000 };
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) benchStep(sizes[i]);
+    simBackendFree(&gSim);
+
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
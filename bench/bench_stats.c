@@ -0,0 +1,149 @@
+// Histogram recording cost (single thread and contended) and percentile
+// accuracy against exact percentiles of the same samples; the concurrent
+// totals, counters and the text/JSON export. Exits non-zero if a
+// percentile is off by more than a bucket (1/16) or a check fails.
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+
+#include "bench.h"
+#include "stats.h"
+
+#define SAMPLES  2000000
+#define THREADS  4
+
+static Histogram gShared;
+static int       gFailures;
+
+static void fail(const char *what, unsigned long long got, unsigned long long want) {
+    if (gFailures++ < 10) printf("  FAIL %s: %llu, expected %llu\n", what, got, want);
+}
+
+static void expectText(const char *buf, const char *what, const char *needle) {
+    if (!strstr(buf, needle) && gFailures++ < 10) printf("  FAIL %s: no '%s' in the output\n", what, needle);
+}
+
+// Braces balance, nothing follows the final one and no member list ends in
+// a comma
+static bool wellFormedJSON(const char *json) {
+    int depth = 0;
+    const char *p = json;
+    for (; *p; p++) {
+        if (*p == '{') depth++;
+        if (*p == '}' && --depth < 0) return false;
+        if (*p == ',') {
+            const char *next = p + 1;
+            while (*next == ' ' || *next == '\n') next++;
+            if (*next == '}') return false;
+        }
+        if (depth == 0 && *p == '}') break;
+    }
+    if (depth != 0 || !*p) return false;
+    for (p++; *p; p++) {
+        if (*p != '\n' && *p != ' ') return false;
+    }
+    return true;
+}
+
+static void checkExport(void) {
+    enum { CONSUMED = 1234, SWITCHES = 77 };
+    for (int i = 0; i < CONSUMED; i++) statsCount(COUNTER_CONSUMED);
+    statsCount(COUNTER_TAP_DISABLED);
+    if (statsCounter(COUNTER_CONSUMED) != CONSUMED) fail("consumed counter", statsCounter(COUNTER_CONSUMED), CONSUMED);
+    if (statsCounter(COUNTER_TAP_DISABLED) != 1) fail("tap_disabled counter", statsCounter(COUNTER_TAP_DISABLED), 1);
+    if (statsCounter(COUNTER_PASSED) != 0) fail("passed counter", statsCounter(COUNTER_PASSED), 0);
+    for (int i = 0; i < SWITCHES; i++) statsRecordAction(ACTION_SWITCH, 1000 + i);
+    statsRecordPhase(PHASE_WARP, 500);
+    const Histogram *switches = statsActionHistogram(ACTION_SWITCH);
+    if (atomic_load(&switches->count) != SWITCHES) fail("switch action samples", atomic_load(&switches->count), SWITCHES);
+    if (atomic_load(&switches->max) != 1000 + SWITCHES - 1) fail("switch action max", atomic_load(&switches->max), 1000 + SWITCHES - 1);
+
+    static char buf[16384];
+    char expect[128];
+    size_t length = statsFormatJSON(buf, sizeof(buf));
+    if (length != strlen(buf)) fail("JSON length", length, strlen(buf));
+    if (statsFormatJSON(NULL, 0) != length) fail("JSON length without a buffer", statsFormatJSON(NULL, 0), length);
+    if (!wellFormedJSON(buf) && gFailures++ < 10) printf("  FAIL JSON export is malformed:\n%s", buf);
+    expectText(buf, "JSON", "\"counters\": {");
+    expectText(buf, "JSON", "\"actions_ns\": {");
+    expectText(buf, "JSON", "\"phases_ns\": {");
+    snprintf(expect, sizeof(expect), "\"consumed\": %d", CONSUMED);
+    expectText(buf, "JSON", expect);
+    expectText(buf, "JSON", "\"tap_disabled\": 1");
+    snprintf(expect, sizeof(expect), "\"%s\": {\"count\": %d,", hotkeyActionName(ACTION_SWITCH), SWITCHES);
+    expectText(buf, "JSON", expect);
+    expectText(buf, "JSON", "\"warp\": {\"count\": 1,");
+
+    length = statsFormatText(buf, sizeof(buf));
+    if (length != strlen(buf)) fail("text length", length, strlen(buf));
+    expectText(buf, "text", "counters:\n");
+    snprintf(expect, sizeof(expect), "  %-16s %d\n", "consumed", CONSUMED);
+    expectText(buf, "text", expect);
+    snprintf(expect, sizeof(expect), "  %-16s n=%-8d", hotkeyActionName(ACTION_SWITCH), SWITCHES);
+    expectText(buf, "text", expect);
+    printf("  %-40s %s\n", "counters and text/JSON export", gFailures ? "FAILED" : "ok");
+}
+
+static void *recordMany(void *arg) {
+    uint32_t seed = (uint32_t)(uintptr_t)arg;
+    for (int i = 0; i < SAMPLES; i++) histogramRecord(&gShared, benchRandom(&seed) % 1000000);
+    return NULL;
+}
+
+int main(void) {
+    static uint64_t values[SAMPLES];
+    static Histogram histogram;
+    uint32_t seed = 99;
+
+    // Log-normal-ish latencies: mostly microseconds, long tail into ms.
+    for (int i = 0; i < SAMPLES; i++) {
+        double u = (benchRandom(&seed) % 1000000 + 1) / 1000001.0;
+        values[i] = (uint64_t)(20000.0 * exp(-1.5 * log(u)));
+    }
+
+    printf("bench_stats: log-linear histogram\n");
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i < SAMPLES; i++) histogramRecord(&histogram, values[i]);
+    uint64_t elapsed = benchNowNs() - t0;
+    printf("  %-40s %6.2f ns/sample\n", "record, single thread", (double)elapsed / SAMPLES);
+
+    pthread_t threads[THREADS];
+    t0 = benchNowNs();
+    for (int t = 0; t < THREADS; t++) pthread_create(&threads[t], NULL, recordMany, (void *)(uintptr_t)(t + 1));
+    for (int t = 0; t < THREADS; t++) pthread_join(threads[t], NULL);
+    elapsed = benchNowNs() - t0;
+    printf("  %-40s %6.2f ns/sample (wall, %d threads)\n", "record, contended", (double)elapsed / (SAMPLES * THREADS), THREADS);
+    // No increment lost under contention
+    uint64_t sum = 0;
+    for (int t = 0; t < THREADS; t++) {
+        uint32_t threadSeed = (uint32_t)(t + 1);
+        for (int i = 0; i < SAMPLES; i++) sum += benchRandom(&threadSeed) % 1000000;
+    }
+    uint64_t bucketed = 0;
+    for (size_t b = 0; b < HISTOGRAM_BUCKETS; b++) bucketed += atomic_load(&gShared.buckets[b]);
+    if (atomic_load(&gShared.count) != (uint64_t)SAMPLES * THREADS) fail("contended count", atomic_load(&gShared.count), (uint64_t)SAMPLES * THREADS);
+    if (bucketed != (uint64_t)SAMPLES * THREADS) fail("contended bucket total", bucketed, (uint64_t)SAMPLES * THREADS);
+    if (atomic_load(&gShared.sum) != sum) fail("contended sum", atomic_load(&gShared.sum), sum);
+    if (atomic_load(&histogram.count) != (uint64_t)SAMPLES) fail("single-thread count", atomic_load(&histogram.count), SAMPLES);
+
+    qsort(values, SAMPLES, sizeof(values[0]), benchCompareU64);
+    static const double percentiles[] = { 50, 90, 99, 99.9 };
+    for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); p++) {
+        uint64_t exact = values[(size_t)(percentiles[p] / 100.0 * SAMPLES) - 1];
+        uint64_t approx = histogramPercentile(&histogram, percentiles[p]);
+        double error = ((double)approx - (double)exact) / (double)exact;
+        printf("  p%-5g exact %10llu  histogram %10llu  error %+5.2f%%\n", percentiles[p],
+               (unsigned long long)exact, (unsigned long long)approx, 100.0 * error);
+        if (fabs(error) > 1.0 / HISTOGRAM_SUB_COUNT) fail("percentile off by more than a bucket", approx, exact);
+    }
+    printf("  histogram memory: %zu bytes\n", sizeof(Histogram));
+
+    checkExport();
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
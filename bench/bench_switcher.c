@@ -0,0 +1,269 @@
+// End-to-end hot paths on the simulated backend: keystroke dispatch through
+// switcherHandleKey(), switchDisplay() per direction and drag requests, over
+// several display layouts. Exits non-zero if the backend saw calls the hot
+// path must not make (display queries) or the cursor ended up off-screen.
+
+#include <unistd.h>
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "stats.h"
+#include "switcher.h"
+
+#define KEYSTROKES 200000
+#define SWITCHES   200000
+#define DRAGS      20
+
+typedef struct { uint16_t keyCode; uint64_t flags; } Key;
+
+static HotkeyTable *buildTable(void) {
+    static const struct { const char *hotkey; HotkeyAction action; } defaults[] = {
+        { "Control+Space",                { ACTION_SWITCH, TOPO_NEXT } },
+        { "Control+Command+Up",           { ACTION_SWITCH, TOPO_UP } },
+        { "Control+Command+Down",         { ACTION_SWITCH, TOPO_DOWN } },
+        { "Command+Left",                 { ACTION_SWITCH, TOPO_LEFT } },
+        { "Command+Right",                { ACTION_SWITCH, TOPO_RIGHT } },
+        { "Control+Option+Command+Space", { ACTION_DRAG, TOPO_NEXT } },
+    };
+    HotkeyBindingList list = { 0 };
+    for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+        HotkeyBinding b = { .action = defaults[i].action };
+        parse_hotkey(defaults[i].hotkey, &b.required, &b.keyCode);
+        b.forbidden = MOD_ALL & ~b.required;
+        hotkeyListAppend(&list, &b);
+    }
+    HotkeyTable *table = hotkeyTableCreate(list.items, list.count);
+    hotkeyListFree(&list);
+    return table;
+}
+
+// Ordinary typing with one switch hotkey every `hotEvery` keystrokes
+static void makeStream(Key *keys, size_t count, uint32_t hotEvery, uint32_t seed) {
+    static const Key hotKeys[] = {
+        { KEYCODE_SPACE, MOD_CONTROL }, { KEYCODE_LEFT_ARROW, MOD_COMMAND },
+        { KEYCODE_RIGHT_ARROW, MOD_COMMAND }, { KEYCODE_UP_ARROW, MOD_CONTROL | MOD_COMMAND },
+        { KEYCODE_DOWN_ARROW, MOD_CONTROL | MOD_COMMAND },
+    };
+    for (size_t i = 0; i < count; i++) {
+        if (hotEvery && benchRandom(&seed) % hotEvery == 0) {
+            keys[i] = hotKeys[benchRandom(&seed) % 5];
+        } else {
+            keys[i].keyCode = (uint16_t)(benchRandom(&seed) % 0x30);
+            keys[i].flags = benchRandom(&seed) % 8 == 0 ? MOD_SHIFT : 0;
+        }
+    }
+}
+
+static bool cursorOnScreen(SimBackend *sim) {
+    TopoPoint p = sim->cursor;
+    for (uint32_t i = 0; i < sim->count; i++) {
+        if (topoRectContains(sim->displays[i].bounds, p)) return true;
+    }
+    return false;
+}
+
+static void printPhases(void) {
+    static const char *names[] = { "dispatch", "display query", "geometry", "warp", "notify" };
+    for (int phase = PHASE_DISPATCH; phase <= PHASE_NOTIFY; phase++) {
+        const Histogram *h = statsPhaseHistogram((StatsPhase)phase);
+        printf("    phase %-14s p50 %6llu ns  p99 %6llu ns\n", names[phase],
+               (unsigned long long)histogramPercentile(h, 50.0),
+               (unsigned long long)histogramPercentile(h, 99.0));
+    }
+}
+
+static int runLayout(const char *name, const DisplayInfo *displays, uint32_t count,
+                     const Key *stream, uint64_t *samples) {
+    int errors = 0;
+    SimBackend sim;
+    simBackendInit(&sim);
+    simBackendSetDisplays(&sim, displays, count);
+    switcherInit(&sim.backend);
+    switcherRebuildTopology();
+    simBackendResetCounters(&sim);
+
+    printf(" layout %s (%u displays)\n", name, count);
+
+    // Dispatch: mostly cold keys, some switch hotkeys
+    uint64_t total = 0;
+    for (size_t i = 0; i < KEYSTROKES; i++) {
+        uint64_t t0 = benchNowNs();
+        switcherHandleKey(stream[i].keyCode, stream[i].flags, 0, false);
+        samples[i] = benchNowNs() - t0;
+        total += samples[i];
+    }
+    benchReport("switcherHandleKey (mixed stream)", samples, KEYSTROKES, total);
+
+    // switchDisplay, cycling through every direction
+    static const TopoDirection directions[] = { TOPO_NEXT, TOPO_RIGHT, TOPO_DOWN, TOPO_LEFT, TOPO_UP, TOPO_PREV };
+    total = 0;
+    for (size_t i = 0; i < SWITCHES; i++) {
+        uint64_t t0 = benchNowNs();
+        switchDisplay(directions[i % 6]);
+        samples[i] = benchNowNs() - t0;
+        total += samples[i];
+    }
+    benchReport("switchDisplay (all directions)", samples, SWITCHES, total);
+
+    if (atomic_load(&sim.calls.displayQueries) != 0) {
+        fprintf(stderr, "  ERROR: %llu display queries on the hot path\n",
+                (unsigned long long)atomic_load(&sim.calls.displayQueries));
+        errors++;
+    }
+    if (!cursorOnScreen(&sim)) {
+        fprintf(stderr, "  ERROR: cursor off-screen at (%.1f, %.1f)\n", sim.cursor.x, sim.cursor.y);
+        errors++;
+    }
+    printf("    backend calls: %llu cursor reads, %llu warps, %llu notifications\n",
+           (unsigned long long)atomic_load(&sim.calls.cursorGets),
+           (unsigned long long)atomic_load(&sim.calls.cursorSets),
+           (unsigned long long)atomic_load(&sim.calls.notifications));
+
+    // Jump to display N versus stepping there with switchDisplay(), per anchor
+    static const char *anchorNames[] = { "proportional", "last", "center" };
+    for (int anchor = ANCHOR_PROPORTIONAL; anchor <= ANCHOR_CENTER; anchor++) {
+        switcherSetJumpAnchor((JumpAnchor)anchor);
+        simBackendResetCounters(&sim);
+        unsigned token;
+        const Topology *topology = topologyAcquire(&token);
+        total = 0;
+        for (size_t i = 0; i < SWITCHES; i++) {
+            uint32_t number = 1 + (uint32_t)(i % count);
+            uint64_t t0 = benchNowNs();
+            jumpToDisplay(number);
+            samples[i] = benchNowNs() - t0;
+            total += samples[i];
+            if (i < count && !topoRectContains(topology->displays[topology->order[number - 1]].bounds, sim.cursor)) {
+                fprintf(stderr, "  ERROR: jump to display %u missed\n", number);
+                errors++;
+            }
+        }
+        topologyRelease(token);
+        char label[64];
+        snprintf(label, sizeof(label), "jumpToDisplay (anchor=%s)", anchorNames[anchor]);
+        benchReport(label, samples, SWITCHES, total);
+        printf("    backend calls: %llu cursor reads, %llu warps\n",
+               (unsigned long long)atomic_load(&sim.calls.cursorGets),
+               (unsigned long long)atomic_load(&sim.calls.cursorSets));
+    }
+    switcherSetJumpAnchor(ANCHOR_PROPORTIONAL);
+
+    // Drag requests: caller cost only, each drag runs to completion in between
+    DragOptions options = { .frameRate = 240, .moveMs = 20, .settleMs = 5, .minSettleMs = 1, .adaptive = false };
+    if (!dragEngineStart(switcherDragPoster(), &options)) {
+        fprintf(stderr, "  ERROR: drag engine failed to start\n");
+        simBackendFree(&sim);
+        return errors + 1;
+    }
+    total = 0;
+    for (size_t i = 0; i < DRAGS; i++) {
+        uint64_t t0 = benchNowNs();
+        dragWindowBetweenDisplays(directions[i % 6]);
+        samples[i] = benchNowNs() - t0;
+        total += samples[i];
+        while (dragInProgress()) usleep(500);
+    }
+    benchReport("dragWindowBetweenDisplays (caller)", samples, DRAGS, total);
+    dragEngineStop();
+    printf("    backend calls: %llu mouse events for %d drags\n",
+           (unsigned long long)atomic_load(&sim.calls.mousePosts), DRAGS);
+    if (!cursorOnScreen(&sim)) {
+        fprintf(stderr, "  ERROR: cursor off-screen after drags\n");
+        errors++;
+    }
+
+    simBackendFree(&sim);
+    return errors;
+}
+
+// Display number (as for jumpToDisplay) of topology display `index`
+static uint32_t numberOf(uint32_t index) {
+    unsigned token;
+    const Topology *topology = topologyAcquire(&token);
+    uint32_t number = topology->rank[index] + 1;
+    topologyRelease(token);
+    return number;
+}
+
+static bool samePoint(TopoPoint a, TopoPoint b) {
+    return a.x == b.x && a.y == b.y;
+}
+
+// jump_anchor=last remembers where the cursor left each display - across
+// topology rebuilds and on walls of more than 64 displays - and switching
+// to center afterwards lands on the exact center again
+static int checkAnchors(void) {
+    int errors = 0;
+    SimBackend sim;
+    simBackendInit(&sim);
+    DisplayInfo displays[128];
+    uint32_t count = simLayoutRow(displays, 3, 1920, 1080);
+    simBackendSetDisplays(&sim, displays, count);
+    switcherInit(&sim.backend);
+    switcherRebuildTopology();
+
+    TopoPoint left = { displays[1].bounds.x + 100, displays[1].bounds.y + 50 };
+    TopoRect b = displays[1].bounds;
+    TopoPoint center = { b.x + b.width / 2, b.y + b.height / 2 };
+    switcherSetJumpAnchor(ANCHOR_LAST);
+    sim.cursor = left;
+    jumpToDisplay(numberOf(2));
+    switcherSetJumpAnchor(ANCHOR_CENTER);
+    jumpToDisplay(numberOf(1));
+    if (!samePoint(sim.cursor, center)) {
+        fprintf(stderr, "  ERROR: center jump after last mode landed at (%.1f, %.1f), not (%.1f, %.1f)\n",
+                sim.cursor.x, sim.cursor.y, center.x, center.y);
+        errors++;
+    }
+    switcherSetJumpAnchor(ANCHOR_LAST);
+    sim.cursor = left;
+    jumpToDisplay(numberOf(2));
+    switcherRebuildTopology();
+    jumpToDisplay(numberOf(1));
+    if (!samePoint(sim.cursor, left)) {
+        fprintf(stderr, "  ERROR: last-visited point lost by a rebuild: (%.1f, %.1f)\n", sim.cursor.x, sim.cursor.y);
+        errors++;
+    }
+
+    // A 16x8 wall: a display past index 64
+    count = simLayoutWall(displays, 16, 8, 1920, 1080);
+    simBackendSetDisplays(&sim, displays, count);
+    switcherRebuildTopology();
+    switcherSetJumpAnchor(ANCHOR_LAST);
+    uint32_t far = 100;
+    left = (TopoPoint){ displays[far].bounds.x + 10, displays[far].bounds.y + 20 };
+    sim.cursor = left;
+    jumpToDisplay(numberOf(0));
+    jumpToDisplay(numberOf(far));
+    if (!samePoint(sim.cursor, left)) {
+        fprintf(stderr, "  ERROR: last-visited point on display %u of %u not kept: (%.1f, %.1f)\n",
+                far, count, sim.cursor.x, sim.cursor.y);
+        errors++;
+    }
+    switcherSetJumpAnchor(ANCHOR_PROPORTIONAL);
+    printf("  %-38s %s\n", "jump anchors (last -> center, rebuild, 128 displays)", errors ? "FAILED" : "ok");
+    simBackendFree(&sim);
+    return errors;
+}
+
+int main(void) {
+    static Key stream[KEYSTROKES];
+    static uint64_t samples[KEYSTROKES > SWITCHES ? KEYSTROKES : SWITCHES];
+    makeStream(stream, KEYSTROKES, 10, 7);
+
+    switcherPublishHotkeys(buildTable());
+
+    printf("bench_switcher: hot paths on the simulated backend\n");
+    DisplayInfo displays[16];
+    int errors = 0;
+    errors += runLayout("2x1", displays, simLayoutRow(displays, 2, 1920, 1080), stream, samples);
+    errors += runLayout("4x1", displays, simLayoutRow(displays, 4, 2560, 1440), stream, samples);
+    errors += runLayout("3x3", displays, simLayoutWall(displays, 3, 3, 1920, 1080), stream, samples);
+
+    printf(" phase breakdown (all layouts)\n");
+    printPhases();
+    errors += checkAnchors();
+
+    switcherPublishHotkeys(NULL);
+    return errors ? 1 : 0;
+}
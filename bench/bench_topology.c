@@ -0,0 +1,194 @@
+// Per-keystroke display lookup: re-querying the display list on every switch
+// (the pre-snapshot code path) versus reading the cached topology snapshot.
+//
+// There is no WindowServer on Linux, so every simulated WindowServer query
+// (display list, per-display bounds) costs one real syscall round trip.
+//
+// Every sampled point must land on the same display and the same mapped
+// point both ways, and publishing a new snapshot must not free the old one
+// while a reader still holds it. Exits non-zero if a check fails.
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "topology.h"
+
+#define KEYSTROKES 200000
+#define MAX_DISPLAYS 16
+
+static DisplayInfo gServerDisplays[MAX_DISPLAYS];
+static uint32_t    gServerCount;
+static int         gFailures;
+
+static void fail(const char *what, TopoPoint pos, double got, double want) {
+    if (gFailures++ < 10) printf("  FAIL %s at (%.0f, %.0f): %g, expected %g\n", what, pos.x, pos.y, got, want);
+}
+
+static uint32_t wsGetActiveDisplayList(uint32_t max, uint32_t *ids) {
+    (void)getppid();
+    uint32_t n = gServerCount < max ? gServerCount : max;
+    for (uint32_t i = 0; i < n; i++) ids[i] = gServerDisplays[i].id;
+    return n;
+}
+
+static TopoRect wsDisplayBounds(uint32_t id) {
+    (void)getppid();
+    for (uint32_t i = 0; i < gServerCount; i++) {
+        if (gServerDisplays[i].id == id) return gServerDisplays[i].bounds;
+    }
+    return (TopoRect){ 0, 0, 0, 0 };
+}
+
+// The original switchDisplay() lookup, against the simulated server.
+static TopoPoint legacySwitch(TopoPoint pos) {
+    uint32_t ids[MAX_DISPLAYS];
+    uint32_t count = wsGetActiveDisplayList(MAX_DISPLAYS, ids);
+    uint32_t current = 0;
+    TopoRect currentBounds = wsDisplayBounds(ids[0]);
+    for (uint32_t i = 0; i < count; i++) {
+        TopoRect bounds = wsDisplayBounds(ids[i]);
+        if (topoRectContains(bounds, pos)) {
+            current = i;
+            currentBounds = bounds;
+            break;
+        }
+    }
+    TopoRect next = wsDisplayBounds(ids[(current + 1) % count]);
+    double fx = (pos.x - currentBounds.x) / currentBounds.width;
+    double fy = (pos.y - currentBounds.y) / currentBounds.height;
+    return (TopoPoint){ next.x + fx * next.width, next.y + fy * next.height };
+}
+
+static TopoPoint snapshotSwitch(TopoPoint pos) {
+    unsigned token;
+    const Topology *topology = topologyAcquire(&token);
+    int current = topologyDisplayAt(topology, pos);
+    if (current < 0) current = 0;
+    TopoPoint out = topologyMapPoint(topology, current, (current + 1) % (int)topology->count, pos);
+    topologyRelease(token);
+    return out;
+}
+
+// The legacy path's display index for pos: the first display containing it, else 0
+static int legacyDisplayAt(TopoPoint pos) {
+    uint32_t ids[MAX_DISPLAYS];
+    uint32_t count = wsGetActiveDisplayList(MAX_DISPLAYS, ids);
+    for (uint32_t i = 0; i < count; i++) {
+        if (topoRectContains(wsDisplayBounds(ids[i]), pos)) return (int)i;
+    }
+    return 0;
+}
+
+static TopoPoint randomPoint(uint32_t *seed) {
+    double x = benchRandom(seed) % (gServerCount * 1920);
+    return (TopoPoint){ x, benchRandom(seed) % 1080 };
+}
+
+// The snapshot answers exactly what the legacy path does, for every sampled point
+static void checkAgainstLegacy(void) {
+    uint32_t seed = 12345;
+    unsigned token;
+    const Topology *topology = topologyAcquire(&token);
+    for (size_t i = 0; i < KEYSTROKES; i++) {
+        TopoPoint pos = randomPoint(&seed);
+        int legacy = legacyDisplayAt(pos);
+        int current = topologyDisplayAt(topology, pos);
+        if (current != legacy) fail("topologyDisplayAt", pos, current, legacy);
+        if (current < 0) continue;
+        TopoPoint want = legacySwitch(pos);
+        TopoPoint got = topologyMapPoint(topology, current, (current + 1) % (int)topology->count, pos);
+        if (fabs(got.x - want.x) > 1e-6) fail("topologyMapPoint x", pos, got.x, want.x);
+        if (fabs(got.y - want.y) > 1e-6) fail("topologyMapPoint y", pos, got.y, want.y);
+    }
+    topologyRelease(token);
+}
+
+static _Atomic bool gPublished;
+
+static void *publishThread(void *arg) {
+    topologyPublish(arg);
+    atomic_store(&gPublished, true);
+    return NULL;
+}
+
+// A reader holding the current snapshot keeps it alive: topologyPublish()
+// frees the old snapshot on return, so it must not return before the release
+static void checkPublishWaitsForRelease(void) {
+    unsigned token;
+    const Topology *old = topologyAcquire(&token);
+    uint64_t generation = old->generation;
+    Topology *next = topologyCreate(gServerDisplays, gServerCount);
+    pthread_t thread;
+    atomic_store(&gPublished, false);
+    if (!next || pthread_create(&thread, NULL, publishThread, next) != 0) {
+        topologyRelease(token);
+        if (gFailures++ < 10) printf("  FAIL cannot start the publisher\n");
+        return;
+    }
+    usleep(50000);
+    bool early = atomic_load(&gPublished);
+    if (early) {
+        if (gFailures++ < 10) printf("  FAIL topologyPublish returned (old snapshot freed) while a reader held it\n");
+    } else if (old->generation != generation || old->count != gServerCount) {
+        if (gFailures++ < 10) printf("  FAIL the held snapshot changed under its reader\n");
+    }
+    topologyRelease(token);
+    pthread_join(thread, NULL);
+    const Topology *current = topologyAcquire(&token);
+    if (current != next) {
+        if (gFailures++ < 10) printf("  FAIL the published snapshot is not current\n");
+    }
+    topologyRelease(token);
+    printf("  %-34s %s\n", "publish waits for the reader", early ? "FAILED" : "ok");
+}
+
+static void makeRow(uint32_t count) {
+    gServerCount = count;
+    for (uint32_t i = 0; i < count; i++) {
+        gServerDisplays[i] = (DisplayInfo){ .id = 100 + i, .bounds = { i * 1920.0, 0, 1920, 1080 }, .scale = 1.0 };
+    }
+}
+
+static void run(const char *name, TopoPoint (*fn)(TopoPoint), uint64_t *samples) {
+    uint32_t seed = 12345;
+    volatile double sink = 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < KEYSTROKES; i++) {
+        TopoPoint pos = randomPoint(&seed);
+        uint64_t t0 = benchNowNs();
+        TopoPoint out = fn(pos);
+        uint64_t dt = benchNowNs() - t0;
+        sink += out.x;
+        samples[i] = dt;
+        total += dt;
+    }
+    (void)sink;
+    benchReport(name, samples, KEYSTROKES, total);
+}
+
+int main(void) {
+    static uint64_t samples[KEYSTROKES];
+    static const uint32_t layouts[] = { 2, 4, 8, 16 };
+
+    printf("bench_topology: per-keystroke display lookup (%d keystrokes)\n", KEYSTROKES);
+    for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+        makeRow(layouts[l]);
+        topologyPublish(topologyCreate(gServerDisplays, gServerCount));
+        printf(" %u displays in a row\n", gServerCount);
+        run("query display list per keystroke", legacySwitch, samples);
+        run("cached topology snapshot", snapshotSwitch, samples);
+        checkAgainstLegacy();
+    }
+    checkPublishWaitsForRelease();
+    topologyPublish(NULL);
+
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,235 @@
+// Trace ring: cost of appending a record (alone and from contending
+// threads) and of a hotkey dispatch with tracing, torn-record detection
+// under concurrent dumps, then a scripted session - held and hammered
+// switch keys, jumps, control commands, drags and manual mouse moves on a
+// virtual clock - dumped, decoded and replayed on a fresh simulated backend.
+// Exits non-zero if records are torn or lost, or the replay diverges.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "replay.h"
+#include "switcher.h"
+#include "trace.h"
+
+#define APPENDS        2000000
+#define THREADS        4
+#define DISPATCHES     1000000
+#define SESSION_STEPS  600
+#define DISPLAYS       5
+
+static _Atomic bool gStop;
+
+static uint64_t appendLoop(uint32_t seed, int count) {
+    TraceRecord record = { .kind = TRACE_KEY, .action = ACTION_SWITCH };
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i < count; i++) {
+        // Self-checking payload: a torn copy would break the relation
+        record.timeNs = ((uint64_t)seed << 32) | (uint32_t)i;
+        record.flags = ~record.timeNs;
+        record.totalNs = (uint32_t)i ^ seed;
+        traceAppend(&record);
+    }
+    return benchNowNs() - t0;
+}
+
+static void *appendThread(void *arg) {
+    uint64_t *elapsed = arg;
+    *elapsed = appendLoop((uint32_t)(elapsed - (uint64_t *)0) | 1, APPENDS / THREADS);
+    return NULL;
+}
+
+static void *dumpThread(void *arg) {
+    int *torn = arg;
+    static TraceRecord records[TRACE_CAPACITY];
+    while (!atomic_load(&gStop)) {
+        uint32_t count = traceSnapshot(records, TRACE_CAPACITY);
+        for (uint32_t i = 0; i < count; i++) {
+            const TraceRecord *r = &records[i];
+            if (r->flags != ~r->timeNs || r->totalNs != ((uint32_t)r->timeNs ^ (uint32_t)(r->timeNs >> 32))) (*torn)++;
+        }
+    }
+    return NULL;
+}
+
+static int benchAppend(void) {
+    uint64_t elapsed = appendLoop(1, APPENDS);
+    printf("  %-42s %8.1f ns/record\n", "append, 1 thread", (double)elapsed / APPENDS);
+
+    pthread_t threads[THREADS], dumper;
+    uint64_t times[THREADS];
+    int torn = 0;
+    atomic_store(&gStop, false);
+    pthread_create(&dumper, NULL, dumpThread, &torn);
+    for (int t = 0; t < THREADS; t++) pthread_create(&threads[t], NULL, appendThread, &times[t]);
+    uint64_t slowest = 0;
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        if (times[t] > slowest) slowest = times[t];
+    }
+    atomic_store(&gStop, true);
+    pthread_join(dumper, NULL);
+    printf("  %-42s %8.1f ns/record  (%d threads + concurrent reader)\n", "append, contended",
+           (double)slowest / (APPENDS / THREADS), THREADS);
+    if (torn) fprintf(stderr, "  ERROR: %d torn records passed the stamp check\n", torn);
+    return torn ? 1 : 0;
+}
+
+static void benchDispatch(SimBackend *sim) {
+    HotkeyBinding binding = { .keyCode = KEYCODE_SPACE, .required = MOD_CONTROL, .action = { ACTION_SWITCH, TOPO_NEXT } };
+    binding.forbidden = MOD_ALL & ~binding.required;
+    switcherPublishHotkeys(hotkeyTableCreate(&binding, 1));
+    RepeatOptions noCoalescing = { 0 };
+    switcherSetRepeatOptions(&noCoalescing);
+    sim->virtualClock = false;
+    uint64_t before = traceCount();
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i < DISPATCHES; i++) switcherHandleKey(KEYCODE_SPACE, MOD_CONTROL, 0, false);
+    uint64_t elapsed = benchNowNs() - t0;
+    printf("  %-42s %8.1f ns/hotkey  (%llu records)\n", "switch hotkey incl. trace record",
+           (double)elapsed / DISPATCHES, (unsigned long long)(traceCount() - before));
+}
+
+// A recorded "user session" on the simulated backend
+static void runSession(SimBackend *sim) {
+    HotkeyBinding bindings[] = {
+        { .keyCode = KEYCODE_SPACE, .required = MOD_CONTROL, .action = { ACTION_SWITCH, TOPO_NEXT } },
+        { .keyCode = 0x7B, .required = MOD_COMMAND, .action = { ACTION_SWITCH, TOPO_LEFT } },
+        { .keyCode = 0x7C, .required = MOD_COMMAND, .action = { ACTION_SWITCH, TOPO_RIGHT } },
+        { .keyCode = 0x12, .required = MOD_CONTROL | MOD_OPTION, .action = { ACTION_JUMP, 1 } },
+        { .keyCode = 0x14, .required = MOD_CONTROL | MOD_OPTION, .action = { ACTION_JUMP, 3 } },
+        { .keyCode = 0x17, .required = MOD_CONTROL | MOD_OPTION, .action = { ACTION_JUMP, 9 } },   // no such display
+        { .keyCode = KEYCODE_SPACE, .required = MOD_OPTION | MOD_COMMAND, .action = { ACTION_DRAG, TOPO_NEXT } },
+    };
+    uint32_t count = sizeof(bindings) / sizeof(bindings[0]);
+    for (uint32_t i = 0; i < count; i++) bindings[i].forbidden = MOD_ALL & ~bindings[i].required;
+    switcherPublishHotkeys(hotkeyTableCreate(bindings, count));
+    RepeatOptions repeat = REPEAT_DEFAULT_OPTIONS;
+    switcherSetRepeatOptions(&repeat);
+    switcherSetJumpAnchor(ANCHOR_LAST);
+    sim->virtualClock = true;
+    sim->clockNs = 1000000000ull;
+
+    uint32_t seed = 11;
+    for (int step = 0; step < SESSION_STEPS; step++) {
+        uint32_t choice = benchRandom(&seed) % 16;
+        if (choice == 0) {
+            // The user moves the mouse by hand
+            const DisplayInfo *d = &sim->displays[benchRandom(&seed) % sim->count];
+            pthread_mutex_lock(&sim->lock);
+            sim->cursor = (TopoPoint){ d->bounds.x + benchRandom(&seed) % (uint32_t)d->bounds.width,
+                                       d->bounds.y + benchRandom(&seed) % (uint32_t)d->bounds.height };
+            pthread_mutex_unlock(&sim->lock);
+        } else if (choice == 1) {
+            switcherRun((HotkeyAction){ ACTION_SWITCH, TOPO_PREV }, 1 + benchRandom(&seed) % 3);
+        } else if (choice == 2) {
+            switcherRun((HotkeyAction){ ACTION_JUMP, 2 }, 0);
+        } else if (choice == 3) {
+            switcherHandleKey(KEYCODE_SPACE, MOD_OPTION | MOD_COMMAND, sim->clockNs, false);
+            while (dragInProgress()) usleep(100);
+        } else if (choice < 8) {
+            // Held: a press and a run of auto-repeats
+            uint32_t repeats = benchRandom(&seed) % 12;
+            for (uint32_t r = 0; r <= repeats; r++) {
+                switcherHandleKey(KEYCODE_SPACE, MOD_CONTROL, sim->clockNs, r > 0);
+                simBackendAdvance(sim, 33000000ull);
+            }
+        } else if (choice < 12) {
+            // Hammered arrows
+            uint16_t key = choice & 1 ? 0x7B : 0x7C;
+            uint32_t presses = 1 + benchRandom(&seed) % 6;
+            for (uint32_t p = 0; p < presses; p++) {
+                switcherHandleKey(key, MOD_COMMAND, sim->clockNs, false);
+                simBackendAdvance(sim, 5000000ull + benchRandom(&seed) % 20000000ull);
+            }
+        } else {
+            static const uint16_t jumps[] = { 0x12, 0x14, 0x17 };
+            switcherHandleKey(jumps[benchRandom(&seed) % 3], MOD_CONTROL | MOD_OPTION, sim->clockNs, false);
+        }
+        simBackendAdvance(sim, benchRandom(&seed) % 200000000ull);
+    }
+    simBackendAdvance(sim, 1000000000ull);
+    switcherPublishHotkeys(NULL);
+}
+
+int main(void) {
+    printf("bench_trace: trace ring, dump and replay\n");
+    int errors = benchAppend();
+
+    DisplayInfo displays[DISPLAYS];
+    SimBackend sim;
+    simBackendInit(&sim);
+    simBackendSetDisplays(&sim, displays, simLayoutRow(displays, DISPLAYS, 1920, 1080));
+    switcherInit(&sim.backend);
+    switcherRebuildTopology();
+    static const DragOptions fastDrag = { .frameRate = 1000 };
+    dragEngineStart(switcherDragPoster(), &fastDrag);
+    benchDispatch(&sim);
+
+    uint64_t first = traceCount();
+    runSession(&sim);
+    uint32_t recorded = (uint32_t)(traceCount() - first);
+
+    char path[] = "/tmp/bench_trace.XXXXXX";
+    int fd = mkstemp(path);
+    uint64_t t0 = benchNowNs();
+    bool dumped = fd >= 0 && traceDumpFd(fd);
+    uint64_t dumpNs = benchNowNs() - t0;
+    if (fd >= 0) close(fd);
+    dragEngineStop();
+
+    TraceFile file;
+    char error[256];
+    t0 = benchNowNs();
+    if (!dumped || !traceLoad(path, &file, error, sizeof(error))) {
+        fprintf(stderr, "  ERROR: dump/load failed: %s\n", dumped ? error : "write failed");
+        unlink(path);
+        return 1;
+    }
+    uint64_t loadNs = benchNowNs() - t0;
+    unlink(path);
+    printf("  %-42s %8.1f us dump  %8.1f us load  (%u records)\n", "ring -> file -> decode",
+           dumpNs / 1e3, loadNs / 1e3, file.recordCount);
+    if (file.recordCount != TRACE_CAPACITY || file.displayCount != DISPLAYS) {
+        fprintf(stderr, "  ERROR: dump holds %u records on %u displays\n", file.recordCount, file.displayCount);
+        errors++;
+    }
+
+    // Keep only the session: the ring still holds the dispatch benchmark
+    uint32_t skip = file.recordCount > recorded ? file.recordCount - recorded : 0;
+    memmove(file.records, file.records + skip, (file.recordCount - skip) * sizeof(TraceRecord));
+    file.recordCount -= skip;
+    uint32_t kinds[TRACE_KIND_COUNT] = { 0 };
+    for (uint32_t i = 0; i < file.recordCount; i++) kinds[file.records[i].kind]++;
+    printf("  session: %u records (%u key, %u control, %u flush, %u timer flush)\n", file.recordCount,
+           kinds[TRACE_KEY], kinds[TRACE_CONTROL], kinds[TRACE_FLUSH_INLINE], kinds[TRACE_FLUSH_TIMER]);
+
+    SimBackend replaySim;
+    simBackendInit(&replaySim);
+    ReplayResult result;
+    t0 = benchNowNs();
+    if (!replayTrace(&file, &replaySim, &result, error, sizeof(error))) {
+        fprintf(stderr, "  ERROR: replay failed: %s\n", error);
+        return 1;
+    }
+    printf("  %-42s %8.1f us  (%u inputs, %u compared, %u mismatches)\n", "replay on a fresh simulated backend",
+           (benchNowNs() - t0) / 1e3, result.inputs, result.compared, result.mismatches);
+    if (result.mismatches) {
+        fprintf(stderr, "  ERROR: replay diverged at record %d\n", result.firstMismatch);
+        errors++;
+    }
+    if (kinds[TRACE_FLUSH_TIMER] == 0 || kinds[TRACE_FLUSH_INLINE] == 0 || kinds[TRACE_CONTROL] == 0) {
+        fprintf(stderr, "  ERROR: session did not exercise every record kind\n");
+        errors++;
+    }
+
+    free(result.records);
+    traceFileFree(&file);
+    simBackendFree(&replaySim);
+    simBackendFree(&sim);
+    return errors ? 1 : 0;
+}
@@ -0,0 +1,331 @@
+// Per-display-pair cursor transforms: built for synthetic layouts of real
+// panel geometries (Retina laptops next to large low-DPI monitors, portrait
+// panels, a projector that reports no size) under each mapping, and checked
+// against their definitions - proportional matches the original formula,
+// physical keeps millimetres from the center and round-trips, edge keeps the
+// coordinate along the shared edge, every result lands on the target, the
+// table agrees with building the transform per call, per-pair settings and
+// the unknown-size fallback apply. Then how far off the proportional spot is
+// physically, and the cost of a mapping. Exits non-zero if a check fails.
+
+#include <math.h>
+#include <string.h>
+
+#include "bench.h"
+#include "topology.h"
+
+#define LAYOUTS 400
+#define POINTS  200
+#define MAPS    5000000
+
+typedef struct {
+    const char *name;
+    double      width, height;      // points
+    double      widthMm, heightMm;
+    double      scale;
+} Panel;
+
+static const Panel gPanels[] = {
+    { "MacBook Pro 14in",      1512,  982, 302.1, 196.3, 2.0 },
+    { "MacBook Air 13in",      1470,  956, 286.4, 186.2, 2.0 },
+    { "27in 1440p",            2560, 1440, 596.7, 335.7, 1.0 },
+    { "24in 1080p",            1920, 1080, 527.0, 296.4, 1.0 },
+    { "32in 4K at 1920x1080",  1920, 1080, 708.5, 398.5, 2.0 },
+    { "24in portrait",         1080, 1920, 296.4, 527.0, 1.0 },
+    { "projector, no size",    1920, 1080,   0.0,   0.0, 1.0 },
+};
+#define PANELS (sizeof(gPanels) / sizeof(gPanels[0]))
+
+static int gFailures;
+
+static void fail(const char *what, int from, int to, TopoPoint p, TopoPoint q) {
+    if (gFailures++ < 20) {
+        printf("  FAIL %s: display %d -> %d, (%.2f, %.2f) -> (%.2f, %.2f)\n", what, from, to, p.x, p.y, q.x, q.y);
+    }
+}
+
+static DisplayInfo displayFor(const Panel *panel, uint32_t id, double x, double y) {
+    return (DisplayInfo){
+        .id = id, .bounds = { x, y, panel->width, panel->height }, .scale = panel->scale,
+        .widthMm = panel->widthMm, .heightMm = panel->heightMm,
+    };
+}
+
+// 2-6 random panels in a row, each aligned anywhere along its neighbor's
+// height; every third layout stacks the last one below the first instead
+static uint32_t makeLayout(DisplayInfo *out, uint32_t *seed) {
+    uint32_t count = 2 + benchRandom(seed) % 5;
+    double x = 0, y = 0, previousHeight = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const Panel *panel = &gPanels[benchRandom(seed) % PANELS];
+        if (i > 0) y += round((double)(benchRandom(seed) % 1000) / 1000.0 * previousHeight) - panel->height / 2;
+        out[i] = displayFor(panel, i + 1, x, round(y));
+        x += panel->width;
+        previousHeight = panel->height;
+    }
+    if (count > 2 && benchRandom(seed) % 3 == 0) {
+        const TopoRect *first = &out[0].bounds;
+        out[count - 1].bounds.x = first->x;
+        out[count - 1].bounds.y = first->y + first->height;
+    }
+    return count;
+}
+
+static TopoPoint pointIn(TopoRect r, uint32_t *seed) {
+    return (TopoPoint){ r.x + r.width * (benchRandom(seed) % 100000) / 100000.0,
+                        r.y + r.height * (benchRandom(seed) % 100000) / 100000.0 };
+}
+
+// topologyMapPoint() before the transform table (out of line, as it was)
+__attribute__((noinline)) static TopoPoint legacyMapPoint(TopoRect src, TopoRect dst, TopoPoint p) {
+    double fracX = 0.0, fracY = 0.0;
+    if (src.width > 0) fracX = (p.x - src.x) / src.width;
+    if (src.height > 0) fracY = (p.y - src.y) / src.height;
+    TopoPoint out = { dst.x + fracX * dst.width, dst.y + fracY * dst.height };
+    if (out.x < dst.x) out.x = dst.x;
+    if (out.x > dst.x + dst.width) out.x = dst.x + dst.width;
+    if (out.y < dst.y) out.y = dst.y;
+    if (out.y > dst.y + dst.height) out.y = dst.y + dst.height;
+    return out;
+}
+
+static bool knownSize(const DisplayInfo *d) {
+    return d->widthMm > 0 && d->heightMm > 0;
+}
+
+// Millimetres from the display's center
+static TopoPoint physicalOffset(const DisplayInfo *d, TopoPoint p) {
+    TopoRect b = d->bounds;
+    return (TopoPoint){ (p.x - (b.x + b.width / 2)) * d->widthMm / b.width,
+                        (p.y - (b.y + b.height / 2)) * d->heightMm / b.height };
+}
+
+static bool clampedX(TopoRect b, double x) {
+    return x <= b.x || x >= nextafter(b.x + b.width, b.x);
+}
+
+static bool clampedY(TopoRect b, double y) {
+    return y <= b.y || y >= nextafter(b.y + b.height, b.y);
+}
+
+typedef struct {
+    uint64_t maps, clamped;
+    double   maxError;      // largest deviation from the definition (points or mm)
+} ModeStats;
+
+static void checkPair(const Topology *topology, TopoMapping mode, int from, int to, uint32_t *seed, ModeStats *stats) {
+    const DisplayInfo *a = &topology->displays[from], *b = &topology->displays[to];
+    TopoMapping used = topologyPairMapping(topology, from, to);
+    TopoMapping expected = mode == TOPO_MAP_PHYSICAL && !(knownSize(a) && knownSize(b)) ? TOPO_MAP_PROPORTIONAL : mode;
+    if (used != expected) fail("pair mapping", from, to, (TopoPoint){ 0 }, (TopoPoint){ used, expected });
+    TopoTransform perCall = topologyBuildTransform(a, b, used);
+
+    for (int k = 0; k < POINTS; k++) {
+        TopoPoint p = pointIn(a->bounds, seed);
+        TopoPoint q = topologyMapPoint(topology, from, to, p);
+        TopoPoint r = topoTransformApply(&perCall, p);
+        stats->maps++;
+        if (q.x != r.x || q.y != r.y) fail("table differs from a per-call transform", from, to, p, q);
+        if (!topoRectContains(b->bounds, q)) fail("mapped point off the target", from, to, p, q);
+        bool clamped = clampedX(b->bounds, q.x) || clampedY(b->bounds, q.y);
+        stats->clamped += clamped;
+
+        double error = 0;
+        if (used == TOPO_MAP_PROPORTIONAL) {
+            TopoPoint old = legacyMapPoint(a->bounds, b->bounds, p);
+            error = fmax(fabs(old.x - q.x), fabs(old.y - q.y));
+            if (error > 1e-6) fail("proportional differs from the original mapping", from, to, p, q);
+        } else if (used == TOPO_MAP_PHYSICAL) {
+            TopoPoint want = physicalOffset(a, p), got = physicalOffset(b, q);
+            if (!clampedX(b->bounds, q.x)) error = fmax(error, fabs(want.x - got.x));
+            if (!clampedY(b->bounds, q.y)) error = fmax(error, fabs(want.y - got.y));
+            if (error > 1e-6) fail("physical offset from the center not kept", from, to, p, q);
+            if (!clamped) {
+                TopoPoint back = topologyMapPoint(topology, to, from, q);
+                if (fabs(back.x - p.x) > 1e-6 || fabs(back.y - p.y) > 1e-6) fail("physical round trip", from, to, p, back);
+            }
+        } else if (used == TOPO_MAP_EDGE) {
+            // The kept coordinate: whichever the transform passes through
+            bool keepsY = perCall.scaleY == 1 && perCall.offsetY == 0;
+            double along = keepsY ? p.y : p.x, landed = keepsY ? q.y : q.x;
+            bool inRange = keepsY ? !clampedY(b->bounds, p.y) : !clampedX(b->bounds, p.x);
+            if (inRange) error = fabs(along - landed);
+            if (error > 1e-9) fail("edge coordinate not kept", from, to, p, q);
+        }
+        if (error > stats->maxError) stats->maxError = error;
+    }
+}
+
+static void checkLayouts(void) {
+    static const TopoMapping modes[] = { TOPO_MAP_PROPORTIONAL, TOPO_MAP_PHYSICAL, TOPO_MAP_EDGE };
+    ModeStats stats[TOPO_MAP_COUNT] = { { 0 } };
+    uint64_t buildNs[TOPO_MAP_COUNT] = { 0 }, builds = 0;
+    uint32_t seed = 4242;
+    for (int n = 0; n < LAYOUTS; n++) {
+        DisplayInfo displays[6];
+        uint32_t count = makeLayout(displays, &seed);
+        builds++;
+        for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+            TopoMappingOptions options = { .mode = (uint8_t)modes[m] };
+            uint64_t t0 = benchNowNs();
+            Topology *topology = topologyCreateMapped(displays, count, &options);
+            buildNs[modes[m]] += benchNowNs() - t0;
+            if (!topology || !topology->transforms) {
+                fail("topology not built", -1, -1, (TopoPoint){ 0 }, (TopoPoint){ 0 });
+                topologyDestroy(topology);
+                continue;
+            }
+            for (uint32_t from = 0; from < count; from++) {
+                for (uint32_t to = 0; to < count; to++) {
+                    if (from != to) checkPair(topology, modes[m], (int)from, (int)to, &seed, &stats[modes[m]]);
+                }
+            }
+            topologyDestroy(topology);
+        }
+    }
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        const ModeStats *s = &stats[modes[m]];
+        char name[64];
+        snprintf(name, sizeof(name), "%s, %d layouts", topologyMappingName(modes[m]), LAYOUTS);
+        printf("  %-38s build %6.1f us  %8llu maps  %5.1f%% clamped  max error %.2g %s\n", name,
+               (double)buildNs[modes[m]] / builds / 1e3, (unsigned long long)s->maps,
+               100.0 * s->clamped / (s->maps ? s->maps : 1), s->maxError,
+               modes[m] == TOPO_MAP_PHYSICAL ? "mm" : "pt");
+    }
+}
+
+static void checkSettings(void) {
+    DisplayInfo displays[3] = {
+        displayFor(&gPanels[0], 1, 0, 0),
+        displayFor(&gPanels[4], 2, 1512, -200),
+        displayFor(&gPanels[6], 3, 3432, 0),
+    };
+    TopoMappingOptions options = { .mode = TOPO_MAP_PHYSICAL };
+    options.pairs[0][1] = TOPO_MAP_EDGE;
+    Topology *topology = topologyCreateMapped(displays, 3, &options);
+    TopoPoint none = { 0 };
+    if (topologyPairMapping(topology, 0, 1) != TOPO_MAP_EDGE) fail("per-pair setting", 1, 2, none, none);
+    if (topologyPairMapping(topology, 1, 0) != TOPO_MAP_PHYSICAL) fail("overall mode", 2, 1, none, none);
+    if (topologyPairMapping(topology, 1, 2) != TOPO_MAP_PROPORTIONAL) fail("unknown size fallback", 2, 3, none, none);
+
+    // Side by side: edge keeps the height, so the middle of the laptop's
+    // right edge lands next to it on the monitor
+    TopoPoint p = { 1511, 491 };
+    TopoPoint q = topologyMapPoint(topology, 0, 1, p);
+    if (q.y != 491) fail("edge mapping", 1, 2, p, q);
+    topologyDestroy(topology);
+
+    // Stacked: edge keeps x
+    displays[1].bounds = (TopoRect){ -200, -1080, 1920, 1080 };
+    options.pairs[0][1] = TOPO_MAP_DEFAULT;
+    options.mode = TOPO_MAP_EDGE;
+    topology = topologyCreateMapped(displays, 2, &options);
+    int laptop = topologyIndexOf(topology, 1), monitor = topologyIndexOf(topology, 2);
+    q = topologyMapPoint(topology, laptop, monitor, p);
+    if (q.x != 1511) fail("edge mapping, stacked", 1, 2, p, q);
+    topologyDestroy(topology);
+
+    // Beyond TOPO_TRANSFORM_MAX displays there is no table; same results
+    DisplayInfo wall[80];
+    for (uint32_t i = 0; i < 80; i++) {
+        wall[i] = displayFor(&gPanels[i % PANELS], i + 1, (i % 10) * 3000.0, (i / 10) * 2000.0);
+    }
+    options = (TopoMappingOptions){ .mode = TOPO_MAP_PHYSICAL };
+    topology = topologyCreateMapped(wall, 80, &options);
+    if (!topology || topology->transforms) {
+        fail("video wall without a table", -1, -1, none, none);
+    } else {
+        uint32_t seed = 9;
+        for (int k = 0; k < 1000; k++) {
+            int from = (int)(benchRandom(&seed) % 80), to = (int)(benchRandom(&seed) % 80);
+            TopoPoint a = pointIn(wall[from].bounds, &seed);
+            TopoTransform t = topologyBuildTransform(&wall[from], &wall[to], topologyPairMapping(topology, from, to));
+            TopoPoint got = topologyMapPoint(topology, from, to, a), want = topoTransformApply(&t, a);
+            if (got.x != want.x || got.y != want.y) fail("video wall mapping", from, to, a, got);
+        }
+    }
+    topologyDestroy(topology);
+}
+
+// How far, physically, the proportional spot is from the physical one when
+// moving off a Retina laptop onto a large low-DPI monitor and back
+static void reportMisplacement(void) {
+    DisplayInfo pair[2] = { displayFor(&gPanels[0], 1, 0, 0), displayFor(&gPanels[4], 2, 1512, 0) };
+    TopoMappingOptions proportional = { .mode = TOPO_MAP_PROPORTIONAL }, physical = { .mode = TOPO_MAP_PHYSICAL };
+    Topology *a = topologyCreateMapped(pair, 2, &proportional), *b = topologyCreateMapped(pair, 2, &physical);
+    uint32_t seed = 31;
+    for (int dir = 0; dir < 2; dir++) {
+        double total = 0, worst = 0;
+        uint32_t counted = 0;
+        for (int k = 0; k < 100000; k++) {
+            TopoPoint p = pointIn(pair[dir].bounds, &seed);
+            TopoPoint q = topologyMapPoint(b, dir, 1 - dir, p);
+            if (clampedX(pair[1 - dir].bounds, q.x) || clampedY(pair[1 - dir].bounds, q.y)) continue;
+            TopoPoint r = topologyMapPoint(a, dir, 1 - dir, p);
+            TopoPoint offQ = physicalOffset(&pair[1 - dir], q), offR = physicalOffset(&pair[1 - dir], r);
+            double mm = hypot(offQ.x - offR.x, offQ.y - offR.y);
+            total += mm;
+            if (mm > worst) worst = mm;
+            counted++;
+        }
+        printf("  %-38s mean %5.1f mm, max %5.1f mm off the physical spot\n",
+               dir == 0 ? "proportional, laptop -> 32in" : "proportional, 32in -> laptop",
+               counted ? total / counted : 0, worst);
+    }
+    topologyDestroy(a);
+    topologyDestroy(b);
+}
+
+static void benchMapping(void) {
+    DisplayInfo displays[4] = {
+        displayFor(&gPanels[0], 1, 0, 300), displayFor(&gPanels[2], 2, 1512, 0),
+        displayFor(&gPanels[4], 3, 4072, 0), displayFor(&gPanels[5], 4, 5992, -400),
+    };
+    TopoMappingOptions options = { .mode = TOPO_MAP_PHYSICAL };
+    Topology *topology = topologyCreateMapped(displays, 4, &options);
+    static TopoPoint points[1024];
+    static int froms[1024], tos[1024];
+    uint32_t seed = 5;
+    for (int i = 0; i < 1024; i++) {
+        froms[i] = (int)(benchRandom(&seed) % 4);
+        tos[i] = (froms[i] + 1 + (int)(benchRandom(&seed) % 3)) % 4;
+        points[i] = pointIn(displays[froms[i]].bounds, &seed);
+    }
+    double sink = 0;
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i < MAPS; i++) {
+        TopoPoint q = topologyMapPoint(topology, froms[i & 1023], tos[i & 1023], points[i & 1023]);
+        sink += q.x;
+    }
+    uint64_t t1 = benchNowNs();
+    for (int i = 0; i < MAPS; i++) {
+        int from = froms[i & 1023], to = tos[i & 1023];
+        TopoTransform t = topologyBuildTransform(&topology->displays[from], &topology->displays[to],
+                                                 topologyPairMapping(topology, from, to));
+        sink += topoTransformApply(&t, points[i & 1023]).x;
+    }
+    uint64_t t2 = benchNowNs();
+    for (int i = 0; i < MAPS; i++) {
+        TopoPoint q = legacyMapPoint(displays[froms[i & 1023]].bounds, displays[tos[i & 1023]].bounds, points[i & 1023]);
+        sink += q.x;
+    }
+    uint64_t t3 = benchNowNs();
+    printf("  %-38s %8.2f ns/map\n", "transform table (physical)", (double)(t1 - t0) / MAPS);
+    printf("  %-38s %8.2f ns/map\n", "transform built per call", (double)(t2 - t1) / MAPS);
+    printf("  %-38s %8.2f ns/map (checksum %.0f)\n", "original proportional arithmetic", (double)(t3 - t2) / MAPS,
+           sink / 1e9);
+    topologyDestroy(topology);
+}
+
+int main(void) {
+    printf("bench_transform: per-display-pair cursor transforms\n");
+    checkLayouts();
+    checkSettings();
+    reportMisplacement();
+    benchMapping();
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
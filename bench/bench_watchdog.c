@@ -0,0 +1,261 @@
+// Event tap watchdog. A simulated tap stands in for the system's: it calls
+// the dispatch path for each key the way eventTapCallback() does, disables
+// itself when a callback runs past SYSTEM_LIMIT_US and delivers the notice,
+// and drops keys while disabled. Cursor warps are made slow on the
+// simulated backend, with a longer stall every tenth one. The same slow
+// stream runs with everything in the tap, then with the watchdog deferring
+// predicted overruns to its worker; then fast again (deferral must stop)
+// and slow from a fast history (it must be learned within a few presses).
+// Finally the re-enable backoff is checked on a virtual timeline. Exits
+// non-zero if a check fails.
+
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "backend_sim.h"
+#include "log.h"
+#include "stats.h"
+#include "switcher.h"
+#include "watchdog.h"
+
+#define BUDGET_US       2000    // callback budget
+#define SYSTEM_LIMIT_US 8000    // the simulated system disables the tap beyond this
+#define SLOW_WARP_US    5000
+#define STALL_WARP_US   10000   // every tenth warp
+#define KEY_GAP_US      6000    // between presses
+#define PRESSES         60
+#define BURST           20      // the last presses of the deferred run, back to back
+
+static int gFailures;
+
+static void fail(const char *what, uint64_t value) {
+    if (gFailures++ < 10) printf("  FAIL %s: %llu\n", what, (unsigned long long)value);
+}
+
+static SimBackend gSim;
+
+// The stand-in for the system's tap and for monitor_switcher's glue
+typedef struct {
+    bool     enabled;
+    uint64_t reenableAt;
+    uint64_t lost;          // keys the tap never saw
+    uint64_t callbacks;
+    uint64_t maxNs;
+    uint64_t overBudget;
+} SimTap;
+
+static void tapReenable(SimTap *tap) {
+    tap->enabled = true;
+    watchdogTapEnabled(statsNowNs());
+}
+
+// The disable notice, as eventTapCallback() handles it
+static void tapDisabled(SimTap *tap, WatchdogReason reason) {
+    tap->enabled = false;
+    uint64_t now = statsNowNs();
+    tap->reenableAt = watchdogTapDisabled(reason, now);
+    if (tap->reenableAt <= now) tapReenable(tap);
+}
+
+// The re-enable timer, polled
+static void tapPoll(SimTap *tap) {
+    if (!tap->enabled && watchdogTapPending() && statsNowNs() >= tap->reenableAt) tapReenable(tap);
+}
+
+static void tapWaitEnabled(SimTap *tap) {
+    while (!tap->enabled) {
+        usleep(1000);
+        tapPoll(tap);
+    }
+}
+
+static void tapKey(SimTap *tap, uint16_t keyCode, uint64_t flags) {
+    tapPoll(tap);
+    if (!tap->enabled) {
+        tap->lost++;
+        return;
+    }
+    // As eventTapCallback(): timed from the top, unless the fast reject
+    // turns the key away
+    uint64_t t0 = statsNowNs();
+    if (!switcherKeyMayMatch(keyCode)) return;
+    uint64_t eventTime = statsNowNs();
+    pthread_mutex_lock(&gSim.lock);
+    TopoPoint cursor = gSim.cursor;
+    pthread_mutex_unlock(&gSim.lock);
+    switcherHandleKeyAt(keyCode, flags, eventTime, false, cursor);
+    uint64_t ns = statsNowNs() - t0;
+    watchdogRecordCallback(ns);
+    tap->callbacks++;
+    if (ns > tap->maxNs) tap->maxNs = ns;
+    if (ns > BUDGET_US * 1000) tap->overBudget++;
+    if (ns > SYSTEM_LIMIT_US * 1000) tapDisabled(tap, WATCHDOG_DISABLED_BY_TIMEOUT);
+}
+
+static int cursorRank(void) {
+    pthread_mutex_lock(&gSim.lock);
+    TopoPoint cursor = gSim.cursor;
+    pthread_mutex_unlock(&gSim.lock);
+    unsigned token;
+    const Topology *topology = topologyAcquire(&token);
+    int display = topologyDisplayAt(topology, cursor);
+    int rank = display >= 0 ? (int)topology->rank[display] : -1;
+    topologyRelease(token);
+    return rank;
+}
+
+static void waitIdle(void) {
+    while (watchdogBusy()) usleep(500);
+}
+
+typedef struct {
+    SimTap        tap;
+    WatchdogStats stats;
+    uint64_t      warps;
+    uint64_t      elapsedNs;
+} RunResult;
+
+// `presses` switch presses, KEY_GAP_US apart except for the last `burst`;
+// `slow` makes the warps slow. Waits for deferred work and a re-enable.
+static RunResult runPresses(const char *name, int presses, int burst, bool slow, uint16_t keyCode, uint64_t flags) {
+    RunResult r = { .tap = { .enabled = true } };
+    watchdogResetStats();
+    simBackendResetCounters(&gSim);
+    uint64_t t0 = benchNowNs();
+    for (int i = 0; i < presses; i++) {
+        gSim.cursorDelayUs = !slow ? 0 : i % 10 == 9 ? STALL_WARP_US : SLOW_WARP_US;
+        tapKey(&r.tap, keyCode, flags);
+        if (i < presses - burst) usleep(KEY_GAP_US);
+    }
+    waitIdle();
+    r.elapsedNs = benchNowNs() - t0;
+    tapWaitEnabled(&r.tap);
+    gSim.cursorDelayUs = 0;
+    r.stats = watchdogGetStats();
+    r.warps = atomic_load(&gSim.calls.cursorSets);
+    printf("  %-30s %3llu over budget, worst %6.2f ms, %llu disabled, %llu re-enabled, %2llu keys lost, "
+           "%2llu deferred\n", name, (unsigned long long)r.tap.overBudget, (double)r.tap.maxNs / 1e6,
+           (unsigned long long)r.stats.disables, (unsigned long long)r.stats.reenables,
+           (unsigned long long)r.tap.lost, (unsigned long long)r.stats.deferred);
+    return r;
+}
+
+static void checkBackoff(void) {
+    // A virtual timeline an hour past the live runs
+    WatchdogOptions options = { .budgetUs = BUDGET_US, .backoffMinMs = 50, .backoffMaxMs = 400, .stableMs = 1000 };
+    watchdogConfigure(&options);
+    watchdogResetStats();
+    const uint64_t ms = 1000000, base = statsNowNs() + 3600000 * ms;
+    // Disabled at `at`, re-enabled when the watchdog says
+    static const struct { uint64_t at, delay; } steps[] = {
+        { 0, 0 },        // first disable: at once
+        { 100, 50 },     // again within stableMs of the re-enable: backoff
+        { 200, 100 },
+        { 350, 200 },
+        { 600, 400 },
+        { 1100, 400 },   // capped
+        { 3000, 0 },     // stable for over a second: at once again
+        { 3100, 50 },
+    };
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]); i++) {
+        uint64_t now = base + steps[i].at * ms;
+        uint64_t at = watchdogTapDisabled(WATCHDOG_DISABLED_BY_TIMEOUT, now);
+        if (at - now != steps[i].delay * ms) fail("re-enable delay (ms)", (at - now) / ms);
+        // A second notice before the re-enable changes nothing
+        if (watchdogTapDisabled(WATCHDOG_DISABLED_BY_USER_INPUT, now + ms) != at) fail("repeated notice moved the re-enable", i);
+        if (!watchdogTapPending()) fail("no re-enable pending", i);
+        watchdogTapEnabled(at);
+        if (watchdogTapPending()) fail("re-enable still pending", i);
+    }
+    WatchdogStats stats = watchdogGetStats();
+    size_t n = sizeof(steps) / sizeof(steps[0]);
+    if (stats.disables != n || stats.reenables != n) fail("disables/re-enables on the timeline", stats.disables * 100 + stats.reenables);
+    printf("  %-30s %llu disables, %llu re-enables, delays checked (0 50 100 200 400 400 0 50 ms)\n",
+           "backoff timeline", (unsigned long long)stats.disables, (unsigned long long)stats.reenables);
+}
+
+int main(void) {
+    printf("bench_watchdog: event tap budget, deferral and re-enable\n");
+    logSetLevel(LOG_LEVEL_ERROR);
+
+    simBackendInit(&gSim);
+    DisplayInfo displays[3];
+    uint32_t count = simLayoutRow(displays, 3, 1920, 1080);
+    simBackendSetDisplays(&gSim, displays, count);
+    gSim.cursor = (TopoPoint){ 400, 300 };
+    switcherInit(&gSim.backend);
+    switcherRebuildTopology();
+
+    HotkeyBindingList list = { 0 };
+    HotkeyBinding binding = { .action = { ACTION_SWITCH, TOPO_NEXT } };
+    parse_hotkey("Control+Space", &binding.required, &binding.keyCode);
+    binding.forbidden = MOD_ALL & ~binding.required;
+    hotkeyListAppend(&list, &binding);
+    switcherPublishHotkeys(hotkeyTableCreate(list.items, list.count));
+    hotkeyListFree(&list);
+    uint16_t key = binding.keyCode;
+    uint64_t flags = binding.required;
+
+    WatchdogOptions options = { .budgetUs = BUDGET_US, .backoffMinMs = 50, .backoffMaxMs = 400, .stableMs = 1000 };
+    watchdogConfigure(&options);
+
+    // Fast warps, no worker: everything fits
+    RunResult fast = runPresses("fast, in the tap", 200, 0, false, key, flags);
+    if (fast.tap.overBudget) fail("fast callbacks over budget", fast.tap.overBudget);
+    if (fast.stats.disables) fail("fast run disabled the tap", fast.stats.disables);
+
+    // Slow warps without the worker: the tap is disabled and keys are lost
+    RunResult inTap = runPresses("slow, in the tap", PRESSES, 0, true, key, flags);
+    if (inTap.tap.overBudget != inTap.tap.callbacks) fail("slow callbacks within budget in the tap", inTap.tap.overBudget);
+    if (!inTap.stats.disables || !inTap.tap.lost) fail("the simulated system never disabled the tap", 0);
+    if (inTap.stats.reenables != inTap.stats.disables) fail("disables left without a re-enable", inTap.stats.disables);
+    if (inTap.stats.overruns != inTap.tap.overBudget) fail("overruns counted", inTap.stats.overruns);
+
+    // The worker takes them: known slow, so deferred from the first press,
+    // and a burst queues up behind each other
+    if (!watchdogStart(switcherRunDeferred)) {
+        printf("  FAIL cannot start the watchdog worker\n");
+        return 1;
+    }
+    int before = cursorRank();
+    RunResult deferred = runPresses("slow, deferred", PRESSES, BURST, true, key, flags);
+    if (deferred.tap.overBudget) fail("deferred run over budget", deferred.tap.overBudget);
+    if (deferred.stats.disables) fail("deferred run disabled the tap", deferred.stats.disables);
+    if (deferred.tap.lost) fail("deferred run lost keys", deferred.tap.lost);
+    if (deferred.stats.deferred != PRESSES) fail("presses deferred", deferred.stats.deferred);
+    if (deferred.warps != PRESSES) fail("switches carried out", deferred.warps);
+    if (cursorRank() != (before + PRESSES) % (int)count) fail("cursor on the wrong display after the run", (uint64_t)cursorRank());
+    printf("  %-30s %.2f ms worst callback, %.0f ms to drain %d presses\n", "",
+           (double)deferred.tap.maxNs / 1e6, (double)deferred.elapsedNs / 1e6, PRESSES);
+
+    // Fast again: the first few still go to the worker, then inline
+    RunResult recovered = runPresses("fast again", 40, 0, false, key, flags);
+    RunResult settled = runPresses("fast, settled", 40, 0, false, key, flags);
+    if (recovered.stats.deferred > 10) fail("fast presses deferred while recovering", recovered.stats.deferred);
+    if (settled.stats.deferred) fail("fast presses deferred once settled", settled.stats.deferred);
+    if (watchdogPredictNs(ACTION_SWITCH) > BUDGET_US * 1000) fail("prediction stuck above budget", watchdogPredictNs(ACTION_SWITCH));
+
+    // Slow from a fast history: a couple of overruns while it is learned,
+    // none long enough to get the tap disabled
+    before = cursorRank();
+    RunResult learned = runPresses("slow, learned", PRESSES, BURST, true, key, flags);
+    if (learned.tap.overBudget > 4) fail("overruns before the slowdown was learned", learned.tap.overBudget);
+    if (learned.stats.disables) fail("learning run disabled the tap", learned.stats.disables);
+    if (learned.tap.lost) fail("learning run lost keys", learned.tap.lost);
+    if (cursorRank() != (before + PRESSES) % (int)count) fail("cursor on the wrong display after learning", (uint64_t)cursorRank());
+    watchdogStop();
+
+    checkBackoff();
+
+    printf("  counters: tap_disabled %llu, tap_reenabled %llu, tap_overruns %llu, deferred %llu\n",
+           (unsigned long long)statsCounter(COUNTER_TAP_DISABLED), (unsigned long long)statsCounter(COUNTER_TAP_REENABLED),
+           (unsigned long long)statsCounter(COUNTER_TAP_OVERRUNS), (unsigned long long)statsCounter(COUNTER_DEFERRED));
+    simBackendFree(&gSim);
+
+    if (gFailures) {
+        printf("  %d check(s) failed\n", gFailures);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,265 @@
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "log.h"
+#include "stats.h"
+#include "switcher.h"
+
+static const HotkeyConfigEntry kDefaultHotkeys[CONFIG_HOTKEY_COUNT] = {
+    { "switch_hotkey",       "Control+Space",                { ACTION_SWITCH, TOPO_NEXT },   true },
+    { "switch_up_hotkey",    "Control+Command+Up",           { ACTION_SWITCH, TOPO_UP },     true },
+    { "switch_down_hotkey",  "Control+Command+Down",         { ACTION_SWITCH, TOPO_DOWN },   true },
+    { "exit_hotkey",         "Control+Option+Command+Q",     { ACTION_EXIT, 0 },             false },
+    { "switch_left_hotkey",  "Command+Left",                 { ACTION_SWITCH, TOPO_LEFT },   true },
+    { "switch_right_hotkey", "Command+Right",                { ACTION_SWITCH, TOPO_RIGHT },  true },
+    { "drag_window_hotkey",  "Control+Option+Command+Space", { ACTION_DRAG, TOPO_NEXT },     true },
+    { "evacuate_hotkey",     "",                             { ACTION_EVACUATE, TOPO_NEXT }, true },
+    { "display_1_hotkey",    "",                             { ACTION_JUMP, 1 },             true },
+    { "display_2_hotkey",    "",                             { ACTION_JUMP, 2 },             true },
+    { "display_3_hotkey",    "",                             { ACTION_JUMP, 3 },             true },
+    { "display_4_hotkey",    "",                             { ACTION_JUMP, 4 },             true },
+    { "display_5_hotkey",    "",                             { ACTION_JUMP, 5 },             true },
+    { "display_6_hotkey",    "",                             { ACTION_JUMP, 6 },             true },
+    { "display_7_hotkey",    "",                             { ACTION_JUMP, 7 },             true },
+    { "display_8_hotkey",    "",                             { ACTION_JUMP, 8 },             true },
+    { "display_9_hotkey",    "",                             { ACTION_JUMP, 9 },             true },
+};
+
+static void copyString(char *dst, size_t size, const char *src) {
+    strncpy(dst, src, size - 1);
+    dst[size - 1] = '\0';
+}
+
+static bool parseBool(const char *val) {
+    return strcasecmp(val, "false") != 0 && strcmp(val, "0") != 0;
+}
+
+void configDefaults(Config *config) {
+    memset(config, 0, sizeof(*config));
+    memcpy(config->hotkeys, kDefaultHotkeys, sizeof(kDefaultHotkeys));
+    config->drag = (DragOptions)DRAG_DEFAULT_OPTIONS;
+    config->windowMode = WINDOW_MODE_MOVE;
+    config->move = (MoveOptions)MOVE_DEFAULT_OPTIONS;
+    config->repeat = (RepeatOptions)REPEAT_DEFAULT_OPTIONS;
+    config->sequenceTimeoutMs = HOTKEY_SEQUENCE_TIMEOUT_MS;
+    config->watchdog = (WatchdogOptions)WATCHDOG_DEFAULT_OPTIONS;
+    copyString(config->notificationSink, sizeof(config->notificationSink), "native");
+    copyString(config->statsFile, sizeof(config->statsFile), "/tmp/quickmonitorswitcher-stats.json");
+    config->statsJSON = true;
+    copyString(config->traceFile, sizeof(config->traceFile), "/tmp/quickmonitorswitcher.trace");
+    config->watch = true;
+    config->logLevel = LOG_LEVEL_INFO;
+}
+
+bool configLoad(Config *config, const char *path, char *error, size_t errorSize) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        snprintf(error, errorSize, "cannot open %s", path);
+        return false;
+    }
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == ';' || line[0] == '[') continue;
+        char *eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        char *key = line;
+        char *val = eq + 1;
+        while (*key == ' ' || *key == '\t') key++;
+        char *end = key + strlen(key) - 1;
+        while (end > key && (*end == ' ' || *end == '\t')) *end-- = '\0';
+        while (*val == ' ' || *val == '\t') val++;
+        char *vn = strchr(val, '\n'); if (vn) *vn = '\0';
+        char *cr = strchr(val, '\r'); if (cr) *cr = '\0';
+        HotkeyConfigEntry *entry = NULL;
+        for (size_t i = 0; i < CONFIG_HOTKEY_COUNT; i++) {
+            if (strcasecmp(key, config->hotkeys[i].key) == 0) entry = &config->hotkeys[i];
+        }
+        if (entry) {
+            copyString(entry->hotkey, sizeof(entry->hotkey), val);
+        } else if (strcasecmp(key, "drag_frame_rate") == 0) {
+            config->drag.frameRate = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcasecmp(key, "drag_move_ms") == 0) {
+            config->drag.moveMs = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcasecmp(key, "drag_settle_ms") == 0) {
+            config->drag.settleMs = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcasecmp(key, "drag_adaptive") == 0) {
+            config->drag.adaptive = parseBool(val);
+        } else if (strcasecmp(key, "repeat_window_ms") == 0) {
+            config->repeat.windowMs = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcasecmp(key, "autorepeat") == 0) {
+            if (strcasecmp(val, "ignore") == 0) config->repeat.policy = REPEAT_IGNORE;
+            else if (strcasecmp(val, "accelerate") == 0) config->repeat.policy = REPEAT_ACCELERATE;
+            else config->repeat.policy = REPEAT_THROTTLE;
+        } else if (strcasecmp(key, "autorepeat_rate") == 0) {
+            config->repeat.maxRate = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcasecmp(key, "autorepeat_accel_every") == 0) {
+            config->repeat.accelEvery = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcasecmp(key, "sequence_timeout_ms") == 0) {
+            config->sequenceTimeoutMs = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcasecmp(key, "tap_budget_ms") == 0) {
+            double ms = strtod(val, NULL);
+            config->watchdog.budgetUs = ms > 0 && ms < 60000 ? (uint32_t)(ms * 1000) : 0;
+        } else if (strcasecmp(key, "tap_backoff_max_ms") == 0) {
+            config->watchdog.backoffMaxMs = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcasecmp(key, "jump_modifier") == 0) {
+            copyString(config->jumpModifier, sizeof(config->jumpModifier), val);
+        } else if (strcasecmp(key, "window_mode") == 0) {
+            config->windowMode = strcasecmp(val, "drag") == 0 ? WINDOW_MODE_DRAG : WINDOW_MODE_MOVE;
+        } else if (strcasecmp(key, "window_target") == 0) {
+            config->move.pick = strcasecmp(val, "focused") == 0 ? WINDOW_FOCUSED : WINDOW_UNDER_CURSOR;
+        } else if (strcasecmp(key, "window_scale") == 0) {
+            config->move.scale = parseBool(val);
+        } else if (strcasecmp(key, "jump_anchor") == 0) {
+            if (strcasecmp(val, "last") == 0) config->jumpAnchor = ANCHOR_LAST;
+            else if (strcasecmp(val, "center") == 0) config->jumpAnchor = ANCHOR_CENTER;
+            else config->jumpAnchor = ANCHOR_PROPORTIONAL;
+        } else if (strcasecmp(key, "cursor_mapping") == 0) {
+            TopoMapping mapping;
+            if (topologyParseMapping(val, &mapping)) config->cursorMapping.mode = (uint8_t)mapping;
+        } else if (strncasecmp(key, "cursor_mapping_", 15) == 0) {
+            // cursor_mapping_<from>_<to>, by display number
+            unsigned from = 0, to = 0;
+            char tail;
+            TopoMapping mapping;
+            if (sscanf(key + 15, "%u_%u%c", &from, &to, &tail) == 2 && from >= 1 && to >= 1 &&
+                from <= TOPO_MAPPING_DISPLAYS && to <= TOPO_MAPPING_DISPLAYS && topologyParseMapping(val, &mapping)) {
+                config->cursorMapping.pairs[from - 1][to - 1] = (uint8_t)mapping;
+            }
+        } else if (strcasecmp(key, "stats_file") == 0) {
+            copyString(config->statsFile, sizeof(config->statsFile), val);
+        } else if (strcasecmp(key, "stats_format") == 0) {
+            config->statsJSON = strcasecmp(val, "text") != 0;
+        } else if (strcasecmp(key, "trace_file") == 0) {
+            copyString(config->traceFile, sizeof(config->traceFile), val);
+        } else if (strcasecmp(key, "notification") == 0) {
+            copyString(config->notificationSink, sizeof(config->notificationSink), val);
+        } else if (strcasecmp(key, "notification_file") == 0) {
+            copyString(config->notificationFile, sizeof(config->notificationFile), val);
+        } else if (strcasecmp(key, "notification_interval_ms") == 0) {
+            config->notificationIntervalMs = (uint32_t)strtoul(val, NULL, 10);
+        } else if (strcasecmp(key, "watch_config") == 0) {
+            config->watch = parseBool(val);
+        } else if (strcasecmp(key, "log_level") == 0) {
+            config->logLevel = logLevelFromName(val);
+        } else if (strcasecmp(key, "log_file") == 0) {
+            copyString(config->logFile, sizeof(config->logFile), val);
+        } else if (strcasecmp(key, "control_socket") == 0) {
+            copyString(config->controlSocket, sizeof(config->controlSocket), val);
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// Hotkey entries, jump_modifier digits and drag arrows
+#define CONFIG_MAX_BINDINGS (CONFIG_HOTKEY_COUNT + CONFIG_JUMP_DISPLAYS + 4)
+
+HotkeyTable *configCompileHotkeys(const Config *config, bool strict, char *error, size_t errorSize) {
+    HotkeyBindingList list = { 0 };
+    const char *sources[CONFIG_MAX_BINDINGS];   // config key of each binding
+    uint64_t dragModifiers = 0;
+    for (size_t i = 0; i < CONFIG_HOTKEY_COUNT; i++) {
+        const HotkeyConfigEntry *entry = &config->hotkeys[i];
+        if (entry->hotkey[0] == '\0') continue;
+        HotkeyBinding binding = { .action = entry->action };
+        if (!parse_sequence(entry->hotkey, entry->exact, &binding)) {
+            snprintf(error, errorSize, "%s: cannot parse '%s'", entry->key, entry->hotkey);
+            if (strict) {
+                hotkeyListFree(&list);
+                return NULL;
+            }
+            LOG_WARN("Ignoring %s", error);
+            continue;
+        }
+        if (binding.followCount && !binding.timeoutMs) binding.timeoutMs = config->sequenceTimeoutMs;
+        if (entry->action.type == ACTION_DRAG && !binding.followCount) dragModifiers = binding.required;
+        sources[list.count] = entry->key;
+        hotkeyListAppend(&list, &binding);
+    }
+
+    // jump_modifier + 1..9 jumps to that display (explicit display_N_hotkey wins)
+    if (config->jumpModifier[0]) {
+        uint64_t modifiers;
+        if (!parse_modifiers(config->jumpModifier, &modifiers)) {
+            snprintf(error, errorSize, "jump_modifier: cannot parse '%s'", config->jumpModifier);
+            if (strict) {
+                hotkeyListFree(&list);
+                return NULL;
+            }
+            LOG_WARN("Ignoring %s", error);
+        } else {
+            for (int n = 1; n <= CONFIG_JUMP_DISPLAYS; n++) {
+                char digit[2] = { (char)('0' + n), '\0' };
+                HotkeyBinding binding = { .required = modifiers, .forbidden = MOD_ALL & ~modifiers,
+                                          .action = { ACTION_JUMP, n } };
+                uint64_t none;
+                parse_hotkey(digit, &none, &binding.keyCode);
+                sources[list.count] = "jump_modifier";
+                hotkeyListAppend(&list, &binding);
+            }
+        }
+    }
+
+    // Arrow keys with the drag modifiers pick the drag direction explicitly
+    if (dragModifiers) {
+        static const struct { uint16_t keyCode; TopoDirection direction; } arrows[] = {
+            { KEYCODE_LEFT_ARROW, TOPO_LEFT }, { KEYCODE_RIGHT_ARROW, TOPO_RIGHT },
+            { KEYCODE_UP_ARROW, TOPO_UP },     { KEYCODE_DOWN_ARROW, TOPO_DOWN },
+        };
+        for (size_t i = 0; i < sizeof(arrows) / sizeof(arrows[0]); i++) {
+            HotkeyBinding binding = {
+                .keyCode = arrows[i].keyCode,
+                .required = dragModifiers,
+                .action = { ACTION_DRAG, arrows[i].direction },
+            };
+            sources[list.count] = "drag_window_hotkey arrows";
+            hotkeyListAppend(&list, &binding);
+        }
+    }
+
+    // A sequence must not share its keys with another hotkey, nor start
+    // with one: the later of the two would never fire
+    HotkeyConflict conflicts[CONFIG_MAX_BINDINGS];
+    uint32_t conflictCount = hotkeyFindConflicts(list.items, list.count, conflicts, CONFIG_MAX_BINDINGS);
+    for (uint32_t i = 0; i < conflictCount && i < CONFIG_MAX_BINDINGS; i++) {
+        const HotkeyConflict *c = &conflicts[i];
+        snprintf(error, errorSize, "%s conflicts with %s (%s)", sources[c->later], sources[c->earlier],
+                 c->prefix ? "one starts with the other" : "same keys");
+        if (strict) {
+            hotkeyListFree(&list);
+            return NULL;
+        }
+        LOG_WARN("Ignoring %s", error);
+    }
+
+    HotkeyTable *table = hotkeyTableCreate(list.items, list.count);
+    hotkeyListFree(&list);
+    if (!table) snprintf(error, errorSize, "out of memory");
+    return table;
+}
+
+bool configReloadHotkeys(const char *path, char *error, size_t errorSize) {
+    uint64_t t0 = statsNowNs();
+    Config config;
+    configDefaults(&config);
+    HotkeyTable *table = NULL;
+    if (configLoad(&config, path, error, errorSize)) {
+        table = configCompileHotkeys(&config, true, error, errorSize);
+    }
+    if (!table) {
+        statsCount(COUNTER_CONFIG_ERRORS);
+        return false;
+    }
+    // Waits for the tap to let go of the old table, then frees it
+    switcherPublishHotkeys(table);
+    switcherSetJumpAnchor(config.jumpAnchor);
+    switcherSetWindowMode(config.windowMode);
+    statsRecordPhase(PHASE_CONFIG_RELOAD, statsNowNs() - t0);
+    statsCount(COUNTER_CONFIG_RELOADS);
+    return true;
+}
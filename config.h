@@ -0,0 +1,82 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "drag.h"
+#include "hotkeys.h"
+#include "log.h"
+#include "mover.h"
+#include "repeat.h"
+#include "switcher.h"
+#include "watchdog.h"
+
+// config.ini parsing, independent of the platform. Parsing fills a Config
+// value; compiling turns its hotkeys into an immutable HotkeyTable. Both run
+// off the event tap thread (at startup and on hot reload).
+
+// A hotkey configurable in config.ini, in dispatch priority order
+typedef struct {
+    const char  *key;          // config.ini key
+    char         hotkey[128];  // "Modifier+Key" or a sequence ("Modifier+Key, Key")
+    HotkeyAction action;
+    bool         exact;        // all other modifiers must be released
+} HotkeyConfigEntry;
+
+#define CONFIG_HOTKEY_COUNT 17   // 8 fixed actions + display_1..9_hotkey
+#define CONFIG_JUMP_DISPLAYS 9
+
+typedef struct {
+    HotkeyConfigEntry hotkeys[CONFIG_HOTKEY_COUNT];
+    DragOptions       drag;
+    WindowMode        windowMode;
+    MoveOptions       move;
+    RepeatOptions     repeat;
+
+    uint32_t          sequenceTimeoutMs;     // default pause limit inside hotkey sequences
+    WatchdogOptions   watchdog;              // event tap budget and re-enable backoff
+
+    char              jumpModifier[64];      // "Modifier+..." + digit jumps to display N
+    JumpAnchor        jumpAnchor;
+    TopoMappingOptions cursorMapping;        // where the cursor lands on another display
+
+    char              notificationSink[32];
+    char              notificationFile[PATH_MAX];
+    uint32_t          notificationIntervalMs;
+
+    char              statsFile[PATH_MAX];   // empty = no export
+    bool              statsJSON;
+
+    char              traceFile[PATH_MAX];   // trace dumps (SIGUSR2, crash); empty = none
+
+    bool              watch;                 // reload hotkeys when the file changes
+
+    LogLevel          logLevel;
+    char              logFile[PATH_MAX];     // empty = stderr
+
+    char              controlSocket[PATH_MAX]; // empty = no control socket
+} Config;
+
+void configDefaults(Config *config);
+
+// Overlay the settings in `path` on *config. Returns false (with a message)
+// if the file cannot be read; unknown keys are ignored.
+bool configLoad(Config *config, const char *path, char *error, size_t errorSize);
+
+// Build the dispatch table. With `strict`, any hotkey that does not parse,
+// and any sequence that conflicts with another hotkey (same keys, or one
+// starts the other), fails the whole compile (hot reload keeps the old
+// table then); otherwise such hotkeys are skipped with a warning. Returns
+// NULL on failure.
+HotkeyTable *configCompileHotkeys(const Config *config, bool strict, char *error, size_t errorSize);
+
+// Re-read `path` and publish its hotkeys through switcherPublishHotkeys(),
+// and apply its jump_anchor and window_mode. On any error the current
+// settings stay in place. Records reload latency and success/failure
+// counters in stats.
+bool configReloadHotkeys(const char *path, char *error, size_t errorSize);
+
+#endif // CONFIG_H
@@ -0,0 +1,198 @@
+#include "configwatch.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <sys/event.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#endif
+
+static pthread_t           gThread;
+static bool                gRunning = false;
+static int                 gStopPipe[2] = { -1, -1 };
+static int                 gWatchFd = -1;     // kqueue or inotify descriptor
+static char                gPath[PATH_MAX];
+static char                gDir[PATH_MAX];
+static char                gBase[NAME_MAX + 1];
+static uint32_t            gDebounceMs;
+static ConfigWatchCallback gCallback;
+static void               *gContext;
+
+#if defined(__APPLE__)
+
+static int gDirFd = -1;
+static int gFileFd = -1;
+
+// (Re)arm the vnode filter on the file itself; it may have been replaced
+static void watchFile(void) {
+    if (gFileFd >= 0) close(gFileFd);
+    gFileFd = open(gPath, O_EVTONLY);
+    if (gFileFd < 0) return;
+    struct kevent ev;
+    EV_SET(&ev, gFileFd, EVFILT_VNODE, EV_ADD | EV_CLEAR,
+           NOTE_WRITE | NOTE_EXTEND | NOTE_ATTRIB | NOTE_DELETE | NOTE_RENAME, 0, NULL);
+    kevent(gWatchFd, &ev, 1, NULL, 0, NULL);
+}
+
+static bool watchOpen(void) {
+    gWatchFd = kqueue();
+    if (gWatchFd < 0) return false;
+    gDirFd = open(gDir, O_EVTONLY);
+    if (gDirFd < 0) {
+        close(gWatchFd);
+        gWatchFd = -1;
+        return false;
+    }
+    struct kevent ev;
+    EV_SET(&ev, gDirFd, EVFILT_VNODE, EV_ADD | EV_CLEAR, NOTE_WRITE, 0, NULL);
+    kevent(gWatchFd, &ev, 1, NULL, 0, NULL);
+    watchFile();
+    return true;
+}
+
+static void watchClose(void) {
+    if (gFileFd >= 0) close(gFileFd);
+    if (gDirFd >= 0) close(gDirFd);
+    if (gWatchFd >= 0) close(gWatchFd);
+    gFileFd = gDirFd = gWatchFd = -1;
+}
+
+// Consume pending events; true if the watched file may have changed
+static bool watchDrain(void) {
+    struct kevent events[8];
+    struct timespec zero = { 0, 0 };
+    bool fileChanged = false, dirChanged = false;
+    int n;
+    while ((n = kevent(gWatchFd, NULL, 0, events, 8, &zero)) > 0) {
+        for (int i = 0; i < n; i++) {
+            if ((int)events[i].ident == gFileFd) fileChanged = true;
+            else dirChanged = true;
+        }
+    }
+    if (dirChanged && !fileChanged) {
+        // Some entry in the directory changed: only relevant if it replaced our file
+        struct stat watched, current;
+        bool same = gFileFd >= 0 && fstat(gFileFd, &watched) == 0 &&
+                    stat(gPath, &current) == 0 && watched.st_ino == current.st_ino;
+        if (same) return false;
+        fileChanged = true;
+    }
+    if (fileChanged) watchFile();
+    return fileChanged;
+}
+
+#elif defined(__linux__)
+
+static bool watchOpen(void) {
+    gWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (gWatchFd < 0) return false;
+    if (inotify_add_watch(gWatchFd, gDir, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) < 0) {
+        close(gWatchFd);
+        gWatchFd = -1;
+        return false;
+    }
+    return true;
+}
+
+static void watchClose(void) {
+    if (gWatchFd >= 0) close(gWatchFd);
+    gWatchFd = -1;
+}
+
+static bool watchDrain(void) {
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    ssize_t len;
+    while ((len = read(gWatchFd, buf, sizeof(buf))) > 0) {
+        for (char *p = buf; p < buf + len; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->len && strcmp(event->name, gBase) == 0) changed = true;
+            p += sizeof(*event) + event->len;
+        }
+    }
+    return changed;
+}
+
+#else
+
+static bool watchOpen(void) { return false; }
+static void watchClose(void) {}
+static bool watchDrain(void) { return false; }
+
+#endif
+
+static void *watchThread(void *arg) {
+    (void)arg;
+    struct pollfd fds[2] = {
+        { .fd = gWatchFd, .events = POLLIN },
+        { .fd = gStopPipe[0], .events = POLLIN },
+    };
+    bool pending = false;
+    for (;;) {
+        int n = poll(fds, 2, pending ? (int)gDebounceMs : -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+        if (n == 0) {
+            // Quiet for a full debounce interval: the write is complete
+            pending = false;
+            gCallback(gPath, gContext);
+            continue;
+        }
+        if ((fds[0].revents & POLLIN) && watchDrain()) pending = true;
+    }
+    return NULL;
+}
+
+bool configWatchStart(const char *path, uint32_t debounceMs, ConfigWatchCallback callback, void *context) {
+    if (gRunning || !callback || strlen(path) >= sizeof(gPath)) return false;
+    strcpy(gPath, path);
+    char copy[PATH_MAX];
+    strcpy(copy, path);
+    snprintf(gDir, sizeof(gDir), "%s", dirname(copy));
+    strcpy(copy, path);
+    snprintf(gBase, sizeof(gBase), "%s", basename(copy));
+    gDebounceMs = debounceMs;
+    gCallback = callback;
+    gContext = context;
+
+    if (pipe(gStopPipe) != 0) return false;
+    if (!watchOpen()) {
+        close(gStopPipe[0]);
+        close(gStopPipe[1]);
+        return false;
+    }
+    if (pthread_create(&gThread, NULL, watchThread, NULL) != 0) {
+        watchClose();
+        close(gStopPipe[0]);
+        close(gStopPipe[1]);
+        return false;
+    }
+    gRunning = true;
+    return true;
+}
+
+void configWatchStop(void) {
+    if (!gRunning) return;
+    char byte = 0;
+    ssize_t written = write(gStopPipe[1], &byte, 1);
+    (void)written;
+    pthread_join(gThread, NULL);
+    watchClose();
+    close(gStopPipe[0]);
+    close(gStopPipe[1]);
+    gStopPipe[0] = gStopPipe[1] = -1;
+    gRunning = false;
+}
@@ -0,0 +1,19 @@
+#ifndef CONFIGWATCH_H
+#define CONFIGWATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Watches one file for changes on a background thread (kqueue on macOS,
+// inotify on Linux). The parent directory is watched as well, so editors
+// that save by writing a temporary file and renaming it over the original
+// are picked up. Bursts of events are debounced: the callback runs once the
+// file has been quiet for `debounceMs`.
+
+// Runs on the watcher thread, once per debounced burst of changes.
+typedef void (*ConfigWatchCallback)(const char *path, void *context);
+
+bool configWatchStart(const char *path, uint32_t debounceMs, ConfigWatchCallback callback, void *context);
+void configWatchStop(void);
+
+#endif // CONFIGWATCH_H
@@ -0,0 +1,447 @@
+#include "control.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "log.h"
+#include "stats.h"
+#include "switcher.h"
+#include "topology.h"
+#include "trace.h"
+
+#define CONTROL_MAX_CLIENTS 16
+#define CONTROL_BUFFER      (64 * 1024)
+
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0       // SO_NOSIGPIPE is set on the socket instead
+#endif
+
+typedef struct {
+    int    fd;
+    size_t inLen;
+    size_t outLen, outOff;
+    char   in[CONTROL_BUFFER];
+    char   out[CONTROL_BUFFER];
+} ControlClient;
+
+static pthread_t      gThread;
+static bool           gRunning = false;
+static int            gListenFd = -1;
+static int            gStopPipe[2] = { -1, -1 };
+static char           gPath[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static ControlClient *gClients[CONTROL_MAX_CLIENTS];
+
+// --- Protocol ----------------------------------------------------------------
+
+typedef struct {
+    char  *buf;
+    size_t size, used;
+} ReplyBuffer;
+
+static void appendf(ReplyBuffer *r, const char *fmt, ...) {
+    if (r->used >= r->size) return;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(r->buf + r->used, r->size - r->used, fmt, args);
+    va_end(args);
+    if (n > 0) r->used = r->used + (size_t)n < r->size ? r->used + (size_t)n : r->size - 1;
+}
+
+static const struct { const char *name; TopoDirection direction; } kDirections[] = {
+    { "next", TOPO_NEXT }, { "prev", TOPO_PREV }, { "left", TOPO_LEFT },
+    { "right", TOPO_RIGHT }, { "up", TOPO_UP },   { "down", TOPO_DOWN },
+};
+
+static bool parseDirection(const char *word, TopoDirection *direction) {
+    for (size_t i = 0; i < sizeof(kDirections) / sizeof(kDirections[0]); i++) {
+        if (strcasecmp(word, kDirections[i].name) == 0) {
+            *direction = kDirections[i].direction;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parseCount(const char *word, uint32_t *count) {
+    char *end;
+    unsigned long value = strtoul(word, &end, 10);
+    if (*end != '\0' || value == 0 || value > 1000000) return false;
+    *count = (uint32_t)value;
+    return true;
+}
+
+static void appendTopology(ReplyBuffer *payload) {
+    unsigned token;
+    const Topology *topology = topologyAcquire(&token);
+    if (!topology) {
+        topologyRelease(token);
+        appendf(payload, "\tdisplays 0");
+        return;
+    }
+    appendf(payload, "\tdisplays %u", topology->count);
+    for (uint32_t n = 0; n < topology->count; n++) {
+        const DisplayInfo *d = &topology->displays[topology->order[n]];
+        appendf(payload, " %u:%u@%.0f,%.0f,%.0fx%.0f*%.2g", n + 1, d->id,
+                d->bounds.x, d->bounds.y, d->bounds.width, d->bounds.height, d->scale);
+    }
+    topologyRelease(token);
+}
+
+// Stats as single-line JSON
+static void appendStats(ReplyBuffer *payload) {
+    char json[CONTROL_MAX_REPLY / 2];
+    size_t length = statsFormatJSON(json, sizeof(json));
+    if (length >= sizeof(json)) length = sizeof(json) - 1;
+    appendf(payload, "\t");
+    for (size_t i = 0; i < length && payload->used + 1 < payload->size; i++) {
+        if (json[i] == '\n') {
+            while (i + 1 < length && json[i + 1] == ' ') i++;
+            continue;
+        }
+        payload->buf[payload->used++] = json[i];
+    }
+    payload->buf[payload->used] = '\0';
+}
+
+// Run one command. On failure, returns false with a message in error.
+static bool runCommand(char *command, ReplyBuffer *payload, char *error, size_t errorSize) {
+    char *save = NULL;
+    char *verb = strtok_r(command, " \t", &save);
+    char *arg = strtok_r(NULL, " \t", &save);
+    if (strtok_r(NULL, " \t", &save)) {
+        snprintf(error, errorSize, "too many arguments");
+        return false;
+    }
+
+    TopoDirection direction;
+    if (parseDirection(verb, &direction)) {
+        uint32_t count = 1;
+        if (arg && !parseCount(arg, &count)) {
+            snprintf(error, errorSize, "bad count '%s'", arg);
+            return false;
+        }
+        if (!switcherRun((HotkeyAction){ ACTION_SWITCH, direction }, count)) {
+            snprintf(error, errorSize, "no display %s", verb);
+            return false;
+        }
+        return true;
+    }
+    if (strcasecmp(verb, "jump") == 0) {
+        uint32_t number;
+        if (!arg || !parseCount(arg, &number)) {
+            snprintf(error, errorSize, "usage: jump N");
+            return false;
+        }
+        if (!switcherRun((HotkeyAction){ ACTION_JUMP, (int)number }, 0)) {
+            snprintf(error, errorSize, "no display %u", number);
+            return false;
+        }
+        return true;
+    }
+    if (strcasecmp(verb, "drag") == 0) {
+        direction = TOPO_NEXT;
+        if (arg && !parseDirection(arg, &direction)) {
+            snprintf(error, errorSize, "bad direction '%s'", arg);
+            return false;
+        }
+        if (!switcherRun((HotkeyAction){ ACTION_DRAG, direction }, 0)) {
+            snprintf(error, errorSize, "drag failed");
+            return false;
+        }
+        return true;
+    }
+    if (strcasecmp(verb, "evacuate") == 0) {
+        direction = TOPO_NEXT;
+        if (arg && !parseDirection(arg, &direction)) {
+            snprintf(error, errorSize, "bad direction '%s'", arg);
+            return false;
+        }
+        if (!switcherRun((HotkeyAction){ ACTION_EVACUATE, direction }, 0)) {
+            snprintf(error, errorSize, "evacuate failed");
+            return false;
+        }
+        return true;
+    }
+    if (strcasecmp(verb, "trace") == 0) {
+        const char *path = arg ? arg : traceDumpPath();
+        if (!path) {
+            snprintf(error, errorSize, "usage: trace PATH (no trace_file configured)");
+            return false;
+        }
+        if (!traceDump(path)) {
+            snprintf(error, errorSize, "cannot write %s", path);
+            return false;
+        }
+        appendf(payload, "\ttrace %s", path);
+        return true;
+    }
+    if (arg) {
+        snprintf(error, errorSize, "too many arguments");
+        return false;
+    }
+    if (strcasecmp(verb, "cursor") == 0) {
+        Backend *backend = switcherBackend();
+        TopoPoint p;
+        if (!backend->cursorGet(backend, &p)) {
+            snprintf(error, errorSize, "cursor unavailable");
+            return false;
+        }
+        appendf(payload, "\tcursor %.1f,%.1f", p.x, p.y);
+        return true;
+    }
+    if (strcasecmp(verb, "topology") == 0) {
+        appendTopology(payload);
+        return true;
+    }
+    if (strcasecmp(verb, "stats") == 0) {
+        appendStats(payload);
+        return true;
+    }
+    if (strcasecmp(verb, "ping") == 0) {
+        return true;
+    }
+    snprintf(error, errorSize, "unknown command '%s'", verb);
+    return false;
+}
+
+size_t controlExecute(char *line, char *reply, size_t size) {
+    char payloadBuf[CONTROL_MAX_REPLY];
+    ReplyBuffer payload = { payloadBuf, sizeof(payloadBuf), 0 };
+    payloadBuf[0] = '\0';
+    char error[128] = "";
+    unsigned total = 0, done = 0, failed = 0;
+
+    char *save = NULL;
+    for (char *command = strtok_r(line, ";", &save); command; command = strtok_r(NULL, ";", &save)) {
+        while (*command == ' ' || *command == '\t') command++;
+        if (*command == '\0') continue;
+        total++;
+        char message[128];
+        if (runCommand(command, &payload, message, sizeof(message))) {
+            done++;
+        } else if (!failed) {
+            failed = total;
+            snprintf(error, sizeof(error), "%s", message);
+        }
+    }
+
+    ReplyBuffer out = { reply, size, 0 };
+    if (failed) appendf(&out, "err %u/%u #%u %s", done, total, failed, error);
+    else appendf(&out, "ok %u/%u", done, total);
+    appendf(&out, "%s", payloadBuf);
+    // Always end with exactly one newline, even when truncated
+    if (out.used + 1 >= size) out.used = size - 2;
+    reply[out.used++] = '\n';
+    reply[out.used] = '\0';
+    return out.used;
+}
+
+// --- Server ------------------------------------------------------------------
+
+static void closeClient(int slot) {
+    close(gClients[slot]->fd);
+    free(gClients[slot]);
+    gClients[slot] = NULL;
+}
+
+// Write as much pending output as the socket takes. Returns false on error.
+static bool flushClient(ControlClient *c) {
+    while (c->outOff < c->outLen) {
+        ssize_t n = send(c->fd, c->out + c->outOff, c->outLen - c->outOff, SEND_FLAGS);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        c->outOff += (size_t)n;
+    }
+    if (c->outOff == c->outLen) {
+        c->outOff = c->outLen = 0;
+    } else if (c->outOff > 0) {
+        memmove(c->out, c->out + c->outOff, c->outLen - c->outOff);
+        c->outLen -= c->outOff;
+        c->outOff = 0;
+    }
+    return true;
+}
+
+// Answer every complete request line there is room to reply to
+static void processLines(ControlClient *c) {
+    size_t start = 0;
+    while (CONTROL_BUFFER - c->outLen >= CONTROL_MAX_REPLY) {
+        char *newline = memchr(c->in + start, '\n', c->inLen - start);
+        if (!newline) break;
+        *newline = '\0';
+        if (newline > c->in + start && newline[-1] == '\r') newline[-1] = '\0';
+        c->outLen += controlExecute(c->in + start, c->out + c->outLen, CONTROL_BUFFER - c->outLen);
+        start = (size_t)(newline - c->in) + 1;
+    }
+    if (start > 0) {
+        memmove(c->in, c->in + start, c->inLen - start);
+        c->inLen -= start;
+    }
+    if (c->inLen == CONTROL_BUFFER && CONTROL_BUFFER - c->outLen >= CONTROL_MAX_REPLY) {
+        // A single line longer than the buffer: reject it and resynchronise
+        c->outLen += (size_t)snprintf(c->out + c->outLen, CONTROL_BUFFER - c->outLen, "err 0/0 line too long\n");
+        c->inLen = 0;
+    }
+}
+
+static void acceptClient(void) {
+    int fd = accept(gListenFd, NULL, NULL);
+    if (fd < 0) return;
+    int slot = 0;
+    while (slot < CONTROL_MAX_CLIENTS && gClients[slot]) slot++;
+    ControlClient *c = slot < CONTROL_MAX_CLIENTS ? malloc(sizeof(*c)) : NULL;
+    if (!c) {
+        close(fd);
+        return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    c->fd = fd;
+    c->inLen = c->outLen = c->outOff = 0;
+    gClients[slot] = c;
+}
+
+static void *controlThread(void *arg) {
+    (void)arg;
+    struct pollfd fds[2 + CONTROL_MAX_CLIENTS];
+    int slots[2 + CONTROL_MAX_CLIENTS];
+    for (;;) {
+        nfds_t n = 0;
+        fds[n++] = (struct pollfd){ .fd = gStopPipe[0], .events = POLLIN };
+        fds[n++] = (struct pollfd){ .fd = gListenFd, .events = POLLIN };
+        for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+            ControlClient *c = gClients[i];
+            if (!c) continue;
+            short events = 0;
+            // Stop reading while replies back up: the client has to drain them first
+            if (c->inLen < CONTROL_BUFFER && CONTROL_BUFFER - c->outLen >= CONTROL_MAX_REPLY) events |= POLLIN;
+            if (c->outLen > c->outOff) events |= POLLOUT;
+            slots[n] = i;
+            fds[n++] = (struct pollfd){ .fd = c->fd, .events = events };
+        }
+        if (poll(fds, n, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[0].revents) break;
+        if (fds[1].revents & POLLIN) acceptClient();
+
+        for (nfds_t i = 2; i < n; i++) {
+            ControlClient *c = gClients[slots[i]];
+            if (!c || !fds[i].revents) continue;
+            if ((fds[i].revents & POLLOUT) && !flushClient(c)) {
+                closeClient(slots[i]);
+                continue;
+            }
+            if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t got = recv(c->fd, c->in + c->inLen, CONTROL_BUFFER - c->inLen, 0);
+                if (got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR && errno != EWOULDBLOCK)) {
+                    closeClient(slots[i]);
+                    continue;
+                }
+                if (got > 0) c->inLen += (size_t)got;
+            }
+            // Lines may be waiting from before the output buffer filled up
+            processLines(c);
+            if (!flushClient(c)) closeClient(slots[i]);
+        }
+    }
+    for (int i = 0; i < CONTROL_MAX_CLIENTS; i++) {
+        if (gClients[i]) closeClient(i);
+    }
+    return NULL;
+}
+
+// Remove a socket left behind by an instance that is gone. False if
+// another instance is listening there, or the path is not a socket.
+static bool removeStaleSocket(const struct sockaddr_un *addr) {
+    struct stat st;
+    if (lstat(addr->sun_path, &st) != 0) return errno == ENOENT;
+    if (!S_ISSOCK(st.st_mode)) {
+        LOG_ERROR("control: %s exists and is not a socket", addr->sun_path);
+        return false;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+    bool live = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0;
+    int error = errno;
+    close(fd);
+    if (live) {
+        LOG_ERROR("control: %s is in use by another instance", addr->sun_path);
+        return false;
+    }
+    if (error != ECONNREFUSED) {
+        LOG_ERROR("control: cannot probe %s: %s", addr->sun_path, strerror(error));
+        return false;
+    }
+    return unlink(addr->sun_path) == 0 || errno == ENOENT;
+}
+
+bool controlStart(const char *path) {
+    if (gRunning || strlen(path) >= sizeof(gPath)) return false;
+    strcpy(gPath, path);
+
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strcpy(addr.sun_path, gPath);
+    if (!removeStaleSocket(&addr)) return false;
+    gListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (gListenFd < 0) return false;
+    // Created 0600: no window in which other users could connect
+    mode_t mask = umask(0177);
+    int bound = bind(gListenFd, (struct sockaddr *)&addr, sizeof(addr));
+    umask(mask);
+    if (bound != 0 || listen(gListenFd, CONTROL_MAX_CLIENTS) != 0) {
+        LOG_ERROR("control: cannot listen on %s: %s", gPath, strerror(errno));
+        close(gListenFd);
+        if (bound == 0) unlink(gPath);
+        gListenFd = -1;
+        return false;
+    }
+    fcntl(gListenFd, F_SETFL, fcntl(gListenFd, F_GETFL) | O_NONBLOCK);
+    if (pipe(gStopPipe) != 0) {
+        close(gListenFd);
+        unlink(gPath);
+        return false;
+    }
+    if (pthread_create(&gThread, NULL, controlThread, NULL) != 0) {
+        close(gStopPipe[0]);
+        close(gStopPipe[1]);
+        close(gListenFd);
+        unlink(gPath);
+        return false;
+    }
+    gRunning = true;
+    return true;
+}
+
+void controlStop(void) {
+    if (!gRunning) return;
+    char byte = 0;
+    ssize_t written = write(gStopPipe[1], &byte, 1);
+    (void)written;
+    pthread_join(gThread, NULL);
+    close(gStopPipe[0]);
+    close(gStopPipe[1]);
+    close(gListenFd);
+    unlink(gPath);
+    gListenFd = gStopPipe[0] = gStopPipe[1] = -1;
+    gRunning = false;
+}
@@ -0,0 +1,40 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Local control socket (Unix domain, stream) for scripts and automation.
+//
+// Line protocol. A request is one line holding one or more commands
+// separated by ';'; the server answers every request line with exactly one
+// reply line, so clients can pipeline thousands of commands in a single
+// write and read the replies back in order:
+//
+//   next [N] | prev [N] | left|right|up|down [N]   switch N displays (default 1)
+//   jump N                                          jump to display N (spatial order)
+//   drag [next|prev|left|right|up|down]             move the window (per window_mode)
+//   evacuate [next|prev|left|right|up|down]         move every window off the display
+//   cursor | topology | stats | ping                queries
+//   trace [PATH]                                    dump the trace ring
+//
+// Reply: "ok <done>/<total>" or "err <done>/<total> #<i> <message>" for the
+// first failed command, followed by the output of query commands, each
+// preceded by a tab. Commands run on the control thread through
+// switcherRun(), serialized with hotkey actions.
+
+#define CONTROL_MAX_REPLY 8192   // longest reply line, newline included
+
+// Serve on a socket at path (created mode 0600) from a background thread.
+// A socket there that refuses connections is replaced; returns false if
+// another instance is listening on it, the path is not a socket, or it
+// cannot listen.
+bool controlStart(const char *path);
+void controlStop(void);
+
+// Execute one request line (no newline; modified in place) and format its
+// reply, newline included, into reply. Returns the reply length. Exposed
+// for benchmarks.
+size_t controlExecute(char *line, char *reply, size_t size);
+
+#endif // CONTROL_H
@@ -0,0 +1,239 @@
+#include "drag.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "log.h"
+
+typedef enum {
+    DRAG_IDLE,
+    DRAG_PRESSED,     // button down, waiting for the system to register it
+    DRAG_MOVING,      // posting intermediate drag events, one per frame
+    DRAG_SETTLING,    // at the target, waiting before release
+} DragState;
+
+typedef struct {
+    TopoPoint from, to;
+} DragJob;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  gWake = PTHREAD_COND_INITIALIZER;
+static pthread_t       gThread;
+static bool            gRunning;
+static bool            gHavePending;   // guarded by gLock
+static bool            gCancelPending; // guarded by gLock
+static DragJob         gPending;       // guarded by gLock
+
+static DragPoster     *gPoster;
+static DragOptions     gOptions;
+static _Atomic bool    gBusy;
+
+static _Atomic uint64_t gStarted, gCompleted, gCancelled, gEventsPosted;
+static _Atomic uint64_t gLatencyNs;   // smoothed post() latency
+
+static uint64_t monotonicNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void post(DragEventType type, TopoPoint point) {
+    uint64_t t0 = monotonicNs();
+    gPoster->post(gPoster, type, point);
+    uint64_t elapsed = monotonicNs() - t0;
+    // EWMA, alpha 1/2 while rising and 1/8 while falling: a poster that got
+    // slow must stretch the frames of the drag in flight, not some later one
+    uint64_t latency = atomic_load_explicit(&gLatencyNs, memory_order_relaxed);
+    if (latency == 0) latency = elapsed;
+    else if (elapsed > latency) latency += (elapsed - latency) / 2;
+    else latency -= (latency - elapsed) / 8;
+    atomic_store_explicit(&gLatencyNs, latency, memory_order_relaxed);
+    atomic_fetch_add_explicit(&gEventsPosted, 1, memory_order_relaxed);
+}
+
+// Pause after press / before release: long enough for the window server to
+// keep up (a generous multiple of the measured post latency), within bounds.
+static uint64_t settleNs(void) {
+    uint64_t maxNs = (uint64_t)gOptions.settleMs * 1000000ull;
+    if (!gOptions.adaptive) return maxNs;
+    uint64_t minNs = (uint64_t)gOptions.minSettleMs * 1000000ull;
+    uint64_t wanted = atomic_load_explicit(&gLatencyNs, memory_order_relaxed) * 50;
+    if (wanted < minNs) wanted = minNs;
+    if (wanted > maxNs) wanted = maxNs;
+    return wanted;
+}
+
+// Frame interval: the configured rate, slowed down if posting one event
+// takes more than half a frame so events never queue up behind each other.
+static uint64_t frameNs(void) {
+    uint32_t rate = gOptions.frameRate ? gOptions.frameRate : 60;
+    uint64_t interval = 1000000000ull / rate;
+    if (gOptions.adaptive) {
+        uint64_t latency = atomic_load_explicit(&gLatencyNs, memory_order_relaxed);
+        if (latency * 2 > interval) interval = latency * 2;
+    }
+    return interval;
+}
+
+// Wait on gWake until deadline (monotonic ns) or until a new request or
+// cancellation arrives. Called with gLock held.
+static void waitUntil(uint64_t deadlineNs) {
+    while (gRunning && !gHavePending && !gCancelPending) {
+        uint64_t now = monotonicNs();
+        if (deadlineNs != 0 && now >= deadlineNs) return;
+        if (deadlineNs == 0) {
+            pthread_cond_wait(&gWake, &gLock);
+            continue;
+        }
+        // pthread_cond_timedwait takes a CLOCK_REALTIME deadline
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        uint64_t abs = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec + (deadlineNs - now);
+        ts.tv_sec = (time_t)(abs / 1000000000ull);
+        ts.tv_nsec = (long)(abs % 1000000000ull);
+        pthread_cond_timedwait(&gWake, &gLock, &ts);
+    }
+}
+
+static void *dragMain(void *arg) {
+    (void)arg;
+    DragState state = DRAG_IDLE;
+    DragJob job = { { 0, 0 }, { 0, 0 } };
+    TopoPoint at = { 0, 0 };
+    uint32_t step = 0, steps = 1;
+    uint64_t deadline = 0;
+
+    pthread_mutex_lock(&gLock);
+    for (;;) {
+        waitUntil(state == DRAG_IDLE ? 0 : deadline);
+
+        bool stopping = !gRunning;
+        bool cancel = gCancelPending || stopping || gHavePending;
+        bool start = gHavePending && !stopping;
+        DragJob next = gPending;
+        gCancelPending = false;
+        gHavePending = false;
+        pthread_mutex_unlock(&gLock);
+
+        // Abandon the drag in flight: never leave the button pressed.
+        if (cancel && state != DRAG_IDLE) {
+            post(DRAG_MOUSE_UP, at);
+            atomic_fetch_add(&gCancelled, 1);
+            if (gPoster->finished) gPoster->finished(gPoster, job.from, at, true);
+            state = DRAG_IDLE;
+        }
+        if (stopping) return NULL;
+
+        uint64_t now = monotonicNs();
+        if (start) {
+            job = next;
+            at = job.from;
+            atomic_fetch_add(&gStarted, 1);
+            post(DRAG_MOUSE_DOWN, at);
+            state = DRAG_PRESSED;
+            deadline = monotonicNs() + settleNs();
+        } else if (state == DRAG_PRESSED && now >= deadline) {
+            uint64_t interval = frameNs();
+            steps = (uint32_t)(((uint64_t)gOptions.moveMs * 1000000ull + interval - 1) / interval);
+            if (steps == 0) steps = 1;
+            step = 0;
+            state = DRAG_MOVING;
+            deadline = now;
+        } else if (state == DRAG_MOVING && now >= deadline) {
+            step++;
+            at.x = job.from.x + (job.to.x - job.from.x) * step / steps;
+            at.y = job.from.y + (job.to.y - job.from.y) * step / steps;
+            if (step >= steps) at = job.to; // land exactly on the target
+            post(DRAG_MOUSE_DRAGGED, at);
+            if (step >= steps) {
+                state = DRAG_SETTLING;
+                deadline = monotonicNs() + settleNs();
+            } else {
+                deadline += frameNs();
+                if (deadline < now) deadline = now; // fell behind: don't burst
+            }
+        } else if (state == DRAG_SETTLING && now >= deadline) {
+            post(DRAG_MOUSE_UP, job.to);
+            atomic_fetch_add(&gCompleted, 1);
+            state = DRAG_IDLE;
+            if (gPoster->finished) gPoster->finished(gPoster, job.from, job.to, false);
+        }
+
+        pthread_mutex_lock(&gLock);
+        // Cleared under the lock so it cannot race a concurrent dragRequest()
+        if (state == DRAG_IDLE && !gHavePending) atomic_store(&gBusy, false);
+    }
+}
+
+bool dragEngineStart(DragPoster *poster, const DragOptions *options) {
+    pthread_mutex_lock(&gLock);
+    if (gRunning) {
+        pthread_mutex_unlock(&gLock);
+        return false;
+    }
+    gPoster = poster;
+    gOptions = *options;
+    gHavePending = gCancelPending = false;
+    gRunning = true;
+    if (pthread_create(&gThread, NULL, dragMain, NULL) != 0) {
+        gRunning = false;
+        pthread_mutex_unlock(&gLock);
+        LOG_ERROR("drag: failed to start drag thread");
+        return false;
+    }
+    pthread_mutex_unlock(&gLock);
+    return true;
+}
+
+void dragEngineStop(void) {
+    pthread_mutex_lock(&gLock);
+    if (!gRunning) {
+        pthread_mutex_unlock(&gLock);
+        return;
+    }
+    gRunning = false;
+    pthread_cond_signal(&gWake);
+    pthread_mutex_unlock(&gLock);
+    pthread_join(gThread, NULL);
+}
+
+bool dragRequest(TopoPoint from, TopoPoint to) {
+    pthread_mutex_lock(&gLock);
+    bool running = gRunning;
+    if (running) {
+        gPending = (DragJob){ from, to };
+        gHavePending = true;
+        atomic_store(&gBusy, true);
+        pthread_cond_signal(&gWake);
+    }
+    pthread_mutex_unlock(&gLock);
+    return running;
+}
+
+void dragCancel(void) {
+    if (!atomic_load(&gBusy)) return; // common case: nothing to cancel, no lock
+    pthread_mutex_lock(&gLock);
+    gCancelPending = true;
+    gHavePending = false;
+    pthread_cond_signal(&gWake);
+    pthread_mutex_unlock(&gLock);
+}
+
+bool dragInProgress(void) {
+    return atomic_load(&gBusy);
+}
+
+DragStats dragGetStats(void) {
+    DragStats stats = {
+        .started = atomic_load(&gStarted),
+        .completed = atomic_load(&gCompleted),
+        .cancelled = atomic_load(&gCancelled),
+        .eventsPosted = atomic_load(&gEventsPosted),
+        .postLatencyUs = atomic_load(&gLatencyNs) / 1000.0,
+    };
+    return stats;
+}
@@ -0,0 +1,62 @@
+#ifndef DRAG_H
+#define DRAG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "topology.h"
+
+// Frame-paced drag engine.
+//
+// dragRequest() hands a drag to a dedicated thread and returns at once; the
+// thread runs a timer-driven state machine (press, settle, move at the
+// configured frame rate, settle, release) and posts each synthetic mouse
+// event through an abstract poster. A drag can be cancelled or superseded
+// at any point, in which case the button is released where it is.
+
+typedef enum {
+    DRAG_MOUSE_DOWN,
+    DRAG_MOUSE_DRAGGED,
+    DRAG_MOUSE_UP,
+} DragEventType;
+
+typedef struct DragPoster {
+    // Post one synthetic mouse event. Runs on the drag thread.
+    void (*post)(struct DragPoster *poster, DragEventType type, TopoPoint point);
+    // Optional: called on the drag thread once a drag has finished.
+    void (*finished)(struct DragPoster *poster, TopoPoint from, TopoPoint to, bool cancelled);
+    void *context;
+} DragPoster;
+
+typedef struct {
+    uint32_t frameRate;     // drag events per second while moving
+    uint32_t moveMs;        // time spent moving from source to target
+    uint32_t settleMs;      // upper bound for the pause after press / before release
+    uint32_t minSettleMs;   // lower bound for the same pauses
+    bool     adaptive;      // scale pauses and frame rate to measured post latency
+} DragOptions;
+
+typedef struct {
+    uint64_t started;
+    uint64_t completed;
+    uint64_t cancelled;
+    uint64_t eventsPosted;
+    double   postLatencyUs; // smoothed time spent inside poster->post()
+} DragStats;
+
+#define DRAG_DEFAULT_OPTIONS { .frameRate = 60, .moveMs = 200, .settleMs = 150, .minSettleMs = 30, .adaptive = true }
+
+bool dragEngineStart(DragPoster *poster, const DragOptions *options);
+// Cancels any drag in flight (releasing the button) and joins the thread.
+void dragEngineStop(void);
+
+// Start a drag from `from` to `to`; supersedes a drag in flight.
+// Returns false if the engine is not running.
+bool dragRequest(TopoPoint from, TopoPoint to);
+// Release the button and abandon the drag in flight, if any.
+void dragCancel(void);
+bool dragInProgress(void);
+
+DragStats dragGetStats(void);
+
+#endif // DRAG_H
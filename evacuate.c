@@ -0,0 +1,225 @@
+#include "evacuate.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frame.h"
+#include "log.h"
+#include "stats.h"
+
+// Spots taken on the target display: top-left corners quantized to the
+// cascade step, in an open-addressing set sized for the largest plan plus
+// as many windows already on the target.
+#define SPOT_BITS 12
+#define SPOT_SLOTS (1u << SPOT_BITS)
+
+_Static_assert(SPOT_SLOTS >= 4 * EVACUATE_MAX_WINDOWS, "spot set must stay at most half full");
+
+typedef struct {
+    uint64_t keys[SPOT_SLOTS];
+    bool     used[SPOT_SLOTS];
+    uint32_t count;
+    TopoRect area;
+    double   step;
+} SpotSet;
+
+static uint64_t spotKey(const SpotSet *set, TopoRect r) {
+    int32_t cx = (int32_t)lround((r.x - set->area.x) / set->step);
+    int32_t cy = (int32_t)lround((r.y - set->area.y) / set->step);
+    return (uint64_t)(uint32_t)cx << 32 | (uint32_t)cy;
+}
+
+static uint32_t spotSlot(uint64_t key) {
+    return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - SPOT_BITS));
+}
+
+static bool spotTaken(const SpotSet *set, TopoRect r) {
+    uint64_t key = spotKey(set, r);
+    for (uint32_t i = spotSlot(key); set->used[i]; i = (i + 1) & (SPOT_SLOTS - 1)) {
+        if (set->keys[i] == key) return true;
+    }
+    return false;
+}
+
+static void spotTake(SpotSet *set, TopoRect r) {
+    if (set->count >= SPOT_SLOTS / 2) return;
+    uint64_t key = spotKey(set, r);
+    uint32_t i = spotSlot(key);
+    for (; set->used[i]; i = (i + 1) & (SPOT_SLOTS - 1)) {
+        if (set->keys[i] == key) return;
+    }
+    set->used[i] = true;
+    set->keys[i] = key;
+    set->count++;
+}
+
+// Next cascade position: down and to the right, restarting one step further
+// right at the top of the area when the window would leave it
+static TopoRect cascadeNext(TopoRect r, TopoRect area, double step, uint32_t *wraps) {
+    r.x += step;
+    r.y += step;
+    if (r.x + r.width > area.x + area.width || r.y + r.height > area.y + area.height) {
+        ++*wraps;
+        r.x = area.x + *wraps * step;
+        r.y = area.y;
+        if (r.x + r.width > area.x + area.width) {
+            *wraps = 0;
+            r.x = area.x;
+        }
+    }
+    return r;
+}
+
+uint32_t evacuatePlan(const Topology *topology, const TopoRect *frames, uint32_t count, int from, int to,
+                      const EvacuatePlanOptions *options, EvacuateMove *moves) {
+    static _Thread_local SpotSet set;
+    memset(set.used, 0, sizeof(set.used));
+    set.count = 0;
+    set.area = options->toArea;
+    set.step = options->cascadeStep > 0 ? options->cascadeStep : EVACUATE_CASCADE;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (frameDisplayOf(topology, frames[i]) == to) spotTake(&set, frames[i]);
+    }
+
+    uint32_t planned = 0;
+    for (uint32_t i = count; i-- > 0 && planned < EVACUATE_MAX_WINDOWS;) {
+        if (frameDisplayOf(topology, frames[i]) != from) continue;
+        TopoRect r = frameMap(frames[i], options->fromArea, options->toArea, options->scale);
+        uint32_t wraps = 0;
+        bool cascaded = false;
+        for (uint32_t tries = 0; spotTaken(&set, r) && tries <= planned; tries++) {
+            r = cascadeNext(r, options->toArea, set.step, &wraps);
+            cascaded = true;
+        }
+        spotTake(&set, r);
+        moves[planned++] = (EvacuateMove){ i, r, cascaded };
+    }
+    return planned;
+}
+
+// --- Running a plan --------------------------------------------------------------
+
+typedef struct {
+    Backend            *backend;
+    BackendWindow      *windows;
+    const EvacuateMove *moves;
+    uint32_t            count;
+    _Atomic uint32_t    next;
+    _Atomic uint32_t    moved;
+    _Atomic uint32_t    failed;
+} EvacuateJob;
+
+static void *evacuateWorker(void *arg) {
+    EvacuateJob *job = arg;
+    for (;;) {
+        uint32_t i = atomic_fetch_add_explicit(&job->next, 1, memory_order_relaxed);
+        if (i >= job->count) return NULL;
+        const EvacuateMove *move = &job->moves[i];
+        if (job->backend->windowSetFrame(job->backend, &job->windows[move->window], move->to)) {
+            atomic_fetch_add_explicit(&job->moved, 1, memory_order_relaxed);
+        } else {
+            atomic_fetch_add_explicit(&job->failed, 1, memory_order_relaxed);
+        }
+    }
+}
+
+// The calling thread works alongside EVACUATE_WORKERS - 1 helpers
+static void runMoves(EvacuateJob *job) {
+    pthread_t helpers[EVACUATE_WORKERS - 1];
+    uint32_t started = 0;
+    while (started < EVACUATE_WORKERS - 1 && started + 1 < job->count &&
+           pthread_create(&helpers[started], NULL, evacuateWorker, job) == 0) {
+        started++;
+    }
+    evacuateWorker(job);
+    for (uint32_t i = 0; i < started; i++) pthread_join(helpers[i], NULL);
+}
+
+bool evacuateRun(Backend *backend, bool scale, TopoDirection direction, TopoPoint cursor, EvacuateReport *report) {
+    *report = (EvacuateReport){ .fromDisplay = -1, .toDisplay = -1 };
+    uint64_t t0 = statsNowNs();
+    BackendWindow *windows = NULL;
+    uint32_t count = 0;
+    if (!backend->windowList(backend, &windows, &count)) {
+        LOG_WARN("Cannot list windows");
+        return false;
+    }
+    uint64_t t1 = statsNowNs();
+    report->listNs = t1 - t0;
+    report->listed = count;
+
+    TopoRect *frames = malloc((count ? count : 1) * sizeof(*frames));
+    EvacuateMove *moves = malloc(EVACUATE_MAX_WINDOWS * sizeof(*moves));
+    uint32_t planned = 0, fromNumber = 0, toNumber = 0;
+    if (frames && moves) {
+        for (uint32_t i = 0; i < count; i++) frames[i] = windows[i].frame;
+        // Copy what is needed out of the snapshot: the insets query can block
+        unsigned token;
+        const Topology *topology = topologyAcquire(&token);
+        int from = topology ? topologyDisplayAt(topology, cursor) : -1;
+        int to = from >= 0 ? topologyNeighbor(topology, from, direction) : -1;
+        uint64_t generation = topology ? topology->generation : 0;
+        DisplayInfo source = { 0 }, target = { 0 };
+        if (to >= 0 && to != from) {
+            source = topology->displays[from];
+            target = topology->displays[to];
+            fromNumber = topology->rank[from] + 1;
+            toNumber = topology->rank[to] + 1;
+        }
+        topologyRelease(token);
+
+        if (to >= 0 && to != from) {
+            EvacuatePlanOptions options = {
+                .fromArea = frameUsableArea(source.bounds, backend->displayInsets(backend, &source)),
+                .toArea = frameUsableArea(target.bounds, backend->displayInsets(backend, &target)),
+                .scale = scale,
+            };
+            // Planning only reads the snapshot, but it must be the one the
+            // displays were picked from
+            topology = topologyAcquire(&token);
+            if (topology && topology->generation == generation) {
+                planned = evacuatePlan(topology, frames, count, from, to, &options, moves);
+                report->fromDisplay = from;
+                report->toDisplay = to;
+            } else {
+                LOG_DEBUG("Display arrangement changed while planning the evacuation");
+            }
+            topologyRelease(token);
+        }
+    }
+    uint64_t t2 = statsNowNs();
+    report->planNs = t2 - t1;
+    report->planned = planned;
+    for (uint32_t i = 0; i < planned; i++) report->cascaded += moves[i].cascaded;
+
+    EvacuateJob job = { .backend = backend, .windows = windows, .moves = moves, .count = planned };
+    if (planned) runMoves(&job);
+    report->moveNs = statsNowNs() - t2;
+    report->moved = atomic_load(&job.moved);
+    report->failed = atomic_load(&job.failed);
+
+    for (uint32_t i = 0; i < count; i++) backend->windowRelease(backend, &windows[i]);
+    free(windows);
+    free(frames);
+    free(moves);
+    if (report->toDisplay < 0) {
+        LOG_DEBUG("No display in that direction");
+        return false;
+    }
+
+    LOG_INFO("Evacuated display %u: %u of %u windows moved to display %u (%u failed, %u cascaded) in %.1f ms",
+             fromNumber, report->moved, report->planned, toNumber, report->failed,
+             report->cascaded, (double)(statsNowNs() - t0) / 1e6);
+    NotifyEvent event = {
+        .kind = NOTIFY_DISPLAY_EVACUATED,
+        .display = toNumber,
+        .moved = report->moved,
+        .failed = report->failed,
+    };
+    backend->notify(backend, &event);
+    return true;
+}
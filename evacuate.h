@@ -0,0 +1,62 @@
+#ifndef EVACUATE_H
+#define EVACUATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "backend.h"
+#include "topology.h"
+
+// Evacuate a display: move every window on it to a neighboring display.
+//
+// One window-list query, one planning pass, then the frame changes run
+// concurrently on a small pool of worker threads (each is a round trip to
+// the window's application). The planner is pure geometry so it can be
+// checked and benchmarked with simulated window lists.
+
+#define EVACUATE_MAX_WINDOWS 1024    // windows planned per evacuation
+#define EVACUATE_WORKERS     4
+#define EVACUATE_CASCADE     24.0    // points between cascaded windows
+
+typedef struct {
+    uint32_t window;        // index into the window list
+    TopoRect to;            // new frame
+    bool     cascaded;      // shifted off a spot another window already took
+} EvacuateMove;
+
+typedef struct {
+    TopoRect fromArea;      // usable areas (frameUsableArea) of the two displays
+    TopoRect toArea;
+    bool     scale;         // resize in proportion to the areas
+    double   cascadeStep;   // 0 = EVACUATE_CASCADE
+} EvacuatePlanOptions;
+
+// Plan moves for the windows in `frames` (front to back) that belong to
+// display `from` onto display `to`. Each frame is mapped as a single move
+// would map it; windows that would land on the same spot as a window
+// already there, or as another planned one, are cascaded down and to the
+// right (wrapping inside the target area). Back windows are placed first,
+// so the front window ends on top of its cascade. Writes at most
+// EVACUATE_MAX_WINDOWS moves, back to front, and returns their count.
+uint32_t evacuatePlan(const Topology *topology, const TopoRect *frames, uint32_t count, int from, int to,
+                      const EvacuatePlanOptions *options, EvacuateMove *moves);
+
+typedef struct {
+    int      fromDisplay;   // topology display indices, -1 = none
+    int      toDisplay;
+    uint32_t listed;        // windows in the window list
+    uint32_t planned;       // windows on the evacuated display
+    uint32_t moved;
+    uint32_t failed;        // the window refused the new frame or was gone
+    uint32_t cascaded;
+    uint64_t listNs;        // window-list query
+    uint64_t planNs;
+    uint64_t moveNs;        // all frame changes, wall clock
+} EvacuateReport;
+
+// Evacuate the display under `cursor` in `direction`, blocking until every
+// move has finished. Returns false if there was nothing to do (no window
+// list, no display that way); the report is filled in either way.
+bool evacuateRun(Backend *backend, bool scale, TopoDirection direction, TopoPoint cursor, EvacuateReport *report);
+
+#endif // EVACUATE_H
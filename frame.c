@@ -0,0 +1,66 @@
+#include "frame.h"
+
+#include <math.h>
+
+static double clampValue(double v, double lo, double hi) {
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return v;
+}
+
+TopoRect frameUsableArea(TopoRect bounds, FrameInsets insets) {
+    double left = clampValue(insets.left, 0, bounds.width);
+    double right = clampValue(insets.right, 0, bounds.width - left);
+    double top = clampValue(insets.top, 0, bounds.height);
+    double bottom = clampValue(insets.bottom, 0, bounds.height - top);
+    return (TopoRect){
+        bounds.x + left,
+        bounds.y + top,
+        bounds.width - left - right,
+        bounds.height - top - bottom,
+    };
+}
+
+TopoRect frameClamp(TopoRect frame, TopoRect area) {
+    if (frame.width > area.width) frame.width = area.width;
+    if (frame.height > area.height) frame.height = area.height;
+    frame.x = clampValue(frame.x, area.x, area.x + area.width - frame.width);
+    frame.y = clampValue(frame.y, area.y, area.y + area.height - frame.height);
+    return frame;
+}
+
+// Where `offset` sits within `slack` of free space, 0..1 (0 without slack)
+static double slackFraction(double offset, double slack) {
+    return slack > 0 ? clampValue(offset / slack, 0, 1) : 0;
+}
+
+TopoRect frameMap(TopoRect frame, TopoRect from, TopoRect to, bool scale) {
+    TopoRect out = frame;
+    if (scale && from.width > 0 && from.height > 0) {
+        out.width = frame.width * to.width / from.width;
+        out.height = frame.height * to.height / from.height;
+    }
+    out.width = round(fmin(out.width, to.width));
+    out.height = round(fmin(out.height, to.height));
+
+    double fracX = slackFraction(frame.x - from.x, from.width - frame.width);
+    double fracY = slackFraction(frame.y - from.y, from.height - frame.height);
+    out.x = round(to.x + fracX * (to.width - out.width));
+    out.y = round(to.y + fracY * (to.height - out.height));
+    return frameClamp(out, to);
+}
+
+int frameDisplayOf(const Topology *topology, TopoRect frame) {
+    int best = -1;
+    double bestArea = 0;
+    for (uint32_t i = 0; i < topology->count; i++) {
+        TopoRect b = topology->displays[i].bounds;
+        double w = fmin(frame.x + frame.width, b.x + b.width) - fmax(frame.x, b.x);
+        double h = fmin(frame.y + frame.height, b.y + b.height) - fmax(frame.y, b.y);
+        if (w > 0 && h > 0 && w * h > bestArea) {
+            bestArea = w * h;
+            best = (int)i;
+        }
+    }
+    return best;
+}
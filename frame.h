@@ -0,0 +1,37 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdbool.h>
+
+#include "topology.h"
+
+// Window frame geometry for moving windows between displays.
+//
+// Pure functions over TopoRect (global coordinates, top-left origin, in
+// points), independent of how windows are found or moved, so the mapping
+// can be checked off a Mac.
+
+// Space on each edge of a display taken by the menu bar and the Dock
+typedef struct {
+    double top, left, bottom, right;
+} FrameInsets;
+
+// Part of `bounds` left for windows after `insets` (insets that would leave
+// nothing are reduced so the area never goes negative).
+TopoRect frameUsableArea(TopoRect bounds, FrameInsets insets);
+
+// Shrink `frame` to fit `area` if needed, then shift it inside.
+TopoRect frameClamp(TopoRect frame, TopoRect area);
+
+// Map a window frame from usable area `from` to usable area `to`. The
+// window keeps its relative position: the fraction of free space to its
+// left and above it stays the same, so a window against an edge or centered
+// stays that way. With `scale`, its size changes in proportion to the
+// areas. The result is rounded to whole points and lies inside `to`.
+TopoRect frameMap(TopoRect frame, TopoRect from, TopoRect to, bool scale);
+
+// Display a window belongs to: the one it overlaps most, or -1 if the
+// frame is on no display.
+int frameDisplayOf(const Topology *topology, TopoRect frame);
+
+#endif // FRAME_H
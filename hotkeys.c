@@ -0,0 +1,517 @@
+#include "hotkeys.h"
+
+#include <ctype.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// Map single character to a virtual keycode (ANSI US layout)
+static uint16_t keycodeForChar(char c) {
+    switch (c) {
+        case 'A': return 0x00;  case 'S': return 0x01;
+        case 'D': return 0x02;  case 'F': return 0x03;
+        case 'H': return 0x04;  case 'G': return 0x05;
+        case 'Z': return 0x06;  case 'X': return 0x07;
+        case 'C': return 0x08;  case 'V': return 0x09;
+        case 'B': return 0x0B;  case 'Q': return 0x0C;
+        case 'W': return 0x0D;  case 'E': return 0x0E;
+        case 'R': return 0x0F;  case 'Y': return 0x10;
+        case 'T': return 0x11;  case '1': return 0x12;
+        case '2': return 0x13;  case '3': return 0x14;
+        case '4': return 0x15;  case '6': return 0x16;
+        case '5': return 0x17;  case '=': return 0x18;
+        case '9': return 0x19;  case '7': return 0x1A;
+        case '-': return 0x1B;  case '8': return 0x1C;
+        case '0': return 0x1D;  case 'O': return 0x1F;
+        case 'U': return 0x20;  case 'I': return 0x22;
+        case 'P': return 0x23;  case 'L': return 0x25;
+        case 'J': return 0x26;  case 'K': return 0x28;
+        case 'N': return 0x2D;  case 'M': return 0x2E;
+        case ',': return 0x2B;  case '.': return 0x2F;
+        case '/': return 0x2C;  case ';': return 0x29;
+        case '\'': return 0x27;  case '\\': return 0x2A;
+        case '`': return 0x32;  case ' ': return 0x31;
+        default: return KEYCODE_INVALID;
+    }
+}
+
+// Named keys (case-insensitive); single characters go through keycodeForChar
+static const struct { const char *name; uint16_t keyCode; } kNamedKeys[] = {
+    { "Space", KEYCODE_SPACE },
+    { "Left", KEYCODE_LEFT_ARROW },  { "Right", KEYCODE_RIGHT_ARROW },
+    { "Up", KEYCODE_UP_ARROW },      { "Down", KEYCODE_DOWN_ARROW },
+    { "F1", 0x7A },  { "F2", 0x78 },  { "F3", 0x63 },  { "F4", 0x76 },
+    { "F5", 0x60 },  { "F6", 0x61 },  { "F7", 0x62 },  { "F8", 0x64 },
+    { "F9", 0x65 },  { "F10", 0x6D }, { "F11", 0x67 }, { "F12", 0x6F },
+    { "F13", 0x69 }, { "F14", 0x6B }, { "F15", 0x71 }, { "F16", 0x6A },
+    { "F17", 0x40 }, { "F18", 0x4F }, { "F19", 0x50 }, { "F20", 0x5A },
+    { "Keypad0", 0x52 }, { "Keypad1", 0x53 }, { "Keypad2", 0x54 }, { "Keypad3", 0x55 },
+    { "Keypad4", 0x56 }, { "Keypad5", 0x57 }, { "Keypad6", 0x58 }, { "Keypad7", 0x59 },
+    { "Keypad8", 0x5B }, { "Keypad9", 0x5C },
+};
+
+static uint16_t keycodeForName(const char *name) {
+    for (size_t i = 0; i < sizeof(kNamedKeys) / sizeof(kNamedKeys[0]); i++) {
+        if (strcasecmp(name, kNamedKeys[i].name) == 0) return kNamedKeys[i].keyCode;
+    }
+    if (strlen(name) == 1) return keycodeForChar((char)toupper((unsigned char)name[0]));
+    return KEYCODE_INVALID;
+}
+
+// Modifier bit for a token, 0 if it is not a modifier name
+static uint64_t modifierForName(const char *name) {
+    if (strcasecmp(name, "Control") == 0 || strcasecmp(name, "Ctrl") == 0) return MOD_CONTROL;
+    if (strcasecmp(name, "Shift") == 0) return MOD_SHIFT;
+    if (strcasecmp(name, "Option") == 0 || strcasecmp(name, "Alt") == 0) return MOD_OPTION;
+    if (strcasecmp(name, "Command") == 0 || strcasecmp(name, "Cmd") == 0) return MOD_COMMAND;
+    if (strcasecmp(name, "Hyper") == 0) return MOD_ALL;
+    return 0;
+}
+
+// Parse hotkey string of form "Modifier+Key" into modifiers mask and keycode
+bool parse_hotkey(const char *str, uint64_t *modifiers, uint16_t *keycode) {
+    char buf[256];
+    strncpy(buf, str, sizeof(buf)-1);
+    buf[sizeof(buf)-1] = '\0';
+    // Remove newline
+    char *newline = strchr(buf, '\n');
+    if (newline) *newline = '\0';
+    // Trim leading and trailing whitespace
+    char *p = buf;
+    while (isspace((unsigned char)*p)) p++;
+    char *endp = p + strlen(p) - 1;
+    while (endp > p && isspace((unsigned char)*endp)) *endp-- = '\0';
+    *modifiers = 0;
+    *keycode = KEYCODE_INVALID;
+    // Tokenize on '+'
+    char *save = NULL;
+    char *token = strtok_r(p, "+", &save);
+    char *last = NULL;
+    while (token) {
+        // Trim whitespace around token
+        char *t = token;
+        while (isspace((unsigned char)*t)) t++;
+        char *te = t + strlen(t) - 1;
+        while (te > t && isspace((unsigned char)*te)) *te-- = '\0';
+        last = t;
+        *modifiers |= modifierForName(t);
+        token = strtok_r(NULL, "+", &save);
+    }
+    if (last) *keycode = keycodeForName(last);
+    return *keycode != KEYCODE_INVALID;
+}
+
+// "600ms" after the keys of a sequence
+static bool parseTimeout(const char *part, uint32_t *ms) {
+    while (isspace((unsigned char)*part)) part++;
+    if (!isdigit((unsigned char)*part)) return false;
+    char *end = NULL;
+    unsigned long value = strtoul(part, &end, 10);
+    if (strncasecmp(end, "ms", 2) != 0) return false;
+    for (end += 2; isspace((unsigned char)*end); end++) {}
+    if (*end || value == 0 || value > UINT32_MAX) return false;
+    *ms = (uint32_t)value;
+    return true;
+}
+
+bool parse_sequence(const char *str, bool exact, HotkeyBinding *binding) {
+    char buf[256];
+    strncpy(buf, str, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+
+    // Split at the commas between keys; a comma that starts a key or follows
+    // a '+' is the comma key itself ("Command+,")
+    char *parts[HOTKEY_MAX_STEPS + 1];
+    uint32_t count = 0;
+    char *part = buf;
+    for (char *p = buf;; p++) {
+        if (*p == ',') {
+            char *q = p;
+            while (q > part && isspace((unsigned char)q[-1])) q--;
+            if (q == part || q[-1] == '+') continue;
+        }
+        if (*p != ',' && *p != '\0') continue;
+        bool last = *p == '\0';
+        *p = '\0';
+        if (count == HOTKEY_MAX_STEPS + 1) return false;
+        parts[count++] = part;
+        if (last) break;
+        part = p + 1;
+    }
+
+    uint32_t timeoutMs = 0;
+    if (count > 1 && parseTimeout(parts[count - 1], &timeoutMs)) count--;
+    if (count == 0 || count > HOTKEY_MAX_STEPS) return false;
+    HotkeyChord chords[HOTKEY_MAX_STEPS];
+    for (uint32_t i = 0; i < count; i++) {
+        if (!parse_hotkey(parts[i], &chords[i].required, &chords[i].keyCode)) return false;
+        chords[i].forbidden = exact ? MOD_ALL & ~chords[i].required : 0;
+    }
+    binding->keyCode = chords[0].keyCode;
+    binding->required = chords[0].required;
+    binding->forbidden = chords[0].forbidden;
+    binding->followCount = (uint8_t)(count - 1);
+    for (uint32_t i = 1; i < count; i++) binding->follow[i - 1] = chords[i];
+    binding->timeoutMs = timeoutMs;
+    return true;
+}
+
+bool parse_modifiers(const char *str, uint64_t *modifiers) {
+    char buf[256];
+    strncpy(buf, str, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    *modifiers = 0;
+    char *save = NULL;
+    for (char *token = strtok_r(buf, "+", &save); token; token = strtok_r(NULL, "+", &save)) {
+        while (isspace((unsigned char)*token)) token++;
+        char *te = token + strlen(token);
+        while (te > token && isspace((unsigned char)te[-1])) *--te = '\0';
+        uint64_t bit = modifierForName(token);
+        if (!bit) return false;
+        *modifiers |= bit;
+    }
+    return *modifiers != 0;
+}
+
+const char *hotkeyActionName(HotkeyActionType type) {
+    switch (type) {
+        case ACTION_SWITCH:   return "switch";
+        case ACTION_DRAG:     return "drag";
+        case ACTION_EXIT:     return "exit";
+        case ACTION_JUMP:     return "jump";
+        case ACTION_EVACUATE: return "evacuate";
+        default:              return "none";
+    }
+}
+
+bool hotkeyListAppend(HotkeyBindingList *list, const HotkeyBinding *binding) {
+    if (list->count == list->capacity) {
+        uint32_t capacity = list->capacity ? list->capacity * 2 : 16;
+        HotkeyBinding *items = realloc(list->items, capacity * sizeof(*items));
+        if (!items) return false;
+        list->items = items;
+        list->capacity = capacity;
+    }
+    list->items[list->count++] = *binding;
+    return true;
+}
+
+void hotkeyListFree(HotkeyBindingList *list) {
+    free(list->items);
+    *list = (HotkeyBindingList){ 0 };
+}
+
+// --- Sequences ------------------------------------------------------------------
+
+static HotkeyChord chordAt(const HotkeyBinding *binding, uint32_t step) {
+    if (step == 0) return (HotkeyChord){ binding->keyCode, binding->required, binding->forbidden };
+    return binding->follow[step - 1];
+}
+
+// Some set of modifiers satisfies both
+static bool chordsOverlap(HotkeyChord a, HotkeyChord b) {
+    return a.keyCode == b.keyCode && !((a.required | b.required) & (a.forbidden | b.forbidden));
+}
+
+static bool chordMatches(HotkeyChord chord, uint64_t modifiers) {
+    return (modifiers & chord.required) == chord.required && !(modifiers & chord.forbidden);
+}
+
+static bool conflicting(const HotkeyBinding *a, const HotkeyBinding *b, bool *prefix) {
+    if (!a->followCount && !b->followCount) return false;
+    uint32_t shared = (a->followCount < b->followCount ? a->followCount : b->followCount) + 1u;
+    for (uint32_t step = 0; step < shared; step++) {
+        if (!chordsOverlap(chordAt(a, step), chordAt(b, step))) return false;
+    }
+    *prefix = a->followCount != b->followCount;
+    return true;
+}
+
+// Marks the later binding of each conflicting pair, unless the earlier one
+// is itself marked; reports (at most `capacity` of) the marked bindings.
+// Only bindings with the same first keycode can conflict, so each binding
+// is compared along a chain of those (`chain` holds one entry per binding).
+static uint32_t markConflicts(const HotkeyBinding *bindings, uint32_t count, bool *dropped, uint32_t *chain,
+                              HotkeyConflict *conflicts, uint32_t capacity) {
+    uint32_t last[HOTKEY_KEYCODES];
+    memset(last, 0xff, sizeof(last));
+    uint32_t found = 0;
+    for (uint32_t j = 0; j < count; j++) {
+        uint32_t bucket = bindings[j].keyCode % HOTKEY_KEYCODES, first = UINT32_MAX;
+        bool firstPrefix = false;
+        for (uint32_t i = last[bucket]; i != UINT32_MAX; i = chain[i]) {
+            bool prefix;
+            if (dropped[i] || !conflicting(&bindings[i], &bindings[j], &prefix)) continue;
+            first = i;
+            firstPrefix = prefix;
+        }
+        chain[j] = last[bucket];
+        last[bucket] = j;
+        if (first == UINT32_MAX) continue;
+        dropped[j] = true;
+        if (found < capacity) conflicts[found] = (HotkeyConflict){ first, j, firstPrefix };
+        found++;
+    }
+    return found;
+}
+
+uint32_t hotkeyFindConflicts(const HotkeyBinding *bindings, uint32_t count, HotkeyConflict *conflicts,
+                             uint32_t capacity) {
+    bool *dropped = calloc(count ? count : 1, sizeof(*dropped));
+    uint32_t *chain = malloc((count ? count : 1) * sizeof(*chain));
+    uint32_t found = dropped && chain ? markConflicts(bindings, count, dropped, chain, conflicts, capacity) : 0;
+    free(dropped);
+    free(chain);
+    return found;
+}
+
+// Growable arrays used while compiling the automaton
+typedef struct {
+    uint32_t depth;        // keys already matched
+    uint32_t first, count; // live bindings: members[first .. first + count)
+} SequenceState;
+
+typedef struct {
+    const HotkeyBinding *bindings;
+    SequenceState       *states;
+    uint32_t             stateCount, stateCapacity;
+    uint32_t            *members;
+    uint32_t             memberCount, memberCapacity;
+    HotkeyTransition    *edges;
+    uint32_t             edgeCount, edgeCapacity;
+    HotkeyBinding       *roots;      // entries for the keycode table
+    uint32_t             rootCount, rootCapacity;
+    uint32_t            *index;      // open-addressing state lookup, 0 = empty slot
+    uint32_t             indexMask;
+} SequenceBuilder;
+
+static bool grow(void **items, uint32_t *capacity, uint32_t needed, size_t size) {
+    if (needed <= *capacity) return true;
+    uint32_t next = *capacity ? *capacity * 2 : 64;
+    while (next < needed) next *= 2;
+    void *grown = realloc(*items, next * size);
+    if (!grown) return false;
+    *items = grown;
+    *capacity = next;
+    return true;
+}
+
+static uint32_t stateHash(uint32_t depth, const uint32_t *live, uint32_t count) {
+    uint32_t hash = 2166136261u ^ depth;
+    for (uint32_t i = 0; i < count; i++) hash = (hash ^ live[i]) * 16777619u;
+    return hash;
+}
+
+// Keeps the state index at most half full
+static bool growIndex(SequenceBuilder *b) {
+    uint32_t slots = b->index ? b->indexMask + 1 : 0;
+    if ((b->stateCount + 1) * 2 <= slots) return true;
+    slots = slots ? slots * 2 : 64;
+    uint32_t *index = calloc(slots, sizeof(*index));
+    if (!index) return false;
+    for (uint32_t s = 1; s < b->stateCount; s++) {
+        const SequenceState *state = &b->states[s];
+        uint32_t i = stateHash(state->depth, &b->members[state->first], state->count) & (slots - 1);
+        while (index[i]) i = (i + 1) & (slots - 1);
+        index[i] = s;
+    }
+    free(b->index);
+    b->index = index;
+    b->indexMask = slots - 1;
+    return true;
+}
+
+// The state whose live bindings are exactly `live` at `depth`, created if new;
+// 0 on allocation failure
+static uint32_t stateFor(SequenceBuilder *b, uint32_t depth, const uint32_t *live, uint32_t count) {
+    if (!growIndex(b)) return 0;
+    uint32_t i = stateHash(depth, live, count) & b->indexMask;
+    for (; b->index[i]; i = (i + 1) & b->indexMask) {
+        const SequenceState *state = &b->states[b->index[i]];
+        if (state->depth == depth && state->count == count &&
+            memcmp(&b->members[state->first], live, count * sizeof(*live)) == 0) {
+            return b->index[i];
+        }
+    }
+    if (b->stateCount >= (1u << 20) ||
+        !grow((void **)&b->states, &b->stateCapacity, b->stateCount + 1, sizeof(*b->states)) ||
+        !grow((void **)&b->members, &b->memberCapacity, b->memberCount + count, sizeof(*b->members))) {
+        return 0;
+    }
+    memcpy(&b->members[b->memberCount], live, count * sizeof(*live));
+    b->states[b->stateCount] = (SequenceState){ depth, b->memberCount, count };
+    b->memberCount += count;
+    b->index[i] = b->stateCount;
+    return b->stateCount++;
+}
+
+static int compareSymbols(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Subset construction: the edges out of a state are the keystrokes (keycode
+// and exact modifiers) that match the next key of some live binding; the
+// bindings still live after the keystroke form the next state, so shared
+// prefixes share states. Conflicts were removed first, so a completed
+// sequence is always the only live binding.
+static bool buildSequences(SequenceBuilder *b) {
+    uint64_t *symbols = NULL;   // keycode << 36 | modifiers << 32 | binding
+    uint32_t symbolCapacity = 0;
+    uint32_t *live = NULL, liveCapacity = 0;
+    bool ok = true;
+    for (uint32_t s = 0; s < b->stateCount && ok; s++) {
+        SequenceState state = b->states[s];
+        uint32_t symbolCount = 0;
+        for (uint32_t m = 0; m < state.count && ok; m++) {
+            uint32_t index = b->members[state.first + m];
+            HotkeyChord chord = chordAt(&b->bindings[index], state.depth);
+            for (uint64_t mods = 0; mods < 16; mods++) {
+                if (!chordMatches(chord, mods << MOD_SHIFT_BIT)) continue;
+                ok = grow((void **)&symbols, &symbolCapacity, symbolCount + 1, sizeof(*symbols));
+                if (!ok) break;
+                symbols[symbolCount++] = (uint64_t)chord.keyCode << 36 | mods << 32 | index;
+            }
+        }
+        if (!ok) break;
+        qsort(symbols, symbolCount, sizeof(*symbols), compareSymbols);
+
+        for (uint32_t i = 0, j; i < symbolCount && ok; i = j) {
+            uint64_t symbol = symbols[i] >> 32;
+            uint32_t count = 0, terminal = UINT32_MAX, timeoutMs = 0;
+            for (j = i; j < symbolCount && symbols[j] >> 32 == symbol; j++) count++;
+            if (!(ok = grow((void **)&live, &liveCapacity, count, sizeof(*live)))) break;
+            for (uint32_t k = 0; k < count; k++) {
+                uint32_t index = live[k] = (uint32_t)symbols[i + k];
+                const HotkeyBinding *binding = &b->bindings[index];
+                if (binding->followCount == state.depth) terminal = index;
+                uint32_t ms = binding->timeoutMs ? binding->timeoutMs : HOTKEY_SEQUENCE_TIMEOUT_MS;
+                if (ms > timeoutMs) timeoutMs = ms;
+            }
+            uint16_t keyCode = (uint16_t)(symbol >> 4);
+            uint64_t modifiers = (symbol & 15) << MOD_SHIFT_BIT;
+            uint32_t next = terminal == UINT32_MAX ? stateFor(b, state.depth + 1, live, count) : 0;
+            if (terminal == UINT32_MAX && !next) {
+                ok = false;
+            } else if (s == 0) {
+                ok = grow((void **)&b->roots, &b->rootCapacity, b->rootCount + 1, sizeof(*b->roots));
+                if (ok) {
+                    b->roots[b->rootCount++] = (HotkeyBinding){
+                        .keyCode = keyCode, .required = modifiers, .forbidden = MOD_ALL & ~modifiers, .next = next,
+                    };
+                }
+            } else {
+                ok = grow((void **)&b->edges, &b->edgeCapacity, b->edgeCount + 1, sizeof(*b->edges));
+                if (ok) {
+                    b->edges[b->edgeCount++] = (HotkeyTransition){
+                        .key = hotkeyTransitionKey(s, keyCode, modifiers),
+                        .next = next,
+                        .timeoutNs = (uint64_t)timeoutMs * 1000000ull,
+                        .action = next ? (HotkeyAction){ ACTION_NONE, 0 } : b->bindings[terminal].action,
+                    };
+                }
+            }
+        }
+    }
+    free(symbols);
+    free(live);
+    return ok;
+}
+
+static bool hashEdges(HotkeyTable *table, const HotkeyTransition *edges, uint32_t count) {
+    if (!count) return true;
+    uint32_t slots = 16;
+    while (slots < count * 2) slots *= 2;
+    table->transitions = calloc(slots, sizeof(*table->transitions));
+    if (!table->transitions) return false;
+    table->transitionMask = slots - 1;
+    for (uint32_t e = 0; e < count; e++) {
+        uint32_t i = hotkeyTransitionSlot(edges[e].key) & table->transitionMask;
+        while (table->transitions[i].key) i = (i + 1) & table->transitionMask;
+        table->transitions[i] = edges[e];
+    }
+    return true;
+}
+
+static _Atomic uint64_t gGeneration;
+
+HotkeyTable *hotkeyTableCreate(const HotkeyBinding *bindings, uint32_t count) {
+    HotkeyTable *table = calloc(1, sizeof(*table));
+    bool *dropped = calloc(count ? count : 1, sizeof(*dropped));
+    uint32_t *chain = malloc((count ? count : 1) * sizeof(*chain));
+    SequenceBuilder builder = { .bindings = bindings };
+    HotkeyBinding *entries = NULL;
+    bool ok = false;
+    if (!table || !dropped || !chain) goto done;
+    table->generation = atomic_fetch_add(&gGeneration, 1) + 1;
+
+    // Sequences start from state 0, with every sequence binding live
+    markConflicts(bindings, count, dropped, chain, NULL, 0);
+    uint32_t sequences = 0;
+    for (uint32_t i = 0; i < count; i++) sequences += !dropped[i] && bindings[i].followCount;
+    if (sequences) {
+        if (!grow((void **)&builder.states, &builder.stateCapacity, 1, sizeof(*builder.states)) ||
+            !grow((void **)&builder.members, &builder.memberCapacity, sequences, sizeof(*builder.members))) {
+            goto done;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (!dropped[i] && bindings[i].followCount) builder.members[builder.memberCount++] = i;
+        }
+        builder.states[0] = (SequenceState){ 0, 0, sequences };
+        builder.stateCount = 1;
+        if (!buildSequences(&builder) || !hashEdges(table, builder.edges, builder.edgeCount)) goto done;
+        table->states = builder.stateCount - 1;
+    }
+
+    // Single keys in config order, then the first keys of sequences (the
+    // two cannot overlap: that would be a prefix conflict)
+    uint32_t total = 0;
+    entries = malloc((count + builder.rootCount + 1) * sizeof(*entries));
+    table->bindings = malloc((count + builder.rootCount + 1) * sizeof(*table->bindings));
+    if (!entries || !table->bindings) goto done;
+    for (uint32_t i = 0; i < count; i++) {
+        if (dropped[i] || bindings[i].followCount) continue;
+        entries[total] = bindings[i];
+        entries[total++].next = 0;
+    }
+    memcpy(&entries[total], builder.roots, builder.rootCount * sizeof(*entries));
+    total += builder.rootCount;
+
+    // Counting sort by keycode; stable, so config order decides priority.
+    for (uint32_t i = 0; i < total; i++) {
+        if (entries[i].keyCode >= HOTKEY_KEYCODES) continue;
+        table->start[entries[i].keyCode + 1]++;
+    }
+    for (uint32_t k = 0; k < HOTKEY_KEYCODES; k++) table->start[k + 1] += table->start[k];
+    uint32_t cursor[HOTKEY_KEYCODES];
+    memcpy(cursor, table->start, sizeof(cursor));
+    for (uint32_t i = 0; i < total; i++) {
+        uint16_t k = entries[i].keyCode;
+        if (k >= HOTKEY_KEYCODES) continue;
+        table->bindings[cursor[k]++] = entries[i];
+        table->interesting[k >> 6] |= 1ull << (k & 63);
+    }
+    table->count = table->start[HOTKEY_KEYCODES];
+    ok = true;
+
+done:
+    free(entries);
+    free(dropped);
+    free(chain);
+    free(builder.states);
+    free(builder.members);
+    free(builder.edges);
+    free(builder.roots);
+    free(builder.index);
+    if (ok) return table;
+    hotkeyTableDestroy(table);
+    return NULL;
+}
+
+void hotkeyTableDestroy(HotkeyTable *table) {
+    if (!table) return;
+    free(table->bindings);
+    free(table->transitions);
+    free(table);
+}
@@ -0,0 +1,182 @@
+#ifndef HOTKEYS_H
+#define HOTKEYS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Hotkey parsing and keycode-indexed dispatch.
+//
+// Bindings from config.ini are compiled into a table indexed by keycode plus
+// a bitset of keycodes that have any binding at all, so ordinary typing is
+// rejected by a single bit test in the event tap. Plain C; modifier masks
+// use the CGEventFlags bit values so flags can be passed straight through.
+//
+// A binding may also be a sequence of up to HOTKEY_MAX_STEPS keys
+// ("Control+Space, 3"). Its first key is an ordinary table entry that
+// enters a state of a deterministic automaton; the following keys are
+// single hash lookups on (state, keycode, exact modifiers). All sequences
+// are compiled together at load time, sharing common prefixes, and
+// bindings that could never fire as written are reported (and dropped).
+
+#define MOD_SHIFT    0x00020000ull   // kCGEventFlagMaskShift
+#define MOD_CONTROL  0x00040000ull   // kCGEventFlagMaskControl
+#define MOD_OPTION   0x00080000ull   // kCGEventFlagMaskAlternate
+#define MOD_COMMAND  0x00100000ull   // kCGEventFlagMaskCommand
+#define MOD_ALL      (MOD_SHIFT | MOD_CONTROL | MOD_OPTION | MOD_COMMAND)
+#define MOD_SHIFT_BIT 17              // MOD_ALL is 4 contiguous bits from here
+
+#define HOTKEY_KEYCODES  256          // keycodes at or above this never match
+#define KEYCODE_INVALID  0xFFFF
+
+#define HOTKEY_MAX_STEPS            4      // keys in one sequence
+#define HOTKEY_SEQUENCE_TIMEOUT_MS  1000   // default longest pause between them
+
+#define KEYCODE_SPACE        0x31
+#define KEYCODE_LEFT_ARROW   0x7B
+#define KEYCODE_RIGHT_ARROW  0x7C
+#define KEYCODE_DOWN_ARROW   0x7D
+#define KEYCODE_UP_ARROW     0x7E
+
+typedef enum {
+    ACTION_NONE = 0,
+    ACTION_SWITCH,          // arg: TopoDirection
+    ACTION_DRAG,            // arg: TopoDirection
+    ACTION_EXIT,
+    ACTION_JUMP,            // arg: display number (1-based, spatial order)
+    ACTION_EVACUATE,        // arg: TopoDirection
+    ACTION_COUNT
+} HotkeyActionType;
+
+typedef struct {
+    HotkeyActionType type;
+    int              arg;
+} HotkeyAction;
+
+// One key of a sequence
+typedef struct {
+    uint16_t keyCode;
+    uint64_t required;
+    uint64_t forbidden;
+} HotkeyChord;
+
+typedef struct {
+    uint16_t     keyCode;
+    uint64_t     required;   // modifiers that must be held
+    uint64_t     forbidden;  // modifiers that must not be held
+    HotkeyAction action;
+
+    // Sequences: the keys after the first, and the longest pause allowed
+    // between two of them (0 = HOTKEY_SEQUENCE_TIMEOUT_MS)
+    uint8_t      followCount;
+    HotkeyChord  follow[HOTKEY_MAX_STEPS - 1];
+    uint32_t     timeoutMs;
+
+    // Compiled tables only: the sequence state this key enters (0 = none,
+    // run `action`)
+    uint32_t     next;
+} HotkeyBinding;
+
+// Automaton edge out of a sequence state
+typedef struct {
+    uint32_t     key;        // hotkeyTransitionKey(); 0 = empty slot
+    uint32_t     next;       // state entered, 0 = the sequence is complete: run `action`
+    uint64_t     timeoutNs;  // longest pause before this key
+    HotkeyAction action;
+} HotkeyTransition;
+
+typedef struct HotkeyTable {
+    uint64_t       interesting[HOTKEY_KEYCODES / 64];
+    uint32_t       start[HOTKEY_KEYCODES + 1]; // bindings for key k: [start[k], start[k+1])
+    uint32_t       count;
+    HotkeyBinding *bindings;                   // grouped by keycode, config order kept
+
+    uint64_t          generation;              // unique per table, tells stale states apart
+    uint32_t          states;                  // sequence states, numbered from 1
+    uint32_t          transitionMask;          // hash slots - 1
+    HotkeyTransition *transitions;             // open addressing, NULL without sequences
+} HotkeyTable;
+
+// Two bindings that cannot both work: their key sequences are the same
+// (ambiguous) or one is the start of the other (prefix). Single keys that
+// overlap are not conflicts - the earlier one wins, as always.
+typedef struct {
+    uint32_t earlier, later;   // binding indices
+    bool     prefix;
+} HotkeyConflict;
+
+// Growable list used while reading the config.
+typedef struct {
+    HotkeyBinding *items;
+    uint32_t       count, capacity;
+} HotkeyBindingList;
+
+// Stable lowercase name for an action type ("switch", "drag", ...)
+const char *hotkeyActionName(HotkeyActionType type);
+
+bool hotkeyListAppend(HotkeyBindingList *list, const HotkeyBinding *binding);
+void hotkeyListFree(HotkeyBindingList *list);
+
+// Parse "Modifier+...+Key". Keys: A-Z, 0-9, punctuation, Space, Left,
+// Right, Up, Down, F1-F20, Keypad0-Keypad9. Returns false if no key could
+// be recognised.
+bool parse_hotkey(const char *str, uint64_t *modifiers, uint16_t *keycode);
+
+// Parse a hotkey or a sequence: up to HOTKEY_MAX_STEPS hotkeys separated
+// by commas, optionally followed by a pause limit ("Control+Space, 3",
+// "Hyper+L, L, 600ms"). Fills the keys, modifiers (forbidding all others
+// if `exact`) and timeout of *binding; leaves the action alone.
+bool parse_sequence(const char *str, bool exact, HotkeyBinding *binding);
+
+// Parse "Modifier+...+Modifier" with no key. Returns false if any part is
+// not a modifier name or there is none.
+bool parse_modifiers(const char *str, uint64_t *modifiers);
+
+// Find conflicting pairs, in order; writes at most `capacity` and returns
+// how many there are.
+uint32_t hotkeyFindConflicts(const HotkeyBinding *bindings, uint32_t count, HotkeyConflict *conflicts,
+                             uint32_t capacity);
+
+// Compile bindings into a table. Earlier bindings win when several match
+// the same keystroke; the later binding of a conflicting pair is left out.
+// Returns NULL on allocation failure.
+HotkeyTable *hotkeyTableCreate(const HotkeyBinding *bindings, uint32_t count);
+void hotkeyTableDestroy(HotkeyTable *table);
+
+static inline bool hotkeyIsInteresting(const HotkeyTable *table, uint16_t keyCode) {
+    return keyCode < HOTKEY_KEYCODES &&
+           (table->interesting[keyCode >> 6] >> (keyCode & 63)) & 1u;
+}
+
+// First binding matching the keystroke, or NULL.
+static inline const HotkeyBinding *hotkeyLookup(const HotkeyTable *table, uint16_t keyCode, uint64_t flags) {
+    if (!hotkeyIsInteresting(table, keyCode)) return NULL;
+    for (uint32_t i = table->start[keyCode]; i < table->start[keyCode + 1]; i++) {
+        const HotkeyBinding *b = &table->bindings[i];
+        if ((flags & b->required) == b->required && !(flags & b->forbidden)) return b;
+    }
+    return NULL;
+}
+
+static inline uint32_t hotkeyTransitionKey(uint32_t state, uint16_t keyCode, uint64_t flags) {
+    return state << 12 | (uint32_t)keyCode << 4 | (uint32_t)(flags >> MOD_SHIFT_BIT & 15);
+}
+
+static inline uint32_t hotkeyTransitionSlot(uint32_t key) {
+    return (key * 0x9E3779B1u) >> 8;
+}
+
+// Edge out of sequence `state` for the keystroke, or NULL (the sequence is
+// broken off). One hash probe in the common case.
+static inline const HotkeyTransition *hotkeyStep(const HotkeyTable *table, uint32_t state, uint16_t keyCode,
+                                                 uint64_t flags) {
+    if (!table->transitions || keyCode >= HOTKEY_KEYCODES) return NULL;
+    uint32_t key = hotkeyTransitionKey(state, keyCode, flags);
+    for (uint32_t i = hotkeyTransitionSlot(key) & table->transitionMask; table->transitions[i].key;
+         i = (i + 1) & table->transitionMask) {
+        if (table->transitions[i].key == key) return &table->transitions[i];
+    }
+    return NULL;
+}
+
+#endif // HOTKEYS_H
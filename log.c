@@ -0,0 +1,391 @@
+#include "log.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "stats.h"
+
+#define LOG_RING_ENTRIES 256        // per thread; power of two
+#define LOG_MAX_THREADS  32
+#define LOG_TEXT_BYTES   104        // copies of string arguments, per entry
+#define LOG_POLL_NS      5000000    // writer poll interval while messages flow
+#define LOG_IDLE_POLLS   20         // empty polls before sleeping until woken
+#define LOG_LINE_MAX     1024
+
+_Atomic int gLogLevel = LOG_LEVEL_INFO;
+
+typedef struct {
+    uint64_t    timeNs;
+    const char *format;
+    uint8_t     level;
+    uint8_t     count;
+    LogArg      args[LOG_MAX_ARGS];   // string arguments point into text
+    char        text[LOG_TEXT_BYTES];
+} LogEntry;
+
+// Single producer (the owning thread), single consumer (the writer)
+typedef struct {
+    _Atomic uint32_t head;
+    _Atomic uint32_t tail;
+    _Atomic bool     closed;          // owning thread has exited
+    LogEntry         entries[LOG_RING_ENTRIES];
+} LogRing;
+
+static LogRing *_Atomic  gRings[LOG_MAX_THREADS];
+static _Thread_local LogRing *tRing;
+static _Thread_local bool     tNoRing;
+static pthread_key_t     gRingKey;
+static pthread_once_t    gRingKeyOnce = PTHREAD_ONCE_INIT;
+
+static _Atomic bool      gRunning = false;
+static _Atomic bool      gWriterSleeping = false;
+static _Atomic uint64_t  gDropped;
+static pthread_mutex_t   gWakeLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    gWake = PTHREAD_COND_INITIALIZER;
+static pthread_t         gWriter;
+static FILE             *gOut = NULL;
+static int64_t           gWallOffsetNs;   // realtime - statsNowNs()
+
+static const char *const kLevelNames[] = { "OFF", "ERROR", "WARN", "INFO", "DEBUG" };
+
+void logSetLevel(LogLevel level) {
+    atomic_store_explicit(&gLogLevel, (int)level, memory_order_relaxed);
+}
+
+LogLevel logLevelFromName(const char *name) {
+    for (int level = LOG_LEVEL_OFF; level <= LOG_LEVEL_DEBUG; level++) {
+        if (strcasecmp(name, kLevelNames[level]) == 0) return (LogLevel)level;
+    }
+    if (strcasecmp(name, "warning") == 0) return LOG_LEVEL_WARN;
+    return LOG_LEVEL_INFO;
+}
+
+uint64_t logDropped(void) {
+    return atomic_load_explicit(&gDropped, memory_order_relaxed);
+}
+
+// --- Formatting ----------------------------------------------------------------
+
+#define APPEND(...) do {                                                                    \
+        int n_ = snprintf(buf ? buf + (used < size ? used : size) : NULL,                   \
+                          used < size ? size - used : 0, __VA_ARGS__);                       \
+        if (n_ > 0) used += (size_t)n_;                                                    \
+    } while (0)
+
+static int64_t argAsInt(const LogArg *a) {
+    switch (a->type) {
+        case LOG_ARG_INT:    return a->i;
+        case LOG_ARG_DOUBLE: return (int64_t)a->d;
+        case LOG_ARG_UINT:   return (int64_t)a->u;
+        default:             return (int64_t)(uintptr_t)a->p;
+    }
+}
+
+static double argAsDouble(const LogArg *a) {
+    switch (a->type) {
+        case LOG_ARG_DOUBLE: return a->d;
+        case LOG_ARG_INT:    return (double)a->i;
+        case LOG_ARG_UINT:   return (double)a->u;
+        default:             return 0.0;
+    }
+}
+
+size_t logFormat(char *buf, size_t size, const char *format, const LogArg *args, unsigned count) {
+    size_t used = 0;
+    unsigned next = 0;
+    const char *p = format;
+    while (*p) {
+        if (*p != '%') {
+            size_t run = strcspn(p, "%");
+            APPEND("%.*s", (int)run, p);
+            p += run;
+            continue;
+        }
+        if (p[1] == '%') {
+            APPEND("%%");
+            p += 2;
+            continue;
+        }
+
+        // Rebuild the spec without length modifiers; the argument's type decides
+        char spec[32];
+        size_t n = 0;
+        spec[n++] = *p++;
+        while (*p && strchr("-+ #0", *p) && n < 8) spec[n++] = *p++;
+        while (*p >= '0' && *p <= '9' && n < 16) spec[n++] = *p++;
+        if (*p == '.') {
+            spec[n++] = *p++;
+            while (*p >= '0' && *p <= '9' && n < 24) spec[n++] = *p++;
+        }
+        while (*p && strchr("hlLqjzt", *p)) p++;
+        char conversion = *p;
+        if (!conversion) break;
+        p++;
+        if (next >= count) {
+            APPEND("<?>");
+            continue;
+        }
+        const LogArg *a = &args[next++];
+        switch (conversion) {
+            case 'd':
+            case 'i':
+                spec[n++] = 'l'; spec[n++] = 'l'; spec[n++] = 'd'; spec[n] = '\0';
+                APPEND(spec, (long long)argAsInt(a));
+                break;
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+                spec[n++] = 'l'; spec[n++] = 'l'; spec[n++] = conversion; spec[n] = '\0';
+                APPEND(spec, (unsigned long long)argAsInt(a));
+                break;
+            case 'c':
+                spec[n++] = 'c'; spec[n] = '\0';
+                APPEND(spec, (int)argAsInt(a));
+                break;
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+                spec[n++] = conversion; spec[n] = '\0';
+                APPEND(spec, argAsDouble(a));
+                break;
+            case 's':
+                spec[n++] = 's'; spec[n] = '\0';
+                if (a->type == LOG_ARG_STRING) APPEND(spec, a->s ? a->s : "(null)");
+                else if (a->type == LOG_ARG_DOUBLE) APPEND("%g", a->d);
+                else APPEND("%lld", (long long)argAsInt(a));
+                break;
+            case 'p':
+                APPEND("%p", a->type == LOG_ARG_POINTER || a->type == LOG_ARG_STRING ? a->p : (const void *)(uintptr_t)argAsInt(a));
+                break;
+            default:
+                APPEND("%%%c", conversion);
+                break;
+        }
+    }
+    if (buf && size) buf[used < size ? used : size - 1] = '\0';
+    return used;
+}
+
+static void writeLine(FILE *out, LogLevel level, int64_t wallNs, const char *message) {
+    time_t seconds = (time_t)(wallNs / 1000000000);
+    struct tm tm;
+    localtime_r(&seconds, &tm);
+    char stamp[32];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm);
+    fprintf(out, "%s.%03d %-5s %s\n", stamp, (int)(wallNs / 1000000 % 1000), kLevelNames[level], message);
+}
+
+static int64_t wallClockNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// --- Producer side -------------------------------------------------------------
+
+static void ringThreadExited(void *ring) {
+    atomic_store_explicit(&((LogRing *)ring)->closed, true, memory_order_release);
+}
+
+static void createRingKey(void) {
+    pthread_key_create(&gRingKey, ringThreadExited);
+}
+
+// This thread's ring, registered on first use; NULL if all slots are taken
+static LogRing *threadRing(void) {
+    if (tRing || tNoRing) return tRing;
+    pthread_once(&gRingKeyOnce, createRingKey);
+    LogRing *ring = calloc(1, sizeof(*ring));
+    if (ring) {
+        for (int i = 0; i < LOG_MAX_THREADS; i++) {
+            LogRing *expected = NULL;
+            if (atomic_compare_exchange_strong(&gRings[i], &expected, ring)) {
+                pthread_setspecific(gRingKey, ring);
+                return tRing = ring;
+            }
+        }
+        free(ring);
+    }
+    tNoRing = true;
+    return NULL;
+}
+
+static void dropMessage(void) {
+    atomic_fetch_add_explicit(&gDropped, 1, memory_order_relaxed);
+    statsCount(COUNTER_LOG_DROPPED);
+}
+
+void logWrite(LogLevel level, const char *format, const LogArg *args, unsigned count) {
+    if (!atomic_load_explicit(&gRunning, memory_order_acquire)) {
+        char line[LOG_LINE_MAX];
+        logFormat(line, sizeof(line), format, args, count);
+        writeLine(stderr, level, wallClockNs(), line);
+        return;
+    }
+    LogRing *ring = threadRing();
+    if (!ring) {
+        dropMessage();
+        return;
+    }
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - atomic_load_explicit(&ring->tail, memory_order_acquire) >= LOG_RING_ENTRIES) {
+        dropMessage();
+        return;
+    }
+
+    LogEntry *entry = &ring->entries[head & (LOG_RING_ENTRIES - 1)];
+    entry->timeNs = statsNowNs();
+    entry->format = format;
+    entry->level = (uint8_t)level;
+    entry->count = (uint8_t)(count < LOG_MAX_ARGS ? count : LOG_MAX_ARGS);
+    size_t textUsed = 0;
+    for (unsigned i = 0; i < entry->count; i++) {
+        entry->args[i] = args[i];
+        if (args[i].type != LOG_ARG_STRING || !args[i].s) continue;
+        // Strings may not outlive the call: copy (truncated) into the entry
+        size_t room = LOG_TEXT_BYTES - textUsed;
+        size_t length = strnlen(args[i].s, room ? room - 1 : 0);
+        char *copy = entry->text + textUsed;
+        if (room) {
+            memcpy(copy, args[i].s, length);
+            copy[length] = '\0';
+            textUsed += length + 1;
+        }
+        entry->args[i].s = room ? copy : "";
+    }
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+
+    // Wake the writer only if it went to sleep
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load_explicit(&gWriterSleeping, memory_order_relaxed)) {
+        pthread_mutex_lock(&gWakeLock);
+        pthread_cond_signal(&gWake);
+        pthread_mutex_unlock(&gWakeLock);
+    }
+}
+
+// --- Writer --------------------------------------------------------------------
+
+static bool pending(void) {
+    for (int i = 0; i < LOG_MAX_THREADS; i++) {
+        LogRing *ring = atomic_load_explicit(&gRings[i], memory_order_acquire);
+        if (ring && atomic_load_explicit(&ring->head, memory_order_acquire) !=
+                    atomic_load_explicit(&ring->tail, memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Write every queued entry, oldest first across threads. Returns the count.
+static unsigned drain(void) {
+    static uint64_t reportedDrops;
+    unsigned written = 0;
+    for (;;) {
+        LogRing *oldest = NULL;
+        uint64_t oldestTime = UINT64_MAX;
+        for (int i = 0; i < LOG_MAX_THREADS; i++) {
+            LogRing *ring = atomic_load_explicit(&gRings[i], memory_order_acquire);
+            if (!ring) continue;
+            uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+            if (atomic_load_explicit(&ring->head, memory_order_acquire) == tail) {
+                // Nothing left from a thread that has exited: recycle its slot
+                if (atomic_load_explicit(&ring->closed, memory_order_acquire) &&
+                    atomic_load_explicit(&ring->head, memory_order_acquire) == tail) {
+                    atomic_store(&gRings[i], NULL);
+                    free(ring);
+                }
+                continue;
+            }
+            const LogEntry *entry = &ring->entries[tail & (LOG_RING_ENTRIES - 1)];
+            if (entry->timeNs < oldestTime) {
+                oldestTime = entry->timeNs;
+                oldest = ring;
+            }
+        }
+        if (!oldest) break;
+        uint32_t tail = atomic_load_explicit(&oldest->tail, memory_order_relaxed);
+        const LogEntry *entry = &oldest->entries[tail & (LOG_RING_ENTRIES - 1)];
+        char line[LOG_LINE_MAX];
+        logFormat(line, sizeof(line), entry->format, entry->args, entry->count);
+        writeLine(gOut, (LogLevel)entry->level, (int64_t)entry->timeNs + gWallOffsetNs, line);
+        atomic_store_explicit(&oldest->tail, tail + 1, memory_order_release);
+        written++;
+    }
+    uint64_t dropped = logDropped();
+    if (dropped != reportedDrops) {
+        char line[64];
+        snprintf(line, sizeof(line), "log: %llu messages dropped", (unsigned long long)(dropped - reportedDrops));
+        writeLine(gOut, LOG_LEVEL_WARN, wallClockNs(), line);
+        reportedDrops = dropped;
+        written++;
+    }
+    if (written) fflush(gOut);
+    return written;
+}
+
+static void *writerMain(void *arg) {
+    (void)arg;
+    unsigned idle = 0;
+    while (atomic_load_explicit(&gRunning, memory_order_acquire)) {
+        if (drain()) {
+            idle = 0;
+        } else if (++idle < LOG_IDLE_POLLS) {
+            nanosleep(&(struct timespec){ 0, LOG_POLL_NS }, NULL);
+        } else {
+            // Quiet for a while: sleep until a producer wakes us
+            pthread_mutex_lock(&gWakeLock);
+            atomic_store(&gWriterSleeping, true);
+            if (!pending() && atomic_load(&gRunning)) pthread_cond_wait(&gWake, &gWakeLock);
+            atomic_store(&gWriterSleeping, false);
+            pthread_mutex_unlock(&gWakeLock);
+            idle = 0;
+        }
+    }
+    drain();
+    return NULL;
+}
+
+bool logStart(const char *path) {
+    if (atomic_load(&gRunning)) return false;
+    gOut = stderr;
+    bool opened = true;
+    if (path && path[0] && strcmp(path, "-") != 0) {
+        gOut = fopen(path, "a");
+        if (!gOut) {
+            fprintf(stderr, "log: cannot open %s: %s; logging to stderr\n", path, strerror(errno));
+            gOut = stderr;
+            opened = false;
+        }
+    }
+    gWallOffsetNs = wallClockNs() - (int64_t)statsNowNs();
+    atomic_store(&gRunning, true);
+    if (pthread_create(&gWriter, NULL, writerMain, NULL) != 0) {
+        atomic_store(&gRunning, false);
+        if (gOut != stderr) fclose(gOut);
+        gOut = stderr;
+        return false;
+    }
+    return opened;
+}
+
+void logStop(void) {
+    if (!atomic_load(&gRunning)) return;
+    pthread_mutex_lock(&gWakeLock);
+    atomic_store(&gRunning, false);
+    pthread_cond_signal(&gWake);
+    pthread_mutex_unlock(&gWakeLock);
+    pthread_join(gWriter, NULL);
+    drain();
+    if (gOut != stderr) fclose(gOut);
+    gOut = stderr;
+}
@@ -0,0 +1,127 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Leveled, asynchronous logging.
+//
+// LOG_ERROR(...) .. LOG_DEBUG(...) take a printf format and up to
+// LOG_MAX_ARGS arguments. The calling thread only captures the format
+// pointer and the arguments (type-tagged with _Generic, strings copied)
+// into its own lock-free ring; a background writer formats and writes
+// them. When a ring is full the message is dropped and counted instead of
+// blocking. Levels above LOG_COMPILE_LEVEL compile to nothing; the rest
+// are filtered at runtime by logSetLevel().
+//
+// Formats must be string literals (only the pointer is kept). Supported
+// conversions: d i u x X o c s p f e g (any flags, width and precision;
+// length modifiers are ignored - the argument's own type decides).
+// Before logStart() and after logStop() messages are written synchronously
+// to stderr.
+
+typedef enum {
+    LOG_LEVEL_OFF = 0,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_DEBUG,
+} LogLevel;
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_MAX_ARGS 8
+
+typedef enum {
+    LOG_ARG_INT = 0,
+    LOG_ARG_UINT,
+    LOG_ARG_DOUBLE,
+    LOG_ARG_STRING,
+    LOG_ARG_POINTER,
+} LogArgType;
+
+typedef struct {
+    LogArgType type;
+    union {
+        int64_t     i;
+        uint64_t    u;
+        double      d;
+        const char *s;
+        const void *p;
+    };
+} LogArg;
+
+static inline LogArg logArgInt(int64_t v) { return (LogArg){ .type = LOG_ARG_INT, .i = v }; }
+static inline LogArg logArgUint(uint64_t v) { return (LogArg){ .type = LOG_ARG_UINT, .u = v }; }
+static inline LogArg logArgDouble(double v) { return (LogArg){ .type = LOG_ARG_DOUBLE, .d = v }; }
+static inline LogArg logArgString(const char *v) { return (LogArg){ .type = LOG_ARG_STRING, .s = v }; }
+static inline LogArg logArgPointer(const void *v) { return (LogArg){ .type = LOG_ARG_POINTER, .p = v }; }
+
+#define LOG_ARG(x) _Generic((x),                                                       \
+    _Bool: logArgUint, char: logArgInt, signed char: logArgInt, short: logArgInt,     \
+    int: logArgInt, long: logArgInt, long long: logArgInt,                            \
+    unsigned char: logArgUint, unsigned short: logArgUint, unsigned: logArgUint,      \
+    unsigned long: logArgUint, unsigned long long: logArgUint,                        \
+    float: logArgDouble, double: logArgDouble,                                        \
+    char *: logArgString, const char *: logArgString,                                 \
+    default: logArgPointer)(x)
+
+// Argument plumbing: the format counts as the first argument
+#define LOG_COUNT(...) LOG_COUNT_(__VA_ARGS__, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define LOG_COUNT_(a1, a2, a3, a4, a5, a6, a7, a8, a9, n, ...) n
+#define LOG_FIRST(...) LOG_FIRST_(__VA_ARGS__, 0)
+#define LOG_FIRST_(first, ...) first
+#define LOG_CAT(a, b) LOG_CAT_(a, b)
+#define LOG_CAT_(a, b) a##b
+#define LOG_MAP1(a) LOG_ARG(a)
+#define LOG_MAP2(a, ...) LOG_ARG(a), LOG_MAP1(__VA_ARGS__)
+#define LOG_MAP3(a, ...) LOG_ARG(a), LOG_MAP2(__VA_ARGS__)
+#define LOG_MAP4(a, ...) LOG_ARG(a), LOG_MAP3(__VA_ARGS__)
+#define LOG_MAP5(a, ...) LOG_ARG(a), LOG_MAP4(__VA_ARGS__)
+#define LOG_MAP6(a, ...) LOG_ARG(a), LOG_MAP5(__VA_ARGS__)
+#define LOG_MAP7(a, ...) LOG_ARG(a), LOG_MAP6(__VA_ARGS__)
+#define LOG_MAP8(a, ...) LOG_ARG(a), LOG_MAP7(__VA_ARGS__)
+#define LOG_MAP9(a, ...) LOG_ARG(a), LOG_MAP8(__VA_ARGS__)
+
+extern _Atomic int gLogLevel;
+
+static inline bool logEnabled(LogLevel level) {
+    return (int)level <= atomic_load_explicit(&gLogLevel, memory_order_relaxed);
+}
+
+void logWrite(LogLevel level, const char *format, const LogArg *args, unsigned count);
+
+#define LOG_AT(level, ...) do {                                                        \
+        if ((level) <= LOG_COMPILE_LEVEL && logEnabled(level)) {                      \
+            const LogArg logArgs_[] = { LOG_CAT(LOG_MAP, LOG_COUNT(__VA_ARGS__))(__VA_ARGS__) }; \
+            logWrite(level, LOG_FIRST(__VA_ARGS__), logArgs_ + 1, LOG_COUNT(__VA_ARGS__) - 1); \
+        }                                                                              \
+    } while (0)
+
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+#define LOG_WARN(...)  LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_INFO(...)  LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+
+void logSetLevel(LogLevel level);
+// "error", "warn", "info", "debug" or "off"; unknown names give info
+LogLevel logLevelFromName(const char *name);
+
+// Start the writer thread. path NULL, "" or "-" writes to stderr; so does
+// a path that cannot be opened (and false is returned).
+bool logStart(const char *path);
+// Write everything still queued and stop the writer.
+void logStop(void);
+
+// Messages dropped because a thread's ring was full
+uint64_t logDropped(void);
+
+// Format a captured message into buf (snprintf semantics); what the writer
+// does with every entry. Exposed for the benchmarks.
+size_t logFormat(char *buf, size_t size, const char *format, const LogArg *args, unsigned count);
+
+#endif // LOG_H
@@ -3,124 +3,42 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
-#include <limits.h>  // For UINT16_MAX & PATH_MAX (or MAXPATHLEN)
+#include <limits.h>  // For PATH_MAX (or MAXPATHLEN)
 #include <mach-o/dyld.h> // For _NSGetExecutablePath
 #include <libgen.h>      // For dirname
 #include <unistd.h>      // For readlink (optional, for resolving symlinks)
-
-#define LEFT_ARROW_KEYCODE  0x7B
-#define RIGHT_ARROW_KEYCODE 0x7C
-
-// Global hotkey settings (modifiable via config.ini)
-static CGEventFlags gSwitchModifiersRequired   = kCGEventFlagMaskControl;
-static CGEventFlags gSwitchModifiersForbidden = kCGEventFlagMaskShift | kCGEventFlagMaskAlternate | kCGEventFlagMaskCommand;
-static CGKeyCode    gSwitchKeyCode            = 0x31;  // space
-static CGEventFlags gExitModifiersRequired     = kCGEventFlagMaskControl | kCGEventFlagMaskAlternate | kCGEventFlagMaskCommand;
-static CGKeyCode    gExitKeyCode               = 0x0C;  // Q
-static CGEventFlags gDragModifiersRequired = kCGEventFlagMaskControl | kCGEventFlagMaskAlternate | kCGEventFlagMaskCommand;
-static CGEventFlags gDragModifiersForbidden = 0; // No forbidden modifiers for window dragging
-static CGKeyCode gDragKeyCode = 0x31;  // space by default
-
-// Map single character to CGKeyCode (ANSI US layout)
-static CGKeyCode keycodeForChar(char c) {
-    switch (c) {
-        case 'A': return 0x00;  case 'S': return 0x01;
-        case 'D': return 0x02;  case 'F': return 0x03;
-        case 'H': return 0x04;  case 'G': return 0x05;
-        case 'Z': return 0x06;  case 'X': return 0x07;
-        case 'C': return 0x08;  case 'V': return 0x09;
-        case 'B': return 0x0B;  case 'Q': return 0x0C;
-        case 'W': return 0x0D;  case 'E': return 0x0E;
-        case 'R': return 0x0F;  case 'Y': return 0x10;
-        case 'T': return 0x11;  case '1': return 0x12;
-        case '2': return 0x13;  case '3': return 0x14;
-        case '4': return 0x15;  case '6': return 0x16;
-        case '5': return 0x17;  case '=': return 0x18;
-        case '9': return 0x19;  case '7': return 0x1A;
-        case '-': return 0x1B;  case '8': return 0x1C;
-        case '0': return 0x1D;  case 'O': return 0x1F;
-        case 'U': return 0x20;  case 'I': return 0x22;
-        case 'P': return 0x23;  case 'L': return 0x25;
-        case 'J': return 0x26;  case 'K': return 0x28;
-        case 'N': return 0x2D;  case 'M': return 0x2E;
-        case ',': return 0x2B;  case '.': return 0x2F;
-        case '/': return 0x2C;  case ';': return 0x29;
-        case '\'': return 0x27;  case '\\': return 0x2A;
-        case '`': return 0x32;  case ' ': return 0x31;
-        default: return (CGKeyCode)UINT16_MAX;
-    }
-}
-
-// Function to display a notification with cursor position
-void notifyCursorPosition() {
-    CGEventRef tempEvent = CGEventCreate(NULL);
-    if (!tempEvent) return;
-    CGPoint cursorPos = CGEventGetLocation(tempEvent);
-    CFRelease(tempEvent);
-
-    char notificationCmd[256];
-    // Use snprintf to prevent buffer overflows
-    snprintf(notificationCmd, sizeof(notificationCmd),
-             "osascript -e 'display notification \"Cursor at X: %.0f, Y: %.0f\" with title \"QuickMonitorSwitcher\"' &> /dev/null",
-             cursorPos.x, cursorPos.y);
-    system(notificationCmd);
-}
-
-// Parse hotkey string of form "Modifier+Key" into modifiers mask and keycode
-void parse_hotkey(const char *str, CGEventFlags *modifiers, CGKeyCode *keycode) {
-    char buf[256];
-    strncpy(buf, str, sizeof(buf)-1);
-    buf[sizeof(buf)-1] = '\0';
-    // Remove newline
-    char *newline = strchr(buf, '\n');
-    if (newline) *newline = '\0';
-    // Trim leading and trailing whitespace
-    char *p = buf;
-    while (isspace((unsigned char)*p)) p++;
-    char *endp = p + strlen(p) - 1;
-    while (endp > p && isspace((unsigned char)*endp)) *endp-- = '\0';
-    *modifiers = 0;
-    *keycode = 0;
-    // Tokenize on '+'
-    char *token = strtok(p, "+");
-    char *last = NULL;
-    while (token) {
-        // Trim whitespace around token
-        char *t = token;
-        while (isspace((unsigned char)*t)) t++;
-        char *te = t + strlen(t) - 1;
-        while (te > t && isspace((unsigned char)*te)) *te-- = '\0';
-        last = t;
-        if (strcasecmp(t, "Control") == 0) *modifiers |= kCGEventFlagMaskControl;
-        else if (strcasecmp(t, "Shift") == 0) *modifiers |= kCGEventFlagMaskShift;
-        else if (strcasecmp(t, "Option") == 0 || strcasecmp(t, "Alt") == 0) *modifiers |= kCGEventFlagMaskAlternate;
-        else if (strcasecmp(t, "Command") == 0 || strcasecmp(t, "Cmd") == 0) *modifiers |= kCGEventFlagMaskCommand;
-        token = strtok(NULL, "+");
-    }
-    if (last) {
-        if (strcasecmp(last, "Space") == 0) {
-            *keycode = keycodeForChar(' ');
-        } else if (strcasecmp(last, "Left") == 0) {
-            *keycode = LEFT_ARROW_KEYCODE;
-        } else if (strcasecmp(last, "Right") == 0) {
-            *keycode = RIGHT_ARROW_KEYCODE;
-        } else if (strlen(last) == 1) {
-            char c = toupper(last[0]);
-            *keycode = keycodeForChar(c);
-        }
-    }
-}
-
-// Load configuration from config.ini; defaults used if missing
-void loadConfig() {
+#include <signal.h>      // For SIGUSR1/SIGUSR2 (stats export, trace dumps)
+
+#include "backend.h"
+#include "config.h"
+#include "configwatch.h"
+#include "control.h"
+#include "drag.h"
+#include "hotkeys.h"
+#include "log.h"
+#include "mover.h"
+#include "notify.h"
+#include "stats.h"
+#include "switcher.h"
+#include "trace.h"
+#include "watchdog.h"
+
+_Static_assert(MOD_SHIFT == kCGEventFlagMaskShift && MOD_CONTROL == kCGEventFlagMaskControl &&
+               MOD_OPTION == kCGEventFlagMaskAlternate && MOD_COMMAND == kCGEventFlagMaskCommand,
+               "hotkeys.h modifier bits must match CGEventFlags");
+
+// Settings from config.ini (defaults if missing). Only the hotkeys are
+// reloaded while running; the rest is read once at startup.
+static Config gConfig;
+static char   gConfigPath[PATH_MAX] = "config.ini";
+
+// Editors often save in several steps; wait this long for the file to settle
+#define CONFIG_WATCH_DEBOUNCE_MS 50
+
+// Locate config.ini: inside the app bundle, else the current directory
+static void resolveConfigPath() {
     char exe_path[PATH_MAX];
     uint32_t len = sizeof(exe_path);
-    char config_file_path[PATH_MAX];
-
-    // Default to current directory
-    strncpy(config_file_path, "config.ini", PATH_MAX -1);
-    config_file_path[PATH_MAX-1] = '\0';
 
     if (_NSGetExecutablePath(exe_path, &len) == 0) {
         // Make a copy for dirname as it might modify the string
@@ -139,244 +57,91 @@ void loadConfig() {
 
         if (strcmp(basename(mac_os_dir), "MacOS") == 0 && strcmp(basename(dirname(contents_dir)), "Contents") == 0) {
             // Likely running from an app bundle
-            snprintf(config_file_path, sizeof(config_file_path), "%s/Resources/config.ini", contents_dir);
+            snprintf(gConfigPath, sizeof(gConfigPath), "%s/Resources/config.ini", contents_dir);
         } else {
              // Not in a typical App bundle structure, or _NSGetExecutablePath gave an unexpected path.
-             // Keep config_file_path as "config.ini" (current directory)
-             fprintf(stderr, "Not running in a standard app bundle, or path unexpected. Looking for config.ini in current directory.\n");
+             // Keep gConfigPath as "config.ini" (current directory)
+             LOG_WARN("Not running in a standard app bundle, or path unexpected. Looking for config.ini in current directory.");
         }
     } else {
-        fprintf(stderr, "Could not get executable path using _NSGetExecutablePath. Looking for config.ini in current directory.\n");
-        // Fallback: config_file_path is already "config.ini"
-    }
-    
-    fprintf(stdout, "Attempting to load config from: %s\n", config_file_path);
-    FILE *f = fopen(config_file_path, "r");
-    if (!f) {
-        fprintf(stderr, "Failed to open config file: %s. Using default settings.\n", config_file_path);
-        return; // Defaults are already set in global variables
+        LOG_WARN("Could not get executable path using _NSGetExecutablePath. Looking for config.ini in current directory.");
+        // Fallback: gConfigPath is already "config.ini"
     }
-    char line[256];
-    while (fgets(line, sizeof(line), f)) {
-        if (line[0] == '#' || line[0] == ';' || line[0] == '[') continue;
-        char *eq = strchr(line, '=');
-        if (!eq) continue;
-        *eq = '\0';
-        char *key = line;
-        char *val = eq + 1;
-        while (*key == ' ' || *key == '\t') key++;
-        char *end = key + strlen(key) - 1;
-        while (end > key && (*end == ' ' || *end == '\t')) *end-- = '\0';
-        while (*val == ' ' || *val == '\t') val++;
-        char *vn = strchr(val, '\n'); if (vn) *vn = '\0';
-        if (strcasecmp(key, "switch_hotkey") == 0) {
-            parse_hotkey(val, &gSwitchModifiersRequired, &gSwitchKeyCode);
-        } else if (strcasecmp(key, "exit_hotkey") == 0) {
-            parse_hotkey(val, &gExitModifiersRequired, &gExitKeyCode);
-        } else if (strcasecmp(key, "drag_window_hotkey") == 0) {
-            parse_hotkey(val, &gDragModifiersRequired, &gDragKeyCode);
-        }
-    }
-    fclose(f);
 }
 
-// Switch cursor position by one display in the given direction (-1 = left, +1 = right)
-void switchDisplay(int direction) {
-    // Get list of active displays
-    uint32_t maxDisplays = 16;
-    uint32_t displayCount = 0;
-    CGDirectDisplayID displays[16];
-    CGError err = CGGetActiveDisplayList(maxDisplays, displays, &displayCount);
-    if (err != kCGErrorSuccess || displayCount < 2) {
-        return;
+// Load configuration from config.ini; defaults used if missing
+void loadConfig() {
+    configDefaults(&gConfig);
+    resolveConfigPath();
+    LOG_INFO("Attempting to load config from: %s", gConfigPath);
+    char error[256];
+    if (!configLoad(&gConfig, gConfigPath, error, sizeof(error))) {
+        LOG_WARN("Failed to load config (%s). Using default settings.", error);
     }
+}
 
-    // Get current cursor position
-    CGEventRef mouseEvent = CGEventCreate(NULL);
-    CGPoint currentPos = CGEventGetLocation(mouseEvent);
-    CFRelease(mouseEvent);
+// Compile the configured hotkeys into the keycode-indexed dispatch table
+static bool compileHotkeys() {
+    char error[256];
+    HotkeyTable *table = configCompileHotkeys(&gConfig, false, error, sizeof(error));
+    if (!table) return false;
+    switcherPublishHotkeys(table);
+    return true;
+}
 
-    // Find which display the cursor is currently on
-    int currentIndex = 0;
-    CGRect currentBounds = CGDisplayBounds(displays[0]);
-    for (uint32_t i = 0; i < displayCount; ++i) {
-        CGRect bounds = CGDisplayBounds(displays[i]);
-        if (CGRectContainsPoint(bounds, currentPos)) {
-            currentIndex = i;
-            currentBounds = bounds;
-            break;
-        }
+// config.ini changed on disk (runs on the watcher thread)
+static void configChanged(const char *path, void *context) {
+    (void)context;
+    char error[256];
+    if (configReloadHotkeys(path, error, sizeof(error))) {
+        LOG_INFO("Reloaded hotkeys from %s", path);
+    } else {
+        LOG_WARN("Config reload failed (%s); keeping previous hotkeys.", error);
     }
+}
 
-    // Calculate the next display index
-    int newIndex = (currentIndex + direction + displayCount) % displayCount;
-    CGRect newBounds = CGDisplayBounds(displays[newIndex]);
-
-    // Compute proportional position within the current display
-    double fracX = 0.0, fracY = 0.0;
-    if (currentBounds.size.width > 0)
-        fracX = (currentPos.x - currentBounds.origin.x) / currentBounds.size.width;
-    if (currentBounds.size.height > 0)
-        fracY = (currentPos.y - currentBounds.origin.y) / currentBounds.size.height;
+static void displayReconfigurationCallback(CGDirectDisplayID display, CGDisplayChangeSummaryFlags flags, void *userInfo) {
+    (void)display;
+    (void)userInfo;
+    // Rebuild once the change has been applied, not when it is announced
+    if (flags & kCGDisplayBeginConfigurationFlag) return;
+    switcherRebuildTopology();
+}
 
-    // Compute new absolute position proportionally on the target display
-    double newX = newBounds.origin.x + fracX * newBounds.size.width;
-    double newY = newBounds.origin.y + fracY * newBounds.size.height;
+// Event tap re-enabling. The system disables a tap whose callback is too
+// slow; the watchdog decides when to turn it back on.
+#define TAP_HEALTH_CHECK_S 2.0
 
-    // Clamp within the target display
-    if (newX < newBounds.origin.x) newX = newBounds.origin.x;
-    if (newX > newBounds.origin.x + newBounds.size.width) newX = newBounds.origin.x + newBounds.size.width;
-    if (newY < newBounds.origin.y) newY = newBounds.origin.y;
-    if (newY > newBounds.origin.y + newBounds.size.height) newY = newBounds.origin.y + newBounds.size.height;
+static CFMachPortRef     gEventTap;
+static CFRunLoopTimerRef gReenableTimer;   // one-shot, armed while a re-enable is backed off
+static CFRunLoopTimerRef gHealthTimer;
 
-    // Warp the cursor
-    CGWarpMouseCursorPosition(CGPointMake(newX, newY));
-    CGAssociateMouseAndMouseCursorPosition(true);
+static void reenableTap(void) {
+    CGEventTapEnable(gEventTap, true);
+    watchdogTapEnabled(statsNowNs());
+}
 
-    notifyCursorPosition(); // Notify cursor position after switching
+static void reenableTimerFired(CFRunLoopTimerRef timer, void *info) {
+    (void)timer;
+    (void)info;
+    if (watchdogTapPending()) reenableTap();
 }
 
-void dragWindowBetweenDisplays(int direction) {
-    printf("dragWindowBetweenDisplays called with direction: %d\n", direction);
-    
-    // Get list of active displays
-    uint32_t maxDisplays = 16;
-    uint32_t displayCount = 0;
-    CGDirectDisplayID displays[16];
-    CGError err = CGGetActiveDisplayList(maxDisplays, displays, &displayCount);
-    if (err != kCGErrorSuccess || displayCount < 2) {
-        fprintf(stderr, "Failed to get active displays or only one display\n");
-        return;
-    }
-    
-    // Get current mouse position
-    CGEventRef mouseEvent = CGEventCreate(NULL);
-    if (mouseEvent == NULL) {
-        fprintf(stderr, "Failed to create mouse event\n");
-        return;
-    }
-    
-    CGPoint currentPos = CGEventGetLocation(mouseEvent);
-    printf("Current cursor position: X=%.1f, Y=%.1f\n", currentPos.x, currentPos.y);
-    CFRelease(mouseEvent);
-    
-    // Find which display the cursor is currently on
-    int currentIndex = 0;
-    CGRect currentBounds = CGDisplayBounds(displays[0]);
-    for (uint32_t i = 0; i < displayCount; ++i) {
-        CGRect bounds = CGDisplayBounds(displays[i]);
-        if (CGRectContainsPoint(bounds, currentPos)) {
-            currentIndex = i;
-            currentBounds = bounds;
-            break;
-        }
-    }
-    
-    // Calculate the next display index
-    int newIndex = (currentIndex + direction + displayCount) % displayCount;
-    CGRect newBounds = CGDisplayBounds(displays[newIndex]);
-    
-    // Compute proportional position within the current display
-    double fracX = 0.0, fracY = 0.0;
-    if (currentBounds.size.width > 0)
-        fracX = (currentPos.x - currentBounds.origin.x) / currentBounds.size.width;
-    if (currentBounds.size.height > 0)
-        fracY = (currentPos.y - currentBounds.origin.y) / currentBounds.size.height;
-    
-    // Compute new absolute position proportionally on the target display
-    double newX = newBounds.origin.x + fracX * newBounds.size.width;
-    double newY = newBounds.origin.y + fracY * newBounds.size.height;
-    
-    // Clamp within the target display
-    if (newX < newBounds.origin.x) newX = newBounds.origin.x;
-    if (newX > newBounds.origin.x + newBounds.size.width) newX = newBounds.origin.x + newBounds.size.width;
-    if (newY < newBounds.origin.y) newY = newBounds.origin.y;
-    if (newY > newBounds.origin.y + newBounds.size.height) newY = newBounds.origin.y + newBounds.size.height;
-    
-    CGPoint targetPos = CGPointMake(newX, newY);
-    
-    // Simulate mouse down at current position
-    CGEventRef mouseDown = CGEventCreateMouseEvent(
-        NULL, kCGEventLeftMouseDown, 
-        currentPos, kCGMouseButtonLeft
-    );
-    
-    if (mouseDown == NULL) {
-        fprintf(stderr, "Failed to create mouse down event\n");
-        return;
-    }
-    
-    printf("Posting mouse down event\n");
-    CGEventPost(kCGSessionEventTap, mouseDown);
-    CFRelease(mouseDown);
-    
-    // Longer delay to allow system to register the mouse down
-    printf("Waiting for mouse down to register...\n");
-    usleep(150000); // 150ms
-    
-    // Create a sequence of intermediate points for smoother dragging
-    int steps = 10;
-    for (int i = 1; i <= steps; i++) {
-        CGPoint intermediatePos = CGPointMake(
-            currentPos.x + (targetPos.x - currentPos.x) * i / steps,
-            currentPos.y + (targetPos.y - currentPos.y) * i / steps
-        );
-        
-        // Create and post a drag event for this intermediate position
-        CGEventRef dragEvent = CGEventCreateMouseEvent(
-            NULL, kCGEventLeftMouseDragged, 
-            intermediatePos, kCGMouseButtonLeft
-        );
-        
-        if (dragEvent == NULL) {
-            fprintf(stderr, "Failed to create drag event at step %d\n", i);
-            continue;
-        }
-        
-        CGEventPost(kCGSessionEventTap, dragEvent);
-        CFRelease(dragEvent);
-        
-        // Small delay between steps
-        usleep(20000); // 20ms
-    }
-    
-    // Ensure we end up exactly at the target position
-    CGEventRef finalDrag = CGEventCreateMouseEvent(
-        NULL, kCGEventLeftMouseDragged, 
-        targetPos, kCGMouseButtonLeft
-    );
-    
-    if (finalDrag != NULL) {
-        CGEventPost(kCGSessionEventTap, finalDrag);
-        CFRelease(finalDrag);
-    }
-    
-    // Longer delay before mouse up to ensure window follows
-    usleep(150000); // 150ms
-    
-    // Simulate mouse up at the target position
-    CGEventRef mouseUp = CGEventCreateMouseEvent(
-        NULL, kCGEventLeftMouseUp, 
-        targetPos, kCGMouseButtonLeft
-    );
-    
-    if (mouseUp == NULL) {
-        fprintf(stderr, "Failed to create mouse up event\n");
+static void tapDisabled(WatchdogReason reason) {
+    uint64_t now = statsNowNs();
+    uint64_t at = watchdogTapDisabled(reason, now);
+    if (at <= now || !gReenableTimer) {
+        reenableTap();
         return;
     }
-    
-    printf("Posting mouse up event\n");
-    CGEventPost(kCGSessionEventTap, mouseUp);
-    CFRelease(mouseUp);
-    
-    printf("Drag operation completed\n");
-    
-    // Display a custom notification about the drag attempt
-    char notificationCmd[256];
-    snprintf(notificationCmd, sizeof(notificationCmd),
-             "osascript -e 'display notification \"Attempted to drag window from (%.0f,%.0f) to (%.0f,%.0f)\" with title \"QuickMonitorSwitcher\"' &> /dev/null",
-             currentPos.x, currentPos.y, targetPos.x, targetPos.y);
-    system(notificationCmd);
+    CFRunLoopTimerSetNextFireDate(gReenableTimer, CFAbsoluteTimeGetCurrent() + (double)(at - now) / 1e9);
+}
+
+// Catches a tap that was turned off without the notice reaching the callback
+static void healthTimerFired(CFRunLoopTimerRef timer, void *info) {
+    (void)timer;
+    (void)info;
+    if (!watchdogTapPending() && !CGEventTapIsEnabled(gEventTap)) tapDisabled(WATCHDOG_FOUND_DISABLED);
 }
 
 // Callback for keyboard events
@@ -384,85 +149,92 @@ CGEventRef eventTapCallback(CGEventTapProxy proxy, CGEventType type, CGEventRef
     // Suppress unused parameter warnings
     (void)proxy;
     (void)userInfo;
+    // The whole callback counts against the watchdog's budget
+    uint64_t t0 = statsNowNs();
 
+    if (type == kCGEventTapDisabledByTimeout || type == kCGEventTapDisabledByUserInput) {
+        tapDisabled(type == kCGEventTapDisabledByTimeout ? WATCHDOG_DISABLED_BY_TIMEOUT : WATCHDOG_DISABLED_BY_USER_INPUT);
+        return event;
+    }
     if (type != kCGEventKeyDown) {
         return event;
     }
 
     CGKeyCode keyCode = (CGKeyCode)CGEventGetIntegerValueField(event, kCGKeyboardEventKeycode);
-    CGEventFlags flags = CGEventGetFlags(event);
-
-    // Handle Control+Space for next display
-    if ((flags & gSwitchModifiersRequired) == gSwitchModifiersRequired &&
-        !(flags & gSwitchModifiersForbidden) &&
-        keyCode == gSwitchKeyCode) {
-        switchDisplay(1);
-        return NULL; // consume the event
-    }
-
-    // Handle Control+Option+Command+Q to quit the application
-    if ((flags & gExitModifiersRequired) == gExitModifiersRequired && keyCode == gExitKeyCode) {
-        CFRunLoopStop(CFRunLoopGetCurrent());
-        return NULL;
-    }
-
-    // Existing Command+Left/Right handling
-    if ((flags & kCGEventFlagMaskCommand) && !(flags & (kCGEventFlagMaskShift | kCGEventFlagMaskAlternate | kCGEventFlagMaskControl))) {
-        if (keyCode == LEFT_ARROW_KEYCODE) {
-            switchDisplay(-1);
-            return NULL; // consume the event
-        } else if (keyCode == RIGHT_ARROW_KEYCODE) {
-            switchDisplay(1);
-            return NULL; // consume the event
-        }
+    // Fast reject: ordinary typing returns after one bit test, unmeasured
+    if (!switcherKeyMayMatch(keyCode)) {
+        statsCount(COUNTER_PASSED);
+        return event;
     }
+    bool autorepeat = CGEventGetIntegerValueField(event, kCGKeyboardEventAutorepeat) != 0;
+    // Key events carry the cursor position: no need to create an event to ask
+    CGPoint location = CGEventGetLocation(event);
+    bool consumed = switcherHandleKeyAt(keyCode, CGEventGetFlags(event), statsEventTimeToNs(CGEventGetTimestamp(event)),
+                                        autorepeat, (TopoPoint){ location.x, location.y });
+    watchdogRecordCallback(statsNowNs() - t0);
+    return consumed ? NULL : event; // consume the event if a binding matched
+}
 
-    // Handle window dragging hotkey for both directions
-    if (keyCode == gDragKeyCode) {
-        // Create a mask for all modifier keys we care about
-        CGEventFlags allModifiersMask = kCGEventFlagMaskShift | kCGEventFlagMaskControl | 
-                                      kCGEventFlagMaskAlternate | kCGEventFlagMaskCommand;
-        
-        // Extract just the modifiers from the actual flags
-        CGEventFlags actualModifiers = flags & allModifiersMask;
-        
-        // Check if they exactly match what we require
-        if (actualModifiers == gDragModifiersRequired) {
-            printf("Drag window hotkey detected! Required: 0x%llx, Forbidden: 0x%llx, KeyCode: 0x%x\n", 
-                   (unsigned long long)gDragModifiersRequired, 
-                   (unsigned long long)gDragModifiersForbidden, 
-                   (unsigned int)gDragKeyCode);
-            printf("Actual flags: 0x%llx, KeyCode: 0x%x\n", 
-                   (unsigned long long)flags, 
-                   (unsigned int)keyCode);
-            printf("Calling dragWindowBetweenDisplays(1)\n");
-            dragWindowBetweenDisplays(1);  // Forward direction
-            printf("Returned from dragWindowBetweenDisplays\n");
-            return NULL; // consume the event
-        }
+// Start the notification worker with the sink selected in config.ini
+static void startNotifications() {
+    NotifySink sink;
+    if (!notifySinkFromName(&sink, gConfig.notificationSink, gConfig.notificationFile)) {
+        LOG_WARN("Notification sink '%s' unavailable, notifications disabled.", gConfig.notificationSink);
+        return;
     }
-
-    // Also add left and right arrow keys with drag modifiers for explicit direction control
-    if ((flags & gDragModifiersRequired) == gDragModifiersRequired) {
-        if (keyCode == LEFT_ARROW_KEYCODE) {
-            printf("Drag window LEFT hotkey detected!\n"); 
-            dragWindowBetweenDisplays(-1);  // Backward/Left direction
-            return NULL; // consume the event
-        } else if (keyCode == RIGHT_ARROW_KEYCODE) {
-            printf("Drag window RIGHT hotkey detected!\n");
-            dragWindowBetweenDisplays(1);   // Forward/Right direction
-            return NULL; // consume the event
-        }
+    if (strcmp(sink.name, "none") == 0) return;
+    NotifyOptions options = { .minIntervalMs = gConfig.notificationIntervalMs };
+    if (!notifyStart(&sink, &options)) {
+        LOG_ERROR("Failed to start notification worker, notifications disabled.");
+        if (sink.close) sink.close(&sink);
+        return;
     }
-
-    return event;
+    LOG_INFO("Notifications via %s sink", sink.name);
 }
 
 int main(void) {
     loadConfig();
+    logSetLevel(gConfig.logLevel);
+    // Before any thread starts, so only the exporter threads receive SIGUSR1/SIGUSR2
+    if (gConfig.traceFile[0] && !traceStartDumps(gConfig.traceFile, SIGUSR2)) {
+        LOG_ERROR("Failed to start trace dumps.");
+    }
+    if (gConfig.statsFile[0] && !statsStartSignalExport(SIGUSR1, gConfig.statsFile, gConfig.statsJSON)) {
+        LOG_ERROR("Failed to start stats exporter.");
+    }
+    logStart(gConfig.logFile);
+    if (!compileHotkeys()) {
+        LOG_ERROR("Failed to build hotkey table.");
+        return EXIT_FAILURE;
+    }
+    startNotifications();
+    switcherInit(backendCoreGraphics());
+    switcherSetRepeatOptions(&gConfig.repeat);
+    switcherSetJumpAnchor(gConfig.jumpAnchor);
+    switcherSetWindowMode(gConfig.windowMode);
+    switcherSetCursorMapping(&gConfig.cursorMapping);
+    switcherRebuildTopology();
+    if (gConfig.drag.minSettleMs > gConfig.drag.settleMs) gConfig.drag.minSettleMs = gConfig.drag.settleMs;
+    if (!dragEngineStart(switcherDragPoster(), &gConfig.drag)) {
+        LOG_ERROR("Failed to start drag engine, window dragging disabled.");
+    }
+    if (!moverStart(switcherBackend(), &gConfig.move)) {
+        LOG_ERROR("Failed to start window mover; windows will be dragged instead.");
+    }
+    watchdogConfigure(&gConfig.watchdog);
+    if (!watchdogStart(switcherRunDeferred)) {
+        LOG_ERROR("Failed to start watchdog worker; slow actions will run in the event tap.");
+    }
+    CGDisplayRegisterReconfigurationCallback(displayReconfigurationCallback, NULL);
+    if (gConfig.watch && !configWatchStart(gConfigPath, CONFIG_WATCH_DEBOUNCE_MS, configChanged, NULL)) {
+        LOG_WARN("Cannot watch %s; hotkey changes need a restart.", gConfigPath);
+    }
+    if (gConfig.controlSocket[0] && controlStart(gConfig.controlSocket)) {
+        LOG_INFO("Control socket at %s", gConfig.controlSocket);
+    }
     // Create an event tap to capture keydown events
     CGEventMask mask = CGEventMaskBit(kCGEventKeyDown);
-    CFMachPortRef eventTap = CGEventTapCreate(
+    gEventTap = CGEventTapCreate(
         kCGSessionEventTap,
         kCGHeadInsertEventTap,
         kCGEventTapOptionDefault,
@@ -471,22 +243,49 @@ int main(void) {
         NULL
     );
 
-    if (!eventTap) {
-        fprintf(stderr, "Failed to create event tap.\n");
+    if (!gEventTap) {
+        LOG_ERROR("Failed to create event tap.");
         return EXIT_FAILURE;
     }
 
     // Create a run loop source and add to the current run loop
-    CFRunLoopSourceRef runLoopSource = CFMachPortCreateRunLoopSource(kCFAllocatorDefault, eventTap, 0);
+    CFRunLoopSourceRef runLoopSource = CFMachPortCreateRunLoopSource(kCFAllocatorDefault, gEventTap, 0);
     CFRunLoopAddSource(CFRunLoopGetCurrent(), runLoopSource, kCFRunLoopCommonModes);
-    CGEventTapEnable(eventTap, true);
+    CGEventTapEnable(gEventTap, true);
+
+    // Re-enable timer (armed on demand) and the periodic tap health check
+    gReenableTimer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent() + 1e9, 1e9, 0, 0,
+                                          reenableTimerFired, NULL);
+    if (gReenableTimer) CFRunLoopAddTimer(CFRunLoopGetCurrent(), gReenableTimer, kCFRunLoopCommonModes);
+    gHealthTimer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent() + TAP_HEALTH_CHECK_S,
+                                        TAP_HEALTH_CHECK_S, 0, 0, healthTimerFired, NULL);
+    if (gHealthTimer) CFRunLoopAddTimer(CFRunLoopGetCurrent(), gHealthTimer, kCFRunLoopCommonModes);
 
     // Run the loop
     CFRunLoopRun();
 
-    // Cleanup (unreachable in this simple program)
+    // Cleanup
+    if (gConfig.statsFile[0]) statsWriteFile(gConfig.statsFile, gConfig.statsJSON);
+    controlStop();
+    configWatchStop();
+    CGDisplayRemoveReconfigurationCallback(displayReconfigurationCallback, NULL);
+    watchdogStop();
+    moverStop();
+    dragEngineStop();
+    notifyStop();
+    if (gHealthTimer) {
+        CFRunLoopTimerInvalidate(gHealthTimer);
+        CFRelease(gHealthTimer);
+    }
+    if (gReenableTimer) {
+        CFRunLoopTimerInvalidate(gReenableTimer);
+        CFRelease(gReenableTimer);
+    }
     CFRelease(runLoopSource);
-    CFRelease(eventTap);
+    CFRelease(gEventTap);
+    // Last: everything stopped above may still log (the watchdog runs the
+    // actions still queued), and only the writer thread honors log_file
+    logStop();
 
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,194 @@
+#include "mover.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "evacuate.h"
+#include "frame.h"
+#include "log.h"
+#include "stats.h"
+
+typedef struct {
+    TopoDirection direction;
+    TopoPoint     cursor;
+    uint64_t      requestedNs;
+    bool          evacuate;     // every window on the display, not just one
+} MoveJob;
+
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  gWake = PTHREAD_COND_INITIALIZER;
+static pthread_t       gThread;
+static bool            gRunning;       // guarded by gLock
+static bool            gHavePending;   // guarded by gLock
+static MoveJob         gPending;       // guarded by gLock
+
+static Backend        *gBackend;
+static MoveOptions     gOptions;
+static _Atomic bool    gBusy;
+
+static _Atomic uint64_t gRequested, gCompleted, gFailed, gSuperseded, gEvacuations, gLastNs;
+
+bool moverMoveWindow(Backend *backend, const MoveOptions *options, TopoDirection direction,
+                     TopoPoint cursor, MoveResult *result) {
+    BackendWindow window;
+    if (!backend->windowFind(backend, options->pick, cursor, &window)) {
+        LOG_DEBUG("No window to move");
+        return false;
+    }
+
+    // Copy what is needed out of the snapshot: the calls below can block
+    unsigned token;
+    const Topology *topology = topologyAcquire(&token);
+    int from = -1, to = -1;
+    DisplayInfo source = { 0 }, target = { 0 };
+    if (topology) {
+        from = frameDisplayOf(topology, window.frame);
+        if (from < 0) from = topologyDisplayAt(topology, cursor);
+        if (from >= 0) to = topologyNeighbor(topology, from, direction);
+        if (to >= 0 && to != from) {
+            source = topology->displays[from];
+            target = topology->displays[to];
+        }
+    }
+    topologyRelease(token);
+    if (to < 0 || to == from) {
+        LOG_DEBUG("No display in that direction");
+        backend->windowRelease(backend, &window);
+        return false;
+    }
+
+    TopoRect fromArea = frameUsableArea(source.bounds, backend->displayInsets(backend, &source));
+    TopoRect toArea = frameUsableArea(target.bounds, backend->displayInsets(backend, &target));
+    TopoRect before = window.frame;
+    TopoRect after = frameMap(before, fromArea, toArea, options->scale);
+    bool moved = backend->windowSetFrame(backend, &window, after);
+    backend->windowRelease(backend, &window);
+    if (!moved) {
+        LOG_WARN("Window refused to move");
+        return false;
+    }
+
+    // Keep the cursor on the same spot of the window, so the window can be
+    // sent on with another press
+    if (options->pick == WINDOW_UNDER_CURSOR && topoRectContains(before, cursor)) {
+        TopoPoint p = {
+            after.x + (cursor.x - before.x) * after.width / before.width,
+            after.y + (cursor.y - before.y) * after.height / before.height,
+        };
+        backend->cursorSet(backend, p);
+    }
+
+    NotifyEvent event = {
+        .kind = NOTIFY_WINDOW_DRAGGED,
+        .fromX = before.x, .fromY = before.y,
+        .x = after.x, .y = after.y,
+    };
+    backend->notify(backend, &event);
+    if (result) *result = (MoveResult){ before, after, from, to };
+    return true;
+}
+
+static void *moverMain(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&gLock);
+    for (;;) {
+        while (gRunning && !gHavePending) pthread_cond_wait(&gWake, &gLock);
+        if (!gRunning) break;
+        MoveJob job = gPending;
+        gHavePending = false;
+        pthread_mutex_unlock(&gLock);
+
+        bool done;
+        if (job.evacuate) {
+            EvacuateReport report;
+            done = evacuateRun(gBackend, gOptions.scale, job.direction, job.cursor, &report);
+            if (done) atomic_fetch_add(&gEvacuations, 1);
+        } else {
+            done = moverMoveWindow(gBackend, &gOptions, job.direction, job.cursor, NULL);
+        }
+        if (done) {
+            atomic_store(&gLastNs, statsNowNs() - job.requestedNs);
+            atomic_fetch_add(&gCompleted, 1);
+        } else {
+            atomic_fetch_add(&gFailed, 1);
+        }
+
+        pthread_mutex_lock(&gLock);
+        // Cleared under the lock so it cannot race a concurrent moverRequest()
+        if (!gHavePending) atomic_store(&gBusy, false);
+    }
+    pthread_mutex_unlock(&gLock);
+    return NULL;
+}
+
+bool moverStart(Backend *backend, const MoveOptions *options) {
+    pthread_mutex_lock(&gLock);
+    if (gRunning) {
+        pthread_mutex_unlock(&gLock);
+        return false;
+    }
+    gBackend = backend;
+    gOptions = *options;
+    gHavePending = false;
+    gRunning = true;
+    if (pthread_create(&gThread, NULL, moverMain, NULL) != 0) {
+        gRunning = false;
+        pthread_mutex_unlock(&gLock);
+        LOG_ERROR("mover: failed to start window mover thread");
+        return false;
+    }
+    pthread_mutex_unlock(&gLock);
+    return true;
+}
+
+void moverStop(void) {
+    pthread_mutex_lock(&gLock);
+    if (!gRunning) {
+        pthread_mutex_unlock(&gLock);
+        return;
+    }
+    gRunning = false;
+    pthread_cond_signal(&gWake);
+    pthread_mutex_unlock(&gLock);
+    pthread_join(gThread, NULL);
+    atomic_store(&gBusy, false);
+}
+
+static bool request(TopoDirection direction, TopoPoint cursor, bool evacuate) {
+    pthread_mutex_lock(&gLock);
+    bool running = gRunning;
+    if (running) {
+        if (gHavePending) atomic_fetch_add(&gSuperseded, 1);
+        gPending = (MoveJob){ direction, cursor, statsNowNs(), evacuate };
+        gHavePending = true;
+        atomic_store(&gBusy, true);
+        atomic_fetch_add(&gRequested, 1);
+        pthread_cond_signal(&gWake);
+    }
+    pthread_mutex_unlock(&gLock);
+    return running;
+}
+
+bool moverRequest(TopoDirection direction, TopoPoint cursor) {
+    return request(direction, cursor, false);
+}
+
+bool moverRequestEvacuate(TopoDirection direction, TopoPoint cursor) {
+    return request(direction, cursor, true);
+}
+
+bool moverBusy(void) {
+    return atomic_load(&gBusy);
+}
+
+MoveStats moverGetStats(void) {
+    MoveStats stats = {
+        .requested = atomic_load(&gRequested),
+        .completed = atomic_load(&gCompleted),
+        .failed = atomic_load(&gFailed),
+        .superseded = atomic_load(&gSuperseded),
+        .evacuations = atomic_load(&gEvacuations),
+        .lastNs = atomic_load(&gLastNs),
+    };
+    return stats;
+}
@@ -0,0 +1,60 @@
+#ifndef MOVER_H
+#define MOVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "backend.h"
+#include "topology.h"
+
+// Window mover: relocates a window to another display by setting its frame
+// directly (the accessibility API on macOS) instead of dragging its title
+// bar with synthetic mouse events.
+//
+// moverRequest() hands the move to a dedicated thread and returns at once:
+// finding and moving a window are round trips to the window's application,
+// which can stall. A request that has not started yet is replaced by a
+// newer one.
+
+typedef struct {
+    WindowPick pick;        // the window under the cursor or the focused one
+    bool       scale;       // resize in proportion to the target display
+} MoveOptions;
+
+#define MOVE_DEFAULT_OPTIONS { .pick = WINDOW_UNDER_CURSOR, .scale = false }
+
+typedef struct {
+    TopoRect from, to;      // window frame before and after
+    int      fromDisplay;   // topology display indices
+    int      toDisplay;
+} MoveResult;
+
+typedef struct {
+    uint64_t requested;
+    uint64_t completed;
+    uint64_t failed;        // no window, no display that way, or the move was refused
+    uint64_t superseded;    // replaced by a newer request before starting
+    uint64_t evacuations;   // completed requests that were display evacuations
+    uint64_t lastNs;        // request to frame(s) applied, most recent move
+} MoveStats;
+
+bool moverStart(Backend *backend, const MoveOptions *options);
+void moverStop(void);
+
+// Move a window one display in `direction`; `cursor` is the cursor position
+// when the hotkey was pressed. Returns false if the mover is not running.
+bool moverRequest(TopoDirection direction, TopoPoint cursor);
+// Move every window on the display under `cursor` one display in
+// `direction` (evacuate.h). Queued like moverRequest().
+bool moverRequestEvacuate(TopoDirection direction, TopoPoint cursor);
+bool moverBusy(void);
+
+MoveStats moverGetStats(void);
+
+// The move itself, on the calling thread: find the window, map its frame
+// onto the usable area of the target display and apply it. With
+// WINDOW_UNDER_CURSOR the cursor moves along with the window.
+bool moverMoveWindow(Backend *backend, const MoveOptions *options, TopoDirection direction,
+                     TopoPoint cursor, MoveResult *result);
+
+#endif // MOVER_H
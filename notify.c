@@ -0,0 +1,370 @@
+#include "notify.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <spawn.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log.h"
+
+#ifdef __APPLE__
+#include <CoreFoundation/CoreFoundation.h>
+#include <objc/message.h>
+#include <objc/runtime.h>
+#endif
+
+extern char **environ;
+
+#define NOTIFY_TITLE       "QuickMonitorSwitcher"
+#define NOTIFY_QUEUE_SIZE  64   // must be a power of two
+
+// Bounded multi-producer / single-consumer queue (per-cell sequence numbers,
+// after D. Vyukov). Producers never block; a full queue drops the message.
+typedef struct {
+    _Atomic size_t sequence;
+    NotifyEvent event;
+} NotifyCell;
+
+static NotifyCell      gCells[NOTIFY_QUEUE_SIZE];
+static _Atomic size_t  gEnqueuePos;
+static size_t          gDequeuePos;           // worker thread only
+
+static _Atomic bool     gRunning;
+static _Atomic uint32_t gPosting;             // notifyPost() calls past the gRunning check
+static _Atomic bool     gDraining;            // stopped, and no post in progress: the worker exits when empty
+static _Atomic bool     gWakePending;
+static int              gWakePipe[2] = { -1, -1 };
+static pthread_t        gWorker;
+static NotifySink       gSink;
+static NotifyOptions    gOptions;
+
+static _Atomic uint64_t gPosted;
+static _Atomic uint64_t gDropped;
+static _Atomic uint64_t gCoalesced;
+static _Atomic uint64_t gDelivered;
+
+static uint64_t monotonicMs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000u + (uint64_t)ts.tv_nsec / 1000000u;
+}
+
+static bool queuePush(const NotifyEvent *event) {
+    size_t pos = atomic_load_explicit(&gEnqueuePos, memory_order_relaxed);
+    for (;;) {
+        NotifyCell *cell = &gCells[pos & (NOTIFY_QUEUE_SIZE - 1)];
+        size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&gEnqueuePos, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                cell->event = *event;
+                atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            return false; // full
+        } else {
+            pos = atomic_load_explicit(&gEnqueuePos, memory_order_relaxed);
+        }
+    }
+}
+
+static bool queuePop(NotifyEvent *event) {
+    NotifyCell *cell = &gCells[gDequeuePos & (NOTIFY_QUEUE_SIZE - 1)];
+    size_t seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(gDequeuePos + 1) < 0) return false; // empty
+    *event = cell->event;
+    atomic_store_explicit(&cell->sequence, gDequeuePos + NOTIFY_QUEUE_SIZE, memory_order_release);
+    gDequeuePos++;
+    return true;
+}
+
+static void formatEvent(const NotifyEvent *event, char *buf, size_t size) {
+    switch (event->kind) {
+        case NOTIFY_WINDOW_DRAGGED:
+            snprintf(buf, size, "Attempted to drag window from (%.0f,%.0f) to (%.0f,%.0f)",
+                     event->fromX, event->fromY, event->x, event->y);
+            break;
+        case NOTIFY_DISPLAY_EVACUATED:
+            if (event->failed) {
+                snprintf(buf, size, "Moved %u windows to display %u (%u could not be moved)",
+                         event->moved, event->display, event->failed);
+            } else {
+                snprintf(buf, size, "Moved %u windows to display %u", event->moved, event->display);
+            }
+            break;
+        case NOTIFY_CURSOR_MOVED:
+        default:
+            snprintf(buf, size, "Cursor at X: %.0f, Y: %.0f", event->x, event->y);
+            break;
+    }
+}
+
+// Drain everything queued so far, keeping only the newest message per kind.
+static int drainLatest(NotifyEvent latest[NOTIFY_KIND_COUNT], bool have[NOTIFY_KIND_COUNT]) {
+    NotifyEvent event;
+    int drained = 0;
+    while (queuePop(&event)) {
+        if (event.kind >= NOTIFY_KIND_COUNT) continue;
+        if (have[event.kind]) atomic_fetch_add_explicit(&gCoalesced, 1, memory_order_relaxed);
+        latest[event.kind] = event;
+        have[event.kind] = true;
+        drained++;
+    }
+    return drained;
+}
+
+static void *workerMain(void *arg) {
+    (void)arg;
+    uint64_t lastDelivery = 0;
+    NotifyEvent latest[NOTIFY_KIND_COUNT];
+    bool have[NOTIFY_KIND_COUNT] = { false };
+
+    for (;;) {
+        bool running = atomic_load(&gRunning);
+        bool draining = atomic_load(&gDraining);
+        if (drainLatest(latest, have) == 0) {
+            if (draining) break;
+            // Clear the wake flag, then re-check so a message pushed between
+            // the two drains is not left waiting for the next write.
+            atomic_store(&gWakePending, false);
+            atomic_thread_fence(memory_order_seq_cst);
+            if (drainLatest(latest, have) == 0) {
+                char drain[16];
+                ssize_t n = read(gWakePipe[0], drain, sizeof(drain));
+                if (n < 0 && errno != EINTR) break;
+                continue;
+            }
+        }
+
+        // Rate limit: wait out the interval, then pick up anything newer.
+        if (running && gOptions.minIntervalMs > 0 && lastDelivery != 0) {
+            uint64_t now = monotonicMs();
+            uint64_t due = lastDelivery + gOptions.minIntervalMs;
+            if (now < due) {
+                struct timespec ts = { (time_t)((due - now) / 1000), (long)((due - now) % 1000) * 1000000L };
+                nanosleep(&ts, NULL);
+                drainLatest(latest, have);
+            }
+        }
+
+        for (int kind = 0; kind < NOTIFY_KIND_COUNT; kind++) {
+            if (!have[kind]) continue;
+            char message[160];
+            formatEvent(&latest[kind], message, sizeof(message));
+            if (gSink.deliver) gSink.deliver(&gSink, NOTIFY_TITLE, message);
+            atomic_fetch_add_explicit(&gDelivered, 1, memory_order_relaxed);
+            have[kind] = false;
+        }
+        lastDelivery = monotonicMs();
+    }
+    return NULL;
+}
+
+bool notifyStart(const NotifySink *sink, const NotifyOptions *options) {
+    if (atomic_load(&gRunning)) return false;
+    for (size_t i = 0; i < NOTIFY_QUEUE_SIZE; i++) {
+        atomic_store_explicit(&gCells[i].sequence, i, memory_order_relaxed);
+    }
+    atomic_store(&gEnqueuePos, 0);
+    gDequeuePos = 0;
+    atomic_store(&gDraining, false);
+    gSink = *sink;
+    gOptions = options ? *options : (NotifyOptions){ 0 };
+
+    if (pipe(gWakePipe) != 0) {
+        LOG_ERROR("notify: failed to create wake pipe: %s", strerror(errno));
+        return false;
+    }
+    fcntl(gWakePipe[1], F_SETFL, fcntl(gWakePipe[1], F_GETFL) | O_NONBLOCK);
+
+    atomic_store(&gRunning, true);
+    if (pthread_create(&gWorker, NULL, workerMain, NULL) != 0) {
+        LOG_ERROR("notify: failed to start worker thread");
+        atomic_store(&gRunning, false);
+        close(gWakePipe[0]);
+        close(gWakePipe[1]);
+        gWakePipe[0] = gWakePipe[1] = -1;
+        return false;
+    }
+    return true;
+}
+
+bool notifyPost(const NotifyEvent *event) {
+    // Announce the post before checking gRunning; notifyStop() clears
+    // gRunning before waiting for gPosting to reach zero, so either this
+    // post sees it cleared or the stop waits for it (both seq_cst) and the
+    // queue and wake pipe stay valid until it is done.
+    atomic_fetch_add(&gPosting, 1);
+    if (!atomic_load(&gRunning)) {
+        atomic_fetch_sub(&gPosting, 1);
+        return false;
+    }
+    if (!queuePush(event)) {
+        atomic_fetch_add_explicit(&gDropped, 1, memory_order_relaxed);
+        atomic_fetch_sub_explicit(&gPosting, 1, memory_order_release);
+        return false;
+    }
+    atomic_fetch_add_explicit(&gPosted, 1, memory_order_relaxed);
+    // Only the first producer after the worker went idle pays for the write.
+    atomic_thread_fence(memory_order_seq_cst);
+    if (!atomic_exchange(&gWakePending, true)) {
+        char one = 1;
+        ssize_t n = write(gWakePipe[1], &one, 1);
+        (void)n;
+    }
+    atomic_fetch_sub_explicit(&gPosting, 1, memory_order_release);
+    return true;
+}
+
+void notifyStop(void) {
+    if (!atomic_exchange(&gRunning, false)) return;
+    // Posts already past the check finish first: their messages are then
+    // in the queue for the final drain, and none writes to a closed pipe
+    while (atomic_load_explicit(&gPosting, memory_order_acquire)) sched_yield();
+    atomic_store(&gDraining, true);
+    char one = 1;
+    ssize_t n = write(gWakePipe[1], &one, 1);
+    (void)n;
+    pthread_join(gWorker, NULL);
+    close(gWakePipe[0]);
+    close(gWakePipe[1]);
+    gWakePipe[0] = gWakePipe[1] = -1;
+    if (gSink.close) gSink.close(&gSink);
+    memset(&gSink, 0, sizeof(gSink));
+}
+
+NotifyStats notifyGetStats(void) {
+    NotifyStats stats = {
+        .posted    = atomic_load_explicit(&gPosted, memory_order_relaxed),
+        .dropped   = atomic_load_explicit(&gDropped, memory_order_relaxed),
+        .coalesced = atomic_load_explicit(&gCoalesced, memory_order_relaxed),
+        .delivered = atomic_load_explicit(&gDelivered, memory_order_relaxed),
+    };
+    return stats;
+}
+
+// --- Sinks ------------------------------------------------------------------
+
+bool notifySinkNone(NotifySink *sink) {
+    *sink = (NotifySink){ .name = "none" };
+    return true;
+}
+
+// Spawn osascript directly (no /bin/sh) and wait for it on the worker thread.
+static void osascriptDeliver(NotifySink *sink, const char *title, const char *message) {
+    (void)sink;
+    char script[320];
+    snprintf(script, sizeof(script), "display notification \"%s\" with title \"%s\"", message, title);
+    char *argv[] = { "osascript", "-e", script, NULL };
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid;
+    if (posix_spawn(&pid, "/usr/bin/osascript", &actions, NULL, argv, environ) == 0) {
+        int status;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {}
+    }
+    posix_spawn_file_actions_destroy(&actions);
+}
+
+bool notifySinkOsascript(NotifySink *sink) {
+    if (access("/usr/bin/osascript", X_OK) != 0) return false;
+    *sink = (NotifySink){ .name = "osascript", .deliver = osascriptDeliver };
+    return true;
+}
+
+static void fileDeliver(NotifySink *sink, const char *title, const char *message) {
+    FILE *f = sink->context;
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    fprintf(f, "%lld.%03ld %s: %s\n", (long long)ts.tv_sec, ts.tv_nsec / 1000000L, title, message);
+    fflush(f);
+}
+
+static void fileClose(NotifySink *sink) {
+    FILE *f = sink->context;
+    if (f && f != stdout && f != stderr) fclose(f);
+    sink->context = NULL;
+}
+
+bool notifySinkFile(NotifySink *sink, const char *path) {
+    FILE *f;
+    if (!path || !*path || strcmp(path, "-") == 0) {
+        f = stdout;
+    } else if (!(f = fopen(path, "a"))) {
+        LOG_ERROR("notify: cannot open %s: %s", path, strerror(errno));
+        return false;
+    }
+    *sink = (NotifySink){ .name = "file", .deliver = fileDeliver, .close = fileClose, .context = f };
+    return true;
+}
+
+#ifdef __APPLE__
+// NSUserNotificationCenter through the Objective-C runtime, so the rest of
+// the program can stay plain C. The center is nil when the process has no
+// bundle identifier (plain command-line build), in which case we fall back.
+static id objcSend(id target, const char *selector) {
+    return ((id (*)(id, SEL))objc_msgSend)(target, sel_registerName(selector));
+}
+
+static void objcSendArg(id target, const char *selector, id arg) {
+    ((void (*)(id, SEL, id))objc_msgSend)(target, sel_registerName(selector), arg);
+}
+
+static void nativeDeliver(NotifySink *sink, const char *title, const char *message) {
+    id center = sink->context;
+    id pool = objcSend(objcSend((id)objc_getClass("NSAutoreleasePool"), "alloc"), "init");
+    id note = objcSend(objcSend((id)objc_getClass("NSUserNotification"), "alloc"), "init");
+    CFStringRef cfTitle = CFStringCreateWithCString(NULL, title, kCFStringEncodingUTF8);
+    CFStringRef cfText = CFStringCreateWithCString(NULL, message, kCFStringEncodingUTF8);
+    if (note && cfTitle && cfText) {
+        objcSendArg(note, "setTitle:", (id)cfTitle);
+        objcSendArg(note, "setInformativeText:", (id)cfText);
+        objcSendArg(center, "deliverNotification:", note);
+    }
+    if (cfTitle) CFRelease(cfTitle);
+    if (cfText) CFRelease(cfText);
+    if (note) objcSend(note, "release");
+    objcSend(pool, "drain");
+}
+
+bool notifySinkNative(NotifySink *sink) {
+    Class centerClass = objc_getClass("NSUserNotificationCenter");
+    if (!centerClass || !CFBundleGetIdentifier(CFBundleGetMainBundle())) return false;
+    id center = objcSend((id)centerClass, "defaultUserNotificationCenter");
+    if (!center) return false;
+    *sink = (NotifySink){ .name = "native", .deliver = nativeDeliver, .context = center };
+    return true;
+}
+#else
+bool notifySinkNative(NotifySink *sink) {
+    (void)sink;
+    return false;
+}
+#endif
+
+bool notifySinkFromName(NotifySink *sink, const char *name, const char *filePath) {
+    if (!name || !*name || strcasecmp(name, "native") == 0) {
+        if (notifySinkNative(sink)) return true;
+        if (notifySinkOsascript(sink)) return true;
+        return notifySinkNone(sink);
+    }
+    if (strcasecmp(name, "osascript") == 0) return notifySinkOsascript(sink);
+    if (strcasecmp(name, "file") == 0) return notifySinkFile(sink, filePath);
+    if (strcasecmp(name, "none") == 0 || strcasecmp(name, "off") == 0) return notifySinkNone(sink);
+    LOG_ERROR("notify: unknown notification sink '%s'", name);
+    return false;
+}
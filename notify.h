@@ -0,0 +1,74 @@
+#ifndef NOTIFY_H
+#define NOTIFY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Asynchronous notification subsystem.
+//
+// The event tap thread calls notifyPost(), which only pushes a small record
+// into a bounded lock-free queue and returns. A single background worker
+// drains the queue, coalesces bursts so only the latest message of each kind
+// is shown, applies the configured rate limit and hands the text to a sink.
+
+typedef enum {
+    NOTIFY_CURSOR_MOVED = 0,   // (x, y) is the new cursor position
+    NOTIFY_WINDOW_DRAGGED,     // (fromX, fromY) -> (x, y)
+    NOTIFY_DISPLAY_EVACUATED,  // `moved` windows went to display number `display`
+    NOTIFY_KIND_COUNT
+} NotifyKind;
+
+typedef struct {
+    NotifyKind kind;
+    double fromX, fromY;
+    double x, y;
+    uint32_t display, moved, failed;
+} NotifyEvent;
+
+// A sink delivers one formatted message. deliver() always runs on the worker
+// thread, so it may block (fork a process, write a file, ...).
+typedef struct NotifySink {
+    const char *name;
+    void (*deliver)(struct NotifySink *sink, const char *title, const char *message);
+    void (*close)(struct NotifySink *sink);
+    void *context;
+} NotifySink;
+
+typedef struct {
+    uint32_t minIntervalMs;    // 0 = no rate limit
+} NotifyOptions;
+
+typedef struct {
+    uint64_t posted;           // accepted by notifyPost()
+    uint64_t dropped;          // rejected because the queue was full
+    uint64_t coalesced;        // accepted but superseded by a newer message
+    uint64_t delivered;        // handed to the sink
+} NotifyStats;
+
+// Sink constructors. They return false if the sink cannot be used on this
+// system (e.g. the native sink outside an app bundle); *sink is untouched then.
+bool notifySinkNone(NotifySink *sink);
+bool notifySinkOsascript(NotifySink *sink);
+bool notifySinkFile(NotifySink *sink, const char *path);
+bool notifySinkNative(NotifySink *sink);
+
+// Build a sink from its config name ("native", "osascript", "file", "none").
+// "native" falls back to "osascript" when unavailable.
+bool notifySinkFromName(NotifySink *sink, const char *name, const char *filePath);
+
+// Start the worker. Takes ownership of the sink. Returns false on failure,
+// in which case notifyPost() stays a no-op.
+bool notifyStart(const NotifySink *sink, const NotifyOptions *options);
+
+// Lock-free, never blocks. Safe to call from any thread, also while
+// notifyStop() runs. Returns false if the message was dropped (subsystem
+// disabled or queue full).
+bool notifyPost(const NotifyEvent *event);
+
+// Wait for posts in progress, flush pending messages, stop the worker and
+// close the sink.
+void notifyStop(void);
+
+NotifyStats notifyGetStats(void);
+
+#endif // NOTIFY_H
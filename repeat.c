@@ -0,0 +1,92 @@
+#include "repeat.h"
+
+#include <string.h>
+
+static bool sameAction(HotkeyAction a, HotkeyAction b) {
+    return a.type == b.type && a.arg == b.arg;
+}
+
+static uint32_t capHops(const RepeatOptions *options, uint32_t hops) {
+    return options->maxHops && hops > options->maxHops ? options->maxHops : hops;
+}
+
+void repeatInit(RepeatState *state, const RepeatOptions *options) {
+    memset(state, 0, sizeof(*state));
+    state->options = *options;
+}
+
+RepeatDecision repeatPress(RepeatState *state, HotkeyAction action, bool autorepeat, uint64_t now) {
+    const RepeatOptions *options = &state->options;
+    RepeatDecision decision = { 0 };
+    uint32_t weight = 1;
+
+    if (autorepeat) {
+        switch (options->policy) {
+            case REPEAT_IGNORE:
+                decision.dropped = true;
+                return decision;
+            case REPEAT_THROTTLE:
+                if (options->maxRate && now - state->lastRepeat < 1000000000ull / options->maxRate) {
+                    decision.dropped = true;
+                    return decision;
+                }
+                break;
+            case REPEAT_ACCELERATE:
+                state->repeats++;
+                if (options->accelEvery) weight = capHops(options, 1 + state->repeats / options->accelEvery);
+                break;
+        }
+    } else {
+        state->repeats = 0;
+    }
+    state->lastRepeat = now;
+
+    // Inside the window of the same action: defer
+    if (state->windowEnd && now < state->windowEnd && sameAction(state->action, action)) {
+        uint32_t before = state->pending;
+        state->pending = capHops(options, state->pending + weight);
+        decision.coalesced = state->pending - before;
+        return decision;
+    }
+
+    // A different action, or the timer is late: settle the old burst first
+    if (state->pending) {
+        decision.flushAction = state->action;
+        decision.flushHops = state->pending;
+        state->pending = 0;
+    }
+
+    // Leading edge of a new burst
+    decision.hops = weight;
+    state->action = action;
+    if (options->windowMs) {
+        state->windowEnd = now + (uint64_t)options->windowMs * 1000000ull;
+        decision.timerAt = state->windowEnd;
+    } else {
+        state->windowEnd = 0;
+    }
+    return decision;
+}
+
+uint32_t repeatFlush(RepeatState *state, uint64_t now, HotkeyAction *action, uint64_t *timerAt) {
+    *timerAt = 0;
+    if (!state->pending) {
+        state->windowEnd = 0;
+        return 0;
+    }
+    uint32_t hops = state->pending;
+    state->pending = 0;
+    *action = state->action;
+    // Keep coalescing while the key is still being hammered
+    state->windowEnd = now + (uint64_t)state->options.windowMs * 1000000ull;
+    *timerAt = state->windowEnd;
+    return hops;
+}
+
+uint32_t repeatCancel(RepeatState *state, HotkeyAction *action) {
+    uint32_t hops = state->pending;
+    *action = state->action;
+    state->pending = 0;
+    state->windowEnd = 0;
+    return hops;
+}
@@ -0,0 +1,65 @@
+#ifndef REPEAT_H
+#define REPEAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hotkeys.h"
+
+// Coalescing of rapid and auto-repeated switch hotkeys.
+//
+// The first press of a burst runs at once. Further presses of the same
+// action within `windowMs` only add hops; when the window closes they run as
+// a single N-hop jump and a new window opens, so holding or hammering a key
+// costs one cursor move per window instead of one per event. Auto-repeat
+// events are first filtered by the policy. Pure logic: the caller supplies
+// the time and runs the timer.
+
+typedef enum {
+    REPEAT_THROTTLE = 0,   // let at most maxRate repeats per second through (0 = all)
+    REPEAT_IGNORE,         // swallow auto-repeat events
+    REPEAT_ACCELERATE,     // every accelEvery repeats, each one counts one hop more
+} RepeatPolicy;
+
+typedef struct {
+    uint32_t     windowMs;     // 0 = no coalescing
+    RepeatPolicy policy;
+    uint32_t     maxRate;      // REPEAT_THROTTLE
+    uint32_t     accelEvery;   // REPEAT_ACCELERATE
+    uint32_t     maxHops;      // cap for one jump (0 = no cap)
+} RepeatOptions;
+
+#define REPEAT_DEFAULT_OPTIONS { .windowMs = 40, .policy = REPEAT_THROTTLE, .maxRate = 10, .accelEvery = 5, .maxHops = 64 }
+
+typedef struct {
+    RepeatOptions options;
+    HotkeyAction  action;       // action of the burst in progress
+    uint32_t      pending;      // hops waiting for the window to close
+    uint64_t      windowEnd;    // 0 = no burst in progress
+    uint64_t      lastRepeat;   // last press or repeat let through (throttle)
+    uint32_t      repeats;      // auto-repeats since the key went down (accelerate)
+} RepeatState;
+
+typedef struct {
+    HotkeyAction flushAction;   // run first: leftover hops of a previous burst
+    uint32_t     flushHops;
+    uint32_t     hops;          // run the pressed action now with this many hops
+    uint32_t     coalesced;     // hops deferred to the window's end
+    bool         dropped;       // auto-repeat swallowed by the policy
+    uint64_t     timerAt;       // (re)arm the flush timer for this time, 0 = leave it
+} RepeatDecision;
+
+void repeatInit(RepeatState *state, const RepeatOptions *options);
+
+// One press of a coalescable action at time `now` (ns).
+RepeatDecision repeatPress(RepeatState *state, HotkeyAction action, bool autorepeat, uint64_t now);
+
+// The flush timer fired. Returns the hops to run for *action (0 = the burst
+// is over) and sets *timerAt when the timer must be armed again.
+uint32_t repeatFlush(RepeatState *state, uint64_t now, HotkeyAction *action, uint64_t *timerAt);
+
+// End the burst now (another action is about to run). Returns the hops
+// still pending for *action, which the caller should run first.
+uint32_t repeatCancel(RepeatState *state, HotkeyAction *action);
+
+#endif // REPEAT_H
@@ -0,0 +1,138 @@
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "drag.h"
+#include "switcher.h"
+
+// Fast drags: replay only needs their outcome, not their pacing
+static const DragOptions kReplayDrag = { .frameRate = 1000, .moveMs = 0, .settleMs = 0, .minSettleMs = 0, .adaptive = false };
+
+bool replaySameOutcome(const TraceRecord *original, const TraceRecord *replayed) {
+    return original->kind == replayed->kind && original->action == replayed->action &&
+           original->arg == replayed->arg && original->hops == replayed->hops &&
+           original->outcome == replayed->outcome && original->toDisplay == replayed->toDisplay;
+}
+
+static bool isInput(const TraceRecord *record) {
+    return record->kind == TRACE_KEY || record->kind == TRACE_CONTROL;
+}
+
+// One exact-modifier binding per distinct recorded hotkey
+static HotkeyTable *bindingsFromTrace(const TraceFile *file) {
+    HotkeyBinding *bindings = calloc(file->recordCount ? file->recordCount : 1, sizeof(HotkeyBinding));
+    if (!bindings) return NULL;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < file->recordCount; i++) {
+        const TraceRecord *r = &file->records[i];
+        if (r->kind != TRACE_KEY) continue;
+        uint64_t required = r->flags & MOD_ALL;
+        bool seen = false;
+        for (uint32_t j = 0; j < count && !seen; j++) {
+            seen = bindings[j].keyCode == r->keyCode && bindings[j].required == required;
+        }
+        if (seen) continue;
+        bindings[count++] = (HotkeyBinding){
+            .keyCode = r->keyCode,
+            .required = required,
+            .forbidden = MOD_ALL & ~required,
+            .action = { (HotkeyActionType)r->action, r->arg },
+        };
+    }
+    HotkeyTable *table = hotkeyTableCreate(bindings, count);
+    free(bindings);
+    return table;
+}
+
+static void setCursor(SimBackend *sim, const TraceRecord *record) {
+    if (record->fromDisplay < 0) return;
+    pthread_mutex_lock(&sim->lock);
+    sim->cursor = (TopoPoint){ record->fromX, record->fromY };
+    pthread_mutex_unlock(&sim->lock);
+}
+
+static void advanceTo(SimBackend *sim, uint64_t timeNs) {
+    if (timeNs > sim->clockNs) simBackendAdvance(sim, timeNs - sim->clockNs);
+}
+
+bool replayTrace(const TraceFile *file, SimBackend *sim, ReplayResult *result, char *error, size_t errorSize) {
+    *result = (ReplayResult){ .firstMismatch = -1 };
+    if (file->recordCount == 0) {
+        snprintf(error, errorSize, "trace holds no records");
+        return false;
+    }
+    if (!simBackendSetDisplays(sim, file->displays, file->displayCount)) {
+        snprintf(error, errorSize, "trace holds no usable display list");
+        return false;
+    }
+    HotkeyTable *table = bindingsFromTrace(file);
+    if (!table) {
+        snprintf(error, errorSize, "cannot rebuild hotkey bindings");
+        return false;
+    }
+    sim->virtualClock = true;
+    sim->clockNs = file->records[0].timeNs;
+    switcherInit(&sim->backend);
+    switcherSetCursorMapping(&file->mapping);
+    switcherRebuildTopology();
+    switcherSetRepeatOptions(&file->repeat);
+    switcherSetJumpAnchor((JumpAnchor)file->jumpAnchor);
+    switcherPublishHotkeys(table);
+    bool ownDragEngine = dragEngineStart(switcherDragPoster(), &kReplayDrag);
+
+    uint64_t start = traceCount();
+    for (uint32_t i = 0; i < file->recordCount; i++) {
+        const TraceRecord *r = &file->records[i];
+        if (r->kind == TRACE_FLUSH_TIMER) {
+            setCursor(sim, r);
+            advanceTo(sim, r->timeNs);
+            continue;
+        }
+        if (!isInput(r)) continue;
+
+        // Switches flushed ahead of this input saw the cursor first
+        uint32_t first = i;
+        while (first > 0 && file->records[first - 1].kind == TRACE_FLUSH_INLINE) first--;
+        setCursor(sim, &file->records[first]);
+        advanceTo(sim, r->timeNs);
+        if (r->kind == TRACE_KEY) {
+            switcherHandleKey(r->keyCode, r->flags, r->timeNs, r->autorepeat);
+        } else {
+            switcherRun((HotkeyAction){ (HotkeyActionType)r->action, r->arg }, r->hops);
+        }
+        while (dragInProgress()) usleep(100);
+        result->inputs++;
+    }
+    // Let a burst still open at the end of the recording finish
+    if (sim->timerFn) advanceTo(sim, sim->timerAt);
+
+    if (ownDragEngine) dragEngineStop();
+    switcherPublishHotkeys(NULL);
+
+    TraceRecord *all = malloc(TRACE_CAPACITY * sizeof(TraceRecord));
+    if (!all) {
+        snprintf(error, errorSize, "out of memory");
+        return false;
+    }
+    uint32_t total = traceSnapshot(all, TRACE_CAPACITY);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < total; i++) {
+        if ((uint32_t)(all[i].sequence - (uint32_t)start) < total) all[count++] = all[i];
+    }
+    result->records = all;
+    result->recordCount = count;
+
+    uint32_t compared = count < file->recordCount ? count : file->recordCount;
+    for (uint32_t i = 0; i < compared; i++) {
+        if (!replaySameOutcome(&file->records[i], &all[i])) {
+            if (result->firstMismatch < 0) result->firstMismatch = (int32_t)i;
+            result->mismatches++;
+        }
+    }
+    result->compared = compared;
+    result->mismatches += (count > file->recordCount ? count : file->recordCount) - compared;
+    if (result->firstMismatch < 0 && result->mismatches) result->firstMismatch = (int32_t)compared;
+    return true;
+}
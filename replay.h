@@ -0,0 +1,37 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "backend_sim.h"
+#include "trace.h"
+
+// Deterministic replay of a trace dump on the simulated backend.
+//
+// Rebuilds the recorded display layout, repeat settings and (from the
+// recorded keys) the hotkey bindings, then feeds the recorded inputs -
+// hotkeys and control commands - through the real dispatch code on a
+// virtual clock that follows the recorded timestamps, so repeat timers fire
+// exactly as they did. The cursor is put back where the recording saw it
+// before each input, since plain mouse movement is not traced. Every record
+// the replay produces is compared with the original.
+
+typedef struct {
+    uint32_t     inputs;          // records injected
+    uint32_t     compared;        // records compared
+    uint32_t     mismatches;
+    int32_t      firstMismatch;   // index into the original records, -1 = none
+    TraceRecord *records;         // the replay's own trace (free())
+    uint32_t     recordCount;
+} ReplayResult;
+
+// Replay `file` on `sim` (initialized, otherwise unused). Uses the process-
+// wide switcher; nothing else may drive it meanwhile.
+bool replayTrace(const TraceFile *file, SimBackend *sim, ReplayResult *result, char *error, size_t errorSize);
+
+// True if the replayed record matches the original in everything that
+// does not depend on timing
+bool replaySameOutcome(const TraceRecord *original, const TraceRecord *replayed);
+
+#endif // REPLAY_H
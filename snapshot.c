@@ -0,0 +1,34 @@
+#include "snapshot.h"
+
+#include <time.h>
+
+void *snapshotAcquire(SnapshotSlot *slot, unsigned *token) {
+    unsigned index = atomic_load(&slot->epoch) & 1u;
+    atomic_fetch_add(&slot->readers[index], 1);
+    *token = index;
+    return atomic_load(&slot->current);
+}
+
+void snapshotRelease(SnapshotSlot *slot, unsigned token) {
+    atomic_fetch_sub_explicit(&slot->readers[token], 1, memory_order_release);
+}
+
+static void waitForReaders(SnapshotSlot *slot, unsigned index) {
+    const struct timespec pause = { 0, 50 * 1000 };
+    while (atomic_load_explicit(&slot->readers[index], memory_order_acquire) != 0) {
+        nanosleep(&pause, NULL);
+    }
+}
+
+void *snapshotExchange(SnapshotSlot *slot, void *next) {
+    pthread_mutex_lock(&slot->publishLock);
+    void *previous = atomic_exchange(&slot->current, next);
+    // Flip the epoch twice so readers that sampled either counter before the
+    // swap have drained; new readers land on the other counter meanwhile.
+    for (int phase = 0; phase < 2; phase++) {
+        unsigned old = atomic_fetch_xor(&slot->epoch, 1u) & 1u;
+        waitForReaders(slot, old);
+    }
+    pthread_mutex_unlock(&slot->publishLock);
+    return previous;
+}
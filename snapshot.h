@@ -0,0 +1,33 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+// Single-pointer publication with deferred reclamation.
+//
+// Readers (e.g. the event tap) bracket their use of the current object with
+// snapshotAcquire()/snapshotRelease(): two atomic increments, no locks, no
+// waiting. Publishers swap in a new object with snapshotExchange(), which
+// waits for a grace period (every reader that could still see the old
+// object has released it) and then returns the old pointer, safe to free.
+
+typedef struct {
+    _Atomic(void *)   current;
+    _Atomic unsigned  epoch;
+    _Atomic unsigned  readers[2];
+    pthread_mutex_t   publishLock;   // serializes publishers only
+} SnapshotSlot;
+
+#define SNAPSHOT_SLOT_INIT { NULL, 0, { 0, 0 }, PTHREAD_MUTEX_INITIALIZER }
+
+// Returns the current object (may be NULL). *token must be passed back to
+// snapshotRelease().
+void *snapshotAcquire(SnapshotSlot *slot, unsigned *token);
+void snapshotRelease(SnapshotSlot *slot, unsigned token);
+
+// Publish next and return the previous object once no reader can hold it.
+// Must not be called from inside an acquire/release section.
+void *snapshotExchange(SnapshotSlot *slot, void *next);
+
+#endif // SNAPSHOT_H
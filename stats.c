@@ -0,0 +1,254 @@
+#include "stats.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif
+
+#include "log.h"
+
+static Histogram        gActions[ACTION_COUNT];
+static Histogram        gPhases[PHASE_COUNT];
+static _Atomic uint64_t gCounters[COUNTER_COUNT];
+
+static const char *const kPhaseNames[PHASE_COUNT] = {
+    "dispatch", "display_query", "geometry", "warp", "notify", "config_reload", "tap_callback",
+};
+
+static const char *const kCounterNames[COUNTER_COUNT] = {
+    "consumed", "passed", "dropped", "tap_disabled", "config_reloads", "config_errors",
+    "coalesced", "repeat_dropped", "log_dropped", "sequence_keys", "sequence_abandoned",
+    "tap_reenabled", "tap_overruns", "deferred",
+};
+
+// --- Histogram -------------------------------------------------------------
+
+static unsigned bucketIndex(uint64_t value) {
+    if (value < HISTOGRAM_SUB_COUNT) return (unsigned)value;
+    unsigned exponent = 63u - (unsigned)__builtin_clzll(value);
+    unsigned shift = exponent - HISTOGRAM_SUB_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_COUNT + (unsigned)(value >> shift) - HISTOGRAM_SUB_COUNT;
+}
+
+// Upper bound (exclusive) of the values that land in a bucket
+static uint64_t bucketLimit(unsigned index) {
+    if (index < HISTOGRAM_SUB_COUNT) return index + 1;
+    unsigned shift = index / HISTOGRAM_SUB_COUNT - 1;
+    uint64_t sub = index % HISTOGRAM_SUB_COUNT + HISTOGRAM_SUB_COUNT;
+    return (sub + 1) << shift;
+}
+
+void histogramRecord(Histogram *histogram, uint64_t value) {
+    atomic_fetch_add_explicit(&histogram->buckets[bucketIndex(value)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&histogram->sum, value, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+    while (value > max &&
+           !atomic_compare_exchange_weak_explicit(&histogram->max, &max, value,
+                                                  memory_order_relaxed, memory_order_relaxed)) {}
+}
+
+void histogramReset(Histogram *histogram) {
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) atomic_store(&histogram->buckets[i], 0);
+    atomic_store(&histogram->count, 0);
+    atomic_store(&histogram->sum, 0);
+    atomic_store(&histogram->max, 0);
+}
+
+uint64_t histogramPercentile(const Histogram *histogram, double percentile) {
+    uint64_t count = atomic_load_explicit(&histogram->count, memory_order_relaxed);
+    if (count == 0) return 0;
+    uint64_t rank = (uint64_t)(percentile / 100.0 * (double)count + 0.5);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+        if (seen >= rank) {
+            uint64_t limit = bucketLimit(i);
+            uint64_t max = atomic_load_explicit(&histogram->max, memory_order_relaxed);
+            return limit < max ? limit : max;
+        }
+    }
+    return atomic_load_explicit(&histogram->max, memory_order_relaxed);
+}
+
+// --- Recording -------------------------------------------------------------
+
+#ifdef __APPLE__
+static mach_timebase_info_data_t gTimebase;
+
+static uint64_t machToNs(uint64_t ticks) {
+    if (gTimebase.denom == 0) mach_timebase_info(&gTimebase);
+    if (gTimebase.numer == gTimebase.denom) return ticks;
+    return (uint64_t)((__uint128_t)ticks * gTimebase.numer / gTimebase.denom);
+}
+
+uint64_t statsNowNs(void) {
+    return machToNs(mach_absolute_time());
+}
+
+// CGEventTimestamp is in mach_absolute_time() units (nanoseconds on Intel)
+uint64_t statsEventTimeToNs(uint64_t timestamp) {
+    return machToNs(timestamp);
+}
+#else
+uint64_t statsNowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+uint64_t statsEventTimeToNs(uint64_t timestamp) {
+    return timestamp;
+}
+#endif
+
+void statsRecordAction(HotkeyActionType action, uint64_t ns) {
+    if ((unsigned)action < ACTION_COUNT) histogramRecord(&gActions[action], ns);
+}
+
+void statsRecordPhase(StatsPhase phase, uint64_t ns) {
+    if ((unsigned)phase < PHASE_COUNT) histogramRecord(&gPhases[phase], ns);
+}
+
+void statsCount(StatsCounter counter) {
+    atomic_fetch_add_explicit(&gCounters[counter], 1, memory_order_relaxed);
+}
+
+uint64_t statsCounter(StatsCounter counter) {
+    return atomic_load_explicit(&gCounters[counter], memory_order_relaxed);
+}
+
+const Histogram *statsActionHistogram(HotkeyActionType action) {
+    return (unsigned)action < ACTION_COUNT ? &gActions[action] : NULL;
+}
+
+const Histogram *statsPhaseHistogram(StatsPhase phase) {
+    return (unsigned)phase < PHASE_COUNT ? &gPhases[phase] : NULL;
+}
+
+// --- Export ----------------------------------------------------------------
+
+// snprintf into buf at *used, tracking the would-be length like snprintf
+#define APPEND(...) do { \
+        int n_ = snprintf(buf + (*used < size ? *used : size), *used < size ? size - *used : 0, __VA_ARGS__); \
+        if (n_ > 0) *used += (size_t)n_; \
+    } while (0)
+
+static void appendTextHistogram(char *buf, size_t size, size_t *used, const char *name, const Histogram *h) {
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    if (count == 0) return;
+    APPEND("  %-16s n=%-8llu mean=%-10.0f p50=%-10llu p90=%-10llu p99=%-10llu max=%llu\n", name,
+           (unsigned long long)count, (double)atomic_load(&h->sum) / (double)count,
+           (unsigned long long)histogramPercentile(h, 50), (unsigned long long)histogramPercentile(h, 90),
+           (unsigned long long)histogramPercentile(h, 99), (unsigned long long)atomic_load(&h->max));
+}
+
+size_t statsFormatText(char *buf, size_t size) {
+    size_t usedValue = 0, *used = &usedValue;
+    APPEND("counters:\n");
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        APPEND("  %-16s %llu\n", kCounterNames[c], (unsigned long long)statsCounter((StatsCounter)c));
+    }
+    APPEND("actions (ns, event timestamp to completion):\n");
+    for (int a = 1; a < ACTION_COUNT; a++) {
+        appendTextHistogram(buf, size, used, hotkeyActionName((HotkeyActionType)a), &gActions[a]);
+    }
+    APPEND("phases (ns):\n");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        appendTextHistogram(buf, size, used, kPhaseNames[p], &gPhases[p]);
+    }
+    return usedValue;
+}
+
+static void appendJSONHistogram(char *buf, size_t size, size_t *used, const char *name, const Histogram *h, bool last) {
+    uint64_t count = atomic_load_explicit(&h->count, memory_order_relaxed);
+    APPEND("    \"%s\": {\"count\": %llu, \"mean\": %.0f, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, \"max\": %llu}%s\n",
+           name, (unsigned long long)count, count ? (double)atomic_load(&h->sum) / (double)count : 0.0,
+           (unsigned long long)histogramPercentile(h, 50), (unsigned long long)histogramPercentile(h, 90),
+           (unsigned long long)histogramPercentile(h, 99), (unsigned long long)atomic_load(&h->max),
+           last ? "" : ",");
+}
+
+size_t statsFormatJSON(char *buf, size_t size) {
+    size_t usedValue = 0, *used = &usedValue;
+    APPEND("{\n  \"counters\": {");
+    for (int c = 0; c < COUNTER_COUNT; c++) {
+        APPEND("%s\"%s\": %llu", c ? ", " : "", kCounterNames[c], (unsigned long long)statsCounter((StatsCounter)c));
+    }
+    APPEND("},\n  \"actions_ns\": {\n");
+    for (int a = 1; a < ACTION_COUNT; a++) {
+        appendJSONHistogram(buf, size, used, hotkeyActionName((HotkeyActionType)a), &gActions[a], a == ACTION_COUNT - 1);
+    }
+    APPEND("  },\n  \"phases_ns\": {\n");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        appendJSONHistogram(buf, size, used, kPhaseNames[p], &gPhases[p], p == PHASE_COUNT - 1);
+    }
+    APPEND("  }\n}\n");
+    return usedValue;
+}
+
+bool statsWriteFile(const char *path, bool json) {
+    size_t needed = (json ? statsFormatJSON : statsFormatText)(NULL, 0) + 256; // counters may grow meanwhile
+    char *buf = malloc(needed);
+    if (!buf) return false;
+    size_t length = (json ? statsFormatJSON : statsFormatText)(buf, needed);
+    if (length >= needed) length = needed - 1;
+    FILE *f = fopen(path, "w");
+    if (!f) {
+        LOG_ERROR("stats: cannot write %s: %s", path, strerror(errno));
+        free(buf);
+        return false;
+    }
+    fwrite(buf, 1, length, f);
+    fclose(f);
+    free(buf);
+    return true;
+}
+
+typedef struct {
+    int  signo;
+    bool json;
+    char path[1024];
+} SignalExport;
+
+static SignalExport gExport;
+
+static void *exportMain(void *arg) {
+    (void)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, gExport.signo);
+    for (;;) {
+        int received;
+        if (sigwait(&set, &received) != 0) continue;
+        if (statsWriteFile(gExport.path, gExport.json)) {
+            LOG_INFO("Wrote stats to %s", gExport.path);
+        }
+    }
+    return NULL;
+}
+
+bool statsStartSignalExport(int signo, const char *path, bool json) {
+    gExport.signo = signo;
+    gExport.json = json;
+    strncpy(gExport.path, path, sizeof(gExport.path) - 1);
+
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, signo);
+    if (pthread_sigmask(SIG_BLOCK, &set, NULL) != 0) return false;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, exportMain, NULL) != 0) return false;
+    pthread_detach(thread);
+    return true;
+}
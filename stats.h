@@ -0,0 +1,85 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hotkeys.h"
+
+// Latency histograms and event counters.
+//
+// Fixed-memory log-linear histograms (16 linear sub-buckets per power of
+// two, ~6% relative error) updated with relaxed atomic increments only, so
+// recording from the event tap never takes a lock or allocates. Snapshots
+// can be formatted as text or JSON at any time.
+
+#define HISTOGRAM_SUB_BITS  4
+#define HISTOGRAM_SUB_COUNT (1u << HISTOGRAM_SUB_BITS)
+#define HISTOGRAM_BUCKETS   ((64 - HISTOGRAM_SUB_BITS + 1) * HISTOGRAM_SUB_COUNT)
+
+typedef struct {
+    _Atomic uint64_t count;
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+    _Atomic uint64_t buckets[HISTOGRAM_BUCKETS];
+} Histogram;
+
+void histogramRecord(Histogram *histogram, uint64_t value);
+void histogramReset(Histogram *histogram);
+// Smallest bucket bound below which `percentile` (0..100) of samples fall.
+uint64_t histogramPercentile(const Histogram *histogram, double percentile);
+
+typedef enum {
+    PHASE_DISPATCH = 0,     // hotkey lookup in the tap
+    PHASE_DISPLAY_QUERY,    // cursor position + topology snapshot
+    PHASE_GEOMETRY,         // neighbor resolution + coordinate mapping
+    PHASE_WARP,             // cursor warp / drag hand-off
+    PHASE_NOTIFY,           // queueing the notification
+    PHASE_CONFIG_RELOAD,    // config re-parse + binding swap (watcher thread)
+    PHASE_TAP_CALLBACK,     // whole event tap callback for a hotkey (watchdog.h)
+    PHASE_COUNT
+} StatsPhase;
+
+typedef enum {
+    COUNTER_CONSUMED = 0,   // hotkeys handled and swallowed
+    COUNTER_PASSED,         // keystrokes passed through untouched
+    COUNTER_DROPPED,        // hotkeys swallowed whose action could not run
+    COUNTER_TAP_DISABLED,   // tap disabled by timeout or user input
+    COUNTER_CONFIG_RELOADS, // config changes applied
+    COUNTER_CONFIG_ERRORS,  // config changes rejected (previous bindings kept)
+    COUNTER_COALESCED,      // switch presses folded into a later multi-hop jump
+    COUNTER_REPEAT_DROPPED, // auto-repeat events swallowed by the repeat policy
+    COUNTER_LOG_DROPPED,    // log messages dropped because a log ring was full
+    COUNTER_SEQ_KEYS,       // keys swallowed while a hotkey sequence was under way
+    COUNTER_SEQ_ABANDONED,  // sequences broken off by another key or a timeout
+    COUNTER_TAP_REENABLED,  // tap turned back on by the watchdog
+    COUNTER_TAP_OVERRUNS,   // tap callbacks over the time budget
+    COUNTER_DEFERRED,       // actions run on the watchdog worker instead of the tap
+    COUNTER_COUNT
+} StatsCounter;
+
+// Monotonic clock in nanoseconds, same time base as statsEventTimeToNs().
+uint64_t statsNowNs(void);
+// Convert a platform event timestamp (CGEventTimestamp) to statsNowNs() time.
+uint64_t statsEventTimeToNs(uint64_t timestamp);
+
+// End-to-end time for an action: event timestamp to handler completion.
+void statsRecordAction(HotkeyActionType action, uint64_t ns);
+void statsRecordPhase(StatsPhase phase, uint64_t ns);
+void statsCount(StatsCounter counter);
+uint64_t statsCounter(StatsCounter counter);
+
+const Histogram *statsActionHistogram(HotkeyActionType action);
+const Histogram *statsPhaseHistogram(StatsPhase phase);
+
+// Format a snapshot; returns the length that would have been written.
+size_t statsFormatText(char *buf, size_t size);
+size_t statsFormatJSON(char *buf, size_t size);
+bool statsWriteFile(const char *path, bool json);
+
+// Block `signo` in the calling thread (call before starting other threads)
+// and start a thread that writes a snapshot to `path` whenever it arrives.
+bool statsStartSignalExport(int signo, const char *path, bool json);
+
+#endif // STATS_H
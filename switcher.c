@@ -0,0 +1,627 @@
+#include "switcher.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "log.h"
+#include "mover.h"
+#include "notify.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "trace.h"
+
+static Backend *gBackend = NULL;
+
+// Compiled dispatch table; replaced wholesale on config reload
+static SnapshotSlot gHotkeySlot = SNAPSHOT_SLOT_INIT;
+
+// Serializes actions from the event tap, the repeat timer and other callers
+// (control socket). Only taken once a hotkey matched, never for the lookup.
+static pthread_mutex_t gActionLock = PTHREAD_MUTEX_INITIALIZER;
+
+// Switch burst in progress; guarded by gActionLock
+static RepeatState gRepeat;
+
+// Where the cursor last left each display (jump_anchor=last), by display
+// id so the points survive topology rebuilds: one entry per display of the
+// latest topology, resized and carried over by switcherRebuildTopology().
+// Guarded by gActionLock.
+typedef struct {
+    uint32_t  id;
+    bool      valid;
+    TopoPoint point;
+} LastAnchor;
+
+static LastAnchor      *gLastAnchors;
+static uint32_t         gLastAnchorCount;
+static _Atomic int      gJumpAnchor = ANCHOR_PROPORTIONAL;
+
+static _Atomic int      gWindowMode = WINDOW_MODE_MOVE;
+
+// Built into every topology snapshot
+static pthread_mutex_t    gMappingLock = PTHREAD_MUTEX_INITIALIZER;
+static TopoMappingOptions gMapping;
+
+// Trace record of the action in progress (NULL = none); guarded by gActionLock
+static TraceRecord *gTrace = NULL;
+
+// Sequence in progress: automaton state (0 = none) of the hotkey table with
+// generation gSequenceGeneration, and when its last key was pressed. Only
+// the key dispatching thread (the event tap) touches these.
+static uint32_t gSequenceState = 0;
+static uint64_t gSequenceGeneration = 0;
+static uint64_t gSequenceLastNs = 0;
+
+// Copy of the published table's keycode bitset, so the tap can turn away
+// ordinary typing without acquiring the table
+static _Atomic uint64_t gInteresting[HOTKEY_KEYCODES / 64];
+
+// Cursor position carried by the key event being dispatched, so the action
+// need not ask the window server; stale once the switcher moved the cursor.
+// Guarded by gActionLock.
+static TopoPoint gEventCursor;
+static bool      gHaveEventCursor = false;
+
+void switcherInit(Backend *backend) {
+    gBackend = backend;
+}
+
+Backend *switcherBackend(void) {
+    return gBackend;
+}
+
+void switcherSetRepeatOptions(const RepeatOptions *options) {
+    repeatInit(&gRepeat, options);
+    traceSetContext(options, -1, NULL);
+}
+
+void switcherSetJumpAnchor(JumpAnchor anchor) {
+    atomic_store_explicit(&gJumpAnchor, anchor, memory_order_relaxed);
+    traceSetContext(NULL, (int)anchor, NULL);
+}
+
+void switcherSetWindowMode(WindowMode mode) {
+    atomic_store_explicit(&gWindowMode, mode, memory_order_relaxed);
+}
+
+void switcherSetCursorMapping(const TopoMappingOptions *mapping) {
+    pthread_mutex_lock(&gMappingLock);
+    gMapping = *mapping;
+    pthread_mutex_unlock(&gMappingLock);
+    traceSetContext(NULL, -1, mapping);
+}
+
+static uint32_t clampNs(uint64_t ns) {
+    return ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns;
+}
+
+static void recordPhase(StatsPhase phase, uint64_t ns) {
+    statsRecordPhase(phase, ns);
+    if (gTrace) gTrace->phaseNs[phase] = clampNs(ns);
+}
+
+// The action in progress moves the cursor from display `from` to `to`
+static void traceMove(int from, TopoPoint fromPoint, int to, TopoPoint toPoint) {
+    if (!gTrace) return;
+    gTrace->fromDisplay = (int16_t)from;
+    gTrace->toDisplay = (int16_t)to;
+    if (from >= 0) {
+        gTrace->fromX = (float)fromPoint.x;
+        gTrace->fromY = (float)fromPoint.y;
+    }
+    gTrace->toX = (float)toPoint.x;
+    gTrace->toY = (float)toPoint.y;
+}
+
+static void traceBegin(TraceRecord *record, TraceKind kind, HotkeyAction action, uint64_t timeNs) {
+    *record = (TraceRecord){
+        .timeNs = timeNs,
+        .kind = (uint8_t)kind,
+        .action = (uint8_t)action.type,
+        .arg = action.arg,
+        .fromDisplay = -1,
+        .toDisplay = -1,
+    };
+    gTrace = record;
+}
+
+static void traceEnd(TraceRecord *record, TraceOutcome outcome, uint64_t startNs) {
+    record->outcome = (uint8_t)outcome;
+    record->totalNs = clampNs(statsNowNs() - startNs);
+    traceAppend(record);
+    gTrace = NULL;
+}
+
+static bool cursorGet(TopoPoint *point) {
+    if (gHaveEventCursor) {
+        *point = gEventCursor;
+        return true;
+    }
+    return gBackend->cursorGet(gBackend, point);
+}
+
+static void cursorSet(TopoPoint point) {
+    gHaveEventCursor = false;
+    gBackend->cursorSet(gBackend, point);
+}
+
+static LastAnchor *findLastAnchor(uint32_t id) {
+    for (uint32_t i = 0; i < gLastAnchorCount; i++) {
+        if (gLastAnchors[i].id == id) return &gLastAnchors[i];
+    }
+    return NULL;
+}
+
+// The cursor is leaving display `index` from point p
+static void rememberAnchor(const Topology *topology, int index, TopoPoint p) {
+    if (atomic_load_explicit(&gJumpAnchor, memory_order_relaxed) != ANCHOR_LAST) return;
+    if (index < 0 || (uint32_t)index >= topology->count) return;
+    LastAnchor *anchor = findLastAnchor(topology->displays[index].id);
+    if (!anchor) return;   // a display newer than the table; rebuilt shortly
+    anchor->point = p;
+    anchor->valid = true;
+}
+
+// Jump target on display `index`: where the cursor last left it, or its center
+static TopoPoint anchorPoint(const Topology *topology, int index, JumpAnchor anchor) {
+    const DisplayInfo *display = &topology->displays[index];
+    if (anchor == ANCHOR_LAST) {
+        const LastAnchor *last = findLastAnchor(display->id);
+        if (last && last->valid && topoRectContains(display->bounds, last->point)) return last->point;
+    }
+    TopoRect b = display->bounds;
+    return (TopoPoint){ b.x + b.width / 2, b.y + b.height / 2 };
+}
+
+// One last-visited entry per display of `topology`, keeping the points of
+// displays that are still there
+static void resizeLastAnchors(const Topology *topology) {
+    LastAnchor *table = calloc(topology->count ? topology->count : 1, sizeof(*table));
+    if (!table) return;
+    for (uint32_t i = 0; i < topology->count; i++) table[i].id = topology->displays[i].id;
+    pthread_mutex_lock(&gActionLock);
+    for (uint32_t i = 0; i < topology->count; i++) {
+        const LastAnchor *old = findLastAnchor(table[i].id);
+        if (old) table[i] = *old;
+    }
+    LastAnchor *old = gLastAnchors;
+    gLastAnchors = table;
+    gLastAnchorCount = topology->count;
+    pthread_mutex_unlock(&gActionLock);
+    free(old);
+}
+
+void switcherPublishHotkeys(HotkeyTable *table) {
+    // Keys of both tables pass switcherKeyMayMatch() while they are swapped
+    for (uint32_t i = 0; table && i < HOTKEY_KEYCODES / 64; i++) {
+        atomic_fetch_or_explicit(&gInteresting[i], table->interesting[i], memory_order_relaxed);
+    }
+    hotkeyTableDestroy(snapshotExchange(&gHotkeySlot, table));
+    for (uint32_t i = 0; i < HOTKEY_KEYCODES / 64; i++) {
+        atomic_store_explicit(&gInteresting[i], table ? table->interesting[i] : 0, memory_order_relaxed);
+    }
+}
+
+bool switcherKeyMayMatch(uint16_t keyCode) {
+    if (gSequenceState) return true;
+    return keyCode < HOTKEY_KEYCODES &&
+           (atomic_load_explicit(&gInteresting[keyCode >> 6], memory_order_relaxed) >> (keyCode & 63)) & 1u;
+}
+
+bool switcherRebuildTopology(void) {
+    DisplayInfo *infos = NULL;
+    uint32_t displayCount = 0;
+    if (!gBackend->displays(gBackend, &infos, &displayCount)) {
+        LOG_ERROR("Failed to get active displays");
+        return false;
+    }
+    pthread_mutex_lock(&gMappingLock);
+    TopoMappingOptions mapping = gMapping;
+    pthread_mutex_unlock(&gMappingLock);
+    Topology *topology = topologyCreateMapped(infos, displayCount, &mapping);
+    free(infos);
+    if (!topology) {
+        LOG_ERROR("Failed to build display topology");
+        return false;
+    }
+    resizeLastAnchors(topology);
+    topologyPublish(topology);
+    return true;
+}
+
+// Compute where the cursor lands `hops` displays away in the given direction.
+// Returns false if there is nowhere to go (single display, no neighbor).
+static bool computeSwitchTarget(TopoDirection direction, uint32_t hops, TopoPoint current, TopoPoint *target) {
+    unsigned token;
+    const Topology *topology = topologyAcquire(&token);
+    if (!topology || topology->count < 2) {
+        topologyRelease(token);
+        return false;
+    }
+
+    // Find which display the cursor is currently on
+    int currentIndex = topologyDisplayAt(topology, current);
+    if (currentIndex < 0) currentIndex = 0;
+
+    // Resolve the neighbor in the physical arrangement and the proportional position on it
+    int newIndex = topologyNeighborN(topology, currentIndex, direction, hops);
+    if (newIndex < 0) {
+        topologyRelease(token);
+        return false;
+    }
+    *target = topologyMapPoint(topology, currentIndex, newIndex, current);
+    traceMove(currentIndex, current, newIndex, *target);
+    rememberAnchor(topology, currentIndex, current);
+    topologyRelease(token);
+    return true;
+}
+
+bool switchDisplay(TopoDirection direction) {
+    return switchDisplayBy(direction, 1);
+}
+
+bool switchDisplayBy(TopoDirection direction, uint32_t hops) {
+    // Moving the cursor mid-drag would drag the window along: abandon it
+    dragCancel();
+    if (gTrace) gTrace->hops = (uint16_t)(hops > UINT16_MAX ? UINT16_MAX : hops);
+
+    // Get current cursor position
+    uint64_t t0 = statsNowNs();
+    TopoPoint current;
+    if (!cursorGet(&current)) {
+        return false;
+    }
+    uint64_t t1 = statsNowNs();
+    recordPhase(PHASE_DISPLAY_QUERY, t1 - t0);
+
+    TopoPoint target;
+    bool found = computeSwitchTarget(direction, hops, current, &target);
+    uint64_t t2 = statsNowNs();
+    recordPhase(PHASE_GEOMETRY, t2 - t1);
+    if (!found) {
+        return false;
+    }
+
+    // Warp the cursor
+    cursorSet(target);
+    uint64_t t3 = statsNowNs();
+    recordPhase(PHASE_WARP, t3 - t2);
+
+    // Notify cursor position after switching
+    NotifyEvent event = { .kind = NOTIFY_CURSOR_MOVED, .x = target.x, .y = target.y };
+    gBackend->notify(gBackend, &event);
+    recordPhase(PHASE_NOTIFY, statsNowNs() - t3);
+    return true;
+}
+
+bool jumpToDisplay(uint32_t number) {
+    dragCancel();
+    JumpAnchor anchor = (JumpAnchor)atomic_load_explicit(&gJumpAnchor, memory_order_relaxed);
+
+    // Only the proportional and last-visited anchors need the current position
+    uint64_t t0 = statsNowNs();
+    TopoPoint current = { 0, 0 };
+    if (anchor != ANCHOR_CENTER && !cursorGet(&current)) {
+        return false;
+    }
+    uint64_t t1 = statsNowNs();
+    recordPhase(PHASE_DISPLAY_QUERY, t1 - t0);
+
+    unsigned token;
+    const Topology *topology = topologyAcquire(&token);
+    if (!topology || number < 1 || number > topology->count) {
+        topologyRelease(token);
+        return false;
+    }
+    int targetIndex = (int)topology->order[number - 1];
+    int currentIndex = anchor == ANCHOR_CENTER ? -1 : topologyDisplayAt(topology, current);
+    if (targetIndex == currentIndex) {
+        // Already there
+        traceMove(currentIndex, current, targetIndex, current);
+        topologyRelease(token);
+        return true;
+    }
+    TopoPoint target;
+    if (anchor == ANCHOR_PROPORTIONAL && currentIndex >= 0) {
+        target = topologyMapPoint(topology, currentIndex, targetIndex, current);
+    } else {
+        if (currentIndex >= 0) rememberAnchor(topology, currentIndex, current);
+        target = anchorPoint(topology, targetIndex, anchor);
+    }
+    traceMove(currentIndex, current, targetIndex, target);
+    topologyRelease(token);
+    uint64_t t2 = statsNowNs();
+    recordPhase(PHASE_GEOMETRY, t2 - t1);
+
+    cursorSet(target);
+    uint64_t t3 = statsNowNs();
+    recordPhase(PHASE_WARP, t3 - t2);
+
+    NotifyEvent event = { .kind = NOTIFY_CURSOR_MOVED, .x = target.x, .y = target.y };
+    gBackend->notify(gBackend, &event);
+    recordPhase(PHASE_NOTIFY, statsNowNs() - t3);
+    return true;
+}
+
+// Post one synthetic mouse event for the drag engine (runs on the drag thread)
+static void postDragEvent(DragPoster *poster, DragEventType type, TopoPoint point) {
+    (void)poster;
+    gBackend->postMouse(gBackend, type, point);
+}
+
+// Report the outcome of a drag (runs on the drag thread)
+static void dragFinished(DragPoster *poster, TopoPoint from, TopoPoint to, bool cancelled) {
+    (void)poster;
+    LOG_DEBUG("Drag operation %s", cancelled ? "cancelled" : "completed");
+    NotifyEvent event = {
+        .kind = NOTIFY_WINDOW_DRAGGED,
+        .fromX = from.x, .fromY = from.y,
+        .x = to.x, .y = to.y,
+    };
+    gBackend->notify(gBackend, &event);
+}
+
+static DragPoster gDragPoster = { .post = postDragEvent, .finished = dragFinished };
+
+DragPoster *switcherDragPoster(void) {
+    return &gDragPoster;
+}
+
+bool dragWindowBetweenDisplays(TopoDirection direction) {
+    // Get current mouse position
+    uint64_t t0 = statsNowNs();
+    TopoPoint current;
+    if (!cursorGet(&current)) {
+        LOG_WARN("Failed to read cursor position");
+        return false;
+    }
+    uint64_t t1 = statsNowNs();
+    recordPhase(PHASE_DISPLAY_QUERY, t1 - t0);
+
+    // The mover finds the window and its target display on its own thread
+    if (atomic_load_explicit(&gWindowMode, memory_order_relaxed) == WINDOW_MODE_MOVE &&
+        moverRequest(direction, current)) {
+        recordPhase(PHASE_WARP, statsNowNs() - t1);
+        return true;
+    }
+
+    TopoPoint target;
+    bool found = computeSwitchTarget(direction, 1, current, &target);
+    uint64_t t2 = statsNowNs();
+    recordPhase(PHASE_GEOMETRY, t2 - t1);
+    if (!found) {
+        LOG_DEBUG("No display in that direction");
+        return false;
+    }
+
+    bool queued = dragRequest(current, target);
+    recordPhase(PHASE_WARP, statsNowNs() - t2);
+    if (!queued) {
+        LOG_WARN("Drag engine not running");
+    }
+    return queued;
+}
+
+bool evacuateDisplay(TopoDirection direction) {
+    TopoPoint current;
+    if (!cursorGet(&current)) {
+        LOG_WARN("Failed to read cursor position");
+        return false;
+    }
+    bool queued = moverRequestEvacuate(direction, current);
+    if (!queued) {
+        LOG_WARN("Window mover not running");
+    }
+    return queued;
+}
+
+bool performAction(HotkeyAction action) {
+    switch (action.type) {
+        case ACTION_SWITCH:
+            return switchDisplay((TopoDirection)action.arg);
+        case ACTION_DRAG:
+            return dragWindowBetweenDisplays((TopoDirection)action.arg);
+        case ACTION_JUMP:
+            return jumpToDisplay((uint32_t)action.arg);
+        case ACTION_EVACUATE:
+            return evacuateDisplay((TopoDirection)action.arg);
+        case ACTION_EXIT:
+            dragCancel();
+            gBackend->quit(gBackend);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Run switches deferred by the coalescer, traced as a record of their own.
+// Called with gActionLock held.
+static void flushSwitches(TraceKind kind, HotkeyAction action, uint32_t hops) {
+    TraceRecord *outer = gTrace;
+    TraceRecord record;
+    uint64_t start = statsNowNs();
+    traceBegin(&record, kind, action, gBackend->now(gBackend));
+    bool performed = switchDisplayBy((TopoDirection)action.arg, hops);
+    traceEnd(&record, performed ? TRACE_PERFORMED : TRACE_FAILED, start);
+    gTrace = outer;
+}
+
+// Close of a coalescing window (dispatch thread, via backend->schedule)
+static void repeatTimerFired(void *arg) {
+    (void)arg;
+    HotkeyAction action;
+    uint64_t timerAt;
+    pthread_mutex_lock(&gActionLock);
+    uint32_t hops = repeatFlush(&gRepeat, gBackend->now(gBackend), &action, &timerAt);
+    if (timerAt) gBackend->schedule(gBackend, timerAt, repeatTimerFired, NULL);
+    if (hops) flushSwitches(TRACE_FLUSH_TIMER, action, hops);
+    pthread_mutex_unlock(&gActionLock);
+}
+
+// Run the switches still pending from a burst before anything else moves
+// the cursor. Called with gActionLock held.
+static void settleRepeat(void) {
+    HotkeyAction pendingAction;
+    uint32_t pendingHops = repeatCancel(&gRepeat, &pendingAction);
+    if (pendingHops) flushSwitches(TRACE_FLUSH_INLINE, pendingAction, pendingHops);
+}
+
+bool switcherRun(HotkeyAction action, uint32_t count) {
+    uint64_t start = statsNowNs();
+    pthread_mutex_lock(&gActionLock);
+    settleRepeat();
+    TraceRecord record;
+    traceBegin(&record, TRACE_CONTROL, action, gBackend->now(gBackend));
+    bool performed = action.type == ACTION_SWITCH
+        ? switchDisplayBy((TopoDirection)action.arg, count ? count : 1)
+        : performAction(action);
+    traceEnd(&record, performed ? TRACE_PERFORMED : TRACE_FAILED, start);
+    pthread_mutex_unlock(&gActionLock);
+    return performed;
+}
+
+// Run a switch through the coalescer. Returns false only if a move was
+// attempted and failed.
+static bool coalesceSwitch(HotkeyAction action, bool autorepeat, uint64_t now, bool *deferred, bool *dropped) {
+    RepeatDecision decision = repeatPress(&gRepeat, action, autorepeat, now);
+    if (decision.timerAt) gBackend->schedule(gBackend, decision.timerAt, repeatTimerFired, NULL);
+    if (decision.flushHops) flushSwitches(TRACE_FLUSH_INLINE, decision.flushAction, decision.flushHops);
+    *deferred = decision.hops == 0;
+    *dropped = decision.dropped;
+    if (decision.dropped) statsCount(COUNTER_REPEAT_DROPPED);
+    if (decision.coalesced) statsCount(COUNTER_COALESCED);
+    return *deferred || switchDisplayBy((TopoDirection)action.arg, decision.hops);
+}
+
+// Carry out a matched hotkey, in the tap or on the watchdog worker. A
+// deferred job has no event cursor: the cursor may have moved since.
+static void runAction(const WatchdogJob *job, const TopoPoint *cursor) {
+    HotkeyAction action = job->action;
+    uint64_t runStart = statsNowNs();
+    bool performed, deferred = false, dropped = false;
+    pthread_mutex_lock(&gActionLock);
+    if (cursor) {
+        gEventCursor = *cursor;
+        gHaveEventCursor = true;
+    }
+    if (action.type != ACTION_SWITCH) {
+        // Anything else sees the cursor where the pending switches would put it
+        settleRepeat();
+    }
+    TraceRecord record;
+    traceBegin(&record, TRACE_KEY, action, job->timeNs);
+    record.keyCode = job->keyCode;
+    record.flags = job->flags;
+    record.autorepeat = job->autorepeat;
+    record.phaseNs[PHASE_DISPATCH] = clampNs(job->dispatchNs);
+    uint64_t startedAt = gBackend->now(gBackend);
+    record.delayNs = job->eventTimeNs && startedAt > job->eventTimeNs ? clampNs(startedAt - job->eventTimeNs) : 0;
+    if (action.type == ACTION_SWITCH) {
+        performed = coalesceSwitch(action, job->autorepeat, job->timeNs, &deferred, &dropped);
+    } else {
+        performed = performAction(action);
+    }
+    traceEnd(&record, deferred ? (dropped ? TRACE_SUPPRESSED : TRACE_DEFERRED)
+                               : performed ? TRACE_PERFORMED : TRACE_FAILED, job->startNs);
+    gHaveEventCursor = false;
+    pthread_mutex_unlock(&gActionLock);
+    uint64_t end = statsNowNs();
+    watchdogRecordAction(action.type, end - runStart);
+    if (deferred) return;
+    statsCount(performed ? COUNTER_CONSUMED : COUNTER_DROPPED);
+    if (job->eventTimeNs) statsRecordAction(action.type, end - job->eventTimeNs);
+}
+
+void switcherRunDeferred(const WatchdogJob *job) {
+    runAction(job, NULL);
+}
+
+static bool handleKey(uint16_t keyCode, uint64_t flags, uint64_t eventTimeNs, bool autorepeat, const TopoPoint *cursor) {
+    unsigned token;
+    const HotkeyTable *table = snapshotAcquire(&gHotkeySlot, &token);
+    // A sequence in progress belongs to the table it started in
+    if (gSequenceState && (!table || table->generation != gSequenceGeneration)) gSequenceState = 0;
+
+    // Fast reject: ordinary typing never gets past this bit test
+    if (!gSequenceState && (!table || !hotkeyIsInteresting(table, keyCode))) {
+        snapshotRelease(&gHotkeySlot, token);
+        statsCount(COUNTER_PASSED);
+        return false;
+    }
+
+    uint64_t t0 = statsNowNs();
+    uint64_t now = eventTimeNs ? eventTimeNs : gBackend->now(gBackend);
+    HotkeyAction action = { ACTION_NONE, 0 };
+    bool matched = false, advanced = false;
+    if (gSequenceState) {
+        if (autorepeat) {
+            // A key still held from before: the sequence waits for the next press
+            advanced = true;
+        } else {
+            const HotkeyTransition *edge = hotkeyStep(table, gSequenceState, keyCode, flags);
+            gSequenceState = 0;
+            if (edge && now - gSequenceLastNs <= edge->timeoutNs) {
+                gSequenceState = edge->next;
+                gSequenceLastNs = now;
+                advanced = edge->next != 0;
+                matched = edge->next == 0;
+                action = edge->action;
+            } else {
+                // Broken off: the key is looked up as if no sequence had started
+                statsCount(COUNTER_SEQ_ABANDONED);
+            }
+        }
+    }
+    if (!matched && !advanced) {
+        const HotkeyBinding *binding = hotkeyLookup(table, keyCode, flags);
+        if (binding && binding->next) {
+            gSequenceState = binding->next;
+            gSequenceGeneration = table->generation;
+            gSequenceLastNs = now;
+            advanced = true;
+        } else if (binding) {
+            action = binding->action;
+            matched = true;
+        }
+    }
+    snapshotRelease(&gHotkeySlot, token);
+    uint64_t dispatchNs = statsNowNs() - t0;
+    statsRecordPhase(PHASE_DISPATCH, dispatchNs);
+    if (advanced) {
+        statsCount(COUNTER_SEQ_KEYS);
+        return true;
+    }
+    if (!matched) {
+        statsCount(COUNTER_PASSED);
+        return false;
+    }
+
+    WatchdogJob job = {
+        .action = action,
+        .keyCode = keyCode,
+        .flags = flags,
+        .eventTimeNs = eventTimeNs,
+        .timeNs = now,
+        .startNs = t0,
+        .dispatchNs = dispatchNs,
+        .autorepeat = autorepeat,
+    };
+    // Expected to overrun the tap's time budget: the worker runs it, and
+    // the key is consumed now
+    if (watchdogShouldDefer(action.type) && watchdogDefer(&job)) return true;
+    // A deferred action that finished after the key was pressed may have
+    // moved the cursor away from where the event saw it
+    if (cursor && watchdogLastRunNs() >= (eventTimeNs ? eventTimeNs : t0)) cursor = NULL;
+    runAction(&job, cursor);
+    return true;
+}
+
+bool switcherHandleKey(uint16_t keyCode, uint64_t flags, uint64_t eventTimeNs, bool autorepeat) {
+    return handleKey(keyCode, flags, eventTimeNs, autorepeat, NULL);
+}
+
+bool switcherHandleKeyAt(uint16_t keyCode, uint64_t flags, uint64_t eventTimeNs, bool autorepeat, TopoPoint cursor) {
+    return handleKey(keyCode, flags, eventTimeNs, autorepeat, &cursor);
+}
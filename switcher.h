@@ -0,0 +1,111 @@
+#ifndef SWITCHER_H
+#define SWITCHER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "backend.h"
+#include "drag.h"
+#include "hotkeys.h"
+#include "repeat.h"
+#include "topology.h"
+#include "watchdog.h"
+
+// Platform-independent core: hotkey dispatch, cursor switching and drag
+// requests on top of a Backend. monitor_switcher.c feeds it keystrokes from
+// the CoreGraphics event tap; the benchmarks feed it synthetic streams.
+
+// Where a jump to display N puts the cursor
+typedef enum {
+    ANCHOR_PROPORTIONAL = 0,   // same relative position as on the current display
+    ANCHOR_LAST,               // where the cursor last left that display
+    ANCHOR_CENTER,             // the display's center
+} JumpAnchor;
+
+// How the drag hotkey moves a window
+typedef enum {
+    WINDOW_MODE_MOVE = 0,      // set the window's frame (window mover, see mover.h)
+    WINDOW_MODE_DRAG,          // drag its title bar with synthetic mouse events
+} WindowMode;
+
+// Select the backend. Must be called before anything else.
+void switcherInit(Backend *backend);
+
+Backend *switcherBackend(void);
+
+// Query the backend's displays and publish a new topology snapshot.
+// Called at startup and on display reconfiguration only.
+bool switcherRebuildTopology(void);
+
+// Publish a compiled hotkey table, taking ownership. The previous table is
+// freed once the event tap can no longer be using it, so this may wait
+// briefly; never call it from the tap thread. NULL disables all hotkeys.
+void switcherPublishHotkeys(HotkeyTable *table);
+
+// Coalescing of rapid/auto-repeated switch hotkeys (default: off)
+void switcherSetRepeatOptions(const RepeatOptions *options);
+
+// May be changed at any time (e.g. on config reload)
+void switcherSetJumpAnchor(JumpAnchor anchor);
+
+// Default WINDOW_MODE_MOVE; drags are used while the mover is not running
+void switcherSetWindowMode(WindowMode mode);
+
+// How cursor positions carry over between displays (default proportional).
+// Applies from the next switcherRebuildTopology().
+void switcherSetCursorMapping(const TopoMappingOptions *mapping);
+
+// Drag poster forwarding to the backend, for dragEngineStart()
+DragPoster *switcherDragPoster(void);
+
+// Switch cursor position by one display in the given direction
+bool switchDisplay(TopoDirection direction);
+
+// Jump `hops` displays in one direction with a single cursor move
+bool switchDisplayBy(TopoDirection direction, uint32_t hops);
+
+// Move the cursor to display `number` (1-based, in the spatial order
+// used by TOPO_NEXT). Returns false if there is no such display.
+bool jumpToDisplay(uint32_t number);
+
+// Hand the window under the cursor (or the focused one) to the window mover,
+// or a drag of it to the drag engine, depending on the window mode; returns
+// at once
+bool dragWindowBetweenDisplays(TopoDirection direction);
+
+// Hand every window on the cursor's display to the window mover, which
+// moves them all one display in `direction`; returns at once
+bool evacuateDisplay(TopoDirection direction);
+
+// Run the action bound to a hotkey; returns false if it could not be carried out
+bool performAction(HotkeyAction action);
+
+// Thread-safe entry point for callers other than the event tap (control
+// socket): runs `action` serialized with hotkey actions, after any switches
+// still pending from a repeat burst. `count` is the number of hops for
+// ACTION_SWITCH (0 = 1) and ignored otherwise.
+bool switcherRun(HotkeyAction action, uint32_t count);
+
+// Dispatch one key-down. Returns true if a binding matched and the event
+// should be consumed. eventTimeNs (statsNowNs() timebase, 0 = unknown) is
+// used for the end-to-end action latency and repeat coalescing; autorepeat
+// marks key-repeat events generated while the key is held.
+bool switcherHandleKey(uint16_t keyCode, uint64_t flags, uint64_t eventTimeNs, bool autorepeat);
+
+// The same, with the cursor position the key event carries: the action
+// uses it instead of querying the backend for the cursor. Together with
+// the preallocated trace, stats, log and notification queues, a dispatched
+// key then makes no heap allocation (bench_alloc checks this).
+bool switcherHandleKeyAt(uint16_t keyCode, uint64_t flags, uint64_t eventTimeNs, bool autorepeat, TopoPoint cursor);
+
+// False if keyCode cannot match any binding and no sequence is in progress:
+// the tap can pass the key on without reading anything else from the event.
+// One bit test, no lock; call it from the key dispatching thread.
+bool switcherKeyMayMatch(uint16_t keyCode);
+
+// Both hand a hotkey to the watchdog worker instead of running it when it is
+// predicted to overrun the tap's time budget (watchdog.h); this is the
+// worker's runner, for watchdogStart().
+void switcherRunDeferred(const WatchdogJob *job);
+
+#endif // SWITCHER_H
@@ -0,0 +1,232 @@
+// mqs-ctl: command-line client and load generator for the control socket.
+//
+//   mqs-ctl [-s socket] 'next; next; cursor'
+//   mqs-ctl [-s socket] --load [-n requests] [-b commands/request] [-d depth] [-c command]
+//
+// The first form sends one request line and prints the reply; it exits 1 if
+// the reply is an error. --load pipelines requests with up to `depth` in
+// flight and reports throughput and round-trip percentiles.
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_SOCKET "/tmp/quickmonitorswitcher.sock"
+
+static uint64_t nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int connectTo(const char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "mqs-ctl: socket path too long\n");
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "mqs-ctl: cannot connect to %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool writeAll(int fd, const char *data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+// --- One-shot ------------------------------------------------------------------
+
+static int runOnce(const char *path, const char *request) {
+    int fd = connectTo(path);
+    if (fd < 0) return 1;
+    if (!writeAll(fd, request, strlen(request)) || !writeAll(fd, "\n", 1)) {
+        fprintf(stderr, "mqs-ctl: write failed: %s\n", strerror(errno));
+        close(fd);
+        return 1;
+    }
+    char reply[16384];
+    size_t length = 0;
+    while (length < sizeof(reply) - 1) {
+        ssize_t n = read(fd, reply + length, sizeof(reply) - 1 - length);
+        if (n <= 0) break;
+        length += (size_t)n;
+        if (reply[length - 1] == '\n') break;
+    }
+    close(fd);
+    reply[length] = '\0';
+    fputs(reply, stdout);
+    return strncmp(reply, "ok ", 3) == 0 ? 0 : 1;
+}
+
+// --- Load generator ------------------------------------------------------------
+
+typedef struct {
+    int               fd;
+    unsigned          requests, depth;
+    const char       *line;          // one request, newline included
+    size_t            lineLength;
+    uint64_t         *sentAt;
+    uint64_t         *rtt;
+    _Atomic unsigned  received;
+    unsigned          errors;
+} Load;
+
+static void *writer(void *arg) {
+    Load *load = arg;
+    for (unsigned i = 0; i < load->requests; i++) {
+        while (i - atomic_load_explicit(&load->received, memory_order_acquire) >= load->depth) {
+            sched_yield();
+        }
+        load->sentAt[i] = nowNs();
+        if (!writeAll(load->fd, load->line, load->lineLength)) break;
+    }
+    return NULL;
+}
+
+static int compareU64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static int runLoad(const char *path, unsigned requests, unsigned batch, unsigned depth, const char *command) {
+    Load load = { .requests = requests, .depth = depth ? depth : 1 };
+    load.fd = connectTo(path);
+    if (load.fd < 0) return 1;
+
+    size_t commandLength = strlen(command);
+    char *line = malloc(batch * (commandLength + 2) + 1);
+    load.sentAt = calloc(requests, sizeof(uint64_t));
+    load.rtt = calloc(requests, sizeof(uint64_t));
+    if (!line || !load.sentAt || !load.rtt) {
+        fprintf(stderr, "mqs-ctl: out of memory\n");
+        return 1;
+    }
+    size_t length = 0;
+    for (unsigned i = 0; i < batch; i++) {
+        if (i) line[length++] = ';';
+        memcpy(line + length, command, commandLength);
+        length += commandLength;
+    }
+    line[length++] = '\n';
+    load.line = line;
+    load.lineLength = length;
+
+    pthread_t thread;
+    uint64_t t0 = nowNs();
+    pthread_create(&thread, NULL, writer, &load);
+
+    // Replies arrive in order: the n-th newline answers the n-th request
+    static char buffer[65536];
+    bool lineStart = true;
+    unsigned received = 0;
+    while (received < requests) {
+        ssize_t n = read(load.fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            fprintf(stderr, "mqs-ctl: connection closed after %u replies\n", received);
+            break;
+        }
+        uint64_t now = nowNs();
+        for (ssize_t i = 0; i < n; i++) {
+            if (lineStart && buffer[i] != 'o') load.errors++;
+            lineStart = buffer[i] == '\n';
+            if (lineStart) {
+                load.rtt[received] = now - load.sentAt[received];
+                received++;
+                atomic_store_explicit(&load.received, received, memory_order_release);
+            }
+        }
+    }
+    uint64_t elapsed = nowNs() - t0;
+    if (received < requests) atomic_store(&load.received, requests);   // unblock the writer
+    shutdown(load.fd, SHUT_RDWR);
+    pthread_join(thread, NULL);
+    close(load.fd);
+
+    if (received > 0) {
+        qsort(load.rtt, received, sizeof(uint64_t), compareU64);
+        double seconds = (double)elapsed / 1e9;
+        printf("%u requests x %u '%s' (depth %u): %.0f requests/s, %.0f commands/s\n",
+               received, batch, command, load.depth, received / seconds, (double)received * batch / seconds);
+        printf("round trip: p50 %.1f us  p99 %.1f us  max %.1f us\n",
+               load.rtt[received / 2] / 1e3, load.rtt[received * 99 / 100] / 1e3, load.rtt[received - 1] / 1e3);
+    }
+    if (load.errors) printf("%u error replies\n", load.errors);
+    free(line);
+    free(load.sentAt);
+    free(load.rtt);
+    return received == requests && !load.errors ? 0 : 1;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: mqs-ctl [-s socket] 'command[; command...]'\n"
+            "       mqs-ctl [-s socket] --load [-n requests] [-b commands/request] [-d depth] [-c command]\n"
+            "commands: next|prev|left|right|up|down [N], jump N, drag [direction], cursor, topology, stats, trace [path], ping\n");
+}
+
+int main(int argc, char **argv) {
+    const char *path = DEFAULT_SOCKET;
+    const char *command = "ping";
+    unsigned requests = 100000, batch = 1, depth = 64;
+    bool load = false;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        const char *flag = argv[i];
+        if (strcmp(flag, "--load") == 0 || strcmp(flag, "-l") == 0) {
+            load = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            usage();
+            return 2;
+        }
+        const char *value = argv[++i];
+        if (strcmp(flag, "-s") == 0) path = value;
+        else if (strcmp(flag, "-c") == 0) command = value;
+        else if (strcmp(flag, "-n") == 0) requests = (unsigned)strtoul(value, NULL, 10);
+        else if (strcmp(flag, "-b") == 0) batch = (unsigned)strtoul(value, NULL, 10);
+        else if (strcmp(flag, "-d") == 0) depth = (unsigned)strtoul(value, NULL, 10);
+        else {
+            usage();
+            return 2;
+        }
+    }
+    signal(SIGPIPE, SIG_IGN);   // a vanished server shows up as a write error
+    if (load) {
+        if (requests == 0 || batch == 0) {
+            usage();
+            return 2;
+        }
+        return runLoad(path, requests, batch, depth, command);
+    }
+    if (i != argc - 1) {
+        usage();
+        return 2;
+    }
+    return runOnce(path, argv[i]);
+}
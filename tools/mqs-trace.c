@@ -0,0 +1,157 @@
+// mqs-trace: decode, summarize and replay trace dumps.
+//
+//   mqs-trace dump.trace        per-action latency breakdown
+//   mqs-trace -l dump.trace     list every record
+//   mqs-trace -r dump.trace     replay the recorded inputs on the simulated
+//                               backend; exits 1 if the outcome differs
+//
+// Dumps are written on SIGUSR2, by the control socket's "trace" command and
+// when the switcher crashes (trace_file in config.ini).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "backend_sim.h"
+#include "replay.h"
+#include "stats.h"
+#include "trace.h"
+
+enum { COLUMN_DELAY, COLUMN_DISPATCH, COLUMN_QUERY, COLUMN_GEOMETRY, COLUMN_WARP, COLUMN_NOTIFY, COLUMN_TOTAL, COLUMN_COUNT };
+
+static const char *const kColumns[COLUMN_COUNT] = { "delay", "dispatch", "query", "geometry", "warp", "notify", "total" };
+static const char *const kDirections[] = { "left", "right", "up", "down", "next", "prev" };
+
+static Histogram gHistograms[ACTION_COUNT][COLUMN_COUNT];
+
+static void describeAction(const TraceRecord *r, char *out, size_t size) {
+    const char *name = hotkeyActionName((HotkeyActionType)r->action);
+    if (r->action == ACTION_SWITCH || r->action == ACTION_DRAG || r->action == ACTION_EVACUATE) {
+        const char *direction = r->arg >= 0 && r->arg < 6 ? kDirections[r->arg] : "?";
+        if (r->hops > 1) snprintf(out, size, "%s %s x%u", name, direction, r->hops);
+        else snprintf(out, size, "%s %s", name, direction);
+    } else if (r->action == ACTION_JUMP) {
+        snprintf(out, size, "%s %d", name, r->arg);
+    } else {
+        snprintf(out, size, "%s", name);
+    }
+}
+
+static void printRecord(const TraceRecord *r, uint64_t originNs) {
+    char action[48];
+    describeAction(r, action, sizeof(action));
+    char key[40] = "";
+    if (r->kind == TRACE_KEY) {
+        snprintf(key, sizeof(key), "key %3u flags %08llx%s", r->keyCode, (unsigned long long)r->flags,
+                 r->autorepeat ? " rep" : "");
+    }
+    printf("%8u %10.3f ms  %-7s %-28s %-16s %-10s",
+           r->sequence, (double)(r->timeNs - originNs) / 1e6, traceKindName((TraceKind)r->kind),
+           key, action, traceOutcomeName((TraceOutcome)r->outcome));
+    if (r->toDisplay >= 0) {
+        printf("  #%d (%.0f,%.0f) -> #%d (%.0f,%.0f)", r->fromDisplay, r->fromX, r->fromY, r->toDisplay, r->toX, r->toY);
+    }
+    printf("  %.1f us\n", r->totalNs / 1e3);
+}
+
+static void printBreakdown(const TraceFile *file) {
+    uint32_t kinds[TRACE_KIND_COUNT] = { 0 }, outcomes[TRACE_SUPPRESSED + 1] = { 0 };
+    for (uint32_t i = 0; i < file->recordCount; i++) {
+        const TraceRecord *r = &file->records[i];
+        if (r->kind < TRACE_KIND_COUNT) kinds[r->kind]++;
+        if (r->outcome <= TRACE_SUPPRESSED) outcomes[r->outcome]++;
+        if (r->outcome != TRACE_PERFORMED || r->action >= ACTION_COUNT) continue;
+        Histogram *h = gHistograms[r->action];
+        if (r->delayNs) histogramRecord(&h[COLUMN_DELAY], r->delayNs);
+        for (int p = 0; p < TRACE_PHASES; p++) {
+            if (r->phaseNs[p]) histogramRecord(&h[COLUMN_DISPATCH + p], r->phaseNs[p]);
+        }
+        histogramRecord(&h[COLUMN_TOTAL], r->totalNs);
+    }
+
+    printf("%u records (%u key, %u control, %u flush, %u timer flush) on %u displays\n",
+           file->recordCount, kinds[TRACE_KEY], kinds[TRACE_CONTROL], kinds[TRACE_FLUSH_INLINE],
+           kinds[TRACE_FLUSH_TIMER], file->displayCount);
+    printf("outcomes: %u performed, %u failed, %u deferred, %u suppressed\n",
+           outcomes[TRACE_PERFORMED], outcomes[TRACE_FAILED], outcomes[TRACE_DEFERRED], outcomes[TRACE_SUPPRESSED]);
+    if (file->recordCount > 1) {
+        printf("span: %.3f s\n", (double)(file->records[file->recordCount - 1].timeNs - file->records[0].timeNs) / 1e9);
+    }
+    printf("\nlatency of performed actions, p50 / p99 in us\n%-8s %6s", "action", "count");
+    for (int c = 0; c < COLUMN_COUNT; c++) printf(" %17s", kColumns[c]);
+    printf("\n");
+    for (int a = ACTION_NONE + 1; a < ACTION_COUNT; a++) {
+        uint64_t count = gHistograms[a][COLUMN_TOTAL].count;
+        if (!count) continue;
+        printf("%-8s %6llu", hotkeyActionName((HotkeyActionType)a), (unsigned long long)count);
+        for (int c = 0; c < COLUMN_COUNT; c++) {
+            const Histogram *h = &gHistograms[a][c];
+            if (!h->count) {
+                printf(" %17s", "-");
+                continue;
+            }
+            printf(" %8.1f/%8.1f", histogramPercentile(h, 50.0) / 1e3, histogramPercentile(h, 99.0) / 1e3);
+        }
+        printf("\n");
+    }
+}
+
+static int replay(const TraceFile *file) {
+    SimBackend sim;
+    simBackendInit(&sim);
+    ReplayResult result;
+    char error[256];
+    if (!replayTrace(file, &sim, &result, error, sizeof(error))) {
+        fprintf(stderr, "mqs-trace: replay failed: %s\n", error);
+        simBackendFree(&sim);
+        return 1;
+    }
+    printf("replayed %u inputs: %u records compared, %u mismatches\n",
+           result.inputs, result.compared, result.mismatches);
+    if (result.firstMismatch >= 0) {
+        uint32_t i = (uint32_t)result.firstMismatch;
+        uint64_t origin = file->records[0].timeNs;
+        printf("first divergence at record %u\n  recorded: ", i);
+        if (i < file->recordCount) printRecord(&file->records[i], origin);
+        else printf("(none)\n");
+        printf("  replayed: ");
+        if (i < result.recordCount) printRecord(&result.records[i], origin);
+        else printf("(none)\n");
+    }
+    free(result.records);
+    simBackendFree(&sim);
+    return result.mismatches ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    bool list = false, replayInputs = false;
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-'; i++) {
+        if (strcmp(argv[i], "-l") == 0) list = true;
+        else if (strcmp(argv[i], "-r") == 0) replayInputs = true;
+        else break;
+    }
+    if (i != argc - 1) {
+        fprintf(stderr, "usage: mqs-trace [-l] [-r] dump.trace\n");
+        return 2;
+    }
+
+    TraceFile file;
+    char error[256];
+    if (!traceLoad(argv[i], &file, error, sizeof(error))) {
+        fprintf(stderr, "mqs-trace: %s\n", error);
+        return 1;
+    }
+    if (list) {
+        for (uint32_t r = 0; r < file.recordCount; r++) printRecord(&file.records[r], file.records[0].timeNs);
+        printf("\n");
+    }
+    printBreakdown(&file);
+    int status = 0;
+    if (replayInputs) {
+        printf("\n");
+        status = replay(&file);
+    }
+    traceFileFree(&file);
+    return status;
+}
@@ -0,0 +1,398 @@
+#include "topology.h"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "snapshot.h"
+
+static SnapshotSlot        gTopologySlot = SNAPSHOT_SLOT_INIT;
+static _Atomic uint64_t    gNextGeneration = 1;
+
+static bool spatiallyBefore(const TopoRect *a, const TopoRect *b) {
+    if (a->x != b->x) return a->x < b->x;
+    return a->y < b->y;
+}
+
+// Insertion sort of display indices; display counts are small and this keeps
+// topologyCreate() reentrant (no qsort comparator context).
+static void sortSpatial(const DisplayInfo *displays, uint32_t *order, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) order[i] = i;
+    for (uint32_t i = 1; i < count; i++) {
+        uint32_t item = order[i];
+        uint32_t j = i;
+        while (j > 0 && spatiallyBefore(&displays[item].bounds, &displays[order[j - 1]].bounds)) {
+            order[j] = order[j - 1];
+            j--;
+        }
+        order[j] = item;
+    }
+}
+
+// Length of the overlap of [a0, a1) and [b0, b1); <= 0 when disjoint.
+static double overlap(double a0, double a1, double b0, double b1) {
+    double lo = a0 > b0 ? a0 : b0;
+    double hi = a1 < b1 ? a1 : b1;
+    return hi - lo;
+}
+
+// Gap from a to b along `direction` (negative if b is not on that side) and
+// the overlap on the perpendicular axis.
+static void edgeRelation(const TopoRect *a, const TopoRect *b, TopoDirection direction,
+                         double *gap, double *shared) {
+    switch (direction) {
+        case TOPO_LEFT:
+            *gap = a->x - (b->x + b->width);
+            *shared = overlap(a->y, a->y + a->height, b->y, b->y + b->height);
+            break;
+        case TOPO_RIGHT:
+            *gap = b->x - (a->x + a->width);
+            *shared = overlap(a->y, a->y + a->height, b->y, b->y + b->height);
+            break;
+        case TOPO_UP:
+            *gap = a->y - (b->y + b->height);
+            *shared = overlap(a->x, a->x + a->width, b->x, b->x + b->width);
+            break;
+        case TOPO_DOWN:
+        default:
+            *gap = b->y - (a->y + a->height);
+            *shared = overlap(a->x, a->x + a->width, b->x, b->x + b->width);
+            break;
+    }
+}
+
+static double centerDistance2(const TopoRect *a, const TopoRect *b) {
+    double dx = (a->x + a->width / 2) - (b->x + b->width / 2);
+    double dy = (a->y + a->height / 2) - (b->y + b->height / 2);
+    return dx * dx + dy * dy;
+}
+
+// Nearest display on the given side of `from`. Displays overlapping on the
+// perpendicular axis win over diagonal ones; among those the smallest gap,
+// then the largest shared edge. Diagonal candidates fall back to center
+// distance. Rects may touch (gap 0) but not overlap along the direction.
+static int32_t findNeighbor(const DisplayInfo *displays, uint32_t count, uint32_t from,
+                            TopoDirection direction) {
+    const double slack = 1.0; // tolerate sub-point gaps/overlaps from rounding
+    int32_t best = -1;
+    bool bestOverlaps = false;
+    double bestGap = 0, bestShared = 0, bestDistance = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (i == from) continue;
+        double gap, shared;
+        edgeRelation(&displays[from].bounds, &displays[i].bounds, direction, &gap, &shared);
+        if (gap < -slack) continue;
+        bool overlaps = shared > 0;
+        double distance = centerDistance2(&displays[from].bounds, &displays[i].bounds);
+        bool better;
+        if (best < 0) better = true;
+        else if (overlaps != bestOverlaps) better = overlaps;
+        else if (overlaps) better = gap < bestGap || (gap == bestGap && shared > bestShared);
+        else better = distance < bestDistance;
+        if (better) {
+            best = (int32_t)i;
+            bestOverlaps = overlaps;
+            bestGap = gap;
+            bestShared = shared;
+            bestDistance = distance;
+        }
+    }
+    return best;
+}
+
+static void buildNeighbors(Topology *topology) {
+    for (uint32_t i = 0; i < topology->count; i++) {
+        for (int d = 0; d < TOPO_EDGE_DIRECTIONS; d++) {
+            topology->neighbors[i][d] = findNeighbor(topology->displays, topology->count, i, (TopoDirection)d);
+        }
+    }
+}
+
+static uint32_t cellIndex(double value, double origin, double cellSize, uint32_t cells) {
+    double c = (value - origin) / cellSize;
+    if (c < 0) return 0;
+    if (c >= cells) return cells - 1;
+    return (uint32_t)c;
+}
+
+// Roughly two cells per display along each axis keeps most cells to one or
+// two candidates without blowing up memory for large walls.
+static bool buildGrid(Topology *topology) {
+    uint32_t count = topology->count;
+    double minX = topology->displays[0].bounds.x, minY = topology->displays[0].bounds.y;
+    double maxX = minX + topology->displays[0].bounds.width, maxY = minY + topology->displays[0].bounds.height;
+    for (uint32_t i = 1; i < count; i++) {
+        const TopoRect *r = &topology->displays[i].bounds;
+        if (r->x < minX) minX = r->x;
+        if (r->y < minY) minY = r->y;
+        if (r->x + r->width > maxX) maxX = r->x + r->width;
+        if (r->y + r->height > maxY) maxY = r->y + r->height;
+    }
+    topology->extent = (TopoRect){ minX, minY, maxX - minX, maxY - minY };
+
+    uint32_t side = 1;
+    while (side * side < count) side++;
+    topology->gridColumns = topology->gridRows = side * 2;
+    topology->cellWidth = topology->extent.width > 0 ? topology->extent.width / topology->gridColumns : 1.0;
+    topology->cellHeight = topology->extent.height > 0 ? topology->extent.height / topology->gridRows : 1.0;
+
+    uint32_t cells = topology->gridColumns * topology->gridRows;
+    topology->gridStart = calloc(cells + 1, sizeof(*topology->gridStart));
+    if (!topology->gridStart) return false;
+
+    // Pass 1: count displays per cell; pass 2: fill (CSR layout).
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t *cursor = NULL;
+        if (pass == 1) {
+            for (uint32_t c = 0; c < cells; c++) topology->gridStart[c + 1] += topology->gridStart[c];
+            topology->gridItems = malloc((topology->gridStart[cells] + 1) * sizeof(*topology->gridItems));
+            cursor = malloc(cells * sizeof(*cursor));
+            if (!topology->gridItems || !cursor) {
+                free(cursor);
+                return false;
+            }
+            memcpy(cursor, topology->gridStart, cells * sizeof(*cursor));
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            const TopoRect *r = &topology->displays[i].bounds;
+            uint32_t c0 = cellIndex(r->x, minX, topology->cellWidth, topology->gridColumns);
+            uint32_t c1 = cellIndex(r->x + r->width, minX, topology->cellWidth, topology->gridColumns);
+            uint32_t r0 = cellIndex(r->y, minY, topology->cellHeight, topology->gridRows);
+            uint32_t r1 = cellIndex(r->y + r->height, minY, topology->cellHeight, topology->gridRows);
+            for (uint32_t row = r0; row <= r1; row++) {
+                for (uint32_t col = c0; col <= c1; col++) {
+                    uint32_t c = row * topology->gridColumns + col;
+                    if (pass == 0) topology->gridStart[c + 1]++;
+                    else topology->gridItems[cursor[c]++] = i;
+                }
+            }
+        }
+        free(cursor);
+    }
+    return true;
+}
+
+static const char *const kMappingNames[TOPO_MAP_COUNT] = { "default", "proportional", "physical", "edge" };
+
+bool topologyParseMapping(const char *name, TopoMapping *mapping) {
+    for (int m = TOPO_MAP_PROPORTIONAL; m < TOPO_MAP_COUNT; m++) {
+        if (strcasecmp(name, kMappingNames[m]) == 0) {
+            *mapping = (TopoMapping)m;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *topologyMappingName(TopoMapping mapping) {
+    return mapping < TOPO_MAP_COUNT ? kMappingNames[mapping] : "?";
+}
+
+TopoMapping topologyPairMapping(const Topology *topology, int from, int to) {
+    uint32_t a = topology->rank[from], b = topology->rank[to];
+    TopoMapping mapping = TOPO_MAP_DEFAULT;
+    if (a < TOPO_MAPPING_DISPLAYS && b < TOPO_MAPPING_DISPLAYS) mapping = topology->mapping.pairs[a][b];
+    if (mapping == TOPO_MAP_DEFAULT || mapping >= TOPO_MAP_COUNT) mapping = topology->mapping.mode;
+    if (mapping == TOPO_MAP_DEFAULT || mapping >= TOPO_MAP_COUNT) mapping = TOPO_MAP_PROPORTIONAL;
+    const DisplayInfo *source = &topology->displays[from], *target = &topology->displays[to];
+    if (mapping == TOPO_MAP_PHYSICAL && !(source->widthMm > 0 && source->heightMm > 0 &&
+                                          target->widthMm > 0 && target->heightMm > 0)) {
+        mapping = TOPO_MAP_PROPORTIONAL;
+    }
+    return mapping;
+}
+
+// One axis of a transform: [a0, a0 + aLength) onto [b0, b0 + bLength)
+static void proportionalAxis(double a0, double aLength, double b0, double bLength, double *scale, double *offset) {
+    *scale = aLength > 0 ? bLength / aLength : 0;
+    *offset = b0 - a0 * *scale;
+}
+
+// Centers matched, distances scaled by the ratio of millimetres per point
+static void physicalAxis(double a0, double aLength, double aMm, double b0, double bLength, double bMm,
+                         double *scale, double *offset) {
+    *scale = (aMm / aLength) / (bMm / bLength);
+    *offset = (b0 + bLength / 2) - (a0 + aLength / 2) * *scale;
+}
+
+TopoTransform topologyBuildTransform(const DisplayInfo *from, const DisplayInfo *to, TopoMapping mapping) {
+    TopoRect a = from->bounds, b = to->bounds;
+    TopoTransform t = {
+        // Clamped onto the display: its far edges belong to the next one
+        .minX = b.x, .maxX = b.width > 0 ? nextafter(b.x + b.width, b.x) : b.x,
+        .minY = b.y, .maxY = b.height > 0 ? nextafter(b.y + b.height, b.y) : b.y,
+    };
+    bool physical = mapping == TOPO_MAP_PHYSICAL && a.width > 0 && a.height > 0 && b.width > 0 && b.height > 0 &&
+                    from->widthMm > 0 && from->heightMm > 0 && to->widthMm > 0 && to->heightMm > 0;
+    if (physical) {
+        physicalAxis(a.x, a.width, from->widthMm, b.x, b.width, to->widthMm, &t.scaleX, &t.offsetX);
+        physicalAxis(a.y, a.height, from->heightMm, b.y, b.height, to->heightMm, &t.scaleY, &t.offsetY);
+        return t;
+    }
+    proportionalAxis(a.x, a.width, b.x, b.width, &t.scaleX, &t.offsetX);
+    proportionalAxis(a.y, a.height, b.y, b.height, &t.scaleY, &t.offsetY);
+    if (mapping == TOPO_MAP_EDGE) {
+        // Side by side when they are further apart horizontally than
+        // vertically: then the height is what the edge shares, and is kept
+        double gapX = fmax(b.x - (a.x + a.width), a.x - (b.x + b.width));
+        double gapY = fmax(b.y - (a.y + a.height), a.y - (b.y + b.height));
+        if (gapX >= gapY) {
+            t.scaleY = 1;
+            t.offsetY = 0;
+        } else {
+            t.scaleX = 1;
+            t.offsetX = 0;
+        }
+    }
+    return t;
+}
+
+static bool buildTransforms(Topology *topology) {
+    uint32_t count = topology->count;
+    if (count > TOPO_TRANSFORM_MAX) return true;
+    topology->transforms = malloc((size_t)count * count * sizeof(*topology->transforms));
+    if (!topology->transforms) return false;
+    for (uint32_t from = 0; from < count; from++) {
+        for (uint32_t to = 0; to < count; to++) {
+            topology->transforms[from * count + to] = topologyBuildTransform(
+                &topology->displays[from], &topology->displays[to], topologyPairMapping(topology, (int)from, (int)to));
+        }
+    }
+    return true;
+}
+
+Topology *topologyCreate(const DisplayInfo *displays, uint32_t count) {
+    return topologyCreateMapped(displays, count, NULL);
+}
+
+Topology *topologyCreateMapped(const DisplayInfo *displays, uint32_t count, const TopoMappingOptions *mapping) {
+    if (count == 0) return NULL;
+    Topology *topology = calloc(1, sizeof(*topology));
+    if (!topology) return NULL;
+    topology->displays = malloc(count * sizeof(*topology->displays));
+    topology->order = malloc(count * sizeof(*topology->order));
+    topology->rank = malloc(count * sizeof(*topology->rank));
+    topology->neighbors = malloc(count * sizeof(*topology->neighbors));
+    if (!topology->displays || !topology->order || !topology->rank || !topology->neighbors) {
+        topologyDestroy(topology);
+        return NULL;
+    }
+    memcpy(topology->displays, displays, count * sizeof(*displays));
+    topology->count = count;
+    topology->generation = atomic_fetch_add(&gNextGeneration, 1);
+
+    sortSpatial(topology->displays, topology->order, count);
+    for (uint32_t i = 0; i < count; i++) topology->rank[topology->order[i]] = i;
+    buildNeighbors(topology);
+    if (mapping) topology->mapping = *mapping;
+    if (!buildGrid(topology) || !buildTransforms(topology)) {
+        topologyDestroy(topology);
+        return NULL;
+    }
+    return topology;
+}
+
+void topologyDestroy(Topology *topology) {
+    if (!topology) return;
+    free(topology->displays);
+    free(topology->order);
+    free(topology->rank);
+    free(topology->neighbors);
+    free(topology->gridStart);
+    free(topology->gridItems);
+    free(topology->transforms);
+    free(topology);
+}
+
+int topologyDisplayAt(const Topology *topology, TopoPoint p) {
+    if (!topoRectContains(topology->extent, p)) return -1;
+    uint32_t col = cellIndex(p.x, topology->extent.x, topology->cellWidth, topology->gridColumns);
+    uint32_t row = cellIndex(p.y, topology->extent.y, topology->cellHeight, topology->gridRows);
+    uint32_t c = row * topology->gridColumns + col;
+    for (uint32_t k = topology->gridStart[c]; k < topology->gridStart[c + 1]; k++) {
+        uint32_t i = topology->gridItems[k];
+        if (topoRectContains(topology->displays[i].bounds, p)) return (int)i;
+    }
+    return -1;
+}
+
+static TopoDirection opposite(TopoDirection direction) {
+    switch (direction) {
+        case TOPO_LEFT:  return TOPO_RIGHT;
+        case TOPO_RIGHT: return TOPO_LEFT;
+        case TOPO_UP:    return TOPO_DOWN;
+        default:         return TOPO_UP;
+    }
+}
+
+int topologyNeighbor(const Topology *topology, int index, TopoDirection direction) {
+    if (index < 0 || (uint32_t)index >= topology->count || topology->count < 2) return -1;
+    if (direction == TOPO_NEXT || direction == TOPO_PREV) {
+        uint32_t step = direction == TOPO_NEXT ? 1 : topology->count - 1;
+        return (int)topology->order[(topology->rank[index] + step) % topology->count];
+    }
+    int32_t next = topology->neighbors[index][direction];
+    if (next >= 0) return next;
+
+    // Nothing further that way: wrap to the far end of this row/column.
+    // Bounded by count so malformed layouts cannot loop forever.
+    TopoDirection back = opposite(direction);
+    int32_t far = index;
+    for (uint32_t hops = 0; hops < topology->count; hops++) {
+        int32_t step = topology->neighbors[far][back];
+        if (step < 0) break;
+        far = step;
+    }
+    return far == index ? -1 : far;
+}
+
+int topologyNeighborN(const Topology *topology, int index, TopoDirection direction, uint32_t hops) {
+    if (index < 0 || (uint32_t)index >= topology->count || topology->count < 2 || hops == 0) return -1;
+    if (direction == TOPO_NEXT || direction == TOPO_PREV) {
+        uint32_t step = hops % topology->count;
+        if (direction == TOPO_PREV) step = topology->count - step;
+        return (int)topology->order[(topology->rank[index] + step) % topology->count];
+    }
+    // Every row/column wraps, so the walk is a cycle: skip whole laps
+    int current = index;
+    for (uint32_t i = 0; i < hops; i++) {
+        current = topologyNeighbor(topology, current, direction);
+        if (current < 0) return -1;
+        if (current == index) {
+            uint32_t lap = i + 1;
+            for (uint32_t rest = (hops - lap) % lap; rest > 0; rest--) {
+                current = topologyNeighbor(topology, current, direction);
+            }
+            break;
+        }
+    }
+    return current;
+}
+
+int topologyIndexOf(const Topology *topology, uint32_t id) {
+    for (uint32_t i = 0; i < topology->count; i++) {
+        if (topology->displays[i].id == id) return (int)i;
+    }
+    return -1;
+}
+
+TopoPoint topologyMapPoint(const Topology *topology, int from, int to, TopoPoint p) {
+    if (topology->transforms) return topoTransformApply(&topology->transforms[from * topology->count + to], p);
+    TopoTransform t = topologyBuildTransform(&topology->displays[from], &topology->displays[to],
+                                             topologyPairMapping(topology, from, to));
+    return topoTransformApply(&t, p);
+}
+
+void topologyPublish(Topology *next) {
+    topologyDestroy(snapshotExchange(&gTopologySlot, next));
+}
+
+const Topology *topologyAcquire(unsigned *token) {
+    return snapshotAcquire(&gTopologySlot, token);
+}
+
+void topologyRelease(unsigned token) {
+    snapshotRelease(&gTopologySlot, token);
+}
@@ -0,0 +1,146 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Immutable snapshot of the display arrangement.
+//
+// Built once from the platform's display list and rebuilt only when the
+// display configuration changes. Plain C with no CoreGraphics dependency so
+// the geometry can be exercised with synthetic layouts off a Mac.
+//
+// Building precomputes everything the hot path needs: a direction-aware
+// neighbor graph (left/right/up/down resolve in O(1)), the stable spatial
+// ordering used for next/previous cycling, a uniform grid index so
+// point-to-display lookup stays O(1) on large video walls, and an affine
+// transform per ordered display pair so mapping the cursor from one display
+// to another is one table lookup and a multiply-add per axis.
+
+typedef struct { double x, y; } TopoPoint;
+typedef struct { double x, y, width, height; } TopoRect;
+
+typedef enum {
+    TOPO_LEFT = 0,
+    TOPO_RIGHT,
+    TOPO_UP,
+    TOPO_DOWN,
+    TOPO_NEXT,              // next display in spatial order (wraps)
+    TOPO_PREV,              // previous display in spatial order (wraps)
+} TopoDirection;
+
+#define TOPO_EDGE_DIRECTIONS 4
+
+typedef struct {
+    uint32_t id;            // CGDirectDisplayID on macOS
+    TopoRect bounds;        // global display coordinates, in points
+    double   scale;         // backing pixels per point (2.0 on Retina)
+    double   widthMm;       // physical panel size, 0 = unknown
+    double   heightMm;
+} DisplayInfo;
+
+// How a point on one display corresponds to a point on another
+typedef enum {
+    TOPO_MAP_DEFAULT = 0,   // per-pair setting only: whatever the overall mode is
+    TOPO_MAP_PROPORTIONAL,  // same fraction of the width and height
+    TOPO_MAP_PHYSICAL,      // same distance in millimetres from the center
+                            // (proportional when a panel size is unknown)
+    TOPO_MAP_EDGE,          // as if crossing the edge between them: the
+                            // coordinate along that edge is kept
+    TOPO_MAP_COUNT
+} TopoMapping;
+
+#define TOPO_MAPPING_DISPLAYS 9     // pairs that can be set individually: displays 1-9
+#define TOPO_TRANSFORM_MAX    64    // displays with a precomputed transform table
+
+typedef struct {
+    uint8_t mode;           // TopoMapping for every pair not set below (DEFAULT = proportional)
+    uint8_t pairs[TOPO_MAPPING_DISPLAYS][TOPO_MAPPING_DISPLAYS]; // [from - 1][to - 1] by display number
+} TopoMappingOptions;
+
+// p' = p * scale + offset per axis, then clamped into the target display
+typedef struct {
+    double scaleX, offsetX, scaleY, offsetY;
+    double minX, maxX, minY, maxY;
+} TopoTransform;
+
+typedef struct Topology {
+    uint64_t     generation;
+    uint32_t     count;
+    DisplayInfo *displays;  // in platform enumeration order
+    uint32_t    *order;     // display indices sorted left-to-right, top-to-bottom
+    uint32_t    *rank;      // rank[i] = position of display i in order[]
+    int32_t    (*neighbors)[TOPO_EDGE_DIRECTIONS]; // -1 = none
+
+    // Uniform grid over the bounding box of all displays. Cell c lists the
+    // displays intersecting it: gridItems[gridStart[c] .. gridStart[c+1]).
+    TopoRect     extent;
+    uint32_t     gridColumns, gridRows;
+    double       cellWidth, cellHeight;
+    uint32_t    *gridStart;
+    uint32_t    *gridItems;
+
+    // transforms[from * count + to]; NULL above TOPO_TRANSFORM_MAX displays,
+    // where they are built per call instead
+    TopoMappingOptions mapping;
+    TopoTransform     *transforms;
+} Topology;
+
+// Copy the given displays into a new snapshot, mapping points between them
+// proportionally. Returns NULL on allocation failure or when count is 0.
+Topology *topologyCreate(const DisplayInfo *displays, uint32_t count);
+
+// The same with the given mapping (NULL = proportional everywhere)
+Topology *topologyCreateMapped(const DisplayInfo *displays, uint32_t count, const TopoMappingOptions *mapping);
+void topologyDestroy(Topology *topology);
+
+// Index of the display containing p, or -1 if p is on no display.
+int topologyDisplayAt(const Topology *topology, TopoPoint p);
+
+// Index of the display with the given id, or -1.
+int topologyIndexOf(const Topology *topology, uint32_t id);
+
+// Display reached from `index` in the given direction, or -1. Edge
+// directions use the neighbor graph; when there is nothing further that way
+// they wrap to the far end of the same row/column.
+int topologyNeighbor(const Topology *topology, int index, TopoDirection direction);
+
+// Display reached after `hops` steps (>= 1) in one direction, or -1. Going
+// all the way round a cycle lands back on `index`.
+int topologyNeighborN(const Topology *topology, int index, TopoDirection direction, uint32_t hops);
+
+// Mapping used from display `from` to display `to` (never DEFAULT, and
+// PHYSICAL only when both panel sizes are known)
+TopoMapping topologyPairMapping(const Topology *topology, int from, int to);
+
+// Transform taking points on `from` to `to` under `mapping`
+TopoTransform topologyBuildTransform(const DisplayInfo *from, const DisplayInfo *to, TopoMapping mapping);
+
+static inline TopoPoint topoTransformApply(const TopoTransform *t, TopoPoint p) {
+    TopoPoint out = { p.x * t->scaleX + t->offsetX, p.y * t->scaleY + t->offsetY };
+    if (out.x < t->minX) out.x = t->minX;
+    if (out.x > t->maxX) out.x = t->maxX;
+    if (out.y < t->minY) out.y = t->minY;
+    if (out.y > t->maxY) out.y = t->maxY;
+    return out;
+}
+
+// Map p from display `from` to display `to` under the topology's mapping,
+// clamped into the target bounds.
+TopoPoint topologyMapPoint(const Topology *topology, int from, int to, TopoPoint p);
+
+// Parse "proportional", "physical" or "edge"; false if it is none of them
+bool topologyParseMapping(const char *name, TopoMapping *mapping);
+const char *topologyMappingName(TopoMapping mapping);
+
+static inline bool topoRectContains(TopoRect r, TopoPoint p) {
+    return p.x >= r.x && p.x < r.x + r.width && p.y >= r.y && p.y < r.y + r.height;
+}
+
+// Process-wide current snapshot. Publishing takes ownership of `next` and
+// frees the previous snapshot once no reader can still hold it.
+void topologyPublish(Topology *next);
+const Topology *topologyAcquire(unsigned *token);
+void topologyRelease(unsigned token);
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,299 @@
+#include "trace.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "log.h"
+
+_Static_assert((TRACE_CAPACITY & (TRACE_CAPACITY - 1)) == 0, "TRACE_CAPACITY must be a power of two");
+
+// A slot's stamp is its ticket + 1 once the record is complete and 0 while
+// a writer is filling it, so readers can tell torn copies apart.
+typedef struct {
+    _Atomic uint64_t stamp;
+    TraceRecord      record;
+} TraceSlot;
+
+static TraceSlot        gRing[TRACE_CAPACITY];
+static _Atomic uint64_t gHead;
+
+// On-disk layout: header, displayCount TraceFileDisplay, then records to EOF.
+// Version 2 appended fields to both; version 1 files end each at the marker.
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t recordSize;
+    uint32_t displayCount;
+    uint32_t jumpAnchor;
+    uint32_t repeatWindowMs;
+    uint32_t repeatPolicy;
+    uint32_t repeatMaxRate;
+    uint32_t repeatAccelEvery;
+    uint32_t repeatMaxHops;
+    uint64_t dumpTimeNs;
+    // version 1 ends here
+    TopoMappingOptions mapping;
+} TraceFileHeader;
+
+typedef struct {
+    uint32_t id;
+    uint32_t reserved;
+    double   x, y, width, height, scale;
+    // version 1 ends here
+    double   widthMm, heightMm;
+} TraceFileDisplay;
+
+#define TRACE_V1_HEADER_SIZE  offsetof(TraceFileHeader, mapping)
+#define TRACE_V1_DISPLAY_SIZE offsetof(TraceFileDisplay, widthMm)
+
+static TraceFileHeader gContext = {
+    .magic = TRACE_MAGIC,
+    .version = TRACE_VERSION,
+    .headerSize = sizeof(TraceFileHeader),
+    .recordSize = sizeof(TraceRecord),
+};
+
+static char gDumpPath[1024];
+static int  gDumpSignal;
+
+static const char *const kKindNames[TRACE_KIND_COUNT] = { "key", "control", "flush", "timer" };
+static const char *const kOutcomeNames[] = { "performed", "failed", "deferred", "suppressed" };
+
+const char *traceKindName(TraceKind kind) {
+    return kind < TRACE_KIND_COUNT ? kKindNames[kind] : "?";
+}
+
+const char *traceOutcomeName(TraceOutcome outcome) {
+    return outcome <= TRACE_SUPPRESSED ? kOutcomeNames[outcome] : "?";
+}
+
+void traceSetContext(const RepeatOptions *repeat, int jumpAnchor, const TopoMappingOptions *mapping) {
+    if (repeat) {
+        gContext.repeatWindowMs = repeat->windowMs;
+        gContext.repeatPolicy = (uint32_t)repeat->policy;
+        gContext.repeatMaxRate = repeat->maxRate;
+        gContext.repeatAccelEvery = repeat->accelEvery;
+        gContext.repeatMaxHops = repeat->maxHops;
+    }
+    if (jumpAnchor >= 0) gContext.jumpAnchor = (uint32_t)jumpAnchor;
+    if (mapping) gContext.mapping = *mapping;
+}
+
+void traceAppend(const TraceRecord *record) {
+    uint64_t ticket = atomic_fetch_add_explicit(&gHead, 1, memory_order_relaxed);
+    TraceSlot *slot = &gRing[ticket & (TRACE_CAPACITY - 1)];
+    atomic_store_explicit(&slot->stamp, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    slot->record = *record;
+    slot->record.sequence = (uint32_t)ticket;
+    atomic_store_explicit(&slot->stamp, ticket + 1, memory_order_release);
+}
+
+// Copy the record written with `ticket`, if it is still intact
+static bool readSlot(uint64_t ticket, TraceRecord *out) {
+    TraceSlot *slot = &gRing[ticket & (TRACE_CAPACITY - 1)];
+    if (atomic_load_explicit(&slot->stamp, memory_order_acquire) != ticket + 1) return false;
+    memcpy(out, &slot->record, sizeof(*out));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->stamp, memory_order_relaxed) == ticket + 1;
+}
+
+static uint64_t firstTicket(uint64_t head) {
+    return head > TRACE_CAPACITY ? head - TRACE_CAPACITY : 0;
+}
+
+uint64_t traceCount(void) {
+    return atomic_load_explicit(&gHead, memory_order_acquire);
+}
+
+uint32_t traceSnapshot(TraceRecord *out, uint32_t capacity) {
+    uint64_t head = atomic_load_explicit(&gHead, memory_order_acquire);
+    uint32_t count = 0;
+    for (uint64_t ticket = firstTicket(head); ticket < head && count < capacity; ticket++) {
+        if (readSlot(ticket, &out[count])) count++;
+    }
+    return count;
+}
+
+static bool writeAll(int fd, const void *data, size_t length) {
+    const char *p = data;
+    while (length > 0) {
+        ssize_t n = write(fd, p, length);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        p += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+bool traceDumpFd(int fd) {
+    TraceFileHeader header = gContext;
+    header.dumpTimeNs = statsNowNs();
+
+    unsigned token;
+    const Topology *topology = topologyAcquire(&token);
+    header.displayCount = topology ? topology->count : 0;
+    bool ok = writeAll(fd, &header, sizeof(header));
+    for (uint32_t i = 0; ok && i < header.displayCount; i++) {
+        const DisplayInfo *d = &topology->displays[i];
+        TraceFileDisplay display = {
+            .id = d->id,
+            .x = d->bounds.x, .y = d->bounds.y, .width = d->bounds.width, .height = d->bounds.height,
+            .scale = d->scale, .widthMm = d->widthMm, .heightMm = d->heightMm,
+        };
+        ok = writeAll(fd, &display, sizeof(display));
+    }
+    topologyRelease(token);
+
+    // Batches on the stack: no allocation, safe from a signal handler
+    TraceRecord batch[64];
+    uint32_t batched = 0;
+    uint64_t head = atomic_load_explicit(&gHead, memory_order_acquire);
+    for (uint64_t ticket = firstTicket(head); ok && ticket < head; ticket++) {
+        if (readSlot(ticket, &batch[batched])) batched++;
+        if (batched == sizeof(batch) / sizeof(batch[0]) || (ticket + 1 == head && batched)) {
+            ok = writeAll(fd, batch, batched * sizeof(batch[0]));
+            batched = 0;
+        }
+    }
+    return ok;
+}
+
+bool traceDump(const char *path) {
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        LOG_ERROR("trace: cannot write %s: %s", path, strerror(errno));
+        return false;
+    }
+    bool ok = traceDumpFd(fd);
+    close(fd);
+    return ok;
+}
+
+const char *traceDumpPath(void) {
+    return gDumpPath[0] ? gDumpPath : NULL;
+}
+
+// Fatal signal: write what we have, then let the default action run
+static void crashHandler(int signo) {
+    int fd = open(gDumpPath, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd >= 0) {
+        traceDumpFd(fd);
+        close(fd);
+    }
+    raise(signo);
+}
+
+static void *dumpMain(void *arg) {
+    (void)arg;
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, gDumpSignal);
+    for (;;) {
+        int received;
+        if (sigwait(&set, &received) != 0) continue;
+        if (traceDump(gDumpPath)) {
+            LOG_INFO("Wrote trace to %s", gDumpPath);
+        }
+    }
+    return NULL;
+}
+
+bool traceStartDumps(const char *path, int signo) {
+    if (strlen(path) >= sizeof(gDumpPath)) return false;
+    strcpy(gDumpPath, path);
+    gDumpSignal = signo;
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = crashHandler;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    const int fatal[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+    for (size_t i = 0; i < sizeof(fatal) / sizeof(fatal[0]); i++) sigaction(fatal[i], &action, NULL);
+
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, signo);
+    if (pthread_sigmask(SIG_BLOCK, &set, NULL) != 0) return false;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, dumpMain, NULL) != 0) return false;
+    pthread_detach(thread);
+    return true;
+}
+
+bool traceLoad(const char *path, TraceFile *out, char *error, size_t errorSize) {
+    memset(out, 0, sizeof(*out));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        snprintf(error, errorSize, "cannot open %s: %s", path, strerror(errno));
+        return false;
+    }
+    TraceFileHeader header = { 0 };
+    if (fread(&header, TRACE_V1_HEADER_SIZE, 1, f) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        snprintf(error, errorSize, "%s is not a trace dump", path);
+        fclose(f);
+        return false;
+    }
+    size_t headerSize = header.version == 1 ? TRACE_V1_HEADER_SIZE : sizeof(header);
+    size_t displaySize = header.version == 1 ? TRACE_V1_DISPLAY_SIZE : sizeof(TraceFileDisplay);
+    if (header.version < 1 || header.version > TRACE_VERSION || header.headerSize != headerSize ||
+        header.recordSize != sizeof(TraceRecord) ||
+        (headerSize > TRACE_V1_HEADER_SIZE &&
+         fread((char *)&header + TRACE_V1_HEADER_SIZE, headerSize - TRACE_V1_HEADER_SIZE, 1, f) != 1)) {
+        snprintf(error, errorSize, "%s: unsupported trace version %u", path, header.version);
+        fclose(f);
+        return false;
+    }
+    out->repeat = (RepeatOptions){
+        .windowMs = header.repeatWindowMs,
+        .policy = (RepeatPolicy)header.repeatPolicy,
+        .maxRate = header.repeatMaxRate,
+        .accelEvery = header.repeatAccelEvery,
+        .maxHops = header.repeatMaxHops,
+    };
+    out->jumpAnchor = (int)header.jumpAnchor;
+    out->mapping = header.mapping;
+    out->dumpTimeNs = header.dumpTimeNs;
+
+    out->displays = calloc(header.displayCount ? header.displayCount : 1, sizeof(DisplayInfo));
+    out->records = malloc(TRACE_CAPACITY * sizeof(TraceRecord));
+    if (!out->displays || !out->records) {
+        snprintf(error, errorSize, "out of memory");
+        traceFileFree(out);
+        fclose(f);
+        return false;
+    }
+    for (uint32_t i = 0; i < header.displayCount; i++) {
+        TraceFileDisplay d = { 0 };
+        if (fread(&d, displaySize, 1, f) != 1) {
+            snprintf(error, errorSize, "%s: truncated display list", path);
+            traceFileFree(out);
+            fclose(f);
+            return false;
+        }
+        out->displays[i] = (DisplayInfo){ d.id, { d.x, d.y, d.width, d.height }, d.scale, d.widthMm, d.heightMm };
+    }
+    out->displayCount = header.displayCount;
+    out->recordCount = (uint32_t)fread(out->records, sizeof(TraceRecord), TRACE_CAPACITY, f);
+    fclose(f);
+    return true;
+}
+
+void traceFileFree(TraceFile *file) {
+    free(file->displays);
+    free(file->records);
+    memset(file, 0, sizeof(*file));
+}
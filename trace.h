@@ -0,0 +1,107 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "repeat.h"
+#include "stats.h"
+#include "topology.h"
+
+// Always-on flight recorder for hotkey actions.
+//
+// Every hotkey that matched a binding, every control-socket command and
+// every deferred multi-hop switch appends one fixed-size binary record to a
+// lock-free ring (the newest TRACE_CAPACITY records survive). Keystrokes
+// that match no binding are never recorded. The ring is dumped to a file on
+// a signal, on request, or from a crash handler (which only uses write(2)),
+// and tools/mqs-trace decodes and replays dumps.
+
+#define TRACE_CAPACITY 4096          // records; power of two
+#define TRACE_MAGIC    "MQSTRACE"
+#define TRACE_VERSION  2            // 2: cursor mapping and panel sizes; 1 is still read
+
+typedef enum {
+    TRACE_KEY = 0,           // hotkey from the event tap (input)
+    TRACE_CONTROL,           // command from the control socket (input)
+    TRACE_FLUSH_INLINE,      // deferred switches run ahead of the next input
+    TRACE_FLUSH_TIMER,       // deferred switches run when the repeat window closed
+    TRACE_KIND_COUNT
+} TraceKind;
+
+typedef enum {
+    TRACE_PERFORMED = 0,
+    TRACE_FAILED,            // the action could not be carried out
+    TRACE_DEFERRED,          // folded into a later multi-hop switch
+    TRACE_SUPPRESSED,        // auto-repeat dropped by the repeat policy
+} TraceOutcome;
+
+// Phases captured per record: the StatsPhase values up to the notification
+#define TRACE_PHASES (PHASE_NOTIFY + 1)
+
+typedef struct {
+    uint64_t timeNs;         // event timestamp (statsNowNs() time base)
+    uint64_t flags;          // modifier flags of the key-down
+    uint32_t sequence;       // position in the ring's history
+    uint16_t keyCode;
+    uint8_t  kind;           // TraceKind
+    uint8_t  action;         // HotkeyActionType
+    int32_t  arg;            // direction or display number
+    uint16_t hops;           // displays moved by a switch
+    uint8_t  autorepeat;
+    uint8_t  outcome;        // TraceOutcome
+    int16_t  fromDisplay;    // topology display indices, -1 = unknown
+    int16_t  toDisplay;
+    float    fromX, fromY;   // cursor before the action (when a display is known)
+    float    toX, toY;       // cursor after
+    uint32_t phaseNs[TRACE_PHASES];
+    uint32_t delayNs;        // event timestamp to handler start (0 = unknown)
+    uint32_t totalNs;        // handler start to finish
+} TraceRecord;
+
+_Static_assert(sizeof(TraceRecord) == 80, "trace records are part of the dump format");
+
+// Settings that replay needs; refreshed by the switcher when they change
+// (NULL / -1 = unchanged)
+void traceSetContext(const RepeatOptions *repeat, int jumpAnchor, const TopoMappingOptions *mapping);
+
+// Append a record (any thread, lock-free, never blocks or allocates)
+void traceAppend(const TraceRecord *record);
+
+// Records appended since start (the ring keeps the last TRACE_CAPACITY)
+uint64_t traceCount(void);
+
+// Copy the surviving records, oldest first, into out (up to capacity).
+// Records being overwritten while copying are skipped.
+uint32_t traceSnapshot(TraceRecord *out, uint32_t capacity);
+
+// Write a dump: header, the current display list, then the records.
+// traceDumpFd() is async-signal-safe.
+bool traceDumpFd(int fd);
+bool traceDump(const char *path);
+
+// Dump to `path` when `signo` arrives and when the process crashes. Blocks
+// signo in the calling thread; call before starting other threads.
+bool traceStartDumps(const char *path, int signo);
+const char *traceDumpPath(void);
+
+// A dump read back from disk
+typedef struct {
+    RepeatOptions repeat;
+    int           jumpAnchor;
+    TopoMappingOptions mapping;
+    uint64_t      dumpTimeNs;
+    DisplayInfo  *displays;
+    uint32_t      displayCount;
+    TraceRecord  *records;
+    uint32_t      recordCount;
+} TraceFile;
+
+bool traceLoad(const char *path, TraceFile *out, char *error, size_t errorSize);
+void traceFileFree(TraceFile *file);
+
+const char *traceKindName(TraceKind kind);
+const char *traceOutcomeName(TraceOutcome outcome);
+
+#endif // TRACE_H
@@ -0,0 +1,208 @@
+#include "watchdog.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+#include "log.h"
+#include "stats.h"
+
+_Static_assert((WATCHDOG_QUEUE_SIZE & (WATCHDOG_QUEUE_SIZE - 1)) == 0, "queue size must be a power of two");
+
+// Moving average weight of the newest sample: 1 / 2^EWMA_SHIFT
+#define EWMA_SHIFT 2
+
+static const char *const kReasonNames[] = { "timeout", "user input", "found disabled" };
+
+static _Atomic uint32_t gBudgetUs = 10000;
+static WatchdogOptions  gOptions = WATCHDOG_DEFAULT_OPTIONS;   // tap state only
+
+// Tap state, touched by the tap's thread only
+static bool     gPending;
+static uint64_t gReenableAt;
+static uint64_t gEnabledAt;        // most recent re-enable, 0 = none yet
+static uint64_t gBackoffNs;
+
+static _Atomic uint64_t gPredictNs[ACTION_COUNT];
+
+// Deferral worker
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  gWake = PTHREAD_COND_INITIALIZER;
+static pthread_t       gThread;
+static bool            gRunning;                     // guarded by gLock
+static WatchdogJob     gQueue[WATCHDOG_QUEUE_SIZE];  // guarded by gLock
+static uint32_t        gHead, gTail;                 // guarded by gLock
+static void          (*gRun)(const WatchdogJob *job);
+static _Atomic bool     gStarted;
+static _Atomic uint32_t gOutstanding;                // queued or running
+static _Atomic uint64_t gLastRunNs;
+
+static _Atomic uint64_t gDisables, gReenables, gOverruns, gDeferred, gInlineFull, gLastBackoffMs;
+
+void watchdogConfigure(const WatchdogOptions *options) {
+    gOptions = *options;
+    if (gOptions.backoffMinMs == 0) gOptions.backoffMinMs = 1;
+    if (gOptions.backoffMaxMs < gOptions.backoffMinMs) gOptions.backoffMaxMs = gOptions.backoffMinMs;
+    atomic_store(&gBudgetUs, options->budgetUs);
+}
+
+uint64_t watchdogTapDisabled(WatchdogReason reason, uint64_t now) {
+    if (gPending) return gReenableAt;
+    // Disabled again soon after coming back: whatever stalls the callback is
+    // still going on, so give it time before the next attempt
+    if (gEnabledAt && now - gEnabledAt < (uint64_t)gOptions.stableMs * 1000000) {
+        uint64_t minNs = (uint64_t)gOptions.backoffMinMs * 1000000;
+        uint64_t maxNs = (uint64_t)gOptions.backoffMaxMs * 1000000;
+        gBackoffNs = gBackoffNs ? gBackoffNs * 2 : minNs;
+        if (gBackoffNs > maxNs) gBackoffNs = maxNs;
+    } else {
+        gBackoffNs = 0;
+    }
+    gPending = true;
+    gReenableAt = now + gBackoffNs;
+    atomic_fetch_add(&gDisables, 1);
+    atomic_store(&gLastBackoffMs, gBackoffNs / 1000000);
+    statsCount(COUNTER_TAP_DISABLED);
+    LOG_WARN("Event tap disabled (%s); re-enabling in %llu ms",
+             (unsigned)reason < sizeof(kReasonNames) / sizeof(kReasonNames[0]) ? kReasonNames[reason] : "?",
+             (unsigned long long)(gBackoffNs / 1000000));
+    return gReenableAt;
+}
+
+void watchdogTapEnabled(uint64_t now) {
+    if (!gPending) return;
+    gPending = false;
+    gEnabledAt = now;
+    atomic_fetch_add(&gReenables, 1);
+    statsCount(COUNTER_TAP_REENABLED);
+    LOG_INFO("Event tap re-enabled");
+}
+
+bool watchdogTapPending(void) {
+    return gPending;
+}
+
+void watchdogRecordCallback(uint64_t ns) {
+    statsRecordPhase(PHASE_TAP_CALLBACK, ns);
+    uint32_t budgetUs = atomic_load_explicit(&gBudgetUs, memory_order_relaxed);
+    if (budgetUs && ns > (uint64_t)budgetUs * 1000) {
+        atomic_fetch_add_explicit(&gOverruns, 1, memory_order_relaxed);
+        statsCount(COUNTER_TAP_OVERRUNS);
+    }
+}
+
+void watchdogRecordAction(HotkeyActionType type, uint64_t ns) {
+    if ((unsigned)type >= ACTION_COUNT) return;
+    // Updated from the tap and the worker: compare-and-swap so no sample is lost
+    uint64_t old = atomic_load_explicit(&gPredictNs[type], memory_order_relaxed), updated;
+    do {
+        updated = old ? old - (old >> EWMA_SHIFT) + (ns >> EWMA_SHIFT) : ns;
+    } while (!atomic_compare_exchange_weak_explicit(&gPredictNs[type], &old, updated,
+                                                    memory_order_relaxed, memory_order_relaxed));
+}
+
+uint64_t watchdogPredictNs(HotkeyActionType type) {
+    return (unsigned)type < ACTION_COUNT ? atomic_load_explicit(&gPredictNs[type], memory_order_relaxed) : 0;
+}
+
+bool watchdogShouldDefer(HotkeyActionType type) {
+    uint32_t budgetUs = atomic_load_explicit(&gBudgetUs, memory_order_relaxed);
+    if (!budgetUs || !atomic_load_explicit(&gStarted, memory_order_acquire)) return false;
+    return atomic_load_explicit(&gOutstanding, memory_order_acquire) > 0 ||
+           watchdogPredictNs(type) > (uint64_t)budgetUs * 1000;
+}
+
+bool watchdogDefer(const WatchdogJob *job) {
+    pthread_mutex_lock(&gLock);
+    bool queued = gRunning && gTail - gHead < WATCHDOG_QUEUE_SIZE;
+    if (queued) {
+        gQueue[gTail++ & (WATCHDOG_QUEUE_SIZE - 1)] = *job;
+        atomic_fetch_add_explicit(&gOutstanding, 1, memory_order_release);
+        pthread_cond_signal(&gWake);
+    }
+    pthread_mutex_unlock(&gLock);
+    if (queued) {
+        atomic_fetch_add_explicit(&gDeferred, 1, memory_order_relaxed);
+        statsCount(COUNTER_DEFERRED);
+    } else {
+        atomic_fetch_add_explicit(&gInlineFull, 1, memory_order_relaxed);
+    }
+    return queued;
+}
+
+bool watchdogBusy(void) {
+    return atomic_load_explicit(&gOutstanding, memory_order_acquire) > 0;
+}
+
+uint64_t watchdogLastRunNs(void) {
+    return atomic_load_explicit(&gLastRunNs, memory_order_acquire);
+}
+
+static void *watchdogMain(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&gLock);
+    for (;;) {
+        while (gRunning && gHead == gTail) pthread_cond_wait(&gWake, &gLock);
+        if (gHead == gTail) break;   // stopped and drained
+        WatchdogJob job = gQueue[gHead++ & (WATCHDOG_QUEUE_SIZE - 1)];
+        pthread_mutex_unlock(&gLock);
+        gRun(&job);
+        atomic_store_explicit(&gLastRunNs, statsNowNs(), memory_order_release);
+        // Only now: the tap keeps queueing behind this job until it is done
+        atomic_fetch_sub_explicit(&gOutstanding, 1, memory_order_release);
+        pthread_mutex_lock(&gLock);
+    }
+    pthread_mutex_unlock(&gLock);
+    return NULL;
+}
+
+bool watchdogStart(void (*run)(const WatchdogJob *job)) {
+    pthread_mutex_lock(&gLock);
+    if (gRunning) {
+        pthread_mutex_unlock(&gLock);
+        return true;
+    }
+    gRun = run;
+    gHead = gTail = 0;
+    gRunning = true;
+    if (pthread_create(&gThread, NULL, watchdogMain, NULL) != 0) {
+        gRunning = false;
+        pthread_mutex_unlock(&gLock);
+        return false;
+    }
+    pthread_mutex_unlock(&gLock);
+    atomic_store_explicit(&gStarted, true, memory_order_release);
+    return true;
+}
+
+void watchdogStop(void) {
+    pthread_mutex_lock(&gLock);
+    if (!gRunning) {
+        pthread_mutex_unlock(&gLock);
+        return;
+    }
+    atomic_store_explicit(&gStarted, false, memory_order_release);
+    gRunning = false;
+    pthread_cond_signal(&gWake);
+    pthread_mutex_unlock(&gLock);
+    pthread_join(gThread, NULL);
+}
+
+WatchdogStats watchdogGetStats(void) {
+    return (WatchdogStats){
+        .disables = atomic_load(&gDisables),
+        .reenables = atomic_load(&gReenables),
+        .overruns = atomic_load(&gOverruns),
+        .deferred = atomic_load(&gDeferred),
+        .inlineFull = atomic_load(&gInlineFull),
+        .lastBackoffMs = atomic_load(&gLastBackoffMs),
+    };
+}
+
+void watchdogResetStats(void) {
+    atomic_store(&gDisables, 0);
+    atomic_store(&gReenables, 0);
+    atomic_store(&gOverruns, 0);
+    atomic_store(&gDeferred, 0);
+    atomic_store(&gInlineFull, 0);
+    atomic_store(&gLastBackoffMs, 0);
+}
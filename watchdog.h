@@ -0,0 +1,107 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "hotkeys.h"
+
+// Event tap watchdog, independent of the platform.
+//
+// The system disables an event tap whose callback is too slow (or on
+// certain user input) and tells it so with one last event. The watchdog
+// decides when to turn the tap back on: at once the first time, then with
+// exponential backoff while it keeps being disabled shortly after each
+// re-enable. The platform glue performs the re-enable and reports it.
+//
+// It also keeps the callback within a wall-time budget: every action's run
+// time feeds a per-action-type moving average, and an action whose average
+// exceeds the budget is queued for a worker thread instead of running in
+// the callback. Once something is queued, later actions follow it there so
+// they run in order.
+
+typedef struct {
+    uint32_t budgetUs;       // callback wall-time budget; 0 = none (nothing deferred)
+    uint32_t backoffMinMs;   // first delayed re-enable
+    uint32_t backoffMaxMs;   // backoff cap
+    uint32_t stableMs;       // enabled this long, the next disable re-enables at once
+} WatchdogOptions;
+
+#define WATCHDOG_DEFAULT_OPTIONS { .budgetUs = 10000, .backoffMinMs = 50, .backoffMaxMs = 5000, .stableMs = 10000 }
+
+typedef enum {
+    WATCHDOG_DISABLED_BY_TIMEOUT = 0,   // kCGEventTapDisabledByTimeout
+    WATCHDOG_DISABLED_BY_USER_INPUT,    // kCGEventTapDisabledByUserInput
+    WATCHDOG_FOUND_DISABLED,            // noticed by a health check, no event seen
+} WatchdogReason;
+
+// An action handed to the worker: everything the switcher needs to run it
+// later as if it came straight from the callback
+typedef struct {
+    HotkeyAction action;
+    uint16_t     keyCode;
+    uint64_t     flags;
+    uint64_t     eventTimeNs;    // event timestamp (0 = unknown)
+    uint64_t     timeNs;         // backend time of the key
+    uint64_t     startNs;        // statsNowNs() when dispatch started
+    uint64_t     dispatchNs;     // hotkey lookup time
+    bool         autorepeat;
+} WatchdogJob;
+
+#define WATCHDOG_QUEUE_SIZE 64   // power of two
+
+typedef struct {
+    uint64_t disables;           // disable notices acted on
+    uint64_t reenables;
+    uint64_t overruns;           // callbacks over budget
+    uint64_t deferred;           // actions run on the worker
+    uint64_t inlineFull;         // predicted overruns run inline: queue full
+    uint64_t lastBackoffMs;      // delay before the most recent re-enable
+} WatchdogStats;
+
+void watchdogConfigure(const WatchdogOptions *options);
+
+// Start the worker; `run` executes deferred jobs on it, one at a time, in
+// the order they were deferred. Until then nothing is deferred.
+bool watchdogStart(void (*run)(const WatchdogJob *job));
+// Run what is still queued, then stop the worker
+void watchdogStop(void);
+
+// --- Tap state (the tap's thread only) ------------------------------------------
+
+// The tap was disabled. Returns when to re-enable it (statsNowNs() time
+// base; <= now means at once). Repeated notices before the re-enable
+// return the same time.
+uint64_t watchdogTapDisabled(WatchdogReason reason, uint64_t now);
+// The tap was re-enabled at `now`
+void watchdogTapEnabled(uint64_t now);
+// A disable is being waited out
+bool watchdogTapPending(void);
+
+// --- Callback budget ---------------------------------------------------------------
+
+// Wall time of one key callback, from its first instruction, whether the
+// key was consumed or passed through (keys turned away by the fast reject
+// are not timed); counts an overrun above budget
+void watchdogRecordCallback(uint64_t ns);
+// Run time of an action, wherever it ran
+void watchdogRecordAction(HotkeyActionType type, uint64_t ns);
+// Predicted run time of an action type (moving average)
+uint64_t watchdogPredictNs(HotkeyActionType type);
+// True if an action of this type should not run in the callback: predicted
+// over budget, or earlier actions are still queued. Allocation- and
+// lock-free.
+bool watchdogShouldDefer(HotkeyActionType type);
+// Queue a job for the worker; false if the worker is not running or the
+// queue is full (the caller runs it inline then)
+bool watchdogDefer(const WatchdogJob *job);
+// Deferred work queued or running
+bool watchdogBusy(void);
+// statsNowNs() when the worker last finished a job (0 = never): a cursor
+// position captured before then may be out of date
+uint64_t watchdogLastRunNs(void);
+
+WatchdogStats watchdogGetStats(void);
+void watchdogResetStats(void);
+
+#endif // WATCHDOG_H